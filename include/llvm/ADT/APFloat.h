@@ -401,6 +401,9 @@ namespace llvm {
     void makeNaN(bool SNaN = false, bool Neg = false, const APInt *fill = 0);
     opStatus normalize(roundingMode, lostFraction);
     opStatus addOrSubtract(const APFloat &, roundingMode, bool subtract);
+    bool hostArithmetic(const APFloat &, roundingMode, char, opStatus &);
+    bool getHostValue(double &) const;
+    void setHostValue(double);
     cmpResult compareAbsoluteValue(const APFloat &) const;
     opStatus handleOverflow(roundingMode);
     bool roundAwayFromZero(roundingMode, lostFraction, unsigned int) const;
@@ -215,6 +215,30 @@ class APInt {
   /// out-of-line slow case for countPopulation
   unsigned countPopulationSlowCase() const;
 
+  /// out-of-line slow case for countTrailingZeros
+  unsigned countTrailingZerosSlowCase() const;
+
+  /// out-of-line slow case for udiv
+  APInt udivSlowCase(const APInt &RHS) const;
+
+  /// out-of-line slow case for urem
+  APInt uremSlowCase(const APInt &RHS) const;
+
+  /// out-of-line slow case for ult
+  bool ultSlowCase(const APInt &RHS) const;
+
+  /// out-of-line slow case for slt
+  bool sltSlowCase(const APInt &RHS) const;
+
+  /// out-of-line slow case for trunc
+  APInt truncSlowCase(unsigned width) const;
+
+  /// out-of-line slow case for sext
+  APInt sextSlowCase(unsigned width) const;
+
+  /// out-of-line slow case for zext
+  APInt zextSlowCase(unsigned width) const;
+
 public:
   /// @name Constructors
   /// @{
@@ -789,7 +813,14 @@ public:
   /// RHS are treated as unsigned quantities for purposes of this division.
   /// @returns a new APInt value containing the division result
   /// @brief Unsigned division operation.
-  APInt udiv(const APInt &RHS) const;
+  APInt udiv(const APInt &RHS) const {
+    assert(BitWidth == RHS.BitWidth && "Bit widths must be the same");
+    if (isSingleWord()) {
+      assert(RHS.VAL != 0 && "Divide by zero?");
+      return APInt(BitWidth, VAL / RHS.VAL);
+    }
+    return udivSlowCase(RHS);
+  }
 
   /// Signed divide this APInt by APInt RHS.
   /// @brief Signed division function for APInt.
@@ -811,7 +842,14 @@ public:
   /// which is *this.
   /// @returns a new APInt value containing the remainder result
   /// @brief Unsigned remainder operation.
-  APInt urem(const APInt &RHS) const;
+  APInt urem(const APInt &RHS) const {
+    assert(BitWidth == RHS.BitWidth && "Bit widths must be the same");
+    if (isSingleWord()) {
+      assert(RHS.VAL != 0 && "Remainder by zero?");
+      return APInt(BitWidth, VAL % RHS.VAL);
+    }
+    return uremSlowCase(RHS);
+  }
 
   /// Signed remainder operation on APInt.
   /// @brief Function for signed remainder operation.
@@ -931,28 +969,54 @@ public:
   /// the validity of the less-than relationship.
   /// @returns true if *this < RHS when both are considered unsigned.
   /// @brief Unsigned less than comparison
-  bool ult(const APInt &RHS) const;
+  bool ult(const APInt &RHS) const {
+    assert(BitWidth == RHS.BitWidth &&
+           "Bit widths must be same for comparison");
+    if (isSingleWord())
+      return VAL < RHS.VAL;
+    return ultSlowCase(RHS);
+  }
 
   /// Regards both *this as an unsigned quantity and compares it with RHS for
   /// the validity of the less-than relationship.
   /// @returns true if *this < RHS when considered unsigned.
   /// @brief Unsigned less than comparison
   bool ult(uint64_t RHS) const {
-    return ult(APInt(getBitWidth(), RHS));
+    // RHS is truncated to BitWidth, or zero extended if BitWidth is wider.
+    if (isSingleWord())
+      return VAL < (RHS & (~0ULL >> (APINT_BITS_PER_WORD - BitWidth)));
+    return getActiveBits() <= APINT_BITS_PER_WORD && pVal[0] < RHS;
   }
 
   /// Regards both *this and RHS as signed quantities and compares them for
   /// validity of the less-than relationship.
   /// @returns true if *this < RHS when both are considered signed.
   /// @brief Signed less than comparison
-  bool slt(const APInt& RHS) const;
+  bool slt(const APInt& RHS) const {
+    assert(BitWidth == RHS.BitWidth &&
+           "Bit widths must be same for comparison");
+    if (isSingleWord()) {
+      unsigned Shift = APINT_BITS_PER_WORD - BitWidth;
+      return (int64_t(VAL << Shift) >> Shift) <
+             (int64_t(RHS.VAL << Shift) >> Shift);
+    }
+    return sltSlowCase(RHS);
+  }
 
   /// Regards both *this as a signed quantity and compares it with RHS for
   /// the validity of the less-than relationship.
   /// @returns true if *this < RHS when considered signed.
   /// @brief Signed less than comparison
   bool slt(uint64_t RHS) const {
-    return slt(APInt(getBitWidth(), RHS));
+    // RHS is truncated to BitWidth, or zero extended if BitWidth is wider.
+    if (isSingleWord()) {
+      unsigned Shift = APINT_BITS_PER_WORD - BitWidth;
+      return (int64_t(VAL << Shift) >> Shift) <
+             (int64_t(RHS << Shift) >> Shift);
+    }
+    if (isNegative())
+      return true;
+    return getActiveBits() <= APINT_BITS_PER_WORD && pVal[0] < RHS;
   }
 
   /// Regards both *this and RHS as unsigned quantities and compares them for
@@ -1066,20 +1130,39 @@ public:
   /// Truncate the APInt to a specified width. It is an error to specify a width
   /// that is greater than or equal to the current width.
   /// @brief Truncate to new width.
-  APInt trunc(unsigned width) const;
+  APInt trunc(unsigned width) const {
+    assert(width < BitWidth && "Invalid APInt Truncate request");
+    assert(width && "Can't truncate to 0 bits");
+    if (width <= APINT_BITS_PER_WORD)
+      return APInt(width, isSingleWord() ? VAL : pVal[0]);
+    return truncSlowCase(width);
+  }
 
   /// This operation sign extends the APInt to a new width. If the high order
   /// bit is set, the fill on the left will be done with 1 bits, otherwise zero.
   /// It is an error to specify a width that is less than or equal to the
   /// current width.
   /// @brief Sign extend to a new width.
-  APInt sext(unsigned width) const;
+  APInt sext(unsigned width) const {
+    assert(width > BitWidth && "Invalid APInt SignExtend request");
+    if (width <= APINT_BITS_PER_WORD) {
+      unsigned Shift = APINT_BITS_PER_WORD - BitWidth;
+      return APInt(width, uint64_t(int64_t(VAL << Shift) >> Shift),
+                   /*isSigned=*/true);
+    }
+    return sextSlowCase(width);
+  }
 
   /// This operation zero extends the APInt to a new width. The high order bits
   /// are filled with 0 bits.  It is an error to specify a width that is less
   /// than or equal to the current width.
   /// @brief Zero extend to a new width.
-  APInt zext(unsigned width) const;
+  APInt zext(unsigned width) const {
+    assert(width > BitWidth && "Invalid APInt ZeroExtend request");
+    if (width <= APINT_BITS_PER_WORD)
+      return APInt(width, VAL);
+    return zextSlowCase(width);
+  }
 
   /// Make this APInt have the bit width given by \p width. The value is sign
   /// extended, truncated, or left alone to make it that width.
@@ -1264,7 +1347,13 @@ public:
   /// @returns the number of zeros from the least significant bit to the first
   /// one bit.
   /// @brief Count the number of trailing zero bits.
-  unsigned countTrailingZeros() const;
+  unsigned countTrailingZeros() const {
+    if (isSingleWord()) {
+      unsigned Count = CountTrailingZeros_64(VAL);
+      return Count > BitWidth ? BitWidth : Count;
+    }
+    return countTrailingZerosSlowCase();
+  }
 
   /// countTrailingOnes - This function is an APInt version of the
   /// countTrailingOnes_{32,64} functions in MathExtras.h. It counts
@@ -29,6 +29,10 @@ class BitVector {
 
   enum { BITWORD_SIZE = (unsigned)sizeof(BitWord) * CHAR_BIT };
 
+  // Number of words that bulk queries and count() handle between early exits
+  // or reductions.
+  enum { BLOCK_WORDS = 4 };
+
   BitWord  *Bits;        // Actual bits.
   unsigned Size;         // Size of bitvector in bits.
   unsigned Capacity;     // Size of allocated memory in BitWord.
@@ -117,14 +121,30 @@ public:
 
   /// count - Returns the number of bits which are set.
   unsigned count() const {
+    unsigned NumWords = NumBitWords(size());
     unsigned NumBits = 0;
-    for (unsigned i = 0; i < NumBitWords(size()); ++i)
-      if (sizeof(BitWord) == 4)
-        NumBits += CountPopulation_32((uint32_t)Bits[i]);
-      else if (sizeof(BitWord) == 8)
-        NumBits += CountPopulation_64(Bits[i]);
-      else
-        llvm_unreachable("Unsupported!");
+    unsigned i = 0;
+#if !defined(__POPCNT__)
+    // Without a population count instruction, add up the per-byte counts of
+    // a block of 64-bit words and fold them into a total once per block.
+    if (sizeof(BitWord) == 8)
+      for (; i + BLOCK_WORDS <= NumWords; i += BLOCK_WORDS) {
+        uint64_t ByteCounts = 0;
+        for (unsigned j = 0; j != BLOCK_WORDS; ++j) {
+          uint64_t V = Bits[i + j];
+          V -= (V >> 1) & 0x5555555555555555ULL;
+          V = (V & 0x3333333333333333ULL) + ((V >> 2) & 0x3333333333333333ULL);
+          ByteCounts += (V + (V >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        }
+        // A block can have 256 bits set, which doesn't fit in a byte; add
+        // the byte counts up in 16-bit fields instead.
+        uint64_t HalfCounts = (ByteCounts & 0x00FF00FF00FF00FFULL) +
+                              ((ByteCounts >> 8) & 0x00FF00FF00FF00FFULL);
+        NumBits += (unsigned)((HalfCounts * 0x0001000100010001ULL) >> 48);
+      }
+#endif
+    for (; i != NumWords; ++i)
+      NumBits += countPopulation(Bits[i]);
     return NumBits;
   }
 
@@ -138,8 +158,16 @@ public:
 
   /// all - Returns true if all bits are set.
   bool all() const {
-    // TODO: Optimize this.
-    return count() == size();
+    unsigned FullWords = Size / BITWORD_SIZE;
+    for (unsigned i = 0; i != FullWords; ++i)
+      if (Bits[i] != ~0UL)
+        return false;
+
+    // If bits remain check that they are ones. The unused bits are always zero.
+    if (unsigned Remainder = Size % BITWORD_SIZE)
+      return Bits[FullWords] == ~(~0UL << Remainder);
+
+    return true;
   }
 
   /// none - Returns true if none of the bits are set.
@@ -150,15 +178,7 @@ public:
   /// find_first - Returns the index of the first set bit, -1 if none
   /// of the bits are set.
   int find_first() const {
-    for (unsigned i = 0; i < NumBitWords(size()); ++i)
-      if (Bits[i] != 0) {
-        if (sizeof(BitWord) == 4)
-          return i * BITWORD_SIZE + CountTrailingZeros_32((uint32_t)Bits[i]);
-        if (sizeof(BitWord) == 8)
-          return i * BITWORD_SIZE + CountTrailingZeros_64(Bits[i]);
-        llvm_unreachable("Unsupported!");
-      }
-    return -1;
+    return find_first_from_word(0);
   }
 
   /// find_next - Returns the index of the next set bit following the
@@ -174,24 +194,11 @@ public:
     // Mask off previous bits.
     Copy &= ~0L << BitPos;
 
-    if (Copy != 0) {
-      if (sizeof(BitWord) == 4)
-        return WordPos * BITWORD_SIZE + CountTrailingZeros_32((uint32_t)Copy);
-      if (sizeof(BitWord) == 8)
-        return WordPos * BITWORD_SIZE + CountTrailingZeros_64(Copy);
-      llvm_unreachable("Unsupported!");
-    }
+    if (Copy != 0)
+      return WordPos * BITWORD_SIZE + countTrailingZeros(Copy);
 
     // Check subsequent words.
-    for (unsigned i = WordPos+1; i < NumBitWords(size()); ++i)
-      if (Bits[i] != 0) {
-        if (sizeof(BitWord) == 4)
-          return i * BITWORD_SIZE + CountTrailingZeros_32((uint32_t)Bits[i]);
-        if (sizeof(BitWord) == 8)
-          return i * BITWORD_SIZE + CountTrailingZeros_64(Bits[i]);
-        llvm_unreachable("Unsupported!");
-      }
-    return -1;
+    return find_first_from_word(WordPos + 1);
   }
 
   /// clear - Clear all bits.
@@ -279,7 +286,18 @@ public:
   bool anyCommon(const BitVector &RHS) const {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    for (unsigned i = 0, e = std::min(ThisWords, RHSWords); i != e; ++i)
+    unsigned e = std::min(ThisWords, RHSWords);
+    unsigned i = 0;
+    // Test a block of words at a time, so the inner loop has no early exit
+    // and can be unrolled or vectorized.
+    for (; i + BLOCK_WORDS <= e; i += BLOCK_WORDS) {
+      BitWord Common = 0;
+      for (unsigned j = 0; j != BLOCK_WORDS; ++j)
+        Common |= Bits[i + j] & RHS.Bits[i + j];
+      if (Common)
+        return true;
+    }
+    for (; i != e; ++i)
       if (Bits[i] & RHS.Bits[i])
         return true;
     return false;
@@ -289,8 +307,16 @@ public:
   bool operator==(const BitVector &RHS) const {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
+    unsigned e = std::min(ThisWords, RHSWords);
+    unsigned i = 0;
+    for (; i + BLOCK_WORDS <= e; i += BLOCK_WORDS) {
+      BitWord Diff = 0;
+      for (unsigned j = 0; j != BLOCK_WORDS; ++j)
+        Diff |= Bits[i + j] ^ RHS.Bits[i + j];
+      if (Diff)
+        return false;
+    }
+    for (; i != e; ++i)
       if (Bits[i] != RHS.Bits[i])
         return false;
 
@@ -315,8 +341,8 @@ public:
   BitVector &operator&=(const BitVector &RHS) {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
+    unsigned i, e = std::min(ThisWords, RHSWords);
+    for (i = 0; i != e; ++i)
       Bits[i] &= RHS.Bits[i];
 
     // Any bits that are just in this bitvector become zero, because they aren't
@@ -332,12 +358,27 @@ public:
   BitVector &reset(const BitVector &RHS) {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
+    for (unsigned i = 0, e = std::min(ThisWords, RHSWords); i != e; ++i)
       Bits[i] &= ~RHS.Bits[i];
     return *this;
   }
 
+  /// unionWith - Compute *this |= RHS, and return true if that set any bits
+  /// that were not already set. This is the update step of a dataflow fixpoint
+  /// iteration, without the copy and comparison that "|=" followed by "!="
+  /// would need.
+  bool unionWith(const BitVector &RHS) {
+    if (size() < RHS.size())
+      resize(RHS.size());
+    BitWord Changed = 0;
+    for (unsigned i = 0, e = NumBitWords(RHS.size()); i != e; ++i) {
+      BitWord Old = Bits[i], New = Old | RHS.Bits[i];
+      Changed |= New ^ Old;
+      Bits[i] = New;
+    }
+    return Changed != 0;
+  }
+
   BitVector &operator|=(const BitVector &RHS) {
     if (size() < RHS.size())
       resize(RHS.size());
@@ -437,6 +478,31 @@ public:
   }
 
 private:
+  static unsigned countPopulation(BitWord Word) {
+    if (sizeof(BitWord) == 4)
+      return CountPopulation_32((uint32_t)Word);
+    if (sizeof(BitWord) == 8)
+      return CountPopulation_64(Word);
+    llvm_unreachable("Unsupported!");
+  }
+
+  static unsigned countTrailingZeros(BitWord Word) {
+    if (sizeof(BitWord) == 4)
+      return CountTrailingZeros_32((uint32_t)Word);
+    if (sizeof(BitWord) == 8)
+      return CountTrailingZeros_64(Word);
+    llvm_unreachable("Unsupported!");
+  }
+
+  /// find_first_from_word - Returns the index of the first set bit in word
+  /// WordPos or later, -1 if there is none.
+  int find_first_from_word(unsigned WordPos) const {
+    for (unsigned i = WordPos, e = NumBitWords(size()); i < e; ++i)
+      if (Bits[i] != 0)
+        return i * BITWORD_SIZE + countTrailingZeros(Bits[i]);
+    return -1;
+  }
+
   unsigned NumBitWords(unsigned S) const {
     return (S + BITWORD_SIZE-1) / BITWORD_SIZE;
   }
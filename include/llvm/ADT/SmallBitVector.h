@@ -410,6 +410,22 @@ public:
     return *this;
   }
 
+  /// unionWith - Compute *this |= RHS, and return true if that set any bits
+  /// that were not already set.
+  bool unionWith(const SmallBitVector &RHS) {
+    resize(std::max(size(), RHS.size()));
+    if (isSmall()) {
+      uintptr_t Old = getSmallBits();
+      setSmallBits(Old | RHS.getSmallBits());
+      return getSmallBits() != Old;
+    }
+    if (!RHS.isSmall())
+      return getPointer()->unionWith(*RHS.getPointer());
+    SmallBitVector Copy = RHS;
+    Copy.resize(size());
+    return getPointer()->unionWith(*Copy.getPointer());
+  }
+
   SmallBitVector &operator^=(const SmallBitVector &RHS) {
     resize(std::max(size(), RHS.size()));
     if (isSmall())
@@ -17,11 +17,14 @@
 #include "llvm/BasicBlock.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/Support/BlockFrequency.h"
 #include "llvm/Support/BranchProbability.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include <vector>
 #include <string>
@@ -32,226 +35,351 @@ namespace llvm {
 class BlockFrequencyInfo;
 class MachineBlockFrequencyInfo;
 
-/// BlockFrequencyImpl implements block frequency algorithm for IR and
-/// Machine Instructions. Algorithm starts with value 1024 (START_FREQ)
-/// for the entry block and then propagates frequencies using branch weights
-/// from (Machine)BranchProbabilityInfo. LoopInfo is not required because
-/// algorithm can find "backedges" by itself.
-template<class BlockT, class FunctionT, class BlockProbInfoT>
-class BlockFrequencyImpl {
+namespace bfi {
 
-  DenseMap<const BlockT *, BlockFrequency> Freqs;
+/// ScaledMass - A non-negative number Digits * 2^Shift.  The frequency of a
+/// block is the product of the scales of all loops around it, which quickly
+/// outgrows any fixed-width integer; with an explicit exponent none of the
+/// arithmetic below can saturate.  Digits always has its top bit set unless
+/// the number is zero, and the arithmetic rounds towards zero.
+class ScaledMass {
+  uint64_t Digits;
+  int Shift;
 
-  BlockProbInfoT *BPI;
+  void normalize() {
+    if (!Digits) {
+      Shift = 0;
+      return;
+    }
+    unsigned LZ = CountLeadingZeros_64(Digits);
+    Digits <<= LZ;
+    Shift -= LZ;
+  }
 
-  FunctionT *Fn;
+public:
+  ScaledMass() : Digits(0), Shift(0) { }
+  explicit ScaledMass(uint64_t D, int S = 0) : Digits(D), Shift(S) {
+    normalize();
+  }
+  explicit ScaledMass(BranchProbability Prob)
+    : Digits((uint64_t(Prob.getNumerator()) << 32) / Prob.getDenominator()),
+      Shift(-32) {
+    normalize();
+  }
 
-  typedef GraphTraits< Inverse<BlockT *> > GT;
+  bool isZero() const { return !Digits; }
 
-  const uint32_t EntryFreq;
+  /// lg - Return floor(log2()) of a non-zero number.
+  int lg() const { return Shift + 63; }
 
-  std::string getBlockName(BasicBlock *BB) const {
-    return BB->getName().str();
+  bool operator<(const ScaledMass &RHS) const {
+    if (!Digits || !RHS.Digits)
+      return RHS.Digits;
+    if (Shift != RHS.Shift)
+      return Shift < RHS.Shift;
+    return Digits < RHS.Digits;
   }
 
-  std::string getBlockName(MachineBasicBlock *MBB) const {
-    std::string str;
-    raw_string_ostream ss(str);
-    ss << "BB#" << MBB->getNumber();
-
-    if (const BasicBlock *BB = MBB->getBasicBlock())
-      ss << " derived from LLVM BB " << BB->getName();
-
-    return ss.str();
+  ScaledMass &operator+=(const ScaledMass &RHS) {
+    if (!RHS.Digits)
+      return *this;
+    if (!Digits || Shift < RHS.Shift) {
+      ScaledMass Sum = RHS;
+      Sum += *this;
+      return *this = Sum;
+    }
+    unsigned Diff = Shift - RHS.Shift;
+    if (Diff >= 64)
+      return *this;
+    uint64_t Sum = Digits + (RHS.Digits >> Diff);
+    if (Sum < Digits) {
+      // Carry out of the top bit.
+      Sum = (Sum >> 1) | (UINT64_C(1) << 63);
+      ++Shift;
+    }
+    Digits = Sum;
+    return *this;
   }
 
-  void setBlockFreq(BlockT *BB, BlockFrequency Freq) {
-    Freqs[BB] = Freq;
-    DEBUG(dbgs() << "Frequency(" << getBlockName(BB) << ") = " << Freq << "\n");
+  ScaledMass &operator*=(const ScaledMass &RHS) {
+    if (!Digits || !RHS.Digits)
+      return *this = ScaledMass();
+    // Keep the high half of the 128-bit product.
+    uint64_t A1 = Digits >> 32, A0 = Digits & UINT32_MAX;
+    uint64_t B1 = RHS.Digits >> 32, B0 = RHS.Digits & UINT32_MAX;
+    uint64_t P01 = A0 * B1, P10 = A1 * B0;
+    uint64_t Mid = ((A0 * B0) >> 32) + (P01 & UINT32_MAX) + (P10 & UINT32_MAX);
+    uint64_t Hi = A1 * B1 + (P01 >> 32) + (P10 >> 32) + (Mid >> 32);
+    uint64_t Lo = (Mid << 32) | ((A0 * B0) & UINT32_MAX);
+    Shift += RHS.Shift + 64;
+    Digits = Hi;
+    if (!(Digits >> 63)) {
+      Digits = (Digits << 1) | (Lo >> 63);
+      --Shift;
+    }
+    return *this;
   }
 
-  /// getEdgeFreq - Return edge frequency based on SRC frequency and Src -> Dst
-  /// edge probability.
-  BlockFrequency getEdgeFreq(BlockT *Src, BlockT *Dst) const {
-    BranchProbability Prob = BPI->getEdgeProbability(Src, Dst);
-    return getBlockFreq(Src) * Prob;
+  ScaledMass &operator/=(const ScaledMass &RHS) {
+    assert(RHS.Digits && "Division by zero!");
+    if (!Digits)
+      return *this;
+    // Both operands are normalized, so the quotient of the digits lies in
+    // [1/2, 2) and 64 steps of long division produce it with 63 fraction bits.
+    uint64_t R = Digits, Q = 0;
+    bool Carry = false;
+    for (unsigned i = 0; i != 64; ++i) {
+      Q <<= 1;
+      if (Carry || R >= RHS.Digits) {
+        R -= RHS.Digits;
+        Q |= 1;
+      }
+      Carry = R >> 63;
+      R <<= 1;
+    }
+    Digits = Q;
+    Shift -= RHS.Shift + 63;
+    normalize();
+    return *this;
   }
 
-  /// incBlockFreq - Increase BB block frequency by FREQ.
-  ///
-  void incBlockFreq(BlockT *BB, BlockFrequency Freq) {
-    Freqs[BB] += Freq;
-    DEBUG(dbgs() << "Frequency(" << getBlockName(BB) << ") += " << Freq
-                 << " --> " << Freqs[BB] << "\n");
+  const ScaledMass operator*(const ScaledMass &RHS) const {
+    ScaledMass Product = *this;
+    return Product *= RHS;
   }
 
-  /// divBlockFreq - Divide BB block frequency by PROB. If Prob = 0 do nothing.
-  ///
-  void divBlockFreq(BlockT *BB, BranchProbability Prob) {
-    uint64_t N = Prob.getNumerator();
-    assert(N && "Illegal division by zero!");
-    uint64_t D = Prob.getDenominator();
-    uint64_t Freq = (Freqs[BB].getFrequency() * D) / N;
-
-    // Should we assert it?
-    if (Freq > UINT32_MAX)
-      Freq = UINT32_MAX;
-
-    Freqs[BB] = BlockFrequency(Freq);
-    DEBUG(dbgs() << "Frequency(" << getBlockName(BB) << ") /= (" << Prob
-                 << ") --> " << Freqs[BB] << "\n");
+  /// toInt - Return this * 2^Scale rounded to the nearest integer.  Values
+  /// that do not fit 64 bits are clamped; callers pick Scale so that this
+  /// does not happen.
+  uint64_t toInt(int Scale = 0) const {
+    if (!Digits)
+      return 0;
+    int S = Shift + Scale;
+    if (S >= 0)
+      return S > 0 ? UINT64_MAX : Digits;
+    if (S < -64)
+      return 0;
+    if (S == -64)
+      return Digits >> 63;
+    uint64_t Int = Digits >> -S;
+    bool RoundUp = (Digits >> (-S - 1)) & 1;
+    return Int + (RoundUp && Int != UINT64_MAX);
   }
+};
 
-  // All blocks in postorder.
-  std::vector<BlockT *> POT;
+} // End bfi namespace
 
-  // Map Block -> Position in reverse-postorder list.
-  DenseMap<BlockT *, unsigned> RPO;
+/// BlockFrequencyImpl implements block frequency algorithm for IR and
+/// Machine Instructions.  The entry block gets the value 1024 (ENTRY_FREQ),
+/// and frequencies are propagated using branch probabilities from
+/// (Machine)BranchProbabilityInfo and the loop nest from (Machine)LoopInfo.
+///
+/// Loops are processed bottom-up in a single pass.  Within a loop, a unit of
+/// mass starts at the header and flows along the forward edges in
+/// reverse-postorder; each inner loop has already been collapsed into a single
+/// node that passes the mass it receives on to its exits.  Mass that returns
+/// to the header determines how often the loop iterates; mass that exits the
+/// loop determines the distribution over its exits.  Finally the function
+/// itself is processed like a loop, and the frequencies are unwound top-down
+/// by multiplying local masses with the scales of the enclosing loops.  This
+/// costs time linear in the size of the CFG plus the loop nest, and all
+/// intermediate values are ScaledMass numbers that cannot saturate.
+///
+/// Edges that retreat to a block other than the header of the loop being
+/// processed come from irreducible control flow.  Their mass is treated as if
+/// it flowed back to the header of the innermost enclosing loop; at the
+/// function level it is dropped.
+template<class BlockT, class FunctionT, class BlockProbInfoT,
+         class LoopInfoT, class LoopT>
+class BlockFrequencyImpl {
+  typedef bfi::ScaledMass ScaledMass;
 
-  // Cycle Probability for each bloch.
-  DenseMap<BlockT *, uint32_t> CycleProb;
+  DenseMap<const BlockT *, BlockFrequency> Freqs;
 
-  // (reverse-)postorder traversal iterators.
-  typedef typename std::vector<BlockT *>::iterator pot_iterator;
-  typedef typename std::vector<BlockT *>::reverse_iterator rpot_iterator;
+  BlockProbInfoT *BPI;
 
-  pot_iterator pot_begin() { return POT.begin(); }
-  pot_iterator pot_end() { return POT.end(); }
+  LoopInfoT *LI;
 
-  rpot_iterator rpot_begin() { return POT.rbegin(); }
-  rpot_iterator rpot_end() { return POT.rend(); }
+  FunctionT *Fn;
 
-  rpot_iterator rpot_at(BlockT *BB) {
-    rpot_iterator I = rpot_begin();
-    unsigned idx = RPO[BB];
-    assert(idx);
-    std::advance(I, idx - 1);
+  typedef GraphTraits<BlockT *> GT;
 
-    assert(*I == BB);
-    return I;
-  }
+  /// EntryFreq - The frequency of the entry block.  This is ENTRY_FREQ unless
+  /// the loop nest is so deep that the hottest block would not fit 64 bits,
+  /// in which case all frequencies are scaled down together.
+  uint64_t EntryFreq;
 
+  /// InfiniteLoopScale - The number of iterations assumed for a loop that
+  /// has no way out.
+  static const unsigned InfiniteLoopScale = 4096;
 
-  /// isReachable - Returns if BB block is reachable from the entry.
-  ///
-  bool isReachable(BlockT *BB) {
-    return RPO.count(BB);
+  std::string getBlockName(BasicBlock *BB) const {
+    return BB->getName().str();
   }
 
-  /// isBackedge - Return if edge Src -> Dst is a backedge.
-  ///
-  bool isBackedge(BlockT *Src, BlockT *Dst) {
-    assert(isReachable(Src));
-    assert(isReachable(Dst));
+  std::string getBlockName(MachineBasicBlock *MBB) const {
+    std::string str;
+    raw_string_ostream ss(str);
+    ss << "BB#" << MBB->getNumber();
 
-    unsigned a = RPO[Src];
-    unsigned b = RPO[Dst];
+    if (const BasicBlock *BB = MBB->getBasicBlock())
+      ss << " derived from LLVM BB " << BB->getName();
 
-    return a >= b;
+    return ss.str();
   }
 
-  /// getSingleBlockPred - return single BB block predecessor or NULL if
-  /// BB has none or more predecessors.
-  BlockT *getSingleBlockPred(BlockT *BB) {
-    typename GT::ChildIteratorType
-      PI = GraphTraits< Inverse<BlockT *> >::child_begin(BB),
-      PE = GraphTraits< Inverse<BlockT *> >::child_end(BB);
-
-    if (PI == PE)
-      return 0;
-
-    BlockT *Pred = *PI;
-
-    ++PI;
-    if (PI != PE)
-      return 0;
-
-    return Pred;
+  /// getEdgeFreq - Return edge frequency based on SRC frequency and Src -> Dst
+  /// edge probability.
+  BlockFrequency getEdgeFreq(BlockT *Src, BlockT *Dst) const {
+    BranchProbability Prob = BPI->getEdgeProbability(Src, Dst);
+    return getBlockFreq(Src) * Prob;
   }
 
-  void doBlock(BlockT *BB, BlockT *LoopHead,
-               SmallPtrSet<BlockT *, 8> &BlocksInLoop) {
+  /// LoopData - What is known about a loop, or about the function when the
+  /// loop is null.
+  struct LoopData {
+    /// Nodes - The header followed by the blocks directly in the loop and the
+    /// headers of its immediate subloops, in reverse-postorder.
+    std::vector<BlockT *> Nodes;
+    /// Scale - Executions of the header per entry into the loop.
+    ScaledMass Scale;
+    /// EntryMass - Entries into the loop per execution of the header of the
+    /// parent loop.
+    ScaledMass EntryMass;
+    /// Exits - The fraction of entries that leave through each exit block.
+    SmallVector<std::pair<BlockT *, ScaledMass>, 4> Exits;
+    /// Terminated - The fraction of entries that never leave, because they
+    /// return from the function or get stuck in an infinite inner loop.
+    ScaledMass Terminated;
+    /// HeaderFreq - Executions of the header per execution of the function.
+    ScaledMass HeaderFreq;
+  };
+
+  DenseMap<const LoopT *, LoopData> Loops;
+
+  /// Mass - The mass of each block relative to one execution of the header
+  /// of its innermost loop.
+  DenseMap<const BlockT *, ScaledMass> Mass;
+
+  /// RPO - The position of each reachable block in reverse-postorder.
+  DenseMap<const BlockT *, unsigned> RPO;
+
+  /// LoopState - Mass accounting while one loop is being processed.
+  struct LoopState {
+    const LoopT *L;
+    BlockT *Header;
+    /// Terminated - Mass that returns from the function or gets stuck.
+    ScaledMass Terminated;
+    SmallVector<std::pair<BlockT *, ScaledMass>, 4> Exits;
+  };
+
+  void addLoopsPostorder(const LoopT *L, std::vector<const LoopT *> &Order) {
+    for (typename LoopT::iterator I = L->begin(), E = L->end(); I != E; ++I)
+      addLoopsPostorder(*I, Order);
+    Order.push_back(L);
+  }
 
-    DEBUG(dbgs() << "doBlock(" << getBlockName(BB) << ")\n");
-    setBlockFreq(BB, 0);
+  /// distribute - Send mass M from the node From to the block To.
+  void distribute(LoopState &S, BlockT *From, BlockT *To, ScaledMass M) {
+    if (M.isZero())
+      return;
+    // Mass that flows back to the header is implied by the mass that leaves.
+    if (To == S.Header)
+      return;
 
-    if (BB == LoopHead) {
-      setBlockFreq(BB, EntryFreq);
+    const LoopT *ToLoop = LI->getLoopFor(To);
+    if (S.L && !S.L->contains(ToLoop)) {
+      typename SmallVectorImpl<std::pair<BlockT *, ScaledMass> >::iterator
+        I = S.Exits.begin(), E = S.Exits.end();
+      while (I != E && I->first != To)
+        ++I;
+      if (I == E)
+        S.Exits.push_back(std::make_pair(To, M));
+      else
+        I->second += M;
       return;
     }
 
-    if(BlockT *Pred = getSingleBlockPred(BB)) {
-      if (BlocksInLoop.count(Pred))
-        setBlockFreq(BB, getEdgeFreq(Pred, BB));
-      // TODO: else? irreducible, ignore it for now.
+    // Anything but a forward edge to a node of this loop is irreducible.
+    bool IsNode = ToLoop == S.L ||
+      (ToLoop->getHeader() == To && ToLoop->getParentLoop() == S.L);
+    if (!IsNode || RPO.lookup(To) <= RPO.lookup(From)) {
+      DEBUG(dbgs() << "  irreducible edge " << getBlockName(From) << " -> "
+                   << getBlockName(To) << "\n");
       return;
     }
 
-    bool isInLoop = false;
-    bool isLoopHead = false;
+    if (ToLoop == S.L)
+      Mass[To] += M;
+    else
+      Loops[ToLoop].EntryMass += M;
+  }
 
-    for (typename GT::ChildIteratorType
-         PI = GraphTraits< Inverse<BlockT *> >::child_begin(BB),
-         PE = GraphTraits< Inverse<BlockT *> >::child_end(BB);
-         PI != PE; ++PI) {
-      BlockT *Pred = *PI;
+  /// doLoop - Compute the masses of the nodes of L relative to its header,
+  /// and how often L iterates and where it exits per entry.
+  void doLoop(const LoopT *L) {
+    LoopData &D = Loops[L];
+    LoopState S;
+    S.L = L;
+    S.Header = D.Nodes.front();
+    Mass[S.Header] = ScaledMass(1);
+    // A machine function may start with a loop.
+    if (!L)
+      if (const LoopT *EntryLoop = LI->getLoopFor(S.Header))
+        Loops[EntryLoop].EntryMass = ScaledMass(1);
+
+    for (typename std::vector<BlockT *>::iterator I = D.Nodes.begin(),
+         E = D.Nodes.end(); I != E; ++I) {
+      BlockT *BB = *I;
+      const LoopT *Inner = LI->getLoopFor(BB);
+
+      if (Inner != L) {
+        // A collapsed subloop passes its mass on to its exits.
+        const LoopData &ID = Loops[Inner];
+        ScaledMass M = ID.EntryMass;
+        S.Terminated += M * ID.Terminated;
+        for (unsigned i = 0, e = ID.Exits.size(); i != e; ++i)
+          distribute(S, BB, ID.Exits[i].first, M * ID.Exits[i].second);
+        continue;
+      }
 
-      if (isReachable(Pred) && isBackedge(Pred, BB)) {
-        isLoopHead = true;
-      } else if (BlocksInLoop.count(Pred)) {
-        incBlockFreq(BB, getEdgeFreq(Pred, BB));
-        isInLoop = true;
+      ScaledMass M = Mass[BB];
+      SmallPtrSet<BlockT *, 8> Seen;
+      for (typename GT::ChildIteratorType SI = GT::child_begin(BB),
+           SE = GT::child_end(BB); SI != SE; ++SI) {
+        BlockT *Succ = *SI;
+        if (!Seen.insert(Succ))
+          continue;
+        distribute(S, BB, Succ,
+                   M * ScaledMass(BPI->getEdgeProbability(BB, Succ)));
       }
-      // TODO: else? irreducible.
+      if (Seen.empty())
+        S.Terminated += M;
     }
 
-    if (!isInLoop)
-      return;
-
-    if (!isLoopHead)
+    if (!L) {
+      D.Scale = ScaledMass(1);
       return;
+    }
 
-    assert(EntryFreq >= CycleProb[BB]);
-    uint32_t CProb = CycleProb[BB];
-    uint32_t Numerator = EntryFreq - CProb ? EntryFreq - CProb : 1;
-    divBlockFreq(BB, BranchProbability(Numerator, EntryFreq));
-  }
-
-  /// doLoop - Propagate block frequency down through the loop.
-  void doLoop(BlockT *Head, BlockT *Tail) {
-    DEBUG(dbgs() << "doLoop(" << getBlockName(Head) << ", "
-                 << getBlockName(Tail) << ")\n");
-
-    SmallPtrSet<BlockT *, 8> BlocksInLoop;
-
-    for (rpot_iterator I = rpot_at(Head), E = rpot_at(Tail); ; ++I) {
-      BlockT *BB = *I;
-      doBlock(BB, Head, BlocksInLoop);
+    ScaledMass Leaving = S.Terminated;
+    for (unsigned i = 0, e = S.Exits.size(); i != e; ++i)
+      Leaving += S.Exits[i].second;
 
-      BlocksInLoop.insert(BB);
-      if (I == E)
-        break;
+    if (Leaving.isZero()) {
+      DEBUG(dbgs() << "  infinite loop at " << getBlockName(S.Header) << "\n");
+      D.Scale = ScaledMass(InfiniteLoopScale);
+      D.Terminated = ScaledMass(1);
+      return;
     }
 
-    // Compute loop's cyclic probability using backedges probabilities.
-    for (typename GT::ChildIteratorType
-         PI = GraphTraits< Inverse<BlockT *> >::child_begin(Head),
-         PE = GraphTraits< Inverse<BlockT *> >::child_end(Head);
-         PI != PE; ++PI) {
-      BlockT *Pred = *PI;
-      assert(Pred);
-      if (isReachable(Pred) && isBackedge(Pred, Head)) {
-        uint64_t N = getEdgeFreq(Pred, Head).getFrequency();
-        uint64_t D = getBlockFreq(Head).getFrequency();
-        assert(N <= EntryFreq && "Backedge frequency must be <= EntryFreq!");
-        uint64_t Res = (N * EntryFreq) / D;
-
-        assert(Res <= UINT32_MAX);
-        CycleProb[Head] += (uint32_t) Res;
-        DEBUG(dbgs() << "  CycleProb[" << getBlockName(Head) << "] += " << Res
-                     << " --> " << CycleProb[Head] << "\n");
-      }
-    }
+    // Every entry executes the header until the leaving mass adds up to one.
+    D.Scale = ScaledMass(1);
+    D.Scale /= Leaving;
+    for (unsigned i = 0, e = S.Exits.size(); i != e; ++i)
+      D.Exits.push_back(std::make_pair(S.Exits[i].first,
+                                       S.Exits[i].second * D.Scale));
+    D.Terminated = S.Terminated * D.Scale;
   }
 
   friend class BlockFrequencyInfo;
@@ -259,51 +387,79 @@ class BlockFrequencyImpl {
 
   BlockFrequencyImpl() : EntryFreq(BlockFrequency::getEntryFrequency()) { }
 
-  void doFunction(FunctionT *fn, BlockProbInfoT *bpi) {
+  void doFunction(FunctionT *fn, BlockProbInfoT *bpi, LoopInfoT *li) {
     Fn = fn;
     BPI = bpi;
+    LI = li;
 
     // Clear everything.
-    RPO.clear();
-    POT.clear();
-    CycleProb.clear();
     Freqs.clear();
+    Loops.clear();
+    Mass.clear();
+    RPO.clear();
 
+    // Number the reachable blocks in reverse-postorder, and hand each one to
+    // its innermost loop; a loop header also stands for its loop in the
+    // parent.  Walking in reverse-postorder leaves every node list sorted.
     BlockT *EntryBlock = fn->begin();
-
+    std::vector<BlockT *> POT;
     copy(po_begin(EntryBlock), po_end(EntryBlock), back_inserter(POT));
 
+    std::vector<const LoopT *> Order;
+    for (typename LoopInfoT::iterator I = LI->begin(), E = LI->end();
+         I != E; ++I)
+      addLoopsPostorder(*I, Order);
+    Order.push_back(0);
+    for (unsigned i = 0, e = Order.size(); i != e; ++i)
+      Loops[Order[i]];
+
     unsigned RPOidx = 0;
-    for (rpot_iterator I = rpot_begin(), E = rpot_end(); I != E; ++I) {
+    for (typename std::vector<BlockT *>::reverse_iterator I = POT.rbegin(),
+         E = POT.rend(); I != E; ++I) {
       BlockT *BB = *I;
       RPO[BB] = ++RPOidx;
-      DEBUG(dbgs() << "RPO[" << getBlockName(BB) << "] = " << RPO[BB] << "\n");
+      const LoopT *L = LI->getLoopFor(BB);
+      if (L && L->getHeader() == BB)
+        Loops[L->getParentLoop()].Nodes.push_back(BB);
+      Loops[L].Nodes.push_back(BB);
     }
 
-    // Travel over all blocks in postorder.
-    for (pot_iterator I = pot_begin(), E = pot_end(); I != E; ++I) {
-      BlockT *BB = *I;
-      BlockT *LastTail = 0;
-      DEBUG(dbgs() << "POT: " << getBlockName(BB) << "\n");
-
-      for (typename GT::ChildIteratorType
-           PI = GraphTraits< Inverse<BlockT *> >::child_begin(BB),
-           PE = GraphTraits< Inverse<BlockT *> >::child_end(BB);
-           PI != PE; ++PI) {
-
-        BlockT *Pred = *PI;
-        if (isReachable(Pred) && isBackedge(Pred, BB)
-            && (!LastTail || RPO[Pred] > RPO[LastTail]))
-          LastTail = Pred;
-      }
+    // Bottom-up: collapse each loop before its parent looks at it.
+    for (unsigned i = 0, e = Order.size(); i != e; ++i)
+      doLoop(Order[i]);
+
+    // Top-down: scale the local masses by the frequency of their header.
+    Loops[0].HeaderFreq = ScaledMass(1);
+    for (unsigned i = Order.size() - 1; i-- != 0; ) {
+      const LoopT *L = Order[i];
+      LoopData &D = Loops[L];
+      D.HeaderFreq = D.EntryMass * Loops[L->getParentLoop()].HeaderFreq *
+                     D.Scale;
+    }
 
-      if (LastTail)
-        doLoop(BB, LastTail);
+    ScaledMass Entry(BlockFrequency::getEntryFrequency());
+    ScaledMass Max = Entry;
+    for (typename std::vector<BlockT *>::iterator I = POT.begin(),
+         E = POT.end(); I != E; ++I) {
+      ScaledMass &M = Mass[*I];
+      M = M * Loops[LI->getLoopFor(*I)].HeaderFreq * Entry;
+      if (Max < M)
+        Max = M;
     }
 
-    // At the end assume the whole function as a loop, and travel over it once
-    // again.
-    doLoop(*(rpot_begin()), *(pot_begin()));
+    // Make room for the hottest block if it would not fit 64 bits.
+    int Scale = Max.lg() > 62 ? 62 - Max.lg() : 0;
+    EntryFreq = Entry.toInt(Scale);
+    for (typename std::vector<BlockT *>::iterator I = POT.begin(),
+         E = POT.end(); I != E; ++I) {
+      // Reachable blocks never end up with a frequency of zero.
+      uint64_t Freq = Mass[*I].toInt(Scale);
+      setBlockFreq(*I, Freq ? Freq : 1);
+    }
+
+    Loops.clear();
+    Mass.clear();
+    RPO.clear();
   }
 
 public:
@@ -316,6 +472,23 @@ public:
     return 0;
   }
 
+  /// getEntryFreq - Return the frequency of the entry block.
+  uint64_t getEntryFreq() const { return EntryFreq; }
+
+  /// setBlockFreq - Set the frequency of BB.  Transformations that split or
+  /// merge blocks use this to keep the analysis current instead of
+  /// recomputing it.
+  void setBlockFreq(const BlockT *BB, BlockFrequency Freq) {
+    Freqs[BB] = Freq;
+    DEBUG(dbgs() << "Frequency(" << getBlockName(const_cast<BlockT *>(BB))
+                 << ") = " << Freq << "\n");
+  }
+
+  /// eraseBlock - Forget the frequency of BB, which is being deleted.
+  void eraseBlock(const BlockT *BB) {
+    Freqs.erase(BB);
+  }
+
   void print(raw_ostream &OS) const {
     OS << "\n\n---- Block Freqs ----\n";
     for (typename FunctionT::iterator I = Fn->begin(), E = Fn->end(); I != E;) {
@@ -21,14 +21,18 @@
 namespace llvm {
 
 class BranchProbabilityInfo;
-template<class BlockT, class FunctionT, class BranchProbInfoT>
+class Loop;
+class LoopInfo;
+template<class BlockT, class FunctionT, class BranchProbInfoT,
+         class LoopInfoT, class LoopT>
 class BlockFrequencyImpl;
 
 /// BlockFrequencyInfo pass uses BlockFrequencyImpl implementation to estimate
 /// IR basic block frequencies.
 class BlockFrequencyInfo : public FunctionPass {
 
-  BlockFrequencyImpl<BasicBlock, Function, BranchProbabilityInfo> *BFI;
+  BlockFrequencyImpl<BasicBlock, Function, BranchProbabilityInfo, LoopInfo,
+                     Loop> *BFI;
 
 public:
   static char ID;
@@ -48,6 +52,19 @@ public:
   /// the other block frequencies. We do this to avoid using of floating points.
   ///
   BlockFrequency getBlockFreq(const BasicBlock *BB) const;
+
+  /// getEntryFreq - Return the frequency of the entry block.  This is 1024
+  /// unless the loop nest is so deep that all frequencies had to be scaled
+  /// down to fit.
+  uint64_t getEntryFreq() const;
+
+  /// setBlockFreq - Update the frequency of BB after a change to the CFG.
+  /// A block split off BB has the frequency of BB, and a block inserted on
+  /// an edge has the frequency of the edge.
+  void setBlockFreq(const BasicBlock *BB, BlockFrequency Freq);
+
+  /// eraseBlock - Forget the frequency of BB, which is being deleted.
+  void eraseBlock(const BasicBlock *BB);
 };
 
 }
@@ -8,19 +8,15 @@
 //===----------------------------------------------------------------------===//
 //
 // LoopDependenceAnalysis is an LLVM pass that analyses dependences in memory
-// accesses in loops.
-//
-// Please note that this is work in progress and the interface is subject to
-// change.
-//
-// TODO: adapt as interface progresses
+// accesses in loops.  For each pair of accesses it reports whether they may
+// touch the same location and, if so, the direction and, where it is
+// constant, the distance of the dependence at each level of the loop nest.
 //
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_ANALYSIS_LOOP_DEPENDENCE_ANALYSIS_H
 #define LLVM_ANALYSIS_LOOP_DEPENDENCE_ANALYSIS_H
 
-#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -30,36 +26,70 @@ namespace llvm {
 
 class AliasAnalysis;
 class AnalysisUsage;
+class LoopInfo;
 class ScalarEvolution;
 class SCEV;
 class Value;
 class raw_ostream;
 
 class LoopDependenceAnalysis : public LoopPass {
+public:
+  /// Direction - The possible relations between the iteration of the first
+  /// access (the source) and the iteration of the second access (the
+  /// destination) of a dependence at one loop level, as a set of bits.
+  enum Direction {
+    DirNone = 0,
+    DirLT = 1,  ///< The source iteration precedes the destination iteration.
+    DirEQ = 2,
+    DirGT = 4,
+    DirLE = DirLT | DirEQ,
+    DirNE = DirLT | DirGT,
+    DirGE = DirEQ | DirGT,
+    DirAll = DirLT | DirEQ | DirGT
+  };
+
+  /// DependenceLevel - What is known about a dependence at one level of the
+  /// loops that contain both accesses.
+  struct DependenceLevel {
+    const Loop *L;
+    unsigned Direction;
+    /// Distance - The destination iteration minus the source iteration, if
+    /// it is the same for all dependent iteration pairs, or null.
+    const SCEV *Distance;
+
+    DependenceLevel(const Loop *l)
+      : L(l), Direction(DirAll), Distance(0) {}
+  };
+
+private:
   AliasAnalysis *AA;
   ScalarEvolution *SE;
+  LoopInfo *LI;
 
   /// L - The loop we are currently analysing.
   Loop *L;
 
-  /// TODO: doc
   enum DependenceResult { Independent = 0, Dependent = 1, Unknown = 2 };
 
-  /// TODO: doc
-  struct Subscript {
-    /// TODO: Add distance, direction, breaking conditions, ...
-  };
-
   /// DependencePair - Represents a data dependence relation between to memory
   /// reference instructions.
   struct DependencePair : public FastFoldingSetNode {
     Value *A;
     Value *B;
     DependenceResult Result;
-    SmallVector<Subscript, 4> Subscripts;
+    /// Levels - One entry per loop containing both A and B, outermost first.
+    SmallVector<DependenceLevel, 4> Levels;
 
     DependencePair(const FoldingSetNodeID &ID, Value *a, Value *b) :
-        FastFoldingSetNode(ID), A(a), B(b), Result(Unknown), Subscripts() {}
+        FastFoldingSetNode(ID), A(a), B(b), Result(Unknown), Levels() {}
+  };
+
+  /// LinearSubscript - A subscript in the form Const + sum(Coeffs[k] * I[k]),
+  /// where I[k] numbers the iterations of the loop at Levels[k] of the pair
+  /// being analysed.
+  struct LinearSubscript {
+    const SCEV *Const;
+    SmallVector<int64_t, 4> Coeffs;
   };
 
   /// findOrInsertDependencePair - Return true if a DependencePair for the
@@ -67,26 +97,23 @@ class LoopDependenceAnalysis : public LoopPass {
   /// created. The third argument is set to the pair found or created.
   bool findOrInsertDependencePair(Value*, Value*, DependencePair*&);
 
-  /// getLoops - Collect all loops of the loop nest L in which
-  /// a given SCEV is variant.
-  void getLoops(const SCEV*, DenseSet<const Loop*>*) const;
-
-  /// isLoopInvariant - True if a given SCEV is invariant in all loops of the
-  /// loop nest starting at the innermost loop L.
-  bool isLoopInvariant(const SCEV*) const;
-
-  /// isAffine - An SCEV is affine with respect to the loop nest starting at
-  /// the innermost loop L if it is of the form A+B*X where A, B are invariant
-  /// in the loop nest and X is a induction variable in the loop nest.
-  bool isAffine(const SCEV*) const;
-
-  /// TODO: doc
-  bool isZIVPair(const SCEV*, const SCEV*) const;
-  bool isSIVPair(const SCEV*, const SCEV*) const;
-  DependenceResult analyseZIV(const SCEV*, const SCEV*, Subscript*) const;
-  DependenceResult analyseSIV(const SCEV*, const SCEV*, Subscript*) const;
-  DependenceResult analyseMIV(const SCEV*, const SCEV*, Subscript*) const;
-  DependenceResult analyseSubscript(const SCEV*, const SCEV*, Subscript*) const;
+  /// getLinearSubscript - Express a subscript in terms of the iterations of
+  /// the loops in Levels.  Return false if it is not affine in those loops
+  /// or has a coefficient that is not a small constant.
+  bool getLinearSubscript(const SCEV*, const SmallVectorImpl<DependenceLevel>&,
+                          LinearSubscript&) const;
+
+  /// getMaxIteration - Return true and set the last argument to an upper
+  /// bound on the iteration number of the loop, if one is known.
+  bool getMaxIteration(const Loop*, int64_t&) const;
+
+  DependenceResult analyseZIV(const SCEV*) const;
+  DependenceResult analyseSIV(int64_t, int64_t, const SCEV*,
+                              DependenceLevel*) const;
+  DependenceResult analyseMIV(const LinearSubscript&, const LinearSubscript&,
+                              int64_t, SmallVectorImpl<DependenceLevel>&) const;
+  DependenceResult analyseSubscript(const SCEV*, const SCEV*,
+                                    SmallVectorImpl<DependenceLevel>&) const;
   DependenceResult analysePair(DependencePair*) const;
 
 public:
@@ -104,6 +131,13 @@ public:
   /// between two instructions.
   bool depends(Value*, Value*);
 
+  /// depends - Return a boolean indicating if there is a data dependence
+  /// between two instructions and, if there is, describe it per level of
+  /// the loops that contain both, outermost first.  The first instruction is
+  /// the source of the dependence.  Levels nothing could be proven about are
+  /// reported as DirAll without a distance.
+  bool depends(Value*, Value*, SmallVectorImpl<DependenceLevel>&);
+
   bool runOnLoop(Loop*, LPPassManager&);
   virtual void releaseMemory();
   virtual void getAnalysisUsage(AnalysisUsage&) const;
@@ -72,6 +72,14 @@ public:
   /// its containing function.
   bool hasStructRetAttr() const;
 
+  /// hasNonNullAttr - Return true if this argument has the nonnull attribute
+  /// on it in its containing function.
+  bool hasNonNullAttr() const;
+
+  /// onlyReadsMemory - Return true if the containing function does not write
+  /// through this argument, i.e. it has the readonly or readnone attribute.
+  bool onlyReadsMemory() const;
+
   /// addAttr - Add a Attribute to an argument
   void addAttr(Attributes);
   
@@ -139,6 +139,7 @@ DECLARE_LLVM_ATTRIBUTE(NonLazyBind,1U<<31) ///< Function is called early and/or
                                             /// often, so lazy binding isn't
                                             /// worthwhile.
 DECLARE_LLVM_ATTRIBUTE(AddressSafety,1ULL<<32) ///< Address safety checking is on.
+DECLARE_LLVM_ATTRIBUTE(NonNull,1ULL<<33) ///< Pointer is never null
 
 #undef DECLARE_LLVM_ATTRIBUTE
 
@@ -160,12 +161,16 @@ const AttrConst ParameterOnly = {ByVal_i | Nest_i |
 
 /// @brief Attributes that may be applied to the function itself.  These cannot
 /// be used on return values or function parameters.
-const AttrConst FunctionOnly = {NoReturn_i | NoUnwind_i | ReadNone_i |
-  ReadOnly_i | NoInline_i | AlwaysInline_i | OptimizeForSize_i |
+const AttrConst FunctionOnly = {NoReturn_i | NoUnwind_i | NoInline_i |
+  AlwaysInline_i | OptimizeForSize_i |
   StackProtect_i | StackProtectReq_i | NoRedZone_i | NoImplicitFloat_i |
   Naked_i | InlineHint_i | StackAlignment_i |
   UWTable_i | NonLazyBind_i | ReturnsTwice_i | AddressSafety_i};
 
+/// @brief Attributes that may be applied to the function itself or to a
+/// pointer parameter, but not to a return value.
+const AttrConst FunctionOrParameter = {ReadNone_i | ReadOnly_i};
+
 /// @brief Parameter attributes that do not apply to vararg call arguments.
 const AttrConst VarArgsIncompatible = {StructRet_i};
 
@@ -243,7 +248,7 @@ inline uint64_t encodeLLVMAttributesForBitcode(Attributes Attrs) {
   if (Attrs & Attribute::Alignment)
     EncodedAttrs |= (1ull << 16) <<
       (((Attrs & Attribute::Alignment).Raw()-1) >> 16);
-  EncodedAttrs |= (Attrs.Raw() & (0xfffull << 21)) << 11;
+  EncodedAttrs |= (Attrs.Raw() & (0x1fffull << 21)) << 11;
 
   return EncodedAttrs;
 }
@@ -262,7 +267,7 @@ inline Attributes decodeLLVMAttributesForBitcode(uint64_t EncodedAttrs) {
   Attributes Attrs(EncodedAttrs & 0xffff);
   if (Alignment)
     Attrs |= Attribute::constructAlignmentFromInt(Alignment);
-  Attrs |= Attributes((EncodedAttrs & (0xfffull << 32)) >> 11);
+  Attrs |= Attributes((EncodedAttrs & (0x1fffull << 32)) >> 11);
 
   return Attrs;
 }
@@ -63,6 +63,12 @@ namespace llvm {
   /// should be in "binary" mode.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out);
 
+  /// WriteCompressedBitcodeToFile - Write the specified module to the
+  /// specified raw output stream as a compressed bitcode container (see
+  /// isCompressedBitcode).  The readers accept such files wherever they accept
+  /// bitcode, and only decompress the function bodies they materialize.
+  void WriteCompressedBitcodeToFile(const Module *M, raw_ostream &Out);
+
   /// createBitcodeWriterPass - Create and return a pass that writes the module
   /// to the specified ostream.
   ModulePass *createBitcodeWriterPass(raw_ostream &Str);
@@ -96,13 +102,42 @@ namespace llvm {
            BufPtr[3] == 0xde;
   }
 
+  /// isCompressedBitcode - Return true if the given bytes are the magic bytes
+  /// of a compressed bitcode container.  The container splits a bitcode file
+  /// into chunks, each stored as is or compressed with lz77::compress against
+  /// a common dictionary, so that a lazy reader only decompresses the function
+  /// bodies it materializes:
+  ///
+  /// struct bc_compressed_header {
+  ///   uint32_t Magic;                 // 'B', 'C', 'Z', 0x01
+  ///   uint32_t BitcodeSize;           // Size of the uncompressed bitcode.
+  ///   uint32_t NumChunks;
+  ///   uint32_t DictionarySize;
+  ///   uint32_t DictionaryStoredSize;
+  ///   uleb128 Chunks[NumChunks][2];   // Size and stored size of each chunk.
+  ///   ... dictionary, compressed without a dictionary ...
+  ///   ... chunk contents, in order ...
+  /// };
+  ///
+  /// The dictionary and the chunks are stored uncompressed if their stored
+  /// size equals their size.  All fixed-size fields are little-endian.
+  inline bool isCompressedBitcode(const unsigned char *BufPtr,
+                                  const unsigned char *BufEnd) {
+    return BufEnd - BufPtr >= 4 &&
+           BufPtr[0] == 'B' &&
+           BufPtr[1] == 'C' &&
+           BufPtr[2] == 'Z' &&
+           BufPtr[3] == 0x01;
+  }
+
   /// isBitcode - Return true if the given bytes are the magic bytes for
-  /// LLVM IR bitcode, either with or without a wrapper.
+  /// LLVM IR bitcode, either with or without a wrapper, or compressed.
   ///
   inline bool isBitcode(const unsigned char *BufPtr,
                         const unsigned char *BufEnd) {
     return isBitcodeWrapper(BufPtr, BufEnd) ||
-           isRawBitcode(BufPtr, BufEnd);
+           isRawBitcode(BufPtr, BufEnd) ||
+           isCompressedBitcode(BufPtr, BufEnd);
   }
 
   /// SkipBitcodeWrapperHeader - Some systems wrap bc files with a special
@@ -82,6 +82,15 @@ public:
   /// ByValArgFrameIndexMap - Keep track of frame indices for byval arguments.
   DenseMap<const Argument*, int> ByValArgFrameIndexMap;
 
+  /// StatepointSlots - The frame indices of the spill slots through which the
+  /// GC pointers of each llvm.gc.statepoint are relocated.  Relocations may be
+  /// selected before the statepoint itself, so either side creates them.
+  DenseMap<const Instruction*, SmallVector<int, 4> > StatepointSlots;
+
+  /// StatepointResults - Virtual registers carrying the return value of an
+  /// llvm.gc.statepoint's call to llvm.gc.result calls in other DAGs.
+  DenseMap<const Instruction*, unsigned> StatepointResults;
+
   /// ArgDbgValues - A list of DBG_VALUE instructions created during isel for
   /// function arguments that are inserted after scheduling is completed.
   SmallVector<MachineInstr*, 8> ArgDbgValues;
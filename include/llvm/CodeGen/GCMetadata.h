@@ -22,6 +22,9 @@
 // safe point. Liveness analysis is not presently performed by the code
 // generator, so all roots are assumed live.
 //
+// Safe points introduced by llvm.gc.statepoint are precise instead: each one
+// carries the locations of exactly the GC pointers live across its call.
+//
 // GCModuleInfo simply collects GCFunctionInfo instances for each Function as
 // they are compiled. This accretion is necessary for collectors which must emit
 // a stack map for the compilation unit as a whole. Therefore, GCFunctionInfo
@@ -55,15 +58,33 @@ namespace llvm {
     };
   }
 
+  /// GCLocation - Where a GC pointer live across a statepoint can be found
+  /// when the collector runs.
+  struct GCLocation {
+    enum LocationKind {
+      Register = 1, ///< The pointer is held in register Reg.
+      Indirect = 2  ///< The pointer is held in memory at [Reg + Offset].
+    };
+
+    LocationKind Kind;
+    unsigned Reg;       ///< DWARF register number.
+    int Offset;         ///< Offset from Reg, for Indirect locations.
+
+    GCLocation(LocationKind K, unsigned R, int O)
+      : Kind(K), Reg(R), Offset(O) {}
+  };
+
   /// GCPoint - Metadata for a collector-safe point in machine code.
   ///
   struct GCPoint {
     GC::PointKind Kind; ///< The kind of the safe point.
     MCSymbol *Label;    ///< A label.
     DebugLoc Loc;
+    uint64_t ID;        ///< The statepoint ID, for statepoints.
+    std::vector<GCLocation> Live; ///< Live pointers, for statepoints.
 
     GCPoint(GC::PointKind K, MCSymbol *L, DebugLoc DL)
-        : Kind(K), Label(L), Loc(DL) {}
+        : Kind(K), Label(L), Loc(DL), ID(0) {}
   };
 
   /// GCRoot - Metadata for a pointer to an object managed by the garbage
@@ -128,6 +149,15 @@ namespace llvm {
       SafePoints.push_back(GCPoint(Kind, Label, DL));
     }
 
+    /// addStatepoint - Notes the safe point at the return address of the call
+    /// made by an llvm.gc.statepoint. The caller fills in the locations of the
+    /// live pointers.
+    GCPoint &addStatepoint(uint64_t ID, MCSymbol *Label, DebugLoc DL) {
+      SafePoints.push_back(GCPoint(GC::PostCall, Label, DL));
+      SafePoints.back().ID = ID;
+      return SafePoints.back();
+    }
+
     /// getFrameSize/setFrameSize - Records the function's frame size.
     ///
     uint64_t getFrameSize() const { return FrameSize; }
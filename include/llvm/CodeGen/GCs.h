@@ -30,6 +30,12 @@ namespace llvm {
   /// Creates a shadow stack garbage collector. This collector requires no code
   /// generator support.
   void linkShadowStackGC();
+
+  /// Creates a relocating garbage collector built on llvm.gc.statepoint.
+  void linkStatepointGC();
+
+  /// Creates a metadata printer for the statepoint collector's stack maps.
+  void linkStatepointGCPrinter();
 }
 
 #endif
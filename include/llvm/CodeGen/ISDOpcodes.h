@@ -631,6 +631,13 @@ namespace ISD {
     ATOMIC_LOAD_UMIN,
     ATOMIC_LOAD_UMAX,
 
+    /// LIFETIME_START/LIFETIME_END - This corresponds to the llvm.lifetime.*
+    /// intrinsics. The first operand is the input chain, the second operand
+    /// is the TargetFrameIndex of the stack object whose live range begins or
+    /// ends. These nodes return a chain.
+    LIFETIME_START,
+    LIFETIME_END,
+
     /// BUILTIN_OP_END - This must be the last enum value in this list.
     /// The target-specific pre-isel opcode values start here.
     BUILTIN_OP_END
@@ -22,7 +22,10 @@ namespace llvm {
 
 class MachineBasicBlock;
 class MachineBranchProbabilityInfo;
-template<class BlockT, class FunctionT, class BranchProbInfoT>
+class MachineLoop;
+class MachineLoopInfo;
+template<class BlockT, class FunctionT, class BranchProbInfoT,
+         class LoopInfoT, class LoopT>
 class BlockFrequencyImpl;
 
 /// MachineBlockFrequencyInfo pass uses BlockFrequencyImpl implementation to estimate
@@ -30,7 +33,8 @@ class BlockFrequencyImpl;
 class MachineBlockFrequencyInfo : public MachineFunctionPass {
 
   BlockFrequencyImpl<MachineBasicBlock, MachineFunction,
-                     MachineBranchProbabilityInfo> *MBFI;
+                     MachineBranchProbabilityInfo, MachineLoopInfo,
+                     MachineLoop> *MBFI;
 
 public:
   static char ID;
@@ -49,6 +53,19 @@ public:
   /// the other block frequencies. We do this to avoid using of floating points.
   ///
   BlockFrequency getBlockFreq(const MachineBasicBlock *MBB) const;
+
+  /// getEntryFreq - Return the frequency of the entry block.  This is 1024
+  /// unless the loop nest is so deep that all frequencies had to be scaled
+  /// down to fit.
+  uint64_t getEntryFreq() const;
+
+  /// setBlockFreq - Update the frequency of MBB after a change to the CFG.
+  /// A block split off MBB has the frequency of MBB, and a block inserted on
+  /// an edge has the frequency of the edge.
+  void setBlockFreq(const MachineBasicBlock *MBB, BlockFrequency Freq);
+
+  /// eraseBlock - Forget the frequency of MBB, which is being deleted.
+  void eraseBlock(const MachineBasicBlock *MBB);
 };
 
 }
@@ -415,6 +415,10 @@ namespace llvm {
   /// StackSlotColoring - This pass performs stack slot coloring.
   extern char &StackSlotColoringID;
 
+  /// StackColoring - This pass merges disjoint stack allocations, using the
+  /// live ranges described by the lifetime markers.
+  extern char &StackColoringID;
+
   /// createStackProtectorPass - This pass adds stack protectors to functions.
   ///
   FunctionPass *createStackProtectorPass(const TargetLowering *tli);
@@ -16,6 +16,7 @@
 #define LLVM_EXECUTION_ENGINE_JIT_EVENTLISTENER_H
 
 #include "llvm/Config/config.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/DebugLoc.h"
 
@@ -109,6 +110,15 @@ public:
   }
 #endif // USE_OPROFILE
 
+  // Construct a PerfJITEventListener that appends to /tmp/perf-<pid>.map and,
+  // if EmitJITDump is set, writes jit-<pid>.dump in the current directory for
+  // "perf inject --jit".  Returns null on hosts without perf support.
+  static JITEventListener *createPerfJITEventListener(bool EmitJITDump = false);
+
+  // Construct a PerfJITEventListener writing to the given files.  An empty
+  // path disables the corresponding output.
+  static JITEventListener *createPerfJITEventListener(StringRef MapPath,
+                                                      StringRef DumpPath);
 };
 
 } // end namespace llvm.
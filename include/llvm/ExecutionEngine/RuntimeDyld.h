@@ -83,6 +83,13 @@ public:
   void mapSectionAddress(void *LocalAddress, uint64_t TargetAddress);
 
   StringRef getErrorString();
+
+  /// registerObjectsWithDebugger - Loaded objects are only announced to a
+  /// debugger once one is found attached to the process, which is checked at
+  /// most every 100ms as objects are loaded.  Calling this makes all objects
+  /// loaded so far, and all objects loaded later, visible to the debugger
+  /// immediately, e.g. for debuggers that attach late.
+  static void registerObjectsWithDebugger();
 };
 
 } // end namespace llvm
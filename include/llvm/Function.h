@@ -290,6 +290,24 @@ public:
     else removeAttribute(n, Attribute::NoCapture);
   }
 
+  /// @brief Determine if the function does not access memory through the
+  /// pointer passed as parameter n.
+  bool doesNotAccessMemory(unsigned n) const {
+    return paramHasAttr(n, Attribute::ReadNone);
+  }
+
+  /// @brief Determine if the function does not write through the pointer
+  /// passed as parameter n.
+  bool onlyReadsMemory(unsigned n) const {
+    return doesNotAccessMemory(n) || paramHasAttr(n, Attribute::ReadOnly);
+  }
+
+  /// @brief Determine if the pointer passed as parameter n, or returned when
+  /// n is 0, is never null.
+  bool isNonNull(unsigned n) const {
+    return paramHasAttr(n, Attribute::NonNull);
+  }
+
   /// copyAttributesFrom - copy all additional attributes (those not needed to
   /// create a Function) from the Function Src to this one.
   void copyAttributesFrom(const GlobalValue *Src);
@@ -81,7 +81,7 @@ namespace Intrinsic {
     enum IITDescriptorKind {
       Void, MMX, Metadata, Float, Double,
       Integer, Vector, Pointer, Struct,
-      Argument, ExtendVecArgument, TruncVecArgument
+      Argument, ExtendVecArgument, TruncVecArgument, VarArg
     } Kind;
     
     union {
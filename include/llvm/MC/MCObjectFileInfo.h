@@ -84,6 +84,10 @@ protected:
   /// this is the section to emit them into.
   const MCSection *CompactUnwindSection;
 
+  /// StackMapSection - The section the locations of the GC pointers live
+  /// across each statepoint are emitted to, for the collector to read.
+  const MCSection *StackMapSection;
+
   /// DwarfAccelNamesSection, DwarfAccelObjCSection
   /// If we use the DWARF accelerated hash tables then we want toe emit these
   /// sections.
@@ -194,6 +198,7 @@ public:
   const MCSection *getCompactUnwindSection() const{
     return CompactUnwindSection;
   }
+  const MCSection *getStackMapSection() const { return StackMapSection; }
   const MCSection *getDwarfAccelNamesSection() const {
     return DwarfAccelNamesSection;
   }
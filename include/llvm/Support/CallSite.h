@@ -247,6 +247,19 @@ public:
     return paramHasAttr(ArgNo + 1, Attribute::ByVal);
   }
 
+  /// @brief Determine whether the callee does not access memory through this
+  /// argument.
+  bool doesNotAccessMemory(unsigned ArgNo) const {
+    return paramHasAttr(ArgNo + 1, Attribute::ReadNone);
+  }
+
+  /// @brief Determine whether the callee does not write through this
+  /// argument.
+  bool onlyReadsMemory(unsigned ArgNo) const {
+    return doesNotAccessMemory(ArgNo) ||
+      paramHasAttr(ArgNo + 1, Attribute::ReadOnly);
+  }
+
   /// hasArgument - Returns true if this CallSite passes the given Value* as an
   /// argument to the called function.
   bool hasArgument(const Value *Arg) const {
@@ -0,0 +1,46 @@
+//===-- llvm/Support/Compression.h - Fast byte compression ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a small, self-contained LZ77 compressor.  It favours
+// decompression speed over compression ratio and needs no external library.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_COMPRESSION_H
+#define LLVM_SUPPORT_COMPRESSION_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+namespace lz77 {
+
+/// MaxExpansion - No input decompresses to more than MaxExpansion times its
+/// own size: every byte of a length continuation adds at most 255 bytes.
+const unsigned MaxExpansion = 255;
+
+/// compress - Append the compressed form of Input to Output.  The result
+/// carries no framing of its own: the caller has to keep track of the
+/// uncompressed size in order to decompress it again.  If a Dictionary is
+/// given, matches may refer back into it as if it immediately preceded Input;
+/// only the last 64K of it are used.
+void compress(StringRef Input, SmallVectorImpl<char> &Output,
+              StringRef Dictionary = StringRef());
+
+/// decompress - Decompress Input, which was produced by compress with the
+/// same Dictionary, into the OutputSize bytes starting at Output.  Returns
+/// true if Input is malformed or does not decompress to exactly OutputSize
+/// bytes.
+bool decompress(StringRef Input, char *Output, size_t OutputSize,
+                StringRef Dictionary = StringRef());
+
+} // End lz77 namespace
+} // End llvm namespace
+
+#endif
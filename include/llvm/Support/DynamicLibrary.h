@@ -14,6 +14,7 @@
 #ifndef LLVM_SYSTEM_DYNAMIC_LIBRARY_H
 #define LLVM_SYSTEM_DYNAMIC_LIBRARY_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include <string>
 
 namespace llvm {
@@ -81,7 +82,8 @@ namespace sys {
     /// libraries for the symbol \p symbolName. If it is found, the address of
     /// that symbol is returned. If not, null is returned. Note that this will
     /// search permanently loaded libraries (getPermanentLibrary()) as well
-    /// as explicitly registered symbols (AddSymbol()).
+    /// as explicitly registered symbols (AddSymbol()). Addresses found in
+    /// libraries are cached until the next library is loaded.
     /// @throws std::string on error.
     /// @brief Search through libraries for address of a symbol
     static void *SearchForAddressOfSymbol(const char *symbolName);
@@ -91,6 +93,14 @@ namespace sys {
       return SearchForAddressOfSymbol(symbolName.c_str());
     }
 
+    /// This function looks up each of \p symbolNames as
+    /// SearchForAddressOfSymbol() would, and stores the address, or null, at
+    /// the same index of \p addresses, which must have room for all of them.
+    /// The library lock is only taken once for the whole list.
+    /// @brief Search through libraries for the addresses of many symbols
+    static void SearchForAddressOfSymbols(ArrayRef<const char *> symbolNames,
+                                          void **addresses);
+
     /// This functions permanently adds the symbol \p symbolName with the
     /// value \p symbolValue.  These symbols are searched before any
     /// libraries.
@@ -157,14 +157,14 @@ private:
       size_t bytes = Streamer->GetBytes(&Bytes[BytesRead + BytesSkipped],
                                         kChunkSize);
       BytesRead += bytes;
-      if (bytes < kChunkSize) {
+      // A short read only means that the rest of the data has not arrived
+      // yet (e.g. from a pipe); the stream has ended when nothing comes back.
+      if (bytes == 0) {
         if (ObjectSize && BytesRead < Pos)
           assert(0 && "Unexpected short read fetching bitcode");
-        if (BytesRead <= Pos) { // reached EOF/ran out of bytes
-          ObjectSize = BytesRead;
-          EOFReached = true;
-          return false;
-        }
+        ObjectSize = BytesRead;
+        EOFReached = true;
+        return false;
       }
     }
     return true;
@@ -151,6 +151,15 @@ public:
   /// that should be avoided.
   bool isJumpExpensive() const { return JumpIsExpensive; }
 
+  /// isSharedAddReassocExpensive() - Return true if (add (add x, c1), c2)
+  /// should not be turned into (add x, c1+c2) when (add x, c1) has other uses
+  /// and c1+c2 is not a legal add immediate.  Such adds come from addresses
+  /// that CodeGenPrepare rebased onto a shared base to materialize a large
+  /// offset only once.
+  bool isSharedAddReassocExpensive() const {
+    return SharedAddReassocIsExpensive;
+  }
+
   /// isPredictableSelectExpensive - Return true if selects are only cheaper
   /// than branches if the branch is unlikely to be predicted right.
   bool isPredictableSelectExpensive() const {
@@ -1025,6 +1034,13 @@ protected:
     JumpIsExpensive = isExpensive;
   }
 
+  /// setSharedAddReassocIsExpensive - Tells the code generator not to fold
+  /// the constant of a multiple-use add into another add when the sum is not
+  /// a legal add immediate.
+  void setSharedAddReassocIsExpensive(bool isExpensive = true) {
+    SharedAddReassocIsExpensive = isExpensive;
+  }
+
   /// setIntDivIsCheap - Tells the code generator that integer divide is
   /// expensive, and if possible, should be replaced by an alternate sequence
   /// of instructions not containing an integer divide.
@@ -1756,6 +1772,11 @@ private:
   /// control instructions via predication.
   bool JumpIsExpensive;
 
+  /// SharedAddReassocIsExpensive - Tells the code generator not to fold the
+  /// constant of a multiple-use add into another add if the sum is not a legal
+  /// add immediate.
+  bool SharedAddReassocIsExpensive;
+
   /// UseUnderscoreSetJmp - This target prefers to use _setjmp to implement
   /// llvm.setjmp.  Defaults to false.
   bool UseUnderscoreSetJmp;
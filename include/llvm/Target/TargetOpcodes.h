@@ -87,7 +87,21 @@ namespace TargetOpcode {
     /// BUNDLE - This instruction represents an instruction bundle. Instructions
     /// which immediately follow a BUNDLE instruction which are marked with
     /// 'InsideBundle' flag are inside the bundle.
-    BUNDLE
+    BUNDLE = 14,
+
+    /// LIFETIME_START/LIFETIME_END - These pseudo-instructions mark the
+    /// beginning and the end of the live range of the stack object named by
+    /// their frame index operand. They are consumed by the stack coloring
+    /// pass and never reach the emitter.
+    LIFETIME_START = 15,
+    LIFETIME_END = 16,
+
+    /// GC_SAFEPOINT - This pseudo-instruction follows the call made by an
+    /// llvm.gc.statepoint. Its first operand is the statepoint ID, the rest
+    /// are the frame indices of the spill slots holding the live GC pointers.
+    /// GCMachineCodeAnalysis replaces it with a GC_LABEL at the call's return
+    /// address.
+    GC_SAFEPOINT = 17
   };
 } // end namespace TargetOpcode
 } // end namespace llvm
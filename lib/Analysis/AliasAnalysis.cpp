@@ -88,23 +88,29 @@ AliasAnalysis::getModRefInfo(ImmutableCallSite CS,
     Mask = Ref;
 
   if (onlyAccessesArgPointees(MRB)) {
-    bool doesAlias = false;
+    // Collect what the call may do through the arguments that alias Loc.
+    ModRefResult ArgMask = NoModRef;
     if (doesAccessArgPointees(MRB)) {
       MDNode *CSTag = CS.getInstruction()->getMetadata(LLVMContext::MD_tbaa);
+      unsigned ArgNo = 0;
       for (ImmutableCallSite::arg_iterator AI = CS.arg_begin(), AE = CS.arg_end();
-           AI != AE; ++AI) {
+           AI != AE && ArgMask != ModRef; ++AI, ++ArgNo) {
         const Value *Arg = *AI;
         if (!Arg->getType()->isPointerTy())
           continue;
         Location CSLoc(Arg, UnknownSize, CSTag);
-        if (!isNoAlias(CSLoc, Loc)) {
-          doesAlias = true;
-          break;
-        }
+        if (isNoAlias(CSLoc, Loc))
+          continue;
+        // A byval argument is still read to make the copy.
+        if (CS.doesNotAccessMemory(ArgNo) && !CS.isByValArgument(ArgNo))
+          continue;
+        ArgMask = ModRefResult(ArgMask |
+                               (CS.onlyReadsMemory(ArgNo) ? Ref : ModRef));
       }
     }
-    if (!doesAlias)
+    if (ArgMask == NoModRef)
       return NoModRef;
+    Mask = ModRefResult(Mask & ArgMask);
   }
 
   // If Loc is a constant memory location, the call definitely could not
@@ -530,9 +536,14 @@ bool llvm::isKnownNonNull(const Value *V) {
   // Alloca never returns null, malloc might.
   if (isa<AllocaInst>(V)) return true;
 
-  // A byval argument is never null.
+  // A byval or nonnull argument is never null.
   if (const Argument *A = dyn_cast<Argument>(V))
-    return A->hasByValAttr();
+    return A->hasByValAttr() || A->hasNonNullAttr();
+
+  // Neither is the result of a call that is known to return nonnull.
+  if (isa<CallInst>(V) || isa<InvokeInst>(V))
+    return ImmutableCallSite(cast<Instruction>(V))
+      .paramHasAttr(0, Attribute::NonNull);
 
   // Global values are not null unless extern weak.
   if (const GlobalValue *GV = dyn_cast<GlobalValue>(V))
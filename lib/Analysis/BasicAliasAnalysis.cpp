@@ -694,15 +694,20 @@ BasicAliasAnalysis::getModRefInfo(ImmutableCallSite CS,
       if (CI->isTailCall())
         return NoModRef;
   
+  const TargetLibraryInfo &TLI = getAnalysis<TargetLibraryInfo>();
+  ModRefResult Min = ModRef;
+
   // If the pointer is to a locally allocated object that does not escape,
   // then the call can not mod/ref the pointer unless the call takes the pointer
   // as an argument, and itself doesn't capture it.
   if (!isa<Constant>(Object) && CS.getInstruction() != Object &&
       isNonEscapingLocalObject(Object)) {
-    bool PassedAsArg = false;
+    // What the call may do to the object through the arguments it is passed
+    // in; readonly and readnone arguments narrow this.
+    ModRefResult ArgMask = NoModRef;
     unsigned ArgNo = 0;
     for (ImmutableCallSite::arg_iterator CI = CS.arg_begin(), CE = CS.arg_end();
-         CI != CE; ++CI, ++ArgNo) {
+         CI != CE && ArgMask != ModRef; ++CI, ++ArgNo) {
       // Only look at the no-capture or byval pointer arguments.  If this
       // pointer were passed to arguments that were neither of these, then it
       // couldn't be no-capture.
@@ -714,19 +719,20 @@ BasicAliasAnalysis::getModRefInfo(ImmutableCallSite CS,
       // is impossible to alias the pointer we're checking.  If not, we have to
       // assume that the call could touch the pointer, even though it doesn't
       // escape.
-      if (!isNoAlias(Location(*CI), Location(Object))) {
-        PassedAsArg = true;
-        break;
-      }
+      if (isNoAlias(Location(*CI), Location(Object)))
+        continue;
+      // A byval argument is still read to make the copy.
+      if (CS.doesNotAccessMemory(ArgNo) && !CS.isByValArgument(ArgNo))
+        continue;
+      ArgMask = ModRefResult(ArgMask |
+                             (CS.onlyReadsMemory(ArgNo) ? Ref : ModRef));
     }
     
-    if (!PassedAsArg)
+    if (ArgMask == NoModRef)
       return NoModRef;
+    Min = ArgMask;
   }
 
-  const TargetLibraryInfo &TLI = getAnalysis<TargetLibraryInfo>();
-  ModRefResult Min = ModRef;
-
   // Finally, handle specific knowledge of intrinsics.
   const IntrinsicInst *II = dyn_cast<IntrinsicInst>(CS.getInstruction());
   if (II != 0)
@@ -23,6 +23,7 @@ using namespace llvm;
 INITIALIZE_PASS_BEGIN(BlockFrequencyInfo, "block-freq", "Block Frequency Analysis",
                       true, true)
 INITIALIZE_PASS_DEPENDENCY(BranchProbabilityInfo)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
 INITIALIZE_PASS_END(BlockFrequencyInfo, "block-freq", "Block Frequency Analysis",
                     true, true)
 
@@ -31,7 +32,8 @@ char BlockFrequencyInfo::ID = 0;
 
 BlockFrequencyInfo::BlockFrequencyInfo() : FunctionPass(ID) {
   initializeBlockFrequencyInfoPass(*PassRegistry::getPassRegistry());
-  BFI = new BlockFrequencyImpl<BasicBlock, Function, BranchProbabilityInfo>();
+  BFI = new BlockFrequencyImpl<BasicBlock, Function, BranchProbabilityInfo,
+                               LoopInfo, Loop>();
 }
 
 BlockFrequencyInfo::~BlockFrequencyInfo() {
@@ -40,12 +42,13 @@ BlockFrequencyInfo::~BlockFrequencyInfo() {
 
 void BlockFrequencyInfo::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<BranchProbabilityInfo>();
+  AU.addRequired<LoopInfo>();
   AU.setPreservesAll();
 }
 
 bool BlockFrequencyInfo::runOnFunction(Function &F) {
   BranchProbabilityInfo &BPI = getAnalysis<BranchProbabilityInfo>();
-  BFI->doFunction(&F, &BPI);
+  BFI->doFunction(&F, &BPI, &getAnalysis<LoopInfo>());
   return false;
 }
 
@@ -61,3 +64,16 @@ void BlockFrequencyInfo::print(raw_ostream &O, const Module *) const {
 BlockFrequency BlockFrequencyInfo::getBlockFreq(const BasicBlock *BB) const {
   return BFI->getBlockFreq(BB);
 }
+
+uint64_t BlockFrequencyInfo::getEntryFreq() const {
+  return BFI->getEntryFreq();
+}
+
+void BlockFrequencyInfo::setBlockFreq(const BasicBlock *BB,
+                                      BlockFrequency Freq) {
+  BFI->setBlockFreq(BB, Freq);
+}
+
+void BlockFrequencyInfo::eraseBlock(const BasicBlock *BB) {
+  BFI->eraseBlock(BB);
+}
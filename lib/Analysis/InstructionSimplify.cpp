@@ -1705,6 +1705,15 @@ static Value *SimplifyICmpInst(unsigned Predicate, Value *LHS, Value *RHS,
   if (LHSPtr == RHSPtr)
     return ConstantInt::get(ITy, CmpInst::isTrueWhenEqual(Pred));
 
+  // A pointer that is known to be non-null, such as a nonnull argument or
+  // call result, never compares equal to null.
+  if (isa<ConstantPointerNull>(RHSPtr) && llvm::isKnownNonNull(LHSPtr)) {
+    if (Pred == CmpInst::ICMP_EQ)
+      return ConstantInt::get(ITy, false);
+    if (Pred == CmpInst::ICMP_NE)
+      return ConstantInt::get(ITy, true);
+  }
+
   // Be more aggressive about stripping pointer adjustments when checking a
   // comparison of an alloca address to another object.  We can rip off all
   // inbounds GEP operations, even if they are variable.
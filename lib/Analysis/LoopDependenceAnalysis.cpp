@@ -7,20 +7,16 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This is the (beginning) of an implementation of a loop dependence analysis
-// framework, which is used to detect dependences in memory accesses in loops.
-//
-// Please note that this is work in progress and the interface is subject to
-// change.
-//
-// TODO: adapt as implementation progresses.
-//
-// TODO: document lingo (pair, subscript, index)
+// This file implements a loop dependence analysis, which is used to detect
+// dependences in memory accesses in loops.  A pair of accesses to the same
+// object through GEPs of the same pointer is tested subscript by subscript
+// with the classic ZIV, SIV (strong, weak-zero, weak-crossing and exact) and
+// MIV (GCD and Banerjee) tests, yielding a direction, and where possible a
+// distance, for every loop that contains both accesses.
 //
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "lda"
-#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/LoopDependenceAnalysis.h"
@@ -36,6 +32,8 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetData.h"
+#include <algorithm>
+#include <cstdlib>
 using namespace llvm;
 
 STATISTIC(NumAnswered,    "Number of dependence queries answered");
@@ -51,6 +49,7 @@ LoopPass *llvm::createLoopDependenceAnalysisPass() {
 INITIALIZE_PASS_BEGIN(LoopDependenceAnalysis, "lda",
                 "Loop Dependence Analysis", false, true)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(LoopDependenceAnalysis, "lda",
                 "Loop Dependence Analysis", false, true)
@@ -102,13 +101,158 @@ static AliasAnalysis::AliasResult UnderlyingObjectsAlias(AliasAnalysis *AA,
                    bObj, AA->getTypeStoreSize(bObj->getType()));
 }
 
-static inline const SCEV *GetZeroSCEV(ScalarEvolution *SE) {
-  return SE->getConstant(Type::getInt32Ty(SE->getContext()), 0L);
+/// MaxMagnitude - Coefficients, constant differences and iteration counts
+/// beyond this are treated as unknown, so that the arithmetic of the tests
+/// below cannot overflow.
+static const int64_t MaxMagnitude = 1 << 24;
+
+static bool GetSmallConstant(const SCEV *S, int64_t &C) {
+  const SCEVConstant *SC = dyn_cast<SCEVConstant>(S);
+  if (!SC || SC->getValue()->getValue().getMinSignedBits() > 64)
+    return false;
+  C = SC->getValue()->getSExtValue();
+  return C > -MaxMagnitude && C < MaxMagnitude;
+}
+
+static int64_t FloorDiv(int64_t A, int64_t B) {
+  int64_t Q = A / B;
+  return (A % B != 0 && ((A < 0) != (B < 0))) ? Q - 1 : Q;
+}
+
+static int64_t CeilDiv(int64_t A, int64_t B) {
+  return -FloorDiv(-A, B);
+}
+
+/// ExtendedGCD - Return gcd(A, B) and set X and Y so that A*X + B*Y is it.
+static int64_t ExtendedGCD(int64_t A, int64_t B, int64_t &X, int64_t &Y) {
+  int64_t X0 = 1, Y0 = 0, X1 = 0, Y1 = 1;
+  while (B != 0) {
+    int64_t Q = A / B, T;
+    T = A - Q * B; A = B; B = T;
+    T = X0 - Q * X1; X0 = X1; X1 = T;
+    T = Y0 - Q * Y1; Y0 = Y1; Y1 = T;
+  }
+  if (A < 0) {
+    A = -A; X0 = -X0; Y0 = -Y0;
+  }
+  X = X0;
+  Y = Y0;
+  return A;
+}
+
+namespace {
+
+/// Interval - A possibly unbounded range of integers.
+struct Interval {
+  bool HasLo, HasHi;
+  int64_t Lo, Hi;
+
+  Interval() : HasLo(false), HasHi(false), Lo(0), Hi(0) {}
+
+  bool isEmpty() const { return HasLo && HasHi && Lo > Hi; }
+  bool contains(int64_t V) const {
+    return (!HasLo || Lo <= V) && (!HasHi || V <= Hi);
+  }
+  void raiseLo(int64_t V) {
+    if (!HasLo || V > Lo) { Lo = V; HasLo = true; }
+  }
+  void lowerHi(int64_t V) {
+    if (!HasHi || V < Hi) { Hi = V; HasHi = true; }
+  }
+
+  /// constrain - Restrict this range of T to the values for which P + Q*T
+  /// lies within Range.
+  void constrain(int64_t P, int64_t Q, const Interval &Range) {
+    if (Q == 0) {
+      if (!Range.contains(P)) {
+        HasLo = HasHi = true;
+        Lo = 1;
+        Hi = 0;
+      }
+      return;
+    }
+    if (Q > 0) {
+      if (Range.HasLo) raiseLo(CeilDiv(Range.Lo - P, Q));
+      if (Range.HasHi) lowerHi(FloorDiv(Range.Hi - P, Q));
+    } else {
+      if (Range.HasHi) raiseLo(CeilDiv(Range.Hi - P, Q));
+      if (Range.HasLo) lowerHi(FloorDiv(Range.Lo - P, Q));
+    }
+  }
+};
+
+} // end anonymous namespace
+
+/// GetIterationRange - The iteration numbers of a loop whose largest
+/// iteration number is Max, if known.
+static Interval GetIterationRange(bool HasMax, int64_t Max) {
+  Interval R;
+  R.raiseLo(0);
+  if (HasMax)
+    R.lowerHi(Max);
+  return R;
+}
+
+/// GetSimplexBounds - Bound C0 + C1*X + C2*Y over X, Y >= 0 with
+/// X + Y <= Extent, or over the whole quadrant if Extent is not known.
+static Interval GetSimplexBounds(int64_t C0, int64_t C1, int64_t C2,
+                                 bool HasExtent, int64_t Extent) {
+  Interval R;
+  if (HasExtent) {
+    int64_t V1 = C0 + C1 * Extent, V2 = C0 + C2 * Extent;
+    R.raiseLo(std::min(C0, std::min(V1, V2)));
+    R.lowerHi(std::max(C0, std::max(V1, V2)));
+    return R;
+  }
+  if (C1 >= 0 && C2 >= 0) R.raiseLo(C0);
+  if (C1 <= 0 && C2 <= 0) R.lowerHi(C0);
+  return R;
+}
+
+/// GetBanerjeeBounds - Bound A*I - B*J for iteration numbers I and J of a
+/// loop, with I and J related as given by Dir (DirLT means I < J).
+static Interval GetBanerjeeBounds(int64_t A, int64_t B, unsigned Dir,
+                                  bool HasMax, int64_t Max) {
+  switch (Dir) {
+  case LoopDependenceAnalysis::DirEQ:
+    // A*I - B*I.
+    return GetSimplexBounds(0, A - B, 0, HasMax, Max);
+  case LoopDependenceAnalysis::DirLT:
+    // J = I + 1 + S: (A-B)*I - B - B*S.
+    return GetSimplexBounds(-B, A - B, -B, HasMax, Max - 1);
+  case LoopDependenceAnalysis::DirGT:
+    // I = J + 1 + S: (A-B)*J + A + A*S.
+    return GetSimplexBounds(A, A - B, A, HasMax, Max - 1);
+  }
+  llvm_unreachable("Not a single direction!");
+}
+
+static Interval AddIntervals(const Interval &X, const Interval &Y) {
+  Interval R;
+  if (X.HasLo && Y.HasLo) R.raiseLo(X.Lo + Y.Lo);
+  if (X.HasHi && Y.HasHi) R.lowerHi(X.Hi + Y.Hi);
+  return R;
 }
 
 //===----------------------------------------------------------------------===//
 //                             Dependence Testing
 //===----------------------------------------------------------------------===//
+//
+// The subscripts of two accesses to the same array are compared pairwise.
+// Each is first written as C + sum(a[k] * I[k]), with I[k] the iteration
+// number of the k-th loop that contains both accesses.  A pair of subscripts
+// then yields the equation
+//
+//   sum(a[k] * I[k]) - sum(b[k] * J[k]) = Cb - Ca
+//
+// for source iterations I and destination iterations J.  It is classified by
+// the number of loops with a nonzero coefficient (ZIV: none, SIV: one, MIV:
+// several) and handed to the matching test.  A test either proves that the
+// equation has no solution within the loop bounds, or narrows down the
+// directions and distances at the levels it involves.  The results of all
+// subscripts are intersected.
+//
+//===----------------------------------------------------------------------===//
 
 bool LoopDependenceAnalysis::isDependencePair(const Value *A,
                                               const Value *B) const {
@@ -134,87 +278,334 @@ bool LoopDependenceAnalysis::findOrInsertDependencePair(Value *A,
   return false;
 }
 
-void LoopDependenceAnalysis::getLoops(const SCEV *S,
-                                      DenseSet<const Loop*>* Loops) const {
-  // Refactor this into an SCEVVisitor, if efficiency becomes a concern.
-  for (const Loop *L = this->L; L != 0; L = L->getParentLoop())
-    if (!SE->isLoopInvariant(S, L))
-      Loops->insert(L);
+bool LoopDependenceAnalysis::getLinearSubscript(
+    const SCEV *S, const SmallVectorImpl<DependenceLevel> &Levels,
+    LinearSubscript &Sub) const {
+  Sub.Coeffs.assign(Levels.size(), 0);
+  while (const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(S)) {
+    if (!AR->isAffine())
+      return false;
+    // The recurrence has to belong to a loop around both accesses, so that
+    // its iteration number means the same thing for both of them.
+    unsigned Depth = AR->getLoop()->getLoopDepth();
+    if (Depth > Levels.size() || Levels[Depth - 1].L != AR->getLoop())
+      return false;
+    int64_t Step;
+    if (!GetSmallConstant(AR->getStepRecurrence(*SE), Step))
+      return false;
+    Sub.Coeffs[Depth - 1] += Step;
+    S = AR->getStart();
+  }
+  if (!Levels.empty() && !SE->isLoopInvariant(S, Levels[0].L))
+    return false;
+  Sub.Const = S;
+  return true;
 }
 
-bool LoopDependenceAnalysis::isLoopInvariant(const SCEV *S) const {
-  DenseSet<const Loop*> loops;
-  getLoops(S, &loops);
-  return loops.empty();
+bool LoopDependenceAnalysis::getMaxIteration(const Loop *L,
+                                             int64_t &Max) const {
+  return GetSmallConstant(SE->getMaxBackedgeTakenCount(L), Max) && Max >= 0;
 }
 
-bool LoopDependenceAnalysis::isAffine(const SCEV *S) const {
-  const SCEVAddRecExpr *rec = dyn_cast<SCEVAddRecExpr>(S);
-  return isLoopInvariant(S) || (rec && rec->isAffine());
+/// analyseZIV - Subscripts that do not vary in the loop nest are either
+/// always or never equal.
+LoopDependenceAnalysis::DependenceResult
+LoopDependenceAnalysis::analyseZIV(const SCEV *Delta) const {
+  if (Delta->isZero())
+    return Dependent;
+  if (SE->isKnownNonZero(Delta)) {
+    DEBUG(dbgs() << "  -> [I] ZIV\n");
+    return Independent;
+  }
+  return Unknown;
 }
 
-bool LoopDependenceAnalysis::isZIVPair(const SCEV *A, const SCEV *B) const {
-  return isLoopInvariant(A) && isLoopInvariant(B);
-}
+/// analyseSIV - Solve A*I - B*J = Delta, where only one loop of the nest is
+/// involved, within the bounds of that loop.
+LoopDependenceAnalysis::DependenceResult
+LoopDependenceAnalysis::analyseSIV(int64_t A, int64_t B, const SCEV *Delta,
+                                   DependenceLevel *Level) const {
+  int64_t Max;
+  bool HasMax = getMaxIteration(Level->L, Max);
+  int64_t D;
+  bool IsConstant = GetSmallConstant(Delta, D);
 
-bool LoopDependenceAnalysis::isSIVPair(const SCEV *A, const SCEV *B) const {
-  DenseSet<const Loop*> loops;
-  getLoops(A, &loops);
-  getLoops(B, &loops);
-  return loops.size() == 1;
-}
+  if (A == B) {
+    // Strong SIV: A*(I - J) = Delta, so the distance J - I is -Delta/A.
+    if (!IsConstant) {
+      if (A != 1 && A != -1)
+        return Unknown;
+      const SCEV *Dist = A == 1 ? SE->getNegativeSCEV(Delta) : Delta;
+      const SCEV *BTC = SE->getBackedgeTakenCount(Level->L);
+      if (!isa<SCEVCouldNotCompute>(BTC) &&
+          BTC->getType() == Dist->getType() &&
+          (SE->isKnownPredicate(ICmpInst::ICMP_SGT, Dist, BTC) ||
+           SE->isKnownPredicate(ICmpInst::ICMP_SGT,
+                                SE->getNegativeSCEV(Dist), BTC))) {
+        DEBUG(dbgs() << "  -> [I] strong SIV, symbolic distance too large\n");
+        return Independent;
+      }
+      // Ask about Delta rather than about its negation, which ranges are
+      // less precise for.
+      Level->Distance = Dist;
+      if (SE->isKnownPositive(Delta))
+        Level->Direction = A == 1 ? DirGT : DirLT;
+      else if (SE->isKnownNegative(Delta))
+        Level->Direction = A == 1 ? DirLT : DirGT;
+      else if (SE->isKnownNonNegative(Delta))
+        Level->Direction = A == 1 ? DirGE : DirLE;
+      else if (SE->isKnownNonPositive(Delta))
+        Level->Direction = A == 1 ? DirLE : DirGE;
+      return Dependent;
+    }
+    if (D % A != 0) {
+      DEBUG(dbgs() << "  -> [I] strong SIV, distance is not integral\n");
+      return Independent;
+    }
+    int64_t Dist = -D / A;
+    if (HasMax && (Dist > Max || -Dist > Max)) {
+      DEBUG(dbgs() << "  -> [I] strong SIV, distance exceeds trip count\n");
+      return Independent;
+    }
+    Level->Distance = SE->getConstant(Delta->getType(), Dist, true);
+    Level->Direction = Dist > 0 ? DirLT : Dist < 0 ? DirGT : DirEQ;
+    return Dependent;
+  }
 
-LoopDependenceAnalysis::DependenceResult
-LoopDependenceAnalysis::analyseZIV(const SCEV *A,
-                                   const SCEV *B,
-                                   Subscript *S) const {
-  assert(isZIVPair(A, B) && "Attempted to ZIV-test non-ZIV SCEVs!");
-  return A == B ? Dependent : Independent;
-}
+  if (!IsConstant)
+    return Unknown;
 
-LoopDependenceAnalysis::DependenceResult
-LoopDependenceAnalysis::analyseSIV(const SCEV *A,
-                                   const SCEV *B,
-                                   Subscript *S) const {
-  return Unknown; // TODO: Implement.
+  if (A == 0 || B == 0) {
+    // Weak-zero SIV: only one iteration of one side can be involved.
+    int64_t C = A != 0 ? A : -B;
+    if (D % C != 0) {
+      DEBUG(dbgs() << "  -> [I] weak-zero SIV, iteration is not integral\n");
+      return Independent;
+    }
+    int64_t Iter = D / C;
+    if (Iter < 0 || (HasMax && Iter > Max)) {
+      DEBUG(dbgs() << "  -> [I] weak-zero SIV, iteration out of bounds\n");
+      return Independent;
+    }
+    // Only the first or the last iteration being involved is worth
+    // reporting: peeling it off removes the dependence.
+    if (Iter == 0)
+      Level->Direction = A != 0 ? DirLE : DirGE;
+    else if (HasMax && Iter == Max)
+      Level->Direction = A != 0 ? DirGE : DirLE;
+    return Dependent;
+  }
+
+  if (A == -B) {
+    // Weak-crossing SIV: I + J = Delta/A, so the dependent iterations lie
+    // symmetrically around (Delta/A)/2.
+    if (D % A != 0) {
+      DEBUG(dbgs() << "  -> [I] weak-crossing SIV, sum is not integral\n");
+      return Independent;
+    }
+    int64_t Sum = D / A;
+    if (Sum < 0 || (HasMax && Sum > 2 * Max)) {
+      DEBUG(dbgs() << "  -> [I] weak-crossing SIV, sum out of bounds\n");
+      return Independent;
+    }
+    Level->Direction = DirNone;
+    if (Sum % 2 == 0)
+      Level->Direction |= DirEQ;
+    if (Sum > 0 && (!HasMax || Sum < 2 * Max))
+      Level->Direction |= DirNE;
+    return Dependent;
+  }
+
+  // Exact SIV: A*I + (-B)*J = Delta has the solutions
+  //   I = I0 + (-B/G)*T,  J = J0 - (A/G)*T
+  // when G = gcd(A, -B) divides Delta.
+  int64_t X, Y;
+  int64_t G = ExtendedGCD(A, -B, X, Y);
+  if (D % G != 0) {
+    DEBUG(dbgs() << "  -> [I] exact SIV, gcd test\n");
+    return Independent;
+  }
+  int64_t I0 = X * (D / G), J0 = Y * (D / G);
+  int64_t IStep = -B / G, JStep = -(A / G);
+  Interval Iters = GetIterationRange(HasMax, Max);
+  Interval T;
+  T.constrain(I0, IStep, Iters);
+  T.constrain(J0, JStep, Iters);
+  if (T.isEmpty()) {
+    DEBUG(dbgs() << "  -> [I] exact SIV, no solution within bounds\n");
+    return Independent;
+  }
+
+  // The distance J - I is J0 - I0 + (JStep - IStep)*T.
+  Level->Direction = DirNone;
+  static const unsigned Dirs[] = { DirLT, DirEQ, DirGT };
+  for (unsigned i = 0; i != 3; ++i) {
+    Interval Dist;
+    if (Dirs[i] != DirGT) Dist.raiseLo(Dirs[i] == DirLT ? 1 : 0);
+    if (Dirs[i] != DirLT) Dist.lowerHi(Dirs[i] == DirGT ? -1 : 0);
+    Interval TDir = T;
+    TDir.constrain(J0 - I0, JStep - IStep, Dist);
+    if (!TDir.isEmpty())
+      Level->Direction |= Dirs[i];
+  }
+  if (T.HasLo && T.HasHi && T.Lo == T.Hi)
+    Level->Distance = SE->getConstant(Delta->getType(),
+                                      J0 - I0 + (JStep - IStep) * T.Lo, true);
+  return Dependent;
 }
 
+/// analyseMIV - Apply the GCD test to an equation involving several loops,
+/// then the Banerjee inequalities under every combination of directions at
+/// those loops to find the directions that are possible.
 LoopDependenceAnalysis::DependenceResult
-LoopDependenceAnalysis::analyseMIV(const SCEV *A,
-                                   const SCEV *B,
-                                   Subscript *S) const {
-  return Unknown; // TODO: Implement.
+LoopDependenceAnalysis::analyseMIV(const LinearSubscript &Src,
+                                   const LinearSubscript &Dst, int64_t Delta,
+                                   SmallVectorImpl<DependenceLevel> &Levels)
+                                   const {
+  uint64_t G = 0;
+  SmallVector<unsigned, 4> Involved;
+  for (unsigned k = 0, e = Levels.size(); k != e; ++k) {
+    if (!Src.Coeffs[k] && !Dst.Coeffs[k])
+      continue;
+    Involved.push_back(k);
+    G = GreatestCommonDivisor64(G, std::abs(Src.Coeffs[k]));
+    G = GreatestCommonDivisor64(G, std::abs(Dst.Coeffs[k]));
+  }
+  if (Delta % int64_t(G) != 0) {
+    DEBUG(dbgs() << "  -> [I] MIV, gcd test\n");
+    return Independent;
+  }
+
+  // Enumerating direction vectors is exponential in the number of loops.
+  if (Involved.size() > 4)
+    return Unknown;
+
+  SmallVector<int64_t, 4> Max(Involved.size());
+  SmallVector<bool, 4> HasMax(Involved.size());
+  for (unsigned i = 0, e = Involved.size(); i != e; ++i)
+    HasMax[i] = getMaxIteration(Levels[Involved[i]].L, Max[i]);
+
+  static const unsigned Dirs[] = { DirLT, DirEQ, DirGT };
+  SmallVector<unsigned, 4> Feasible(Involved.size(), DirNone);
+  SmallVector<unsigned, 4> Choice(Involved.size(), 0);
+  for (;;) {
+    Interval Sum;
+    Sum.raiseLo(0);
+    Sum.lowerHi(0);
+    bool Possible = true;
+    for (unsigned i = 0, e = Involved.size(); i != e && Possible; ++i) {
+      unsigned Dir = Dirs[Choice[i]];
+      if (!(Levels[Involved[i]].Direction & Dir) ||
+          (Dir != DirEQ && HasMax[i] && Max[i] == 0))
+        Possible = false;
+      Sum = AddIntervals(Sum, GetBanerjeeBounds(Src.Coeffs[Involved[i]],
+                                                Dst.Coeffs[Involved[i]],
+                                                Dir, HasMax[i], Max[i]));
+    }
+    if (Possible && Sum.contains(Delta))
+      for (unsigned i = 0, e = Involved.size(); i != e; ++i)
+        Feasible[i] |= Dirs[Choice[i]];
+
+    // Advance to the next combination of directions.
+    unsigned i = 0;
+    for (; i != Involved.size() && Choice[i] == 2; ++i)
+      Choice[i] = 0;
+    if (i == Involved.size())
+      break;
+    ++Choice[i];
+  }
+
+  for (unsigned i = 0, e = Involved.size(); i != e; ++i) {
+    if (Feasible[i] == DirNone) {
+      DEBUG(dbgs() << "  -> [I] MIV, Banerjee test\n");
+      return Independent;
+    }
+    Levels[Involved[i]].Direction &= Feasible[i];
+  }
+  return Dependent;
 }
 
+/// analyseSubscript - Test one pair of subscripts, narrowing Levels down to
+/// the directions and distances that the pair permits.
 LoopDependenceAnalysis::DependenceResult
-LoopDependenceAnalysis::analyseSubscript(const SCEV *A,
-                                         const SCEV *B,
-                                         Subscript *S) const {
+LoopDependenceAnalysis::analyseSubscript(
+    const SCEV *A, const SCEV *B,
+    SmallVectorImpl<DependenceLevel> &Levels) const {
   DEBUG(dbgs() << "  Testing subscript: " << *A << ", " << *B << "\n");
 
-  if (A == B) {
-    DEBUG(dbgs() << "  -> [D] same SCEV\n");
-    return Dependent;
+  // GEP indices of different widths are sign extended to a common one.
+  Type *ATy = A->getType(), *BTy = B->getType();
+  if (ATy != BTy) {
+    if (SE->getTypeSizeInBits(ATy) < SE->getTypeSizeInBits(BTy))
+      A = SE->getSignExtendExpr(A, BTy);
+    else
+      B = SE->getSignExtendExpr(B, ATy);
   }
 
-  if (!isAffine(A) || !isAffine(B)) {
+  LinearSubscript Src, Dst;
+  if (!getLinearSubscript(A, Levels, Src) ||
+      !getLinearSubscript(B, Levels, Dst)) {
     DEBUG(dbgs() << "  -> [?] not affine\n");
     return Unknown;
   }
 
-  if (isZIVPair(A, B))
-    return analyseZIV(A, B, S);
-
-  if (isSIVPair(A, B))
-    return analyseSIV(A, B, S);
+  const SCEV *Delta = SE->getMinusSCEV(Dst.Const, Src.Const);
+  SmallVector<unsigned, 4> Involved;
+  for (unsigned k = 0, e = Levels.size(); k != e; ++k)
+    if (Src.Coeffs[k] || Dst.Coeffs[k])
+      Involved.push_back(k);
+
+  if (Involved.empty())
+    return analyseZIV(Delta);
+
+  if (Involved.size() == 1) {
+    DependenceLevel Level(Levels[Involved[0]].L);
+    DependenceResult Result = analyseSIV(Src.Coeffs[Involved[0]],
+                                         Dst.Coeffs[Involved[0]],
+                                         Delta, &Level);
+    if (Result != Dependent)
+      return Result;
+
+    // Every subscript computes its distance in its own type, so compare the
+    // values at a common width rather than the SCEVs themselves.
+    DependenceLevel &Old = Levels[Involved[0]];
+    const SCEVConstant *OldC = dyn_cast_or_null<SCEVConstant>(Old.Distance);
+    const SCEVConstant *NewC = dyn_cast_or_null<SCEVConstant>(Level.Distance);
+    if (OldC && NewC) {
+      APInt OldD = OldC->getValue()->getValue();
+      APInt NewD = NewC->getValue()->getValue();
+      unsigned Width = std::max(OldD.getBitWidth(), NewD.getBitWidth());
+      if (OldD.sextOrSelf(Width) != NewD.sextOrSelf(Width)) {
+        DEBUG(dbgs() << "  -> [I] conflicting distances\n");
+        return Independent;
+      }
+    }
+    Old.Direction &= Level.Direction;
+    if (!Old.Distance)
+      Old.Distance = Level.Distance;
+    return Old.Direction == DirNone ? Independent : Dependent;
+  }
 
-  return analyseMIV(A, B, S);
+  int64_t D;
+  if (!GetSmallConstant(Delta, D))
+    return Unknown;
+  return analyseMIV(Src, Dst, D, Levels);
 }
 
 LoopDependenceAnalysis::DependenceResult
 LoopDependenceAnalysis::analysePair(DependencePair *P) const {
   DEBUG(dbgs() << "Analysing:\n" << *P->A << "\n" << *P->B << "\n");
 
+  // The levels of the dependence are the loops that contain both accesses.
+  BasicBlock *ABB = cast<Instruction>(P->A)->getParent();
+  BasicBlock *BBB = cast<Instruction>(P->B)->getParent();
+  const Loop *Common = LI->getLoopFor(ABB);
+  while (Common && !Common->contains(BBB))
+    Common = Common->getParentLoop();
+  for (const Loop *L = Common; L; L = L->getParentLoop())
+    P->Levels.push_back(DependenceLevel(L));
+  std::reverse(P->Levels.begin(), P->Levels.end());
+
   // We only analyse loads and stores but no possible memory accesses by e.g.
   // free, call, or invoke instructions.
   if (!IsLoadOrStoreInst(P->A) || !IsLoadOrStoreInst(P->B)) {
@@ -244,53 +635,79 @@ LoopDependenceAnalysis::analysePair(DependencePair *P) const {
   const GEPOperator *aGEP = dyn_cast<GEPOperator>(aPtr);
   const GEPOperator *bGEP = dyn_cast<GEPOperator>(bPtr);
 
-  if (!aGEP || !bGEP)
+  // Comparing subscripts only makes sense when both accesses index the same
+  // pointer the same way.
+  if (!aGEP || !bGEP ||
+      aGEP->getPointerOperand() != bGEP->getPointerOperand() ||
+      aGEP->getNumIndices() != bGEP->getNumIndices() ||
+      aPtr->getType() != bPtr->getType())
     return Unknown;
 
   // FIXME: Is filtering coupled subscripts necessary?
 
-  // Collect GEP operand pairs (FIXME: use GetGEPOperands from BasicAA), adding
-  // trailing zeroes to the smaller GEP, if needed.
   typedef SmallVector<std::pair<const SCEV*, const SCEV*>, 4> GEPOpdPairsTy;
   GEPOpdPairsTy opds;
-  for(GEPOperator::const_op_iterator aIdx = aGEP->idx_begin(),
-                                     aEnd = aGEP->idx_end(),
-                                     bIdx = bGEP->idx_begin(),
-                                     bEnd = bGEP->idx_end();
-      aIdx != aEnd && bIdx != bEnd;
-      aIdx += (aIdx != aEnd), bIdx += (bIdx != bEnd)) {
-    const SCEV* aSCEV = (aIdx != aEnd) ? SE->getSCEV(*aIdx) : GetZeroSCEV(SE);
-    const SCEV* bSCEV = (bIdx != bEnd) ? SE->getSCEV(*bIdx) : GetZeroSCEV(SE);
-    opds.push_back(std::make_pair(aSCEV, bSCEV));
+  for (GEPOperator::const_op_iterator aIdx = aGEP->idx_begin(),
+                                      aEnd = aGEP->idx_end(),
+                                      bIdx = bGEP->idx_begin();
+       aIdx != aEnd; ++aIdx, ++bIdx)
+    opds.push_back(std::make_pair(SE->getSCEV(*aIdx), SE->getSCEV(*bIdx)));
+
+  // The first index steps over whole objects, so it is only a subscript of
+  // its own when there are no further ones.  Otherwise its range is unknown
+  // and x[1][-1] may be x[0][255].
+  //
+  // TODO: this could be relaxed by adding the size of the underlying object
+  // to the first subscript. If we have e.g. (GEP x,0,i; GEP x,2,-i) and we
+  // know that x is a [100 x i8]*, we could modify the first subscript to be
+  // (i, 200-i) instead of (i, -i).
+  GEPOpdPairsTy::const_iterator First = opds.begin();
+  if (opds.size() > 1) {
+    if (First->first != First->second)
+      return Unknown;
+    ++First;
   }
 
-  if (!opds.empty() && opds[0].first != opds[0].second) {
-    // We cannot (yet) handle arbitrary GEP pointer offsets. By limiting
-    //
-    // TODO: this could be relaxed by adding the size of the underlying object
-    // to the first subscript. If we have e.g. (GEP x,0,i; GEP x,2,-i) and we
-    // know that x is a [100 x i8]*, we could modify the first subscript to be
-    // (i, 200-i) instead of (i, -i).
-    return Unknown;
+  DependenceResult Result = Dependent;
+  for (GEPOpdPairsTy::const_iterator i = First, end = opds.end();
+       i != end; ++i) {
+    switch (analyseSubscript(i->first, i->second, P->Levels)) {
+    case Independent:
+      // A single subscript that can never be equal is enough.
+      return Independent;
+    case Unknown:
+      Result = Unknown;
+      break;
+    case Dependent:
+      break;
+    }
   }
 
-  // Now analyse the collected operand pairs (skipping the GEP ptr offsets).
-  for (GEPOpdPairsTy::const_iterator i = opds.begin() + 1, end = opds.end();
-       i != end; ++i) {
-    Subscript subscript;
-    DependenceResult result = analyseSubscript(i->first, i->second, &subscript);
-    if (result != Dependent) {
-      // We either proved independence or failed to analyse this subscript.
-      // Further subscripts will not improve the situation, so abort early.
-      return result;
+  // A distance that disagrees with the direction leaves no dependence.
+  for (unsigned k = 0, e = P->Levels.size(); k != e; ++k) {
+    const SCEVConstant *Dist =
+      dyn_cast_or_null<SCEVConstant>(P->Levels[k].Distance);
+    if (!Dist)
+      continue;
+    const APInt &V = Dist->getValue()->getValue();
+    unsigned Dir = V.isStrictlyPositive() ? DirLT :
+                   V.isNegative() ? DirGT : DirEQ;
+    if (!(P->Levels[k].Direction & Dir)) {
+      DEBUG(dbgs() << "  -> [I] distance contradicts direction\n");
+      return Independent;
     }
-    P->Subscripts.push_back(subscript);
+    P->Levels[k].Direction = Dir;
   }
-  // We successfully analysed all subscripts but failed to prove independence.
-  return Dependent;
+  return Result;
 }
 
 bool LoopDependenceAnalysis::depends(Value *A, Value *B) {
+  SmallVector<DependenceLevel, 4> Levels;
+  return depends(A, B, Levels);
+}
+
+bool LoopDependenceAnalysis::depends(Value *A, Value *B,
+                                     SmallVectorImpl<DependenceLevel> &Levels) {
   assert(isDependencePair(A, B) && "Values form no dependence pair!");
   ++NumAnswered;
 
@@ -304,6 +721,8 @@ bool LoopDependenceAnalysis::depends(Value *A, Value *B) {
     case Unknown:     ++NumUnknown;     break;
     }
   }
+  Levels.clear();
+  Levels.append(p->Levels.begin(), p->Levels.end());
   return p->Result != Independent;
 }
 
@@ -315,6 +734,7 @@ bool LoopDependenceAnalysis::runOnLoop(Loop *L, LPPassManager &) {
   this->L = L;
   AA = &getAnalysis<AliasAnalysis>();
   SE = &getAnalysis<ScalarEvolution>();
+  LI = &getAnalysis<LoopInfo>();
   return false;
 }
 
@@ -327,6 +747,22 @@ void LoopDependenceAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
   AU.addRequiredTransitive<AliasAnalysis>();
   AU.addRequiredTransitive<ScalarEvolution>();
+  AU.addRequiredTransitive<LoopInfo>();
+}
+
+/// PrintDependenceLevel - Print the distance of a dependence at one level if
+/// it is a known constant, and its direction otherwise.
+static void PrintDependenceLevel(
+    raw_ostream &OS, const LoopDependenceAnalysis::DependenceLevel &Level) {
+  if (const SCEVConstant *C =
+        dyn_cast_or_null<SCEVConstant>(Level.Distance)) {
+    OS << C->getValue()->getValue();
+    return;
+  }
+  static const char *const Names[] = {
+    "none", "<", "=", "<=", ">", "<>", ">=", "*"
+  };
+  OS << Names[Level.Direction];
 }
 
 static void PrintLoopInfo(raw_ostream &OS,
@@ -346,14 +782,26 @@ static void PrintLoopInfo(raw_ostream &OS,
     OS << "\t" << (x - memrefs.begin()) << ": " << **x << "\n";
 
   OS << "  Pairwise dependence results:\n";
+  SmallVector<LoopDependenceAnalysis::DependenceLevel, 4> levels;
   for (SmallVector<Instruction*, 8>::const_iterator x = memrefs.begin(),
        end = memrefs.end(); x != end; ++x)
     for (SmallVector<Instruction*, 8>::const_iterator y = x + 1;
-         y != end; ++y)
-      if (LDA->isDependencePair(*x, *y))
-        OS << "\t" << (x - memrefs.begin()) << "," << (y - memrefs.begin())
-           << ": " << (LDA->depends(*x, *y) ? "dependent" : "independent")
-           << "\n";
+         y != end; ++y) {
+      if (!LDA->isDependencePair(*x, *y))
+        continue;
+      OS << "\t" << (x - memrefs.begin()) << "," << (y - memrefs.begin())
+         << ": ";
+      if (!LDA->depends(*x, *y, levels)) {
+        OS << "independent\n";
+        continue;
+      }
+      OS << "dependent [";
+      for (unsigned i = 0, e = levels.size(); i != e; ++i) {
+        if (i) OS << " ";
+        PrintDependenceLevel(OS, levels[i]);
+      }
+      OS << "]\n";
+    }
 }
 
 void LoopDependenceAnalysis::print(raw_ostream &OS, const Module*) const {
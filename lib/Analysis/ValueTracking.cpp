@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "valuetracking"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Constants.h"
@@ -27,13 +28,66 @@
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/PatternMatch.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include <cstring>
 using namespace llvm;
 using namespace llvm::PatternMatch;
 
 const unsigned MaxDepth = 6;
 
+STATISTIC(NumKnownBitsLookups, "Number of known-bits cache lookups");
+STATISTIC(NumKnownBitsHits,    "Number of known-bits cache hits");
+STATISTIC(NumSignBitsLookups,  "Number of sign-bits cache lookups");
+STATISTIC(NumSignBitsHits,     "Number of sign-bits cache hits");
+
+namespace {
+  /// KnownBitsEntry - The known bits of a value, and the search depth they
+  /// were computed at.  A result computed at a smaller depth had a larger
+  /// search budget, so it can answer any query at the same or a greater depth.
+  struct KnownBitsEntry {
+    APInt KnownZero, KnownOne;
+    unsigned Depth;
+    KnownBitsEntry(const APInt &Zero, const APInt &One, unsigned D)
+      : KnownZero(Zero), KnownOne(One), Depth(D) {}
+  };
+
+  /// KnownBitsCache - Memoizes the operators visited by a single top-level
+  /// ComputeMaskedBits query.  Expressions that reuse a value, like
+  /// (X+Y)*(X-Y), would otherwise analyze it once per path, which grows
+  /// exponentially with the search depth.  The cache only lives as long as
+  /// the query, so it never sees the IR change underneath it.
+  typedef SmallDenseMap<Value*, KnownBitsEntry, 8> KnownBitsCache;
+
+  /// SignBitsEntry - The number of sign bits of a value, and the search depth
+  /// it was computed at, with the same reuse rule as KnownBitsEntry.
+  struct SignBitsEntry {
+    unsigned NumSignBits;
+    unsigned Depth;
+    SignBitsEntry(unsigned N, unsigned D) : NumSignBits(N), Depth(D) {}
+  };
+
+  /// SignBitsCache - Memoizes the operators visited by a single top-level
+  /// ComputeNumSignBits query, like KnownBitsCache does for
+  /// ComputeMaskedBits.
+  typedef SmallDenseMap<Value*, SignBitsEntry, 8> SignBitsCache;
+}
+
+static void computeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
+                              const TargetData *TD, unsigned Depth,
+                              KnownBitsCache &Cache);
+static void computeMaskedBitsOperator(Operator *I, APInt &KnownZero,
+                                      APInt &KnownOne, const TargetData *TD,
+                                      unsigned Depth, KnownBitsCache &Cache);
+static unsigned computeNumSignBits(Value *V, const TargetData *TD,
+                                   unsigned Depth, SignBitsCache &Cache,
+                                   KnownBitsCache &KnownCache);
+static unsigned computeNumSignBitsUncached(Value *V, const TargetData *TD,
+                                           unsigned Depth,
+                                           SignBitsCache &Cache,
+                                           KnownBitsCache &KnownCache);
+
 /// getBitWidth - Returns the bitwidth of the given scalar or pointer type (if
 /// unknown returns 0).  For vector types, returns the element type's bitwidth.
 static unsigned getBitWidth(Type *Ty, const TargetData *TD) {
@@ -46,7 +100,8 @@ static unsigned getBitWidth(Type *Ty, const TargetData *TD) {
 static void ComputeMaskedBitsAddSub(bool Add, Value *Op0, Value *Op1, bool NSW,
                                     APInt &KnownZero, APInt &KnownOne,
                                     APInt &KnownZero2, APInt &KnownOne2,
-                                    const TargetData *TD, unsigned Depth) {
+                                    const TargetData *TD, unsigned Depth,
+                                    KnownBitsCache &Cache) {
   if (!Add) {
     if (ConstantInt *CLHS = dyn_cast<ConstantInt>(Op0)) {
       // We know that the top bits of C-X are clear if X contains less bits
@@ -57,7 +112,7 @@ static void ComputeMaskedBitsAddSub(bool Add, Value *Op0, Value *Op1, bool NSW,
         unsigned NLZ = (CLHS->getValue()+1).countLeadingZeros();
         // NLZ can't be BitWidth with no sign bit
         APInt MaskV = APInt::getHighBitsSet(BitWidth, NLZ+1);
-        llvm::ComputeMaskedBits(Op1, KnownZero2, KnownOne2, TD, Depth+1);
+        computeMaskedBits(Op1, KnownZero2, KnownOne2, TD, Depth+1, Cache);
     
         // If all of the MaskV bits are known to be zero, then we know the
         // output top bits are zero, because we now know that the output is
@@ -78,12 +133,12 @@ static void ComputeMaskedBitsAddSub(bool Add, Value *Op0, Value *Op1, bool NSW,
   // result. For an add, this works with either operand. For a subtract,
   // this only works if the known zeros are in the right operand.
   APInt LHSKnownZero(BitWidth, 0), LHSKnownOne(BitWidth, 0);
-  llvm::ComputeMaskedBits(Op0, LHSKnownZero, LHSKnownOne, TD, Depth+1);
+  computeMaskedBits(Op0, LHSKnownZero, LHSKnownOne, TD, Depth+1, Cache);
   assert((LHSKnownZero & LHSKnownOne) == 0 &&
          "Bits known to be one AND zero?");
   unsigned LHSKnownZeroOut = LHSKnownZero.countTrailingOnes();
 
-  llvm::ComputeMaskedBits(Op1, KnownZero2, KnownOne2, TD, Depth+1);
+  computeMaskedBits(Op1, KnownZero2, KnownOne2, TD, Depth+1, Cache);
   assert((KnownZero2 & KnownOne2) == 0 && "Bits known to be one AND zero?"); 
   unsigned RHSKnownZeroOut = KnownZero2.countTrailingOnes();
 
@@ -132,10 +187,11 @@ static void ComputeMaskedBitsAddSub(bool Add, Value *Op0, Value *Op1, bool NSW,
 static void ComputeMaskedBitsMul(Value *Op0, Value *Op1, bool NSW,
                                  APInt &KnownZero, APInt &KnownOne,
                                  APInt &KnownZero2, APInt &KnownOne2,
-                                 const TargetData *TD, unsigned Depth) {
+                                 const TargetData *TD, unsigned Depth,
+                                 KnownBitsCache &Cache) {
   unsigned BitWidth = KnownZero.getBitWidth();
-  ComputeMaskedBits(Op1, KnownZero, KnownOne, TD, Depth+1);
-  ComputeMaskedBits(Op0, KnownZero2, KnownOne2, TD, Depth+1);
+  computeMaskedBits(Op1, KnownZero, KnownOne, TD, Depth+1, Cache);
+  computeMaskedBits(Op0, KnownZero2, KnownOne2, TD, Depth+1, Cache);
   assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?");
   assert((KnownZero2 & KnownOne2) == 0 && "Bits known to be one AND zero?");
 
@@ -225,8 +281,9 @@ void llvm::computeMaskedBitsLoad(const MDNode &Ranges, APInt &KnownZero) {
 /// where V is a vector, known zero, and known one values are the
 /// same width as the vector element, and the bit is set only if it is true
 /// for all of the elements in the vector.
-void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
-                             const TargetData *TD, unsigned Depth) {
+static void computeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
+                              const TargetData *TD, unsigned Depth,
+                              KnownBitsCache &Cache) {
   assert(V && "No Value?");
   assert(Depth <= MaxDepth && "Limit Search Depth");
   unsigned BitWidth = KnownZero.getBitWidth();
@@ -302,7 +359,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     if (GA->mayBeOverridden()) {
       KnownZero.clearAllBits(); KnownOne.clearAllBits();
     } else {
-      ComputeMaskedBits(GA->getAliasee(), KnownZero, KnownOne, TD, Depth+1);
+      computeMaskedBits(GA->getAliasee(), KnownZero, KnownOne, TD, Depth+1,
+                        Cache);
     }
     return;
   }
@@ -325,6 +383,35 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
   Operator *I = dyn_cast<Operator>(V);
   if (!I) return;
 
+  // Reuse the result of an earlier visit in this query if it searched at
+  // least as deep as we would.
+  ++NumKnownBitsLookups;
+  KnownBitsCache::iterator CI = Cache.find(V);
+  if (CI != Cache.end() && CI->second.Depth <= Depth) {
+    ++NumKnownBitsHits;
+    KnownZero = CI->second.KnownZero;
+    KnownOne = CI->second.KnownOne;
+    return;
+  }
+
+  computeMaskedBitsOperator(I, KnownZero, KnownOne, TD, Depth, Cache);
+
+  // The recursion may have visited V again through a phi at a greater depth,
+  // so overwrite any entry it left behind.
+  KnownBitsEntry Entry(KnownZero, KnownOne, Depth);
+  std::pair<KnownBitsCache::iterator, bool> Ins =
+    Cache.insert(std::make_pair(V, Entry));
+  if (!Ins.second)
+    Ins.first->second = Entry;
+}
+
+/// computeMaskedBitsOperator - Compute the known bits of an operator by
+/// looking through its operands.  This is the recursive part of
+/// computeMaskedBits, whose results are memoized in Cache.
+static void computeMaskedBitsOperator(Operator *I, APInt &KnownZero,
+                                      APInt &KnownOne, const TargetData *TD,
+                                      unsigned Depth, KnownBitsCache &Cache) {
+  unsigned BitWidth = KnownZero.getBitWidth();
   APInt KnownZero2(KnownZero), KnownOne2(KnownOne);
   switch (I->getOpcode()) {
   default: break;
@@ -334,8 +421,10 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     return;
   case Instruction::And: {
     // If either the LHS or the RHS are Zero, the result is zero.
-    ComputeMaskedBits(I->getOperand(1), KnownZero, KnownOne, TD, Depth+1);
-    ComputeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1);
+    computeMaskedBits(I->getOperand(1), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
+    computeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1,
+                      Cache);
     assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
     assert((KnownZero2 & KnownOne2) == 0 && "Bits known to be one AND zero?"); 
     
@@ -346,8 +435,10 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     return;
   }
   case Instruction::Or: {
-    ComputeMaskedBits(I->getOperand(1), KnownZero, KnownOne, TD, Depth+1);
-    ComputeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1);
+    computeMaskedBits(I->getOperand(1), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
+    computeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1,
+                      Cache);
     assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
     assert((KnownZero2 & KnownOne2) == 0 && "Bits known to be one AND zero?"); 
     
@@ -358,8 +449,10 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     return;
   }
   case Instruction::Xor: {
-    ComputeMaskedBits(I->getOperand(1), KnownZero, KnownOne, TD, Depth+1);
-    ComputeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1);
+    computeMaskedBits(I->getOperand(1), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
+    computeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1,
+                      Cache);
     assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
     assert((KnownZero2 & KnownOne2) == 0 && "Bits known to be one AND zero?"); 
     
@@ -373,19 +466,22 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
   case Instruction::Mul: {
     bool NSW = cast<OverflowingBinaryOperator>(I)->hasNoSignedWrap();
     ComputeMaskedBitsMul(I->getOperand(0), I->getOperand(1), NSW,
-                         KnownZero, KnownOne, KnownZero2, KnownOne2, TD, Depth);
+                         KnownZero, KnownOne, KnownZero2, KnownOne2, TD, Depth,
+                         Cache);
     break;
   }
   case Instruction::UDiv: {
     // For the purposes of computing leading zeros we can conservatively
     // treat a udiv as a logical right shift by the power of 2 known to
     // be less than the denominator.
-    ComputeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1);
+    computeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1,
+                      Cache);
     unsigned LeadZ = KnownZero2.countLeadingOnes();
 
     KnownOne2.clearAllBits();
     KnownZero2.clearAllBits();
-    ComputeMaskedBits(I->getOperand(1), KnownZero2, KnownOne2, TD, Depth+1);
+    computeMaskedBits(I->getOperand(1), KnownZero2, KnownOne2, TD, Depth+1,
+                      Cache);
     unsigned RHSUnknownLeadingOnes = KnownOne2.countLeadingZeros();
     if (RHSUnknownLeadingOnes != BitWidth)
       LeadZ = std::min(BitWidth,
@@ -395,9 +491,10 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     return;
   }
   case Instruction::Select:
-    ComputeMaskedBits(I->getOperand(2), KnownZero, KnownOne, TD, Depth+1);
-    ComputeMaskedBits(I->getOperand(1), KnownZero2, KnownOne2, TD,
-                      Depth+1);
+    computeMaskedBits(I->getOperand(2), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
+    computeMaskedBits(I->getOperand(1), KnownZero2, KnownOne2, TD,
+                      Depth+1, Cache);
     assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
     assert((KnownZero2 & KnownOne2) == 0 && "Bits known to be one AND zero?"); 
 
@@ -431,7 +528,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     
     KnownZero = KnownZero.zextOrTrunc(SrcBitWidth);
     KnownOne = KnownOne.zextOrTrunc(SrcBitWidth);
-    ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
+    computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
     KnownZero = KnownZero.zextOrTrunc(BitWidth);
     KnownOne = KnownOne.zextOrTrunc(BitWidth);
     // Any top bits are known to be zero.
@@ -445,7 +543,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
         // TODO: For now, not handling conversions like:
         // (bitcast i64 %x to <2 x i32>)
         !I->getType()->isVectorTy()) {
-      ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
+      computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                        Cache);
       return;
     }
     break;
@@ -456,7 +555,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
       
     KnownZero = KnownZero.trunc(SrcBitWidth);
     KnownOne = KnownOne.trunc(SrcBitWidth);
-    ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
+    computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
     assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
     KnownZero = KnownZero.zext(BitWidth);
     KnownOne = KnownOne.zext(BitWidth);
@@ -473,7 +573,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     // (shl X, C1) & C2 == 0   iff   (X & C2 >>u C1) == 0
     if (ConstantInt *SA = dyn_cast<ConstantInt>(I->getOperand(1))) {
       uint64_t ShiftAmt = SA->getLimitedValue(BitWidth);
-      ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
+      computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                        Cache);
       assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
       KnownZero <<= ShiftAmt;
       KnownOne  <<= ShiftAmt;
@@ -488,7 +589,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
       uint64_t ShiftAmt = SA->getLimitedValue(BitWidth);
       
       // Unsigned shift right.
-      ComputeMaskedBits(I->getOperand(0), KnownZero,KnownOne, TD, Depth+1);
+      computeMaskedBits(I->getOperand(0), KnownZero,KnownOne, TD, Depth+1,
+                        Cache);
       assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
       KnownZero = APIntOps::lshr(KnownZero, ShiftAmt);
       KnownOne  = APIntOps::lshr(KnownOne, ShiftAmt);
@@ -504,7 +606,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
       uint64_t ShiftAmt = SA->getLimitedValue(BitWidth-1);
       
       // Signed shift right.
-      ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
+      computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                        Cache);
       assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?"); 
       KnownZero = APIntOps::lshr(KnownZero, ShiftAmt);
       KnownOne  = APIntOps::lshr(KnownOne, ShiftAmt);
@@ -521,14 +624,14 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     bool NSW = cast<OverflowingBinaryOperator>(I)->hasNoSignedWrap();
     ComputeMaskedBitsAddSub(false, I->getOperand(0), I->getOperand(1), NSW,
                             KnownZero, KnownOne, KnownZero2, KnownOne2, TD,
-                            Depth);
+                            Depth, Cache);
     break;
   }
   case Instruction::Add: {
     bool NSW = cast<OverflowingBinaryOperator>(I)->hasNoSignedWrap();
     ComputeMaskedBitsAddSub(true, I->getOperand(0), I->getOperand(1), NSW,
                             KnownZero, KnownOne, KnownZero2, KnownOne2, TD,
-                            Depth);
+                            Depth, Cache);
     break;
   }
   case Instruction::SRem:
@@ -536,7 +639,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
       APInt RA = Rem->getValue().abs();
       if (RA.isPowerOf2()) {
         APInt LowBits = RA - 1;
-        ComputeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1);
+        computeMaskedBits(I->getOperand(0), KnownZero2, KnownOne2, TD, Depth+1,
+                          Cache);
 
         // The low bits of the first operand are unchanged by the srem.
         KnownZero = KnownZero2 & LowBits;
@@ -560,8 +664,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     // remainder is zero.
     if (KnownZero.isNonNegative()) {
       APInt LHSKnownZero(BitWidth, 0), LHSKnownOne(BitWidth, 0);
-      ComputeMaskedBits(I->getOperand(0), LHSKnownZero, LHSKnownOne, TD,
-                        Depth+1);
+      computeMaskedBits(I->getOperand(0), LHSKnownZero, LHSKnownOne, TD,
+                        Depth+1, Cache);
       // If it's known zero, our sign bit is also zero.
       if (LHSKnownZero.isNegative())
         KnownZero.setBit(BitWidth - 1);
@@ -573,8 +677,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
       APInt RA = Rem->getValue();
       if (RA.isPowerOf2()) {
         APInt LowBits = (RA - 1);
-        ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD,
-                          Depth+1);
+        computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD,
+                          Depth+1, Cache);
         assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?");
         KnownZero |= ~LowBits;
         KnownOne &= LowBits;
@@ -584,8 +688,10 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
 
     // Since the result is less than or equal to either operand, any leading
     // zero bits in either operand must also exist in the result.
-    ComputeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
-    ComputeMaskedBits(I->getOperand(1), KnownZero2, KnownOne2, TD, Depth+1);
+    computeMaskedBits(I->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                      Cache);
+    computeMaskedBits(I->getOperand(1), KnownZero2, KnownOne2, TD, Depth+1,
+                      Cache);
 
     unsigned Leaders = std::max(KnownZero.countLeadingOnes(),
                                 KnownZero2.countLeadingOnes());
@@ -595,7 +701,7 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
   }
 
   case Instruction::Alloca: {
-    AllocaInst *AI = cast<AllocaInst>(V);
+    AllocaInst *AI = cast<AllocaInst>(I);
     unsigned Align = AI->getAlignment();
     if (Align == 0 && TD)
       Align = TD->getABITypeAlignment(AI->getType()->getElementType());
@@ -608,8 +714,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
     // Analyze all of the subscripts of this getelementptr instruction
     // to determine if we can prove known low zero bits.
     APInt LocalKnownZero(BitWidth, 0), LocalKnownOne(BitWidth, 0);
-    ComputeMaskedBits(I->getOperand(0), LocalKnownZero, LocalKnownOne, TD,
-                      Depth+1);
+    computeMaskedBits(I->getOperand(0), LocalKnownZero, LocalKnownOne, TD,
+                      Depth+1, Cache);
     unsigned TrailZ = LocalKnownZero.countTrailingOnes();
 
     gep_type_iterator GTI = gep_type_begin(I);
@@ -630,7 +736,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
         unsigned GEPOpiBits = Index->getType()->getScalarSizeInBits();
         uint64_t TypeSize = TD ? TD->getTypeAllocSize(IndexedTy) : 1;
         LocalKnownZero = LocalKnownOne = APInt(GEPOpiBits, 0);
-        ComputeMaskedBits(Index, LocalKnownZero, LocalKnownOne, TD, Depth+1);
+        computeMaskedBits(Index, LocalKnownZero, LocalKnownOne, TD, Depth+1,
+                          Cache);
         TrailZ = std::min(TrailZ,
                           unsigned(CountTrailingZeros_64(TypeSize) +
                                    LocalKnownZero.countTrailingOnes()));
@@ -672,11 +779,11 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
             break;
           // Ok, we have a PHI of the form L op= R. Check for low
           // zero bits.
-          ComputeMaskedBits(R, KnownZero2, KnownOne2, TD, Depth+1);
+          computeMaskedBits(R, KnownZero2, KnownOne2, TD, Depth+1, Cache);
 
           // We need to take the minimum number of known bits
           APInt KnownZero3(KnownZero), KnownOne3(KnownOne);
-          ComputeMaskedBits(L, KnownZero3, KnownOne3, TD, Depth+1);
+          computeMaskedBits(L, KnownZero3, KnownOne3, TD, Depth+1, Cache);
 
           KnownZero = APInt::getLowBitsSet(BitWidth,
                                            std::min(KnownZero2.countTrailingOnes(),
@@ -707,8 +814,8 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
         KnownOne2 = APInt(BitWidth, 0);
         // Recurse, but cap the recursion to one level, because we don't
         // want to waste time spinning around in loops.
-        ComputeMaskedBits(P->getIncomingValue(i), KnownZero2, KnownOne2, TD,
-                          MaxDepth-1);
+        computeMaskedBits(P->getIncomingValue(i), KnownZero2, KnownOne2, TD,
+                          MaxDepth-1, Cache);
         KnownZero &= KnownZero2;
         KnownOne &= KnownOne2;
         // If all bits have been ruled out, there's no need to check
@@ -755,19 +862,21 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
         case Intrinsic::sadd_with_overflow:
           ComputeMaskedBitsAddSub(true, II->getArgOperand(0),
                                   II->getArgOperand(1), false, KnownZero,
-                                  KnownOne, KnownZero2, KnownOne2, TD, Depth);
+                                  KnownOne, KnownZero2, KnownOne2, TD, Depth,
+                                  Cache);
           break;
         case Intrinsic::usub_with_overflow:
         case Intrinsic::ssub_with_overflow:
           ComputeMaskedBitsAddSub(false, II->getArgOperand(0),
                                   II->getArgOperand(1), false, KnownZero,
-                                  KnownOne, KnownZero2, KnownOne2, TD, Depth);
+                                  KnownOne, KnownZero2, KnownOne2, TD, Depth,
+                                  Cache);
           break;
         case Intrinsic::umul_with_overflow:
         case Intrinsic::smul_with_overflow:
           ComputeMaskedBitsMul(II->getArgOperand(0), II->getArgOperand(1),
                                false, KnownZero, KnownOne,
-                               KnownZero2, KnownOne2, TD, Depth);
+                               KnownZero2, KnownOne2, TD, Depth, Cache);
           break;
         }
       }
@@ -775,6 +884,12 @@ void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
   }
 }
 
+void llvm::ComputeMaskedBits(Value *V, APInt &KnownZero, APInt &KnownOne,
+                             const TargetData *TD, unsigned Depth) {
+  KnownBitsCache Cache;
+  computeMaskedBits(V, KnownZero, KnownOne, TD, Depth, Cache);
+}
+
 /// ComputeSignBit - Determine whether the sign bit is known to be zero or
 /// one.  Convenience wrapper around ComputeMaskedBits.
 void llvm::ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
@@ -1008,6 +1123,47 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
   assert((TD || V->getType()->isIntOrIntVectorTy()) &&
          "ComputeNumSignBits requires a TargetData object to operate "
          "on non-integer values!");
+  SignBitsCache Cache;
+  KnownBitsCache KnownCache;
+  return computeNumSignBits(V, TD, Depth, Cache, KnownCache);
+}
+
+static unsigned computeNumSignBits(Value *V, const TargetData *TD,
+                                   unsigned Depth, SignBitsCache &Cache,
+                                   KnownBitsCache &KnownCache) {
+  if (Depth == MaxDepth)
+    return 1;  // Limit search depth.
+  if (!isa<Operator>(V))
+    return computeNumSignBitsUncached(V, TD, Depth, Cache, KnownCache);
+
+  // Reuse the result of an earlier visit in this query if it searched at
+  // least as deep as we would.
+  ++NumSignBitsLookups;
+  SignBitsCache::iterator CI = Cache.find(V);
+  if (CI != Cache.end() && CI->second.Depth <= Depth) {
+    ++NumSignBitsHits;
+    return CI->second.NumSignBits;
+  }
+
+  unsigned NumSignBits =
+    computeNumSignBitsUncached(V, TD, Depth, Cache, KnownCache);
+
+  // As in computeMaskedBits, overwrite any deeper entry left by a phi.
+  SignBitsEntry Entry(NumSignBits, Depth);
+  std::pair<SignBitsCache::iterator, bool> Ins =
+    Cache.insert(std::make_pair(V, Entry));
+  if (!Ins.second)
+    Ins.first->second = Entry;
+  return NumSignBits;
+}
+
+/// computeNumSignBitsUncached - The recursive part of ComputeNumSignBits,
+/// whose results are memoized in Cache.  The known bits it asks for along the
+/// way are shared through KnownCache.
+static unsigned computeNumSignBitsUncached(Value *V, const TargetData *TD,
+                                           unsigned Depth,
+                                           SignBitsCache &Cache,
+                                           KnownBitsCache &KnownCache) {
   Type *Ty = V->getType();
   unsigned TyBits = TD ? TD->getTypeSizeInBits(V->getType()->getScalarType()) :
                          Ty->getScalarSizeInBits();
@@ -1017,18 +1173,16 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
   // Note that ConstantInt is handled by the general ComputeMaskedBits case
   // below.
 
-  if (Depth == 6)
-    return 1;  // Limit search depth.
-  
   Operator *U = dyn_cast<Operator>(V);
   switch (Operator::getOpcode(V)) {
   default: break;
   case Instruction::SExt:
     Tmp = TyBits - U->getOperand(0)->getType()->getScalarSizeInBits();
-    return ComputeNumSignBits(U->getOperand(0), TD, Depth+1) + Tmp;
+    return computeNumSignBits(U->getOperand(0), TD, Depth+1, Cache,
+                              KnownCache) + Tmp;
     
   case Instruction::AShr: {
-    Tmp = ComputeNumSignBits(U->getOperand(0), TD, Depth+1);
+    Tmp = computeNumSignBits(U->getOperand(0), TD, Depth+1, Cache, KnownCache);
     // ashr X, C   -> adds C sign bits.  Vectors too.
     const APInt *ShAmt;
     if (match(U->getOperand(1), m_APInt(ShAmt))) {
@@ -1041,7 +1195,8 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
     const APInt *ShAmt;
     if (match(U->getOperand(1), m_APInt(ShAmt))) {
       // shl destroys sign bits.
-      Tmp = ComputeNumSignBits(U->getOperand(0), TD, Depth+1);
+      Tmp = computeNumSignBits(U->getOperand(0), TD, Depth+1, Cache,
+                               KnownCache);
       Tmp2 = ShAmt->getZExtValue();
       if (Tmp2 >= TyBits ||      // Bad shift.
           Tmp2 >= Tmp) break;    // Shifted all sign bits out.
@@ -1053,9 +1208,10 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
   case Instruction::Or:
   case Instruction::Xor:    // NOT is handled here.
     // Logical binary ops preserve the number of sign bits at the worst.
-    Tmp = ComputeNumSignBits(U->getOperand(0), TD, Depth+1);
+    Tmp = computeNumSignBits(U->getOperand(0), TD, Depth+1, Cache, KnownCache);
     if (Tmp != 1) {
-      Tmp2 = ComputeNumSignBits(U->getOperand(1), TD, Depth+1);
+      Tmp2 = computeNumSignBits(U->getOperand(1), TD, Depth+1, Cache,
+                                KnownCache);
       FirstAnswer = std::min(Tmp, Tmp2);
       // We computed what we know about the sign bits as our first
       // answer. Now proceed to the generic code that uses
@@ -1064,22 +1220,23 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
     break;
 
   case Instruction::Select:
-    Tmp = ComputeNumSignBits(U->getOperand(1), TD, Depth+1);
+    Tmp = computeNumSignBits(U->getOperand(1), TD, Depth+1, Cache, KnownCache);
     if (Tmp == 1) return 1;  // Early out.
-    Tmp2 = ComputeNumSignBits(U->getOperand(2), TD, Depth+1);
+    Tmp2 = computeNumSignBits(U->getOperand(2), TD, Depth+1, Cache, KnownCache);
     return std::min(Tmp, Tmp2);
     
   case Instruction::Add:
     // Add can have at most one carry bit.  Thus we know that the output
     // is, at worst, one more bit than the inputs.
-    Tmp = ComputeNumSignBits(U->getOperand(0), TD, Depth+1);
+    Tmp = computeNumSignBits(U->getOperand(0), TD, Depth+1, Cache, KnownCache);
     if (Tmp == 1) return 1;  // Early out.
       
     // Special case decrementing a value (ADD X, -1):
     if (ConstantInt *CRHS = dyn_cast<ConstantInt>(U->getOperand(1)))
       if (CRHS->isAllOnesValue()) {
         APInt KnownZero(TyBits, 0), KnownOne(TyBits, 0);
-        ComputeMaskedBits(U->getOperand(0), KnownZero, KnownOne, TD, Depth+1);
+        computeMaskedBits(U->getOperand(0), KnownZero, KnownOne, TD, Depth+1,
+                          KnownCache);
         
         // If the input is known to be 0 or 1, the output is 0/-1, which is all
         // sign bits set.
@@ -1092,19 +1249,20 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
           return Tmp;
       }
       
-    Tmp2 = ComputeNumSignBits(U->getOperand(1), TD, Depth+1);
+    Tmp2 = computeNumSignBits(U->getOperand(1), TD, Depth+1, Cache, KnownCache);
     if (Tmp2 == 1) return 1;
     return std::min(Tmp, Tmp2)-1;
     
   case Instruction::Sub:
-    Tmp2 = ComputeNumSignBits(U->getOperand(1), TD, Depth+1);
+    Tmp2 = computeNumSignBits(U->getOperand(1), TD, Depth+1, Cache, KnownCache);
     if (Tmp2 == 1) return 1;
       
     // Handle NEG.
     if (ConstantInt *CLHS = dyn_cast<ConstantInt>(U->getOperand(0)))
       if (CLHS->isNullValue()) {
         APInt KnownZero(TyBits, 0), KnownOne(TyBits, 0);
-        ComputeMaskedBits(U->getOperand(1), KnownZero, KnownOne, TD, Depth+1);
+        computeMaskedBits(U->getOperand(1), KnownZero, KnownOne, TD, Depth+1,
+                          KnownCache);
         // If the input is known to be 0 or 1, the output is 0/-1, which is all
         // sign bits set.
         if ((KnownZero | APInt(TyBits, 1)).isAllOnesValue())
@@ -1120,7 +1278,7 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
     
     // Sub can have at most one carry bit.  Thus we know that the output
     // is, at worst, one more bit than the inputs.
-    Tmp = ComputeNumSignBits(U->getOperand(0), TD, Depth+1);
+    Tmp = computeNumSignBits(U->getOperand(0), TD, Depth+1, Cache, KnownCache);
     if (Tmp == 1) return 1;  // Early out.
     return std::min(Tmp, Tmp2)-1;
       
@@ -1131,11 +1289,12 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
     
     // Take the minimum of all incoming values.  This can't infinitely loop
     // because of our depth threshold.
-    Tmp = ComputeNumSignBits(PN->getIncomingValue(0), TD, Depth+1);
+    Tmp = computeNumSignBits(PN->getIncomingValue(0), TD, Depth+1, Cache,
+                             KnownCache);
     for (unsigned i = 1, e = PN->getNumIncomingValues(); i != e; ++i) {
       if (Tmp == 1) return Tmp;
-      Tmp = std::min(Tmp,
-                     ComputeNumSignBits(PN->getIncomingValue(i), TD, Depth+1));
+      Tmp = std::min(Tmp, computeNumSignBits(PN->getIncomingValue(i), TD,
+                                             Depth+1, Cache, KnownCache));
     }
     return Tmp;
   }
@@ -1150,7 +1309,7 @@ unsigned llvm::ComputeNumSignBits(Value *V, const TargetData *TD,
   // use this information.
   APInt KnownZero(TyBits, 0), KnownOne(TyBits, 0);
   APInt Mask;
-  ComputeMaskedBits(V, KnownZero, KnownOne, TD, Depth);
+  computeMaskedBits(V, KnownZero, KnownOne, TD, Depth, KnownCache);
   
   if (KnownZero.isNegative()) {        // sign bit is 0
     Mask = KnownZero;
@@ -532,6 +532,7 @@ lltok::Kind LLLexer::LexIdentifier() {
   KEYWORD(noreturn);
   KEYWORD(noalias);
   KEYWORD(nocapture);
+  KEYWORD(nonnull);
   KEYWORD(byval);
   KEYWORD(nest);
   KEYWORD(readnone);
@@ -884,10 +884,14 @@ bool LLParser::ParseOptionalAttrs(Attributes &Attrs, unsigned AttrKind) {
       if (AttrKind != 2 && (Attrs & Attribute::FunctionOnly))
         return Error(AttrLoc, "invalid use of function-only attribute");
 
+      if (AttrKind == 1 && (Attrs & Attribute::FunctionOrParameter))
+        return Error(AttrLoc, "invalid use of attribute on a return value");
+
       // As a hack, we allow "align 2" on functions as a synonym for
       // "alignstack 2".
       if (AttrKind == 2 &&
-          (Attrs & ~(Attribute::FunctionOnly | Attribute::Alignment)))
+          (Attrs & ~(Attribute::FunctionOnly | Attribute::FunctionOrParameter |
+                     Attribute::Alignment)))
         return Error(AttrLoc, "invalid use of attribute on a function");
 
       if (AttrKind != 0 && (Attrs & Attribute::ParameterOnly))
@@ -900,6 +904,7 @@ bool LLParser::ParseOptionalAttrs(Attributes &Attrs, unsigned AttrKind) {
     case lltok::kw_sret:            Attrs |= Attribute::StructRet; break;
     case lltok::kw_noalias:         Attrs |= Attribute::NoAlias; break;
     case lltok::kw_nocapture:       Attrs |= Attribute::NoCapture; break;
+    case lltok::kw_nonnull:         Attrs |= Attribute::NonNull; break;
     case lltok::kw_byval:           Attrs |= Attribute::ByVal; break;
     case lltok::kw_nest:            Attrs |= Attribute::Nest; break;
 
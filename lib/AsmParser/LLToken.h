@@ -86,6 +86,7 @@ namespace lltok {
     kw_noreturn,
     kw_noalias,
     kw_nocapture,
+    kw_nonnull,
     kw_byval,
     kw_nest,
     kw_readnone,
@@ -22,6 +22,7 @@
 #include "llvm/AutoUpgrade.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/DataStream.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -2746,6 +2747,22 @@ bool BitcodeReader::Materialize(GlobalValue *GV, std::string *ErrInfo) {
     return true;
   }
 
+  // A streamed function may be handed to a client before the rest of the
+  // stream has been read, so it must not keep referring to blockaddress
+  // placeholders.  Read ahead to the bodies of the functions they name.
+  if (LazyStreamer) {
+    while (!BlockAddrFwdRefs.empty()) {
+      Function *Target = BlockAddrFwdRefs.begin()->first;
+      if (!Target->isMaterializable()) {
+        Error("Invalid blockaddress reference");
+        if (ErrInfo) *ErrInfo = ErrorString;
+        return true;
+      }
+      if (Materialize(Target, ErrInfo))
+        return true;
+    }
+  }
+
   // Upgrade any old intrinsic calls in the function.
   for (UpgradedIntrinsicMap::iterator I = UpgradedIntrinsics.begin(),
        E = UpgradedIntrinsics.end(); I != E; ++I) {
@@ -2820,6 +2837,350 @@ bool BitcodeReader::MaterializeModule(Module *M, std::string *ErrInfo) {
   return false;
 }
 
+//===----------------------------------------------------------------------===//
+// Compressed bitcode containers
+//===----------------------------------------------------------------------===//
+
+static uint32_t ReadInt32(const unsigned char *P) {
+  return P[0] | (P[1] << 8) | (P[2] << 16) | (uint32_t(P[3]) << 24);
+}
+
+/// DecompressChunk - Turn a chunk of a compressed bitcode container back into
+/// the Size bytes of bitcode at Out.
+static bool DecompressChunk(const unsigned char *Data, uint32_t StoredSize,
+                            unsigned char *Out, uint32_t Size,
+                            StringRef Dictionary) {
+  if (StoredSize == Size) {
+    memcpy(Out, Data, Size);
+    return false;
+  }
+  return lz77::decompress(StringRef((const char*)Data, StoredSize),
+                          (char*)Out, Size, Dictionary);
+}
+
+namespace {
+/// CompressedBitcodeHeader - The fixed-size part of the header of a
+/// compressed bitcode container.
+struct CompressedBitcodeHeader {
+  /// MaxDictionarySize - The writer never makes a bigger dictionary; a header
+  /// that claims one is corrupt, and must not make the reader allocate it.
+  enum { Size = 5 * 4, MaxDictionarySize = 64 * 1024 };
+  uint32_t BitcodeSize;
+  uint32_t NumChunks;
+  uint32_t DictionarySize;
+  uint32_t DictionaryStoredSize;
+
+  /// read - Decode the header at P; return true if it is malformed.
+  bool read(const unsigned char *P) {
+    BitcodeSize = ReadInt32(P + 4);
+    NumChunks = ReadInt32(P + 8);
+    DictionarySize = ReadInt32(P + 12);
+    DictionaryStoredSize = ReadInt32(P + 16);
+    return NumChunks == 0 || (BitcodeSize & 3) ||
+           DictionarySize > MaxDictionarySize ||
+           DictionaryStoredSize > DictionarySize;
+  }
+
+  /// isValidChunk - Return true if StoredSize bytes can hold a chunk of Size
+  /// bytes, either stored as is or compressed.  This bounds what a chunk can
+  /// make the reader allocate by the size of the input it really occupies.
+  static bool isValidChunk(uint64_t Size, uint64_t StoredSize) {
+    return Size != 0 && Size <= ~0U && StoredSize != 0 && StoredSize <= Size &&
+           Size <= StoredSize * lz77::MaxExpansion;
+  }
+};
+
+/// CompressedBitcodeObject - The bitcode held in a compressed bitcode
+/// container.  A chunk is decompressed the first time any of its bytes is
+/// read; the reader jumps over the function bodies it does not materialize,
+/// so their chunks are never touched.
+class CompressedBitcodeObject : public StreamableMemoryObject {
+  struct Chunk {
+    uint64_t Offset;              // Offset in the bitcode.
+    uint32_t Size;
+    uint32_t StoredSize;
+    const unsigned char *Data;    // Contents in the container.
+    bool Ready;
+  };
+  mutable std::vector<Chunk> Chunks;
+  std::vector<char> Dictionary;
+  uint64_t Size;
+  OwningArrayPtr<unsigned char> Bytes;
+  mutable unsigned LastChunk;
+
+  CompressedBitcodeObject() : Size(0), LastChunk(0) {}
+
+  static bool ReadULEB128(const unsigned char *&P, const unsigned char *End,
+                          uint64_t &Value) {
+    Value = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      if (P == End)
+        return true;
+      Value |= uint64_t(*P & 0x7f) << Shift;
+      if (!(*P++ & 0x80))
+        return false;
+    }
+    return true;
+  }
+
+  /// fetch - Make bytes [Address, Address+Len) available in Bytes.
+  void fetch(uint64_t Address, uint64_t Len) const {
+    unsigned i = LastChunk;
+    if (Address < Chunks[i].Offset ||
+        Address >= Chunks[i].Offset + Chunks[i].Size) {
+      // Binary search for the last chunk starting at or before Address.
+      unsigned Lo = 0, Hi = Chunks.size();
+      while (Hi - Lo > 1) {
+        unsigned Mid = (Lo + Hi) / 2;
+        if (Chunks[Mid].Offset <= Address)
+          Lo = Mid;
+        else
+          Hi = Mid;
+      }
+      i = LastChunk = Lo;
+    }
+    StringRef Dict(Dictionary.data(), Dictionary.size());
+    for (; i != Chunks.size() && Chunks[i].Offset < Address + Len; ++i) {
+      Chunk &C = Chunks[i];
+      if (C.Ready)
+        continue;
+      // A corrupt chunk reads as zeros, which the reader rejects as
+      // malformed bitcode.
+      if (DecompressChunk(C.Data, C.StoredSize, &Bytes[C.Offset], C.Size,
+                          Dict))
+        memset(&Bytes[C.Offset], 0, C.Size);
+      C.Ready = true;
+    }
+  }
+
+public:
+  /// create - Return the bitcode in the container [Start, End), or null if
+  /// the container is malformed.
+  static CompressedBitcodeObject *create(const unsigned char *Start,
+                                         const unsigned char *End) {
+    CompressedBitcodeHeader Header;
+    if (End - Start < CompressedBitcodeHeader::Size || Header.read(Start))
+      return 0;
+
+    OwningPtr<CompressedBitcodeObject> Obj(new CompressedBitcodeObject());
+    const unsigned char *P = Start + CompressedBitcodeHeader::Size;
+    uint64_t Offset = 0;
+    // Every chunk takes at least two bytes of ULEB128 sizes, so don't trust
+    // a chunk count that the rest of the input can't hold.
+    if (Header.NumChunks > uint64_t(End - P) / 2)
+      return 0;
+    Obj->Chunks.resize(Header.NumChunks);
+    for (unsigned i = 0; i != Header.NumChunks; ++i) {
+      uint64_t Size, StoredSize;
+      if (ReadULEB128(P, End, Size) || ReadULEB128(P, End, StoredSize) ||
+          !CompressedBitcodeHeader::isValidChunk(Size, StoredSize))
+        return 0;
+      Chunk &C = Obj->Chunks[i];
+      C.Offset = Offset;
+      C.Size = Size;
+      C.StoredSize = StoredSize;
+      C.Ready = false;
+      Offset += Size;
+    }
+    if (Offset != Header.BitcodeSize)
+      return 0;
+
+    if (uint64_t(End - P) < Header.DictionaryStoredSize)
+      return 0;
+    Obj->Dictionary.resize(Header.DictionarySize);
+    if (Header.DictionarySize &&
+        DecompressChunk(P, Header.DictionaryStoredSize,
+                        (unsigned char*)&Obj->Dictionary[0],
+                        Header.DictionarySize, StringRef()))
+      return 0;
+    P += Header.DictionaryStoredSize;
+
+    for (unsigned i = 0; i != Header.NumChunks; ++i) {
+      Chunk &C = Obj->Chunks[i];
+      if (uint64_t(End - P) < C.StoredSize)
+        return 0;
+      C.Data = P;
+      P += C.StoredSize;
+    }
+
+    Obj->Size = Header.BitcodeSize;
+    Obj->Bytes.reset(new unsigned char[Header.BitcodeSize]);
+    return Obj.take();
+  }
+
+  virtual uint64_t getBase() const { return 0; }
+  virtual uint64_t getExtent() const { return Size; }
+
+  virtual int readByte(uint64_t Address, uint8_t *Ptr) const {
+    if (Address >= Size)
+      return -1;
+    fetch(Address, 1);
+    *Ptr = Bytes[Address];
+    return 0;
+  }
+
+  virtual int readBytes(uint64_t Address, uint64_t Len, uint8_t *Buf,
+                        uint64_t *Copied) const {
+    if (Address + Len > Size)
+      return -1;
+    fetch(Address, Len);
+    memcpy(Buf, &Bytes[Address], Len);
+    if (Copied) *Copied = Len;
+    return 0;
+  }
+
+  virtual const uint8_t *getPointer(uint64_t Address, uint64_t Len) const {
+    fetch(Address, Len);
+    return &Bytes[Address];
+  }
+
+  virtual bool isValidAddress(uint64_t Address) const {
+    return Address < Size;
+  }
+  virtual bool isObjectEnd(uint64_t Address) const {
+    return Address == Size;
+  }
+};
+
+/// DecompressingStreamer - Passes the bytes of a DataStreamer through, unless
+/// they form a compressed bitcode container, in which case it yields the
+/// bitcode inside, a chunk at a time.
+class DecompressingStreamer : public DataStreamer {
+  OwningPtr<DataStreamer> Source;
+  bool Started;
+  bool Compressed;
+  /// Chunks - The sizes and stored sizes of the chunks of the container.
+  std::vector<std::pair<uint32_t, uint32_t> > Chunks;
+  unsigned NextChunk;
+  std::vector<char> Dictionary;
+  /// Pending - Bytes that have been produced but not returned yet.
+  std::vector<unsigned char> Pending;
+  size_t PendingPos;
+  /// Input - Bytes read from Source ahead of time while decoding the index.
+  std::vector<unsigned char> Input;
+  size_t InputPos;
+
+  /// readFully - Read Len bytes from Source unless it ends first.
+  size_t readFully(unsigned char *Buf, size_t Len) {
+    size_t Read = std::min(Len, Input.size() - InputPos);
+    if (Read) {
+      memcpy(Buf, &Input[InputPos], Read);
+      InputPos += Read;
+    }
+    while (Read != Len) {
+      size_t N = Source->GetBytes(Buf + Read, Len - Read);
+      if (N == 0)
+        break;
+      Read += N;
+    }
+    return Read;
+  }
+
+  bool readULEB128(uint64_t &Value) {
+    Value = 0;
+    for (unsigned Shift = 0; Shift < 64; Shift += 7) {
+      if (InputPos == Input.size()) {
+        Input.resize(4096);
+        Input.resize(Source->GetBytes(&Input[0], Input.size()));
+        InputPos = 0;
+        if (Input.empty())
+          return true;
+      }
+      unsigned char Byte = Input[InputPos++];
+      Value |= uint64_t(Byte & 0x7f) << Shift;
+      if (!(Byte & 0x80))
+        return false;
+    }
+    return true;
+  }
+
+  void start() {
+    Started = true;
+    Pending.resize(4);
+    Pending.resize(readFully(&Pending[0], 4));
+    if (!isCompressedBitcode(&Pending[0], &Pending[0] + Pending.size()))
+      return;
+
+    Compressed = true;
+    unsigned char Bytes[CompressedBitcodeHeader::Size];
+    memcpy(Bytes, &Pending[0], 4);
+    Pending.clear();
+    CompressedBitcodeHeader Header;
+    if (readFully(Bytes + 4, sizeof(Bytes) - 4) != sizeof(Bytes) - 4 ||
+        Header.read(Bytes))
+      return;
+    for (uint32_t i = 0; i != Header.NumChunks; ++i) {
+      uint64_t Size, StoredSize;
+      if (readULEB128(Size) || readULEB128(StoredSize) ||
+          !CompressedBitcodeHeader::isValidChunk(Size, StoredSize)) {
+        Chunks.clear();
+        return;
+      }
+      Chunks.push_back(std::make_pair(Size, StoredSize));
+    }
+
+    std::vector<unsigned char> Stored(Header.DictionaryStoredSize);
+    Dictionary.resize(Header.DictionarySize);
+    if (Header.DictionarySize &&
+        (readFully(&Stored[0], Stored.size()) != Stored.size() ||
+         DecompressChunk(&Stored[0], Stored.size(),
+                         (unsigned char*)&Dictionary[0], Dictionary.size(),
+                         StringRef())))
+      Chunks.clear();
+  }
+
+  bool readChunk() {
+    if (NextChunk == Chunks.size())
+      return false;
+    uint32_t Size = Chunks[NextChunk].first;
+    uint32_t StoredSize = Chunks[NextChunk].second;
+    ++NextChunk;
+
+    // Read the stored bytes a piece at a time, so that a chunk that claims
+    // more than the rest of the input holds can't allocate it up front.
+    std::vector<unsigned char> Stored;
+    while (Stored.size() != StoredSize) {
+      size_t Read = Stored.size();
+      size_t Len = std::min<size_t>(StoredSize - Read, 64 * 1024);
+      Stored.resize(Read + Len);
+      if (readFully(&Stored[Read], Len) != Len) {
+        Pending.clear();
+        return false;
+      }
+    }
+
+    Pending.resize(Size);
+    PendingPos = 0;
+    if (DecompressChunk(&Stored[0], StoredSize, &Pending[0], Size,
+                        StringRef(Dictionary.data(), Dictionary.size()))) {
+      Pending.clear();
+      return false;
+    }
+    return true;
+  }
+
+public:
+  explicit DecompressingStreamer(DataStreamer *Source)
+    : Source(Source), Started(false), Compressed(false), NextChunk(0),
+      PendingPos(0), InputPos(0) {}
+
+  virtual size_t GetBytes(unsigned char *Buf, size_t Len) {
+    if (!Started)
+      start();
+    if (PendingPos == Pending.size()) {
+      if (!Compressed)
+        return Source->GetBytes(Buf, Len);
+      if (!readChunk())
+        return 0;
+    }
+    size_t N = std::min(Len, Pending.size() - PendingPos);
+    memcpy(Buf, &Pending[PendingPos], N);
+    PendingPos += N;
+    return N;
+  }
+};
+} // end anonymous namespace
+
 bool BitcodeReader::InitStream() {
   if (LazyStreamer) return InitLazyStream();
   return InitStreamFromBuffer();
@@ -2829,6 +3190,16 @@ bool BitcodeReader::InitStreamFromBuffer() {
   const unsigned char *BufPtr = (unsigned char *)Buffer->getBufferStart();
   const unsigned char *BufEnd = BufPtr+Buffer->getBufferSize();
 
+  if (isCompressedBitcode(BufPtr, BufEnd)) {
+    CompressedBitcodeObject *Bytes =
+      CompressedBitcodeObject::create(BufPtr, BufEnd);
+    if (!Bytes)
+      return Error("Invalid compressed bitcode container");
+    StreamFile.reset(new BitstreamReader(Bytes));
+    Stream.init(*StreamFile);
+    return false;
+  }
+
   if (Buffer->getBufferSize() & 3) {
     if (!isRawBitcode(BufPtr, BufEnd) && !isBitcodeWrapper(BufPtr, BufEnd))
       return Error("Invalid bitcode signature");
@@ -2851,7 +3222,8 @@ bool BitcodeReader::InitStreamFromBuffer() {
 bool BitcodeReader::InitLazyStream() {
   // Check and strip off the bitcode wrapper; BitstreamReader expects never to
   // see it.
-  StreamingMemoryObject *Bytes = new StreamingMemoryObject(LazyStreamer);
+  StreamingMemoryObject *Bytes =
+    new StreamingMemoryObject(new DecompressingStreamer(LazyStreamer));
   StreamFile.reset(new BitstreamReader(Bytes));
   Stream.init(*StreamFile);
 
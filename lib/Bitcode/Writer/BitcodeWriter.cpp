@@ -24,6 +24,7 @@
 #include "llvm/ValueSymbolTable.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
@@ -63,6 +64,11 @@ enum {
   FUNCTION_INST_RET_VOID_ABBREV,
   FUNCTION_INST_RET_VAL_ABBREV,
   FUNCTION_INST_UNREACHABLE_ABBREV,
+  FUNCTION_INST_STORE_ABBREV,
+  FUNCTION_INST_BR_ABBREV,
+  FUNCTION_INST_BR_COND_ABBREV,
+  FUNCTION_INST_CMP2_ABBREV,
+  FUNCTION_INST_CALL_ABBREV,
   
   // SwitchInst Magic
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
@@ -1108,7 +1114,8 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
   case Instruction::FCmp:
     // compare returning Int1Ty or vector of Int1Ty
     Code = bitc::FUNC_CODE_INST_CMP2;
-    PushValueAndType(I.getOperand(0), InstID, Vals, VE);
+    if (!PushValueAndType(I.getOperand(0), InstID, Vals, VE))
+      AbbrevToUse = FUNCTION_INST_CMP2_ABBREV;
     Vals.push_back(VE.getValueID(I.getOperand(1)));
     Vals.push_back(cast<CmpInst>(I).getPredicate());
     break;
@@ -1133,9 +1140,11 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
       Code = bitc::FUNC_CODE_INST_BR;
       BranchInst &II = cast<BranchInst>(I);
       Vals.push_back(VE.getValueID(II.getSuccessor(0)));
+      AbbrevToUse = FUNCTION_INST_BR_ABBREV;
       if (II.isConditional()) {
         Vals.push_back(VE.getValueID(II.getSuccessor(1)));
         Vals.push_back(VE.getValueID(II.getCondition()));
+        AbbrevToUse = FUNCTION_INST_BR_COND_ABBREV;
       }
     }
     break;
@@ -1275,11 +1284,14 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
     }
     break;
   case Instruction::Store:
-    if (cast<StoreInst>(I).isAtomic())
+    if (cast<StoreInst>(I).isAtomic()) {
       Code = bitc::FUNC_CODE_INST_STOREATOMIC;
-    else
+      PushValueAndType(I.getOperand(1), InstID, Vals, VE);  // ptrty + ptr
+    } else {
       Code = bitc::FUNC_CODE_INST_STORE;
-    PushValueAndType(I.getOperand(1), InstID, Vals, VE);  // ptrty + ptr
+      if (!PushValueAndType(I.getOperand(1), InstID, Vals, VE))  // ptr
+        AbbrevToUse = FUNCTION_INST_STORE_ABBREV;
+    }
     Vals.push_back(VE.getValueID(I.getOperand(0)));       // val.
     Vals.push_back(Log2_32(cast<StoreInst>(I).getAlignment())+1);
     Vals.push_back(cast<StoreInst>(I).isVolatile());
@@ -1324,7 +1336,9 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
 
     Vals.push_back(VE.getAttributeID(CI.getAttributes()));
     Vals.push_back((CI.getCallingConv() << 1) | unsigned(CI.isTailCall()));
-    PushValueAndType(CI.getCalledValue(), InstID, Vals, VE);  // Callee
+    if (!PushValueAndType(CI.getCalledValue(), InstID, Vals, VE) && // Callee
+        CI.getCallingConv() == CallingConv::C)
+      AbbrevToUse = FUNCTION_INST_CALL_ABBREV;
 
     // Emit value #'s for the fixed parameters.
     for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
@@ -1408,10 +1422,16 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
   Stream.ExitBlock();
 }
 
-/// WriteFunction - Emit a function body to the module stream.
+/// BodyRangeList - The byte ranges of the contents of the function blocks,
+/// from just after each block header to the end of the block.
+typedef std::vector<std::pair<uint64_t, uint64_t> > BodyRangeList;
+
+/// WriteFunction - Emit a function body to the module stream.  If Bodies is
+/// non-null, record where the contents of the function block lie.
 static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
+                          BitstreamWriter &Stream, BodyRangeList *Bodies) {
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  uint64_t BodyStart = Stream.GetCurrentBitNo() / 8;
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1478,6 +1498,10 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
     WriteMetadataAttachment(F, VE, Stream);
   VE.purgeFunction();
   Stream.ExitBlock();
+
+  if (Bodies)
+    Bodies->push_back(std::make_pair(BodyStart,
+                                     Stream.GetCurrentBitNo() / 8));
 }
 
 // Emit blockinfo, which defines the standard abbreviations etc.
@@ -1638,6 +1662,61 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
       llvm_unreachable("Unexpected abbrev ordering!");
   }
 
+  // The following are the most frequent records that were not abbreviated
+  // above, going by llvm-bcanalyzer's histograms of typical modules.  Four
+  // bits of abbrev id leave room for no more.
+  { // INST_STORE abbrev for FUNCTION_BLOCK.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_STORE));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Ptr
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Val
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 4)); // Align
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // volatile
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
+                                   Abbv) != FUNCTION_INST_STORE_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+  { // Unconditional INST_BR abbrev for FUNCTION_BLOCK.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_BR));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Dest
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
+                                   Abbv) != FUNCTION_INST_BR_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+  { // Conditional INST_BR abbrev for FUNCTION_BLOCK.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_BR));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // True dest
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // False dest
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Cond
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
+                                   Abbv) != FUNCTION_INST_BR_COND_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+  { // INST_CMP2 abbrev for FUNCTION_BLOCK.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_CMP2));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // LHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // RHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 6)); // pred
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
+                                   Abbv) != FUNCTION_INST_CMP2_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+  { // INST_CALL abbrev for FUNCTION_BLOCK, for calls with the C convention.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_CALL));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // paramattrs
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // tail
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Callee
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Args
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
+                                   Abbv) != FUNCTION_INST_CALL_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+
   Stream.ExitBlock();
 }
 
@@ -1739,7 +1818,8 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
 }
 
 /// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        BodyRangeList *Bodies = 0) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   // Emit the version number if it is non-zero.
@@ -1784,7 +1864,7 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // Emit function bodies.
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
     if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+      WriteFunction(*F, VE, Stream, Bodies);
 
   Stream.ExitBlock();
 }
@@ -1862,6 +1942,23 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
     Buffer.push_back(0);
 }
 
+/// WriteBitcode - Append the bitcode file for the specified module to Buffer.
+static void WriteBitcode(const Module *M, SmallVectorImpl<char> &Buffer,
+                         BodyRangeList *Bodies = 0) {
+  BitstreamWriter Stream(Buffer);
+
+  // Emit the file header.
+  Stream.Emit((unsigned)'B', 8);
+  Stream.Emit((unsigned)'C', 8);
+  Stream.Emit(0x0, 4);
+  Stream.Emit(0xC, 4);
+  Stream.Emit(0xE, 4);
+  Stream.Emit(0xD, 4);
+
+  // Emit the module.
+  WriteModule(M, Stream, Bodies);
+}
+
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
@@ -1875,20 +1972,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     Buffer.insert(Buffer.begin(), DarwinBCHeaderSize, 0);
 
   // Emit the module into the buffer.
-  {
-    BitstreamWriter Stream(Buffer);
-
-    // Emit the file header.
-    Stream.Emit((unsigned)'B', 8);
-    Stream.Emit((unsigned)'C', 8);
-    Stream.Emit(0x0, 4);
-    Stream.Emit(0xC, 4);
-    Stream.Emit(0xE, 4);
-    Stream.Emit(0xD, 4);
-
-    // Emit the module.
-    WriteModule(M, Stream);
-  }
+  WriteBitcode(M, Buffer);
 
   if (TT.isOSDarwin())
     EmitDarwinBCHeaderAndTrailer(Buffer, TT);
@@ -1896,3 +1980,105 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   // Write the generated bitstream to "Out".
   Out.write((char*)&Buffer.front(), Buffer.size());
 }
+
+static void AppendInt32(uint32_t Value, SmallVectorImpl<char> &Buffer) {
+  Buffer.push_back((unsigned char) (Value >>  0));
+  Buffer.push_back((unsigned char) (Value >>  8));
+  Buffer.push_back((unsigned char) (Value >> 16));
+  Buffer.push_back((unsigned char) (Value >> 24));
+}
+
+static void AppendULEB128(uint64_t Value, SmallVectorImpl<char> &Buffer) {
+  do {
+    unsigned char Byte = Value & 0x7f;
+    Value >>= 7;
+    if (Value)
+      Byte |= 0x80;
+    Buffer.push_back(Byte);
+  } while (Value);
+}
+
+/// AppendChunk - Append Chunk to Data, compressed if that makes it smaller,
+/// and return the number of bytes appended.
+static size_t AppendChunk(StringRef Chunk, StringRef Dictionary,
+                          SmallVectorImpl<char> &Data) {
+  size_t Before = Data.size();
+  lz77::compress(Chunk, Data, Dictionary);
+  if (Data.size() - Before >= Chunk.size()) {
+    Data.resize(Before);
+    Data.append(Chunk.begin(), Chunk.end());
+  }
+  return Data.size() - Before;
+}
+
+/// MaxDictionarySize - The size of the dictionary of a compressed bitcode
+/// container, which is made of function bodies sampled across the module.
+static const uint64_t MaxDictionarySize = 64 * 1024;
+
+/// WriteCompressedBitcodeToFile - Write the specified module to the specified
+/// output stream as a compressed bitcode container.  The contents of every
+/// function block become a chunk of their own, so a lazy reader that skips a
+/// function body never decompresses it.  The block headers in between are
+/// read while the module is parsed; they are a few bytes each and are stored
+/// as is.  Function bodies are too small to compress well on their own, so
+/// all chunks are compressed against a dictionary of sample bodies.
+void llvm::WriteCompressedBitcodeToFile(const Module *M, raw_ostream &Out) {
+  SmallVector<char, 1024> Buffer;
+  Buffer.reserve(256*1024);
+  BodyRangeList Bodies;
+  WriteBitcode(M, Buffer, &Bodies);
+
+  // Sample bodies evenly across the module.
+  uint64_t TotalBodySize = 0;
+  for (unsigned i = 0, e = Bodies.size(); i != e; ++i)
+    TotalBodySize += Bodies[i].second - Bodies[i].first;
+  SmallVector<char, 1024> Dictionary;
+  uint64_t Seen = 0;
+  for (unsigned i = 0, e = Bodies.size(); i != e; ++i) {
+    uint64_t Size = Bodies[i].second - Bodies[i].first;
+    if (Seen * MaxDictionarySize >= Dictionary.size() * TotalBodySize &&
+        Dictionary.size() + Size <= MaxDictionarySize) {
+      const char *Body = &Buffer[Bodies[i].first];
+      Dictionary.append(Body, Body + Size);
+    }
+    Seen += Size;
+  }
+  StringRef Dict(Dictionary.data(), Dictionary.size());
+
+  std::vector<uint64_t> Splits;
+  for (unsigned i = 0, e = Bodies.size(); i != e; ++i) {
+    Splits.push_back(Bodies[i].first);
+    Splits.push_back(Bodies[i].second);
+  }
+  Splits.push_back(Buffer.size());
+
+  SmallVector<char, 1024> Index;
+  SmallVector<char, 1024> Data;
+  Data.reserve(Buffer.size() / 2);
+  size_t DictionaryStoredSize = AppendChunk(Dict, StringRef(), Data);
+  unsigned NumChunks = 0;
+  uint64_t Start = 0;
+  for (unsigned i = 0, e = Splits.size(); i != e; ++i) {
+    if (Splits[i] == Start)
+      continue;
+    StringRef Chunk(&Buffer[Start], Splits[i] - Start);
+    Start = Splits[i];
+    AppendULEB128(Chunk.size(), Index);
+    AppendULEB128(AppendChunk(Chunk, Dict, Data), Index);
+    ++NumChunks;
+  }
+
+  SmallVector<char, 20> Header;
+  Header.push_back('B');
+  Header.push_back('C');
+  Header.push_back('Z');
+  Header.push_back(0x01);
+  AppendInt32(Buffer.size(), Header);
+  AppendInt32(NumChunks, Header);
+  AppendInt32(Dict.size(), Header);
+  AppendInt32(DictionaryStoredSize, Header);
+
+  Out.write(Header.data(), Header.size());
+  Out.write(Index.data(), Index.size());
+  Out.write(Data.data(), Data.size());
+}
@@ -24,10 +24,6 @@
 #include <algorithm>
 using namespace llvm;
 
-static bool isIntegerValue(const std::pair<const Value*, unsigned> &V) {
-  return V.first->getType()->isIntegerTy();
-}
-
 /// ValueEnumerator - Enumerate module-level information.
 ValueEnumerator::ValueEnumerator(const Module *M) {
   // Enumerate the global variables.
@@ -170,17 +166,26 @@ void ValueEnumerator::print(raw_ostream &OS, const ValueMapType &Map,
 
 // Optimize constant ordering.
 namespace {
-  struct CstSortPredicate {
-    ValueEnumerator &VE;
-    explicit CstSortPredicate(ValueEnumerator &ve) : VE(ve) {}
-    bool operator()(const std::pair<const Value*, unsigned> &LHS,
-                    const std::pair<const Value*, unsigned> &RHS) {
-      // Sort by plane.
-      if (LHS.first->getType() != RHS.first->getType())
-        return VE.getTypeID(LHS.first->getType()) <
-               VE.getTypeID(RHS.first->getType());
-      // Then by frequency.
-      return LHS.second > RHS.second;
+  /// CstSortKey - Where a constant goes in the constant pool: integers first,
+  /// so that GEP structure indices come before gep constant exprs, then by
+  /// type plane so that few SETTYPE records are needed, then by decreasing
+  /// frequency so that the most used constants get the smallest value ids.
+  /// Computing this once keeps type lookups out of the comparisons.
+  struct CstSortKey {
+    bool IsNotInteger;
+    unsigned TypeID;
+    unsigned Frequency;
+    unsigned Index;
+
+    bool operator<(const CstSortKey &RHS) const {
+      if (IsNotInteger != RHS.IsNotInteger)
+        return RHS.IsNotInteger;
+      if (TypeID != RHS.TypeID)
+        return TypeID < RHS.TypeID;
+      if (Frequency != RHS.Frequency)
+        return Frequency > RHS.Frequency;
+      // Keep the enumeration order otherwise, for a deterministic result.
+      return Index < RHS.Index;
     }
   };
 }
@@ -189,17 +194,24 @@ namespace {
 void ValueEnumerator::OptimizeConstants(unsigned CstStart, unsigned CstEnd) {
   if (CstStart == CstEnd || CstStart+1 == CstEnd) return;
 
-  CstSortPredicate P(*this);
-  std::stable_sort(Values.begin()+CstStart, Values.begin()+CstEnd, P);
-
-  // Ensure that integer constants are at the start of the constant pool.  This
-  // is important so that GEP structure indices come before gep constant exprs.
-  std::partition(Values.begin()+CstStart, Values.begin()+CstEnd,
-                 isIntegerValue);
-
-  // Rebuild the modified portion of ValueMap.
-  for (; CstStart != CstEnd; ++CstStart)
-    ValueMap[Values[CstStart].first] = CstStart+1;
+  SmallVector<CstSortKey, 64> Keys;
+  Keys.reserve(CstEnd - CstStart);
+  for (unsigned i = CstStart; i != CstEnd; ++i) {
+    Type *Ty = Values[i].first->getType();
+    CstSortKey Key = { !Ty->isIntegerTy(), getTypeID(Ty), Values[i].second, i };
+    Keys.push_back(Key);
+  }
+  std::sort(Keys.begin(), Keys.end());
+
+  // Permute the modified portion of Values and rebuild its part of ValueMap.
+  ValueList Sorted;
+  Sorted.reserve(Keys.size());
+  for (unsigned i = 0, e = Keys.size(); i != e; ++i)
+    Sorted.push_back(Values[Keys[i].Index]);
+  for (unsigned i = 0, e = Sorted.size(); i != e; ++i) {
+    Values[CstStart + i] = Sorted[i];
+    ValueMap[Sorted[i].first] = CstStart + i + 1;
+  }
 }
 
 
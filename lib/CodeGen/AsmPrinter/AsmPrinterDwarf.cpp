@@ -67,6 +67,7 @@ static const char *DecodeDWARFEncoding(unsigned Encoding) {
   case dwarf::DW_EH_PE_omit:   return "omit";
   case dwarf::DW_EH_PE_pcrel:  return "pcrel";
   case dwarf::DW_EH_PE_udata4: return "udata4";
+  case dwarf::DW_EH_PE_uleb128: return "uleb128";
   case dwarf::DW_EH_PE_udata8: return "udata8";
   case dwarf::DW_EH_PE_sdata4: return "sdata4";
   case dwarf::DW_EH_PE_sdata8: return "sdata8";
@@ -42,13 +42,21 @@ using namespace llvm;
 DwarfCFIException::DwarfCFIException(AsmPrinter *A)
   : DwarfException(A),
     shouldEmitPersonality(false), shouldEmitLSDA(false), shouldEmitMoves(false),
-    moveTypeModule(AsmPrinter::CFI_M_None) {}
+    moveTypeModule(AsmPrinter::CFI_M_None) {
+  ShareLSDATables = true;
+}
 
 DwarfCFIException::~DwarfCFIException() {}
 
 /// EndModule - Emit all exception information that should come after the
 /// content.
 void DwarfCFIException::EndModule() {
+  // Emit the action records and type tables shared by the LSDAs.
+  if (!Pool.empty()) {
+    Asm->OutStreamer.SwitchSection(Asm->getObjFileLowering().getLSDASection());
+    EmitLSDAPool();
+  }
+
   if (moveTypeModule == AsmPrinter::CFI_M_Debug)
     Asm->OutStreamer.EmitCFISections(false, true);
 
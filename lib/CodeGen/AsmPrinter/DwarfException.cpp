@@ -39,7 +39,7 @@
 using namespace llvm;
 
 DwarfException::DwarfException(AsmPrinter *A)
-  : Asm(A), MMI(Asm->MMI) {}
+  : Asm(A), MMI(Asm->MMI), ShareLSDATables(false) {}
 
 DwarfException::~DwarfException() {}
 
@@ -360,12 +360,6 @@ void DwarfException::EmitExceptionTable() {
 
   std::sort(LandingPads.begin(), LandingPads.end(), PadLT);
 
-  // Compute the actions table and gather the first action index for each
-  // landing pad site.
-  SmallVector<ActionEntry, 32> Actions;
-  SmallVector<unsigned, 64> FirstActions;
-  unsigned SizeActions=ComputeActionsTable(LandingPads, Actions, FirstActions);
-
   // Invokes and nounwind calls have entries in PadMap (due to being bracketed
   // by try-range labels when lowered).  Ordinary calls do not, so appropriate
   // try-ranges for them need be deduced when using DWARF exception handling.
@@ -380,6 +374,22 @@ void DwarfException::EmitExceptionTable() {
     }
   }
 
+  // If the assembler can compute uleb128 label differences, let it size the
+  // tables.  Darwin's linker splits the LSDA section into atoms, across which
+  // such differences are not preserved, so it keeps the fixed layout below.
+  bool IsSJLJ = Asm->MAI->getExceptionHandlingType() == ExceptionHandling::SjLj;
+  if (!IsSJLJ && Asm->MAI->hasLEB128() &&
+      !Asm->MAI->hasSubsectionsViaSymbols()) {
+    EmitCompactExceptionTable(LandingPads, PadMap);
+    return;
+  }
+
+  // Compute the actions table and gather the first action index for each
+  // landing pad site.
+  SmallVector<ActionEntry, 32> Actions;
+  SmallVector<unsigned, 64> FirstActions;
+  unsigned SizeActions=ComputeActionsTable(LandingPads, Actions, FirstActions);
+
   // Compute the call-site table.
   SmallVector<CallSiteEntry, 64> CallSites;
   ComputeCallSiteTable(CallSites, PadMap, LandingPads, FirstActions);
@@ -387,7 +397,6 @@ void DwarfException::EmitExceptionTable() {
   // Final tallies.
 
   // Call sites.
-  bool IsSJLJ = Asm->MAI->getExceptionHandlingType() == ExceptionHandling::SjLj;
   bool HaveTTData = IsSJLJ ? (!TypeInfos.empty() || !FilterIds.empty()) : true;
 
   unsigned CallSiteTableLength;
@@ -712,6 +721,293 @@ void DwarfException::EmitExceptionTable() {
   Asm->EmitAlignment(2);
 }
 
+/// AddToLSDAPool - Add the actions of the landing pads, along with the type
+/// infos and exception specifications they use, to the pool, and gather the
+/// first action of each landing pad.
+void DwarfException::
+AddToLSDAPool(const SmallVectorImpl<const LandingPadInfo *> &LandingPads,
+              SmallVectorImpl<unsigned> &FirstActions) {
+  const std::vector<const GlobalVariable *> &TypeInfos = MMI->getTypeInfos();
+  const std::vector<unsigned> &FilterIds = MMI->getFilterIds();
+
+  // Translate the function's type ids into the pool's.
+  SmallVector<unsigned, 16> PoolTypeIDs;
+  for (unsigned i = 0, e = TypeInfos.size(); i != e; ++i) {
+    unsigned &ID = Pool.TypeIDs[TypeInfos[i]];
+    if (!ID) {
+      Pool.TypeInfos.push_back(TypeInfos[i]);
+      ID = Pool.TypeInfos.size();
+    }
+    PoolTypeIDs.push_back(ID);
+  }
+
+  FirstActions.reserve(LandingPads.size());
+  for (SmallVectorImpl<const LandingPadInfo *>::const_iterator
+         I = LandingPads.begin(), E = LandingPads.end(); I != E; ++I) {
+    const std::vector<int> &TypeIds = (*I)->TypeIds;
+
+    // The type ids are in the reverse of the order they are matched in, so
+    // each chain is built from its last record to its first.
+    unsigned Action = 0, NextIndex = ~0U;
+    for (unsigned J = 0, M = TypeIds.size(); J != M; ++J) {
+      int TypeID = TypeIds[J];
+      int ValueForTypeID = 0;
+      if (TypeID > 0) {
+        ValueForTypeID = PoolTypeIDs[TypeID - 1];
+      } else if (TypeID < 0) {
+        // An exception specification is written as the negative byte offset,
+        // biased by one, of its list of type ids from the @TType base.
+        std::vector<unsigned> Filter;
+        for (unsigned i = -1 - TypeID; FilterIds[i]; ++i)
+          Filter.push_back(PoolTypeIDs[FilterIds[i] - 1]);
+
+        std::map<std::vector<unsigned>, int>::iterator F =
+          Pool.Filters.find(Filter);
+        if (F == Pool.Filters.end()) {
+          int Value = -1 - int(Pool.SizeFilters);
+          F = Pool.Filters.insert(std::make_pair(Filter, Value)).first;
+          for (unsigned i = 0, e = Filter.size(); i != e; ++i) {
+            Pool.FilterIds.push_back(Filter[i]);
+            Pool.SizeFilters += MCAsmInfo::getULEB128Size(Filter[i]);
+          }
+          Pool.FilterIds.push_back(0);
+          Pool.SizeFilters += 1;
+        }
+        ValueForTypeID = F->second;
+      }
+
+      // Records are shared between chains with a common tail.
+      unsigned &Index = Pool.ActionIDs[std::make_pair(ValueForTypeID, Action)];
+      if (!Index) {
+        // The next action field is a displacement from the field itself to
+        // the next record, which has already been laid out.
+        unsigned SizeTypeID = MCAsmInfo::getSLEB128Size(ValueForTypeID);
+        int NextAction = 0;
+        if (Action)
+          NextAction = int(Action - 1) - int(Pool.SizeActions + SizeTypeID);
+        ActionEntry Entry = { ValueForTypeID, NextAction, NextIndex };
+        Pool.Actions.push_back(Entry);
+        Pool.ActionOffsets.push_back(Pool.SizeActions);
+        Pool.SizeActions += SizeTypeID + MCAsmInfo::getSLEB128Size(NextAction);
+        Index = Pool.Actions.size();
+      }
+      NextIndex = Index - 1;
+      Action = Pool.ActionOffsets[NextIndex] + 1;
+    }
+    FirstActions.push_back(Action);
+  }
+}
+
+/// EmitCompactExceptionTable - Emit the LSDA of the current function with a
+/// uleb128 call-site table whose sizes and offsets are left to the assembler,
+/// and with its action records, type infos and exception specifications in
+/// the pool.  If the pool is shared, the LSDA refers to its tables by label
+/// and EndModule emits them once for all functions; otherwise they are
+/// emitted right after the call-site table, as usual.
+void DwarfException::
+EmitCompactExceptionTable(const SmallVectorImpl<const LandingPadInfo *> &LPs,
+                          const RangeMapType &PadMap) {
+  SmallVector<unsigned, 64> FirstActions;
+  AddToLSDAPool(LPs, FirstActions);
+
+  SmallVector<CallSiteEntry, 64> CallSites;
+  ComputeCallSiteTable(CallSites, PadMap, LPs, FirstActions);
+
+  MCContext &Ctx = Asm->OutContext;
+  unsigned FunctionNumber = Asm->getFunctionNumber();
+  bool VerboseAsm = Asm->OutStreamer.isVerboseAsm();
+  bool HaveTTData = !MMI->getTypeInfos().empty() ||
+                    !MMI->getFilterIds().empty();
+
+  // Begin the exception table.  No padding is needed: the type infos are
+  // aligned where the pool is emitted.
+  if (const MCSection *LSDASection = Asm->getObjFileLowering().getLSDASection())
+    Asm->OutStreamer.SwitchSection(LSDASection);
+
+  Asm->OutStreamer.EmitLabel(Ctx.GetOrCreateSymbol(Twine("GCC_except_table")+
+                                                   Twine(FunctionNumber)));
+  Asm->OutStreamer.EmitLabel(Asm->GetTempSymbol("exception", FunctionNumber));
+
+  // Emit the LSDA header.
+  Asm->EmitEncodingByte(dwarf::DW_EH_PE_omit, "@LPStart");
+  Asm->EmitEncodingByte(HaveTTData ?
+                        Asm->getObjFileLowering().getTTypeEncoding() :
+                        unsigned(dwarf::DW_EH_PE_omit), "@TType");
+
+  if (HaveTTData) {
+    if (!Pool.TTBaseLabel)
+      Pool.TTBaseLabel = Ctx.CreateTempSymbol();
+    MCSymbol *TTBaseRef = Asm->GetTempSymbol("ttbase_ref", FunctionNumber);
+    if (VerboseAsm)
+      Asm->OutStreamer.AddComment("@TType base offset");
+    Asm->OutStreamer.EmitULEB128Value(
+      MCBinaryExpr::CreateSub(MCSymbolRefExpr::Create(Pool.TTBaseLabel, Ctx),
+                              MCSymbolRefExpr::Create(TTBaseRef, Ctx), Ctx));
+    Asm->OutStreamer.EmitLabel(TTBaseRef);
+  }
+
+  // Emit the landing pad call site table.
+  MCSymbol *CSTBegin = Asm->GetTempSymbol("cst_begin", FunctionNumber);
+  MCSymbol *CSTEnd = Asm->GetTempSymbol("cst_end", FunctionNumber);
+  Asm->EmitEncodingByte(dwarf::DW_EH_PE_uleb128, "Call site");
+  if (VerboseAsm)
+    Asm->OutStreamer.AddComment("Call site table length");
+  Asm->OutStreamer.EmitULEB128Value(
+    MCBinaryExpr::CreateSub(MCSymbolRefExpr::Create(CSTEnd, Ctx),
+                            MCSymbolRefExpr::Create(CSTBegin, Ctx), Ctx));
+  Asm->OutStreamer.EmitLabel(CSTBegin);
+
+  // The first action of a call site is relative to the end of the call-site
+  // table.  Shared action records follow every LSDA that uses them, so refer
+  // to them through the start of the records.
+  const MCExpr *ActionsBase = 0;
+  if (ShareLSDATables && !Pool.Actions.empty()) {
+    if (!Pool.ActionsLabel)
+      Pool.ActionsLabel = Ctx.CreateTempSymbol();
+    ActionsBase =
+      MCBinaryExpr::CreateSub(MCSymbolRefExpr::Create(Pool.ActionsLabel, Ctx),
+                              MCSymbolRefExpr::Create(CSTEnd, Ctx), Ctx);
+  }
+
+  MCSymbol *EHFuncBeginSym = Asm->GetTempSymbol("eh_func_begin",
+                                                FunctionNumber);
+  MCSymbol *EHFuncEndSym = Asm->GetTempSymbol("eh_func_end", FunctionNumber);
+  unsigned Entry = 0;
+  for (SmallVectorImpl<CallSiteEntry>::const_iterator
+         I = CallSites.begin(), E = CallSites.end(); I != E; ++I) {
+    const CallSiteEntry &S = *I;
+
+    MCSymbol *BeginLabel = S.BeginLabel ? S.BeginLabel : EHFuncBeginSym;
+    MCSymbol *EndLabel = S.EndLabel ? S.EndLabel : EHFuncEndSym;
+
+    if (VerboseAsm)
+      Asm->OutStreamer.AddComment(">> Call Site " + Twine(++Entry) + " <<");
+    Asm->OutStreamer.EmitULEB128Value(
+      MCBinaryExpr::CreateSub(MCSymbolRefExpr::Create(BeginLabel, Ctx),
+                              MCSymbolRefExpr::Create(EHFuncBeginSym, Ctx),
+                              Ctx));
+    if (VerboseAsm)
+      Asm->OutStreamer.AddComment(Twine("  Call between ") +
+                                  BeginLabel->getName() + " and " +
+                                  EndLabel->getName());
+    Asm->OutStreamer.EmitULEB128Value(
+      MCBinaryExpr::CreateSub(MCSymbolRefExpr::Create(EndLabel, Ctx),
+                              MCSymbolRefExpr::Create(BeginLabel, Ctx), Ctx));
+
+    if (!S.PadLabel) {
+      if (VerboseAsm)
+        Asm->OutStreamer.AddComment("    has no landing pad");
+      Asm->EmitULEB128(0);
+    } else {
+      if (VerboseAsm)
+        Asm->OutStreamer.AddComment(Twine("    jumps to ") +
+                                    S.PadLabel->getName());
+      Asm->OutStreamer.EmitULEB128Value(
+        MCBinaryExpr::CreateSub(MCSymbolRefExpr::Create(S.PadLabel, Ctx),
+                                MCSymbolRefExpr::Create(EHFuncBeginSym, Ctx),
+                                Ctx));
+    }
+
+    if (S.Action == 0) {
+      if (VerboseAsm)
+        Asm->OutStreamer.AddComment("  On action: cleanup");
+      Asm->EmitULEB128(0);
+    } else {
+      if (VerboseAsm)
+        Asm->OutStreamer.AddComment("  On action at offset " +
+                                    Twine(S.Action - 1));
+      if (ActionsBase)
+        Asm->OutStreamer.EmitULEB128Value(
+          MCBinaryExpr::CreateAdd(ActionsBase,
+                                  MCConstantExpr::Create(S.Action, Ctx), Ctx));
+      else
+        Asm->EmitULEB128(S.Action);
+    }
+  }
+  Asm->OutStreamer.EmitLabel(CSTEnd);
+
+  if (!ShareLSDATables)
+    EmitLSDAPool();
+}
+
+/// EmitLSDAPool - Emit the action records, type infos and exception
+/// specifications of the pool, and empty it.  The @TType base lies between
+/// the type infos, which are indexed backwards from it, and the exception
+/// specifications.
+void DwarfException::EmitLSDAPool() {
+  bool VerboseAsm = Asm->OutStreamer.isVerboseAsm();
+
+  // Emit the Action Table.
+  if (Pool.ActionsLabel)
+    Asm->OutStreamer.EmitLabel(Pool.ActionsLabel);
+  for (unsigned i = 0, e = Pool.Actions.size(); i != e; ++i) {
+    const ActionEntry &Action = Pool.Actions[i];
+
+    if (VerboseAsm) {
+      Asm->OutStreamer.AddComment(">> Action Record " + Twine(i + 1) +
+                                  " at offset " + Twine(Pool.ActionOffsets[i]) +
+                                  " <<");
+      if (Action.ValueForTypeID > 0)
+        Asm->OutStreamer.AddComment("  Catch TypeInfo " +
+                                    Twine(Action.ValueForTypeID));
+      else if (Action.ValueForTypeID < 0)
+        Asm->OutStreamer.AddComment("  Filter TypeInfo " +
+                                    Twine(Action.ValueForTypeID));
+      else
+        Asm->OutStreamer.AddComment("  Cleanup");
+    }
+    Asm->EmitSLEB128(Action.ValueForTypeID);
+
+    if (VerboseAsm) {
+      if (Action.NextAction == 0)
+        Asm->OutStreamer.AddComment("  No further actions");
+      else
+        Asm->OutStreamer.AddComment("  Continue to action " +
+                                    Twine(Action.Previous + 1));
+    }
+    Asm->EmitSLEB128(Action.NextAction);
+  }
+
+  if (Pool.TTBaseLabel) {
+    unsigned TTypeEncoding = Asm->getObjFileLowering().getTTypeEncoding();
+    unsigned TypeFormatSize = Asm->GetSizeOfEncodedValue(TTypeEncoding);
+    Asm->EmitAlignment(Log2_32(TypeFormatSize));
+
+    // Emit the Catch TypeInfos.
+    if (VerboseAsm && !Pool.TypeInfos.empty()) {
+      Asm->OutStreamer.AddComment(">> Catch TypeInfos <<");
+      Asm->OutStreamer.AddBlankLine();
+    }
+    unsigned Entry = Pool.TypeInfos.size();
+    for (std::vector<const GlobalVariable *>::const_reverse_iterator
+           I = Pool.TypeInfos.rbegin(), E = Pool.TypeInfos.rend();
+         I != E; ++I) {
+      const GlobalVariable *GV = *I;
+      if (VerboseAsm)
+        Asm->OutStreamer.AddComment("TypeInfo " + Twine(Entry--));
+      if (GV)
+        Asm->EmitReference(GV, TTypeEncoding);
+      else
+        Asm->OutStreamer.EmitIntValue(0, TypeFormatSize, 0);
+    }
+    Asm->OutStreamer.EmitLabel(Pool.TTBaseLabel);
+
+    // Emit the Exception Specifications.
+    if (VerboseAsm && !Pool.FilterIds.empty()) {
+      Asm->OutStreamer.AddComment(">> Filter TypeInfos <<");
+      Asm->OutStreamer.AddBlankLine();
+    }
+    for (unsigned i = 0, e = Pool.FilterIds.size(); i != e; ++i) {
+      if (VerboseAsm && Pool.FilterIds[i])
+        Asm->OutStreamer.AddComment("FilterInfo " + Twine(Pool.FilterIds[i]));
+      Asm->EmitULEB128(Pool.FilterIds[i]);
+    }
+  }
+
+  Asm->EmitAlignment(2);
+  Pool = LSDAPool();
+}
+
 /// EndModule - Emit all exception information that should come after the
 /// content.
 void DwarfException::EndModule() {
@@ -16,6 +16,7 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/CodeGen/AsmPrinter.h"
+#include <map>
 #include <vector>
 
 namespace llvm {
@@ -30,6 +31,7 @@ class MCAsmInfo;
 class MCExpr;
 class MCSymbol;
 class Function;
+class GlobalVariable;
 class AsmPrinter;
 
 //===----------------------------------------------------------------------===//
@@ -43,6 +45,11 @@ protected:
   /// MMI - Collected machine module information.
   MachineModuleInfo *MMI;
 
+  /// ShareLSDATables - Set by subclasses whose LSDAs all go to one section,
+  /// so that their action records, type infos and exception specifications
+  /// can be pooled for the whole module and emitted by EndModule.
+  bool ShareLSDATables;
+
   /// EmitExceptionTable - Emit landing pads and actions.
   ///
   /// The general organization of the table is complex, but the basic concepts
@@ -87,6 +94,46 @@ protected:
     unsigned Previous;
   };
 
+  /// LSDAPool - The action records, type infos and exception specifications
+  /// referenced by one or more LSDAs.  Everything is uniqued: action records
+  /// by type id and next record, so that chains share their common tails.
+  /// Type ids are indices into the pool's type infos, rather than into those
+  /// of a single function.
+  struct LSDAPool {
+    std::vector<const GlobalVariable *> TypeInfos;
+    DenseMap<const GlobalVariable *, unsigned> TypeIDs;
+
+    /// FilterIds - The exception specifications, each a zero-terminated list
+    /// of type ids.  Filters maps each list to the value that refers to it.
+    std::vector<unsigned> FilterIds;
+    std::map<std::vector<unsigned>, int> Filters;
+    unsigned SizeFilters;
+
+    /// Actions - The action records, whose Previous field is the index of
+    /// the next record in the chain, and their byte offsets.  An action
+    /// refers to a record by its offset plus one, zero meaning no action.
+    /// ActionIDs maps a record's type id and next action to its index plus
+    /// one.
+    std::vector<ActionEntry> Actions;
+    std::vector<unsigned> ActionOffsets;
+    std::map<std::pair<int, unsigned>, unsigned> ActionIDs;
+    unsigned SizeActions;
+
+    /// ActionsLabel, TTBaseLabel - The start of the action records and the
+    /// @TType base, created when first referred to.
+    MCSymbol *ActionsLabel;
+    MCSymbol *TTBaseLabel;
+
+    LSDAPool() : SizeFilters(0), SizeActions(0), ActionsLabel(0),
+                 TTBaseLabel(0) {}
+
+    bool empty() const {
+      return Actions.empty() && TypeInfos.empty() && FilterIds.empty();
+    }
+  };
+
+  LSDAPool Pool;
+
   /// CallSiteEntry - Structure describing an entry in the call-site table.
   struct CallSiteEntry {
     // The 'try-range' is BeginLabel .. EndLabel.
@@ -121,6 +168,22 @@ protected:
                             const SmallVectorImpl<unsigned> &FirstActions);
   void EmitExceptionTable();
 
+  /// EmitCompactExceptionTable - Emit an LSDA whose lengths and offsets are
+  /// uleb128 label differences resolved by the assembler.  Its actions, type
+  /// infos and exception specifications are added to the pool.
+  void EmitCompactExceptionTable(
+                      const SmallVectorImpl<const LandingPadInfo *> &LPs,
+                      const RangeMapType &PadMap);
+
+  /// AddToLSDAPool - Add the actions of the landing pads, along with the type
+  /// infos and exception specifications they use, to the pool, and gather the
+  /// first action of each landing pad.
+  void AddToLSDAPool(const SmallVectorImpl<const LandingPadInfo *> &LPs,
+                     SmallVectorImpl<unsigned> &FirstActions);
+
+  /// EmitLSDAPool - Emit the pool at the current position, and empty it.
+  void EmitLSDAPool();
+
 public:
   //===--------------------------------------------------------------------===//
   // Main entry points.
@@ -0,0 +1,154 @@
+//===-- StatepointGCPrinter.cpp - Statepoint stack map emitter ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements printing the stack maps of the statepoint collector.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/GCs.h"
+#include "llvm/CodeGen/AsmPrinter.h"
+#include "llvm/CodeGen/GCMetadataPrinter.h"
+#include "llvm/Function.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSymbol.h"
+#include "llvm/Target/Mangler.h"
+#include "llvm/Target/TargetData.h"
+#include "llvm/Target/TargetLoweringObjectFile.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+using namespace llvm;
+
+namespace {
+
+  class StatepointGCMetadataPrinter : public GCMetadataPrinter {
+  public:
+    void finishAssembly(AsmPrinter &AP);
+  };
+
+}
+
+static GCMetadataPrinterRegistry::Add<StatepointGCMetadataPrinter>
+Y("statepoint", "relocating collector using llvm.gc.statepoint");
+
+void llvm::linkStatepointGCPrinter() { }
+
+/// finishAssembly - Print the stack maps of the module, which the collector
+/// finds through the local symbol __LLVM_StackMaps.  The format is thus:
+///
+///   struct align(sizeof(intptr_t)) {
+///     uint8_t Version;             // 1
+///     uint8_t Reserved0;
+///     uint16_t Reserved1;
+///     uint32_t NumFunctions;
+///     struct align(sizeof(intptr_t)) {
+///       void *FunctionAddress;
+///       uint32_t FrameSize;
+///       uint32_t NumRecords;
+///       struct {
+///         uint32_t ID;             // the statepoint's first argument
+///         uint32_t ReturnOffset;   // from FunctionAddress
+///         uint16_t Reserved;
+///         uint16_t NumLocations;
+///         struct {
+///           uint8_t Kind;          // 1: Register, 2: Indirect [Reg + Offset]
+///           uint8_t Reserved;
+///           uint16_t DwarfRegNum;
+///           int32_t Offset;
+///         } Locations[NumLocations];
+///       } Records[NumRecords];
+///     } Functions[NumFunctions];
+///   } __LLVM_StackMaps;
+///
+/// Locations are listed in the order of the statepoint's GC pointers, so the
+/// i'th location is the one the i'th llvm.gc.relocate reads back.
+///
+void StatepointGCMetadataPrinter::finishAssembly(AsmPrinter &AP) {
+  unsigned IntPtrSize = AP.TM.getTargetData()->getPointerSize();
+  unsigned IntPtrAlign = IntPtrSize == 4 ? 2 : 3;
+
+  const MCSection *Section = AP.getObjFileLowering().getStackMapSection();
+  if (!Section)
+    Section = AP.getObjFileLowering().getDataSection();
+  AP.OutStreamer.SwitchSection(Section);
+  AP.EmitAlignment(IntPtrAlign);
+
+  SmallString<32> Name;
+  AP.Mang->getNameWithPrefix(Name, "__LLVM_StackMaps");
+  MCSymbol *Sym = AP.OutContext.GetOrCreateSymbol(Name);
+  if (AP.MAI->hasDotTypeDotSizeDirective())
+    AP.OutStreamer.EmitSymbolAttribute(Sym, MCSA_ELF_TypeObject);
+  AP.OutStreamer.EmitLabel(Sym);
+
+  unsigned NumFunctions = 0;
+  for (iterator I = begin(), IE = end(); I != IE; ++I)
+    if ((*I)->size())
+      ++NumFunctions;
+
+  AP.OutStreamer.AddComment("version");
+  AP.EmitInt8(1);
+  AP.EmitInt8(0);
+  AP.EmitInt16(0);
+  AP.OutStreamer.AddComment("number of functions");
+  AP.EmitInt32(NumFunctions);
+  AP.EmitAlignment(IntPtrAlign);
+
+  for (iterator I = begin(), IE = end(); I != IE; ++I) {
+    GCFunctionInfo &FI = **I;
+    if (!FI.size())
+      continue;
+
+    const Function &F = FI.getFunction();
+    if (FI.roots_size())
+      report_fatal_error("Function '" + F.getName() + "' uses llvm.gcroot, "
+                         "which the statepoint GC does not support.");
+
+    uint64_t FrameSize = FI.getFrameSize();
+    if (!isUInt<32>(FrameSize))
+      report_fatal_error("Function '" + F.getName() + "' is too large for "
+                         "the statepoint GC! Frame size " + Twine(FrameSize) +
+                         " > 4294967295.");
+
+    MCSymbol *FnSym = AP.Mang->getSymbol(&F);
+    AP.OutStreamer.AddComment("stack map for " + Twine(F.getName()));
+    AP.OutStreamer.EmitSymbolValue(FnSym, IntPtrSize, 0);
+    AP.EmitInt32(FrameSize);
+    AP.EmitInt32(FI.size());
+
+    for (GCFunctionInfo::iterator J = FI.begin(), JE = FI.end(); J != JE; ++J) {
+      if (!isUInt<32>(J->ID))
+        report_fatal_error("Statepoint ID " + Twine(J->ID) + " in function '" +
+                           F.getName() + "' does not fit in 32 bits.");
+      if (J->Live.size() >= 1<<16)
+        report_fatal_error("Function '" + F.getName() + "' has too many GC "
+                           "pointers live across a statepoint! Live count " +
+                           Twine(J->Live.size()) + " >= 65536.");
+
+      AP.OutStreamer.AddComment("statepoint " + Twine(J->ID));
+      AP.EmitInt32(J->ID);
+      AP.EmitLabelDifference(J->Label, FnSym, 4);
+      AP.EmitInt16(0);
+      AP.EmitInt16(J->Live.size());
+
+      for (std::vector<GCLocation>::const_iterator K = J->Live.begin(),
+             KE = J->Live.end(); K != KE; ++K) {
+        AP.EmitInt8(K->Kind);
+        AP.EmitInt8(0);
+        AP.EmitInt16(K->Reg);
+        AP.EmitInt32(K->Offset);
+      }
+    }
+
+    AP.EmitAlignment(IntPtrAlign);
+  }
+}
@@ -11,7 +11,8 @@
 // infrastructure.
 //
 // GCMachineCodeAnalysis identifies the GC safe points in the machine code.
-// Roots are identified in SelectionDAGISel.
+// Roots are identified in SelectionDAGISel, as are the spill slots of the GC
+// pointers live across each llvm.gc.statepoint.
 //
 //===----------------------------------------------------------------------===//
 
@@ -72,6 +73,8 @@ namespace {
 
     void FindSafePoints(MachineFunction &MF);
     void VisitCallPoint(MachineBasicBlock::iterator MI);
+    void FindStatepoints(MachineFunction &MF);
+    void VisitStatepoint(MachineBasicBlock::iterator MI);
     MCSymbol *InsertLabel(MachineBasicBlock &MBB,
                           MachineBasicBlock::iterator MI,
                           DebugLoc DL) const;
@@ -383,6 +386,48 @@ void GCMachineCodeAnalysis::FindSafePoints(MachineFunction &MF) {
         VisitCallPoint(MI);
 }
 
+/// VisitStatepoint - Records the safe point at the return address of the call
+/// a GC_SAFEPOINT follows, along with the locations of its live GC pointers.
+void GCMachineCodeAnalysis::VisitStatepoint(MachineBasicBlock::iterator SP) {
+  MachineBasicBlock &MBB = *SP->getParent();
+  MachineFunction &MF = *MBB.getParent();
+  const TargetFrameLowering *TFI = TM->getFrameLowering();
+  const TargetRegisterInfo *TRI = TM->getRegisterInfo();
+
+  // Nothing but the call sequence separates the call from the GC_SAFEPOINT,
+  // so the nearest preceding call is the one it describes.
+  MachineBasicBlock::iterator CI = SP;
+  do {
+    assert(CI != MBB.begin() && "GC_SAFEPOINT does not follow a call!");
+    --CI;
+  } while (!CI->isCall());
+
+  MCSymbol *Label = InsertLabel(MBB, llvm::next(CI), SP->getDebugLoc());
+  GCPoint &P = FI->addStatepoint(SP->getOperand(0).getImm(), Label,
+                                 SP->getDebugLoc());
+
+  for (unsigned i = 1, e = SP->getNumOperands(); i != e; ++i) {
+    unsigned FrameReg;
+    int Offset = TFI->getFrameIndexReference(MF, SP->getOperand(i).getImm(),
+                                             FrameReg);
+    P.Live.push_back(GCLocation(GCLocation::Indirect,
+                                TRI->getDwarfRegNum(FrameReg, false), Offset));
+  }
+}
+
+void GCMachineCodeAnalysis::FindStatepoints(MachineFunction &MF) {
+  for (MachineFunction::iterator BBI = MF.begin(),
+                                 BBE = MF.end(); BBI != BBE; ++BBI)
+    for (MachineBasicBlock::iterator MI = BBI->begin(),
+                                     ME = BBI->end(); MI != ME;) {
+      MachineBasicBlock::iterator SP = MI++;
+      if (SP->getOpcode() == TargetOpcode::GC_SAFEPOINT) {
+        VisitStatepoint(SP);
+        SP->eraseFromParent();
+      }
+    }
+}
+
 void GCMachineCodeAnalysis::FindStackOffsets(MachineFunction &MF) {
   const TargetFrameLowering *TFI = TM->getFrameLowering();
   assert(TFI && "TargetRegisterInfo not available!");
@@ -398,9 +443,6 @@ bool GCMachineCodeAnalysis::runOnMachineFunction(MachineFunction &MF) {
     return false;
 
   FI = &getAnalysis<GCModuleInfo>().getFunctionInfo(*MF.getFunction());
-  if (!FI->getStrategy().needsSafePoints())
-    return false;
-
   TM = &MF.getTarget();
   MMI = &getAnalysis<MachineModuleInfo>();
   TII = TM->getInstrInfo();
@@ -408,6 +450,14 @@ bool GCMachineCodeAnalysis::runOnMachineFunction(MachineFunction &MF) {
   // Find the size of the stack frame.
   FI->setFrameSize(MF.getFrameInfo()->getStackSize());
 
+  // Statepoints are recorded whatever safe points the strategy asks for, and
+  // every statepoint makes a call.
+  if (MF.getFrameInfo()->hasCalls())
+    FindStatepoints(MF);
+
+  if (!FI->getStrategy().needsSafePoints())
+    return false;
+
   // Find all safe points.
   if (FI->getStrategy().customSafePoints()) {
     FI->getStrategy().findCustomSafePoints(*FI, MF);
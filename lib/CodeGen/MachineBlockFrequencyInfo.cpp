@@ -16,12 +16,14 @@
 #include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/CodeGen/MachineBranchProbabilityInfo.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
 
 using namespace llvm;
 
 INITIALIZE_PASS_BEGIN(MachineBlockFrequencyInfo, "machine-block-freq",
                       "Machine Block Frequency Analysis", true, true)
 INITIALIZE_PASS_DEPENDENCY(MachineBranchProbabilityInfo)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
 INITIALIZE_PASS_END(MachineBlockFrequencyInfo, "machine-block-freq",
                     "Machine Block Frequency Analysis", true, true)
 
@@ -31,7 +33,8 @@ char MachineBlockFrequencyInfo::ID = 0;
 MachineBlockFrequencyInfo::MachineBlockFrequencyInfo() : MachineFunctionPass(ID) {
   initializeMachineBlockFrequencyInfoPass(*PassRegistry::getPassRegistry());
   MBFI = new BlockFrequencyImpl<MachineBasicBlock, MachineFunction,
-                                MachineBranchProbabilityInfo>();
+                                MachineBranchProbabilityInfo, MachineLoopInfo,
+                                MachineLoop>();
 }
 
 MachineBlockFrequencyInfo::~MachineBlockFrequencyInfo() {
@@ -40,13 +43,14 @@ MachineBlockFrequencyInfo::~MachineBlockFrequencyInfo() {
 
 void MachineBlockFrequencyInfo::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<MachineBranchProbabilityInfo>();
+  AU.addRequired<MachineLoopInfo>();
   AU.setPreservesAll();
   MachineFunctionPass::getAnalysisUsage(AU);
 }
 
 bool MachineBlockFrequencyInfo::runOnMachineFunction(MachineFunction &F) {
   MachineBranchProbabilityInfo &MBPI = getAnalysis<MachineBranchProbabilityInfo>();
-  MBFI->doFunction(&F, &MBPI);
+  MBFI->doFunction(&F, &MBPI, &getAnalysis<MachineLoopInfo>());
   return false;
 }
 
@@ -59,3 +63,16 @@ BlockFrequency MachineBlockFrequencyInfo::
 getBlockFreq(const MachineBasicBlock *MBB) const {
   return MBFI->getBlockFreq(MBB);
 }
+
+uint64_t MachineBlockFrequencyInfo::getEntryFreq() const {
+  return MBFI->getEntryFreq();
+}
+
+void MachineBlockFrequencyInfo::
+setBlockFreq(const MachineBasicBlock *MBB, BlockFrequency Freq) {
+  MBFI->setBlockFreq(MBB, Freq);
+}
+
+void MachineBlockFrequencyInfo::eraseBlock(const MachineBasicBlock *MBB) {
+  MBFI->eraseBlock(MBB);
+}
@@ -75,6 +75,7 @@ MachineFunction::MachineFunction(const Function *F, const TargetMachine &TM,
 MachineFunction::~MachineFunction() {
   BasicBlocks.clear();
   InstructionRecycler.clear(Allocator);
+  OperandRecycler.clear(Allocator);
   BasicBlockRecycler.clear(Allocator);
   if (RegInfo) {
     RegInfo->~MachineRegisterInfo();
@@ -157,7 +158,7 @@ MachineInstr *
 MachineFunction::CreateMachineInstr(const MCInstrDesc &MCID,
                                     DebugLoc DL, bool NoImp) {
   return new (InstructionRecycler.Allocate<MachineInstr>(Allocator))
-    MachineInstr(MCID, DL, NoImp);
+    MachineInstr(*this, MCID, DL, NoImp);
 }
 
 /// CloneMachineInstr - Create a new MachineInstr which is a copy of the
@@ -174,7 +175,14 @@ MachineFunction::CloneMachineInstr(const MachineInstr *Orig) {
 ///
 void
 MachineFunction::DeleteMachineInstr(MachineInstr *MI) {
+  // The operand array and the MI object itself are independently recyclable.
+  // Grab the operand array before the destructor runs, it may still need to
+  // inspect the operands.
+  MachineOperand *Operands = MI->Operands;
+  OperandCapacity CapOperands = MI->CapOperands;
   MI->~MachineInstr();
+  if (Operands)
+    deallocateOperandArray(CapOperands, Operands);
   InstructionRecycler.Deallocate(Allocator, MI);
 }
 
@@ -453,7 +461,7 @@ int MachineFrameInfo::CreateFixedObject(uint64_t Size, int64_t SPOffset,
   unsigned StackAlign = TFI.getStackAlignment();
   unsigned Align = MinAlign(SPOffset, StackAlign);
   Objects.insert(Objects.begin(), StackObject(Size, Align, SPOffset, Immutable,
-                                              /*isSS*/false, false));
+                                              /*isSS*/false, false, 0));
   return -++NumFixedObjects;
 }
 
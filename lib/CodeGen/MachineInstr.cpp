@@ -483,16 +483,6 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, const MachineMemOperand &MMO) {
 // MachineInstr Implementation
 //===----------------------------------------------------------------------===//
 
-/// MachineInstr ctor - This constructor creates a dummy MachineInstr with
-/// MCID NULL and no operands.
-MachineInstr::MachineInstr()
-  : MCID(0), Flags(0), AsmPrinterFlags(0),
-    NumMemRefs(0), MemRefs(0),
-    Parent(0) {
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-}
-
 void MachineInstr::addImplicitDefUseOperands() {
   if (MCID->ImplicitDefs)
     for (const uint16_t *ImpDefs = MCID->getImplicitDefs(); *ImpDefs; ++ImpDefs)
@@ -505,73 +495,33 @@ void MachineInstr::addImplicitDefUseOperands() {
 /// MachineInstr ctor - This constructor creates a MachineInstr and adds the
 /// implicit operands. It reserves space for the number of operands specified by
 /// the MCInstrDesc.
-MachineInstr::MachineInstr(const MCInstrDesc &tid, bool NoImp)
-  : MCID(&tid), Flags(0), AsmPrinterFlags(0),
-    NumMemRefs(0), MemRefs(0), Parent(0) {
-  unsigned NumImplicitOps = 0;
-  if (!NoImp)
-    NumImplicitOps = MCID->getNumImplicitDefs() + MCID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + MCID->getNumOperands());
-  if (!NoImp)
-    addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-}
-
-/// MachineInstr ctor - As above, but with a DebugLoc.
-MachineInstr::MachineInstr(const MCInstrDesc &tid, const DebugLoc dl,
-                           bool NoImp)
-  : MCID(&tid), Flags(0), AsmPrinterFlags(0),
-    NumMemRefs(0), MemRefs(0), Parent(0), debugLoc(dl) {
-  unsigned NumImplicitOps = 0;
+MachineInstr::MachineInstr(MachineFunction &MF, const MCInstrDesc &tid,
+                           const DebugLoc dl, bool NoImp)
+  : MCID(&tid), Flags(0), AsmPrinterFlags(0), NumMemRefs(0), NumOperands(0),
+    MemRefs(0), Operands(0), Parent(0), ParentMF(&MF), debugLoc(dl) {
+  unsigned NumOps = MCID->getNumOperands();
   if (!NoImp)
-    NumImplicitOps = MCID->getNumImplicitDefs() + MCID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + MCID->getNumOperands());
+    NumOps += MCID->getNumImplicitDefs() + MCID->getNumImplicitUses();
+  if (NumOps) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF.allocateOperandArray(CapOperands);
+  }
   if (!NoImp)
     addImplicitDefUseOperands();
   // Make sure that we get added to a machine basicblock
   LeakDetector::addGarbageObject(this);
 }
 
-/// MachineInstr ctor - Work exactly the same as the ctor two above, except
-/// that the MachineInstr is created and added to the end of the specified
-/// basic block.
-MachineInstr::MachineInstr(MachineBasicBlock *MBB, const MCInstrDesc &tid)
-  : MCID(&tid), Flags(0), AsmPrinterFlags(0),
-    NumMemRefs(0), MemRefs(0), Parent(0) {
-  assert(MBB && "Cannot use inserting ctor with null basic block!");
-  unsigned NumImplicitOps =
-    MCID->getNumImplicitDefs() + MCID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + MCID->getNumOperands());
-  addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-  MBB->push_back(this);  // Add instruction to end of basic block!
-}
-
-/// MachineInstr ctor - As above, but with a DebugLoc.
-///
-MachineInstr::MachineInstr(MachineBasicBlock *MBB, const DebugLoc dl,
-                           const MCInstrDesc &tid)
-  : MCID(&tid), Flags(0), AsmPrinterFlags(0),
-    NumMemRefs(0), MemRefs(0), Parent(0), debugLoc(dl) {
-  assert(MBB && "Cannot use inserting ctor with null basic block!");
-  unsigned NumImplicitOps =
-    MCID->getNumImplicitDefs() + MCID->getNumImplicitUses();
-  Operands.reserve(NumImplicitOps + MCID->getNumOperands());
-  addImplicitDefUseOperands();
-  // Make sure that we get added to a machine basicblock
-  LeakDetector::addGarbageObject(this);
-  MBB->push_back(this);  // Add instruction to end of basic block!
-}
-
 /// MachineInstr ctor - Copies MachineInstr arg exactly
 ///
 MachineInstr::MachineInstr(MachineFunction &MF, const MachineInstr &MI)
   : MCID(&MI.getDesc()), Flags(0), AsmPrinterFlags(0),
-    NumMemRefs(MI.NumMemRefs), MemRefs(MI.MemRefs),
-    Parent(0), debugLoc(MI.getDebugLoc()) {
-  Operands.reserve(MI.getNumOperands());
+    NumMemRefs(MI.NumMemRefs), NumOperands(0), MemRefs(MI.MemRefs),
+    Operands(0), Parent(0), ParentMF(&MF), debugLoc(MI.getDebugLoc()) {
+  if (unsigned NumOps = MI.getNumOperands()) {
+    CapOperands = OperandCapacity::get(NumOps);
+    Operands = MF.allocateOperandArray(CapOperands);
+  }
 
   // Add operands
   for (unsigned i = 0; i != MI.getNumOperands(); ++i)
@@ -580,16 +530,13 @@ MachineInstr::MachineInstr(MachineFunction &MF, const MachineInstr &MI)
   // Copy all the flags.
   Flags = MI.Flags;
 
-  // Set parent to null.
-  Parent = 0;
-
   LeakDetector::addGarbageObject(this);
 }
 
 MachineInstr::~MachineInstr() {
   LeakDetector::removeGarbageObject(this);
 #ifndef NDEBUG
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = getNumOperands(); i != e; ++i) {
     assert(Operands[i].ParentMI == this && "ParentMI mismatch!");
     assert((!Operands[i].isReg() || !Operands[i].isOnRegUseList()) &&
            "Reg operand def/use list corrupted");
@@ -610,7 +557,7 @@ MachineRegisterInfo *MachineInstr::getRegInfo() {
 /// this instruction from their respective use lists.  This requires that the
 /// operands already be on their use lists.
 void MachineInstr::RemoveRegOperandsFromUseLists() {
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = getNumOperands(); i != e; ++i) {
     if (Operands[i].isReg())
       Operands[i].RemoveRegOperandFromRegInfo();
   }
@@ -620,7 +567,7 @@ void MachineInstr::RemoveRegOperandsFromUseLists() {
 /// this instruction from their respective use lists.  This requires that the
 /// operands not be on their use lists yet.
 void MachineInstr::AddRegOperandsToUseLists(MachineRegisterInfo &RegInfo) {
-  for (unsigned i = 0, e = Operands.size(); i != e; ++i) {
+  for (unsigned i = 0, e = getNumOperands(); i != e; ++i) {
     if (Operands[i].isReg())
       Operands[i].AddRegOperandToRegInfo(&RegInfo);
   }
@@ -633,17 +580,24 @@ void MachineInstr::AddRegOperandsToUseLists(MachineRegisterInfo &RegInfo) {
 /// (before the first implicit operand).
 void MachineInstr::addOperand(const MachineOperand &Op) {
   assert(MCID && "Cannot add operands before providing an instr descriptor");
+
+  // Check if we're adding one of our existing operands.  The operand array
+  // may be reallocated below, so make a copy first.
+  if (&Op >= Operands && &Op < Operands + NumOperands) {
+    MachineOperand CopyOp(Op);
+    return addOperand(CopyOp);
+  }
+
   bool isImpReg = Op.isReg() && Op.isImplicit();
   MachineRegisterInfo *RegInfo = getRegInfo();
 
   // If the Operands backing store is reallocated, all register operands must
   // be removed and re-added to RegInfo.  It is storing pointers to operands.
-  bool Reallocate = RegInfo &&
-    !Operands.empty() && Operands.size() == Operands.capacity();
+  bool Reallocate = !Operands || NumOperands == CapOperands.getSize();
 
   // Find the insert location for the new operand.  Implicit registers go at
   // the end, everything goes before the implicit regs.
-  unsigned OpNo = Operands.size();
+  unsigned OpNo = getNumOperands();
 
   // Remove all the implicit operands from RegInfo if they need to be shifted.
   // FIXME: Allow mixed explicit and implicit operands on inline asm.
@@ -666,18 +620,36 @@ void MachineInstr::addOperand(const MachineOperand &Op) {
   // All operands from OpNo have been removed from RegInfo.  If the Operands
   // backing store needs to be reallocated, we also need to remove any other
   // register operands.
-  if (Reallocate)
-    for (unsigned i = 0; i != OpNo; ++i)
-      if (Operands[i].isReg())
-        Operands[i].RemoveRegOperandFromRegInfo();
+  MachineOperand *OldOperands = Operands;
+  OperandCapacity OldCap = CapOperands;
+  if (Reallocate) {
+    if (RegInfo)
+      for (unsigned i = 0; i != OpNo; ++i)
+        if (Operands[i].isReg())
+          Operands[i].RemoveRegOperandFromRegInfo();
+
+    // Grow the array in amortized linear time.
+    CapOperands = OldOperands ? OldCap.getNext() : OperandCapacity::get(1);
+    Operands = ParentMF->allocateOperandArray(CapOperands);
+    std::copy(OldOperands, OldOperands + OpNo, Operands);
+  }
+
+  // Move the operands following the insertion point.
+  std::copy_backward(OldOperands + OpNo, OldOperands + NumOperands,
+                     Operands + NumOperands + 1);
+  ++NumOperands;
+
+  // Recycle the old operand array.
+  if (OldOperands != Operands && OldOperands)
+    ParentMF->deallocateOperandArray(OldCap, OldOperands);
 
   // Insert the new operand at OpNo.
-  Operands.insert(Operands.begin() + OpNo, Op);
+  Operands[OpNo] = Op;
   Operands[OpNo].ParentMI = this;
 
   // The Operands backing store has now been reallocated, so we can re-add the
   // operands before OpNo.
-  if (Reallocate)
+  if (Reallocate && RegInfo)
     for (unsigned i = 0; i != OpNo; ++i)
       if (Operands[i].isReg())
         Operands[i].AddRegOperandToRegInfo(RegInfo);
@@ -694,7 +666,7 @@ void MachineInstr::addOperand(const MachineOperand &Op) {
 
   // Re-add all the implicit ops.
   if (RegInfo) {
-    for (unsigned i = OpNo + 1, e = Operands.size(); i != e; ++i) {
+    for (unsigned i = OpNo + 1, e = getNumOperands(); i != e; ++i) {
       assert(Operands[i].isReg() && "Should only be an implicit reg!");
       Operands[i].AddRegOperandToRegInfo(RegInfo);
     }
@@ -705,15 +677,15 @@ void MachineInstr::addOperand(const MachineOperand &Op) {
 /// fewer operand than it started with.
 ///
 void MachineInstr::RemoveOperand(unsigned OpNo) {
-  assert(OpNo < Operands.size() && "Invalid operand number");
+  assert(OpNo < getNumOperands() && "Invalid operand number");
 
   // Special case removing the last one.
-  if (OpNo == Operands.size()-1) {
+  if (OpNo == getNumOperands()-1) {
     // If needed, remove from the reg def/use list.
-    if (Operands.back().isReg() && Operands.back().isOnRegUseList())
-      Operands.back().RemoveRegOperandFromRegInfo();
+    if (Operands[OpNo].isReg() && Operands[OpNo].isOnRegUseList())
+      Operands[OpNo].RemoveRegOperandFromRegInfo();
 
-    Operands.pop_back();
+    --NumOperands;
     return;
   }
 
@@ -722,16 +694,17 @@ void MachineInstr::RemoveOperand(unsigned OpNo) {
   // move everything down, then re-add them.
   MachineRegisterInfo *RegInfo = getRegInfo();
   if (RegInfo) {
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
+    for (unsigned i = OpNo, e = getNumOperands(); i != e; ++i) {
       if (Operands[i].isReg())
         Operands[i].RemoveRegOperandFromRegInfo();
     }
   }
 
-  Operands.erase(Operands.begin()+OpNo);
+  std::copy(Operands + OpNo + 1, Operands + NumOperands, Operands + OpNo);
+  --NumOperands;
 
   if (RegInfo) {
-    for (unsigned i = OpNo, e = Operands.size(); i != e; ++i) {
+    for (unsigned i = OpNo, e = getNumOperands(); i != e; ++i) {
       if (Operands[i].isReg())
         Operands[i].AddRegOperandToRegInfo(RegInfo);
     }
@@ -467,6 +467,9 @@ void TargetPassConfig::addMachineSSAOptimization() {
   // instructions dead.
   addPass(OptimizePHIsID);
 
+  // Merge disjoint stack slots.
+  addPass(StackColoringID);
+
   // If the target requests it, assign local variables to stack slots relative
   // to one another and simplify frame index references where possible.
   addPass(LocalStackSlotAllocationID);
@@ -241,6 +241,8 @@ namespace {
     SDValue visitMEMBARRIER(SDNode *N);
 
     SDValue XformToShuffleWithZero(SDNode *N);
+    bool isProfitableToFoldConstantAdd(unsigned Opc, SDValue Inner,
+                                       SDValue Sum) const;
     SDValue ReassociateOps(unsigned Opc, DebugLoc DL, SDValue LHS, SDValue RHS);
 
     SDValue visitShiftByConstant(SDNode *N, unsigned Amt);
@@ -561,6 +563,25 @@ static bool isOneUseSetCC(SDValue N) {
   return false;
 }
 
+/// isProfitableToFoldConstantAdd - Return false if folding the constant of
+/// Inner, an (add x, c1) that stays live for its other uses, into the constant
+/// Sum would need a new immediate to be materialized, and the target says
+/// that is expensive.  CodeGenPrepare deliberately rebases addresses with
+/// large offsets onto each other so that the large offset is only
+/// materialized once.
+bool DAGCombiner::isProfitableToFoldConstantAdd(unsigned Opc, SDValue Inner,
+                                                SDValue Sum) const {
+  if (Opc != ISD::ADD || Inner.hasOneUse() ||
+      !TLI.isSharedAddReassocExpensive())
+    return true;
+  ConstantSDNode *C = dyn_cast<ConstantSDNode>(Sum);
+  if (!C)
+    return true;
+  const APInt &Imm = C->getAPIntValue();
+  return Imm.getMinSignedBits() <= 64 &&
+         TLI.isLegalAddImmediate(Imm.getSExtValue());
+}
+
 SDValue DAGCombiner::ReassociateOps(unsigned Opc, DebugLoc DL,
                                     SDValue N0, SDValue N1) {
   EVT VT = N0.getValueType();
@@ -571,6 +592,8 @@ SDValue DAGCombiner::ReassociateOps(unsigned Opc, DebugLoc DL,
         DAG.FoldConstantArithmetic(Opc, VT,
                                    cast<ConstantSDNode>(N0.getOperand(1)),
                                    cast<ConstantSDNode>(N1));
+      if (!isProfitableToFoldConstantAdd(Opc, N0, OpNode))
+        return SDValue();
       return DAG.getNode(Opc, DL, VT, N0.getOperand(0), OpNode);
     }
     if (N0.hasOneUse()) {
@@ -589,6 +612,8 @@ SDValue DAGCombiner::ReassociateOps(unsigned Opc, DebugLoc DL,
         DAG.FoldConstantArithmetic(Opc, VT,
                                    cast<ConstantSDNode>(N1.getOperand(1)),
                                    cast<ConstantSDNode>(N0));
+      if (!isProfitableToFoldConstantAdd(Opc, N1, OpNode))
+        return SDValue();
       return DAG.getNode(Opc, DL, VT, N1.getOperand(0), OpNode);
     }
     if (N1.hasOneUse()) {
@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Constants.h"
 #include "llvm/CallingConv.h"
 #include "llvm/DerivedTypes.h"
@@ -839,6 +840,7 @@ void SelectionDAGBuilder::clear() {
   UnusedArgNodeMap.clear();
   PendingLoads.clear();
   PendingExports.clear();
+  StatepointResults.clear();
   CurDebugLoc = DebugLoc();
   HasTailCall = false;
 }
@@ -5092,6 +5094,17 @@ SelectionDAGBuilder::visitIntrinsicCall(const CallInst &I, unsigned Intrinsic) {
   case Intrinsic::gcread:
   case Intrinsic::gcwrite:
     llvm_unreachable("GC failed to lower gcread/gcwrite intrinsics!");
+  case Intrinsic::gc_statepoint:
+    visitStatepoint(I);
+    return 0;
+  case Intrinsic::gc_result_int:
+  case Intrinsic::gc_result_float:
+  case Intrinsic::gc_result_ptr:
+    visitGCResult(I);
+    return 0;
+  case Intrinsic::gc_relocate:
+    visitGCRelocate(I);
+    return 0;
   case Intrinsic::flt_rounds:
     setValue(&I, DAG.getNode(ISD::FLT_ROUNDS_, dl, MVT::i32));
     return 0;
@@ -5167,13 +5180,46 @@ SelectionDAGBuilder::visitIntrinsicCall(const CallInst &I, unsigned Intrinsic) {
     return 0;
   }
 
-  case Intrinsic::invariant_start:
   case Intrinsic::lifetime_start:
+  case Intrinsic::lifetime_end: {
+    bool IsStart = (Intrinsic == Intrinsic::lifetime_start);
+    // Stack coloring is not enabled in O0, discard region information.
+    if (OptLevel == CodeGenOpt::None)
+      return 0;
+
+    SmallVector<Value *, 4> Allocas;
+    GetUnderlyingObjects(I.getArgOperand(1), Allocas, TD);
+
+    for (SmallVector<Value*, 4>::iterator Object = Allocas.begin(),
+         E = Allocas.end(); Object != E; ++Object) {
+      AllocaInst *LifetimeObject = dyn_cast_or_null<AllocaInst>(*Object);
+
+      // Could not find an Alloca.
+      if (!LifetimeObject)
+        continue;
+
+      // Only static allocas have a frame index; dynamic allocas are never
+      // candidates for slot sharing.
+      DenseMap<const AllocaInst*, int>::iterator SI =
+        FuncInfo.StaticAllocaMap.find(LifetimeObject);
+      if (SI == FuncInfo.StaticAllocaMap.end())
+        continue;
+
+      SDValue Ops[2];
+      Ops[0] = getRoot();
+      Ops[1] = DAG.getFrameIndex(SI->second, TLI.getPointerTy(), true);
+      unsigned Opcode = (IsStart ? ISD::LIFETIME_START : ISD::LIFETIME_END);
+
+      Res = DAG.getNode(Opcode, dl, MVT::Other, Ops, 2);
+      DAG.setRoot(Res);
+    }
+    return 0;
+  }
+  case Intrinsic::invariant_start:
     // Discard region information.
     setValue(&I, DAG.getUNDEF(TLI.getPointerTy()));
     return 0;
   case Intrinsic::invariant_end:
-  case Intrinsic::lifetime_end:
     // Discard region information.
     return 0;
   }
@@ -6379,6 +6425,164 @@ void SelectionDAGBuilder::visitVACopy(const CallInst &I) {
                           DAG.getSrcValue(I.getArgOperand(1))));
 }
 
+/// getStatepointSlots - Return the stack slots the GC pointers of an
+/// llvm.gc.statepoint are spilled to across its call, creating them on first
+/// use.  FastISel may select an llvm.gc.relocate before its statepoint.
+const SmallVectorImpl<int> &
+SelectionDAGBuilder::getStatepointSlots(const CallInst &Statepoint) {
+  SmallVector<int, 4> &Slots = FuncInfo.StatepointSlots[&Statepoint];
+  if (!Slots.empty())
+    return Slots;
+
+  MachineFrameInfo *MFI = DAG.getMachineFunction().getFrameInfo();
+  unsigned NumCallArgs =
+    cast<ConstantInt>(Statepoint.getArgOperand(2))->getZExtValue();
+  for (unsigned i = 3 + NumCallArgs, e = Statepoint.getNumArgOperands();
+       i != e; ++i) {
+    Type *Ty = Statepoint.getArgOperand(i)->getType();
+    Slots.push_back(MFI->CreateStackObject(TD->getTypeAllocSize(Ty),
+                                           TD->getABITypeAlignment(Ty),
+                                           false));
+  }
+  return Slots;
+}
+
+/// visitStatepoint - Lower llvm.gc.statepoint to a call bracketed by the
+/// spills and reloads of its GC pointers.  The GC pointers stay in registers
+/// everywhere else; only while the call is on the stack are they in memory,
+/// where the collector finds them through the GC_SAFEPOINT glued to the call.
+void SelectionDAGBuilder::visitStatepoint(const CallInst &I) {
+  DebugLoc dl = getCurDebugLoc();
+  uint64_t ID = cast<ConstantInt>(I.getArgOperand(0))->getZExtValue();
+  unsigned NumCallArgs = cast<ConstantInt>(I.getArgOperand(2))->getZExtValue();
+  const SmallVectorImpl<int> &Slots = getStatepointSlots(I);
+
+  // Spill the GC pointers.
+  SDValue Root = getRoot();
+  SmallVector<SDValue, 8> Stores;
+  for (unsigned i = 0, e = Slots.size(); i != e; ++i) {
+    SDValue Ptr = getValue(I.getArgOperand(3 + NumCallArgs + i));
+    SDValue FIN = DAG.getFrameIndex(Slots[i], TLI.getPointerTy());
+    Stores.push_back(DAG.getStore(Root, dl, Ptr, FIN,
+                                  MachinePointerInfo::getFixedStack(Slots[i]),
+                                  false, false, 0));
+  }
+  if (!Stores.empty())
+    Root = DAG.getNode(ISD::TokenFactor, dl, MVT::Other,
+                       &Stores[0], Stores.size());
+
+  // The call returns whatever type its llvm.gc.results read.  The result must
+  // be exported if any of them will be selected in another DAG.
+  Type *RetTy = Type::getVoidTy(*DAG.getContext());
+  bool ExportResult = FuncInfo.StatepointResults.count(&I);
+  for (Value::const_use_iterator UI = I.use_begin(), UE = I.use_end();
+       UI != UE; ++UI) {
+    const IntrinsicInst *User = cast<IntrinsicInst>(*UI);
+    if (User->getIntrinsicID() == Intrinsic::gc_relocate)
+      continue;
+    RetTy = User->getType();
+    if (User->getParent() != I.getParent())
+      ExportResult = true;
+  }
+
+  TargetLowering::ArgListTy Args;
+  for (unsigned i = 0; i != NumCallArgs; ++i) {
+    TargetLowering::ArgListEntry Entry;
+    Entry.Node = getValue(I.getArgOperand(3 + i));
+    Entry.Ty = I.getArgOperand(3 + i)->getType();
+    Args.push_back(Entry);
+  }
+
+  TargetLowering::
+  CallLoweringInfo CLI(Root, RetTy, false, false, false, false, NumCallArgs,
+                       CallingConv::C, /*isTailCall=*/false,
+                       /*doesNotRet=*/false,
+                       /*isReturnValueUsed=*/!RetTy->isVoidTy(),
+                       getValue(I.getArgOperand(1)->stripPointerCasts()),
+                       Args, DAG, dl);
+  std::pair<SDValue, SDValue> Result = TLI.LowerCallTo(CLI);
+
+  // Glue a GC_SAFEPOINT between the call and the end of its call sequence,
+  // so that nothing can be scheduled in between.  It lists the spill slots
+  // for GCMachineCodeAnalysis, which turns it into the safe point label.
+  SDNode *CallEnd = Result.second.getNode();
+  while (CallEnd->getOpcode() != ISD::CALLSEQ_END)
+    CallEnd = CallEnd->getOperand(0).getNode();
+
+  SmallVector<SDValue, 8> Ops;
+  Ops.push_back(DAG.getTargetConstant(ID, MVT::i64));
+  for (unsigned i = 0, e = Slots.size(); i != e; ++i)
+    Ops.push_back(DAG.getTargetConstant(Slots[i], MVT::i32));
+  Ops.push_back(CallEnd->getOperand(0));
+  SDValue LastOp = CallEnd->getOperand(CallEnd->getNumOperands() - 1);
+  bool HasGlue = LastOp.getValueType() == MVT::Glue;
+  if (HasGlue)
+    Ops.push_back(LastOp);
+  SDNode *SafePoint = DAG.getMachineNode(TargetOpcode::GC_SAFEPOINT, dl,
+                                         MVT::Other, MVT::Glue,
+                                         &Ops[0], Ops.size());
+
+  SmallVector<SDValue, 4> EndOps(CallEnd->op_begin(), CallEnd->op_end());
+  EndOps.front() = SDValue(SafePoint, 0);
+  if (HasGlue)
+    EndOps.back() = SDValue(SafePoint, 1);
+  SDNode *NewEnd = DAG.UpdateNodeOperands(CallEnd, &EndOps[0], EndOps.size());
+  assert(NewEnd == CallEnd && "CALLSEQ_END was CSE'd away!"); (void)NewEnd;
+  DAG.setRoot(Result.second);
+
+  if (!RetTy->isVoidTy()) {
+    StatepointResults[&I] = Result.first;
+    if (ExportResult) {
+      unsigned &Reg = FuncInfo.StatepointResults[&I];
+      if (!Reg)
+        Reg = FuncInfo.CreateRegs(RetTy);
+      RegsForValue RFV(*DAG.getContext(), TLI, Reg, RetTy);
+      SDValue Chain = DAG.getEntryNode();
+      RFV.getCopyToRegs(Result.first, DAG, dl, Chain, 0);
+      PendingExports.push_back(Chain);
+    }
+  }
+
+  // The token itself carries no value; its users refer back to I directly.
+  setValue(&I, DAG.getUNDEF(MVT::i32));
+}
+
+/// visitGCResult - Lower llvm.gc.result to the return value of the call made
+/// by its statepoint.
+void SelectionDAGBuilder::visitGCResult(const CallInst &I) {
+  const Instruction *Statepoint = cast<Instruction>(I.getArgOperand(0));
+  DenseMap<const Instruction*, SDValue>::iterator It =
+    StatepointResults.find(Statepoint);
+  if (It != StatepointResults.end()) {
+    setValue(&I, It->second);
+    return;
+  }
+
+  // The statepoint is selected in another DAG, and copies its result here.
+  unsigned &Reg = FuncInfo.StatepointResults[Statepoint];
+  if (!Reg)
+    Reg = FuncInfo.CreateRegs(I.getType());
+  RegsForValue RFV(*DAG.getContext(), TLI, Reg, I.getType());
+  SDValue Chain = DAG.getEntryNode();
+  setValue(&I, RFV.getCopyFromRegs(DAG, FuncInfo, getCurDebugLoc(), Chain, 0));
+}
+
+/// visitGCRelocate - Lower llvm.gc.relocate to a reload of the spill slot the
+/// collector may have updated while the statepoint's call was on the stack.
+void SelectionDAGBuilder::visitGCRelocate(const CallInst &I) {
+  const CallInst &Statepoint = *cast<CallInst>(I.getArgOperand(0));
+  unsigned Index = cast<ConstantInt>(I.getArgOperand(1))->getZExtValue();
+  int FI = getStatepointSlots(Statepoint)[Index];
+
+  SDValue Load = DAG.getLoad(TLI.getValueType(I.getType()), getCurDebugLoc(),
+                             getRoot(),
+                             DAG.getFrameIndex(FI, TLI.getPointerTy()),
+                             MachinePointerInfo::getFixedStack(FI),
+                             false, false, false, 0);
+  setValue(&I, Load);
+  PendingLoads.push_back(Load.getValue(1));
+}
+
 /// TargetLowering::LowerCallTo - This is the default LowerCallTo
 /// implementation, which just calls LowerCall.
 /// FIXME: When all targets are
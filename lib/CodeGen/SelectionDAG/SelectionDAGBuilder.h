@@ -122,6 +122,10 @@ private:
   /// instructions.
   SmallVector<SDValue, 8> PendingExports;
 
+  /// StatepointResults - The return values of the calls made by the
+  /// llvm.gc.statepoints in the current DAG, for their llvm.gc.results.
+  DenseMap<const Instruction*, SDValue> StatepointResults;
+
   /// SDNodeOrder - A unique monotonically increasing number used to order the
   /// SDNodes we create.
   unsigned SDNodeOrder;
@@ -539,6 +543,11 @@ private:
   void visitVAEnd(const CallInst &I);
   void visitVACopy(const CallInst &I);
 
+  void visitStatepoint(const CallInst &I);
+  void visitGCResult(const CallInst &I);
+  void visitGCRelocate(const CallInst &I);
+  const SmallVectorImpl<int> &getStatepointSlots(const CallInst &Statepoint);
+
   void visitUserOp1(const Instruction &I) {
     llvm_unreachable("UserOp1 should not exist at instruction selection time!");
   }
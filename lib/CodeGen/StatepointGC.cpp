@@ -0,0 +1,40 @@
+//===-- StatepointGC.cpp - Statepoint GC strategy -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a GC strategy for relocating collectors built on the
+// llvm.gc.statepoint intrinsics.  GC pointers are not rooted in allocas; the
+// code generator spills them around each statepoint's call instead, and
+// records where it did so in GCMachineCodeAnalysis.
+//
+// The stack map emitter is in StatepointGCPrinter.cpp.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/GCs.h"
+#include "llvm/CodeGen/GCStrategy.h"
+
+using namespace llvm;
+
+namespace {
+  class StatepointGC : public GCStrategy {
+  public:
+    StatepointGC();
+  };
+}
+
+static GCRegistry::Add<StatepointGC>
+X("statepoint", "relocating collector using llvm.gc.statepoint");
+
+void llvm::linkStatepointGC() { }
+
+StatepointGC::StatepointGC() {
+  // Statepoints are the only safe points, and are recorded unconditionally.
+  NeededSafePoints = 0;
+  UsesMetadata = true;
+}
@@ -14,10 +14,13 @@
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Target/TargetData.h"
 
 using namespace llvm;
@@ -73,6 +76,11 @@ MCJIT::MCJIT(Module *m, TargetMachine *tm, TargetJITInfo &tji,
   // Flush the output buffer so the SmallVector gets its data.
   OS.flush();
 
+  // Without this the debugger is only told about the object once it is seen
+  // attached to the process.
+  if (TM->Options.JITEmitDebugInfo)
+    RuntimeDyld::registerObjectsWithDebugger();
+
   // Load the object into the dynamic linker.
   MemoryBuffer *MB = MemoryBuffer::getMemBuffer(StringRef(Buffer.data(),
                                                           Buffer.size()),
@@ -81,6 +89,48 @@ MCJIT::MCJIT(Module *m, TargetMachine *tm, TargetJITInfo &tji,
     report_fatal_error(Dyld.getErrorString());
   // Resolve any relocations.
   Dyld.resolveRelocations();
+
+  collectLoadedFunctions();
+}
+
+void MCJIT::collectLoadedFunctions() {
+  MemoryBuffer *MB = MemoryBuffer::getMemBuffer(StringRef(Buffer.data(),
+                                                          Buffer.size()),
+                                                "", false);
+  OwningPtr<object::ObjectFile> Obj(object::ObjectFile::createObjectFile(MB));
+  if (!Obj)
+    return;
+
+  StringRef GlobalPrefix = TM->getMCAsmInfo()->getGlobalPrefix();
+  error_code Err;
+  for (object::symbol_iterator I = Obj->begin_symbols(),
+         E = Obj->end_symbols(); I != E; I.increment(Err)) {
+    if (Err)
+      return;
+    object::SymbolRef::Type Type;
+    StringRef Name;
+    uint64_t Size;
+    if (I->getType(Type) || Type != object::SymbolRef::ST_Function ||
+        I->getName(Name) || I->getSize(Size) ||
+        Size == 0 || Size == object::UnknownAddressOrSize)
+      continue;
+
+    StringRef IRName = Name;
+    if (!GlobalPrefix.empty() && IRName.startswith(GlobalPrefix))
+      IRName = IRName.substr(GlobalPrefix.size());
+    const Function *F = M->getFunction(IRName);
+    if (!F)
+      F = M->getFunction(("\1" + Name).str());
+    if (!F || F->isDeclaration())
+      continue;
+
+    LoadedFunction LF;
+    LF.F = F;
+    LF.Code = Dyld.getSymbolAddress(Name);
+    LF.Size = Size;
+    if (LF.Code)
+      LoadedFunctions.push_back(LF);
+  }
 }
 
 MCJIT::~MCJIT() {
@@ -88,6 +138,21 @@ MCJIT::~MCJIT() {
   delete TM;
 }
 
+void MCJIT::RegisterJITEventListener(JITEventListener *L) {
+  if (L == NULL)
+    return;
+  MutexGuard locked(lock);
+
+  // MCJIT has no machine function or line table at hand once the object is
+  // loaded; listeners only get the code range.
+  JITEvent_EmittedFunctionDetails Details;
+  Details.MF = 0;
+  for (unsigned I = 0, S = LoadedFunctions.size(); I < S; ++I) {
+    const LoadedFunction &LF = LoadedFunctions[I];
+    L->NotifyFunctionEmitted(*LF.F, LF.Code, LF.Size, Details);
+  }
+}
+
 void *MCJIT::getPointerToBasicBlock(BasicBlock *BB) {
   report_fatal_error("not yet implemented");
 }
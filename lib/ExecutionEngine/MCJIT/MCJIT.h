@@ -12,6 +12,7 @@
 
 #include "llvm/PassManager.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/raw_ostream.h"
@@ -40,6 +41,19 @@ class MCJIT : public ExecutionEngine {
 
   RuntimeDyld Dyld;
 
+  /// LoadedFunction - A function of the loaded object, as reported to
+  /// JITEventListeners.
+  struct LoadedFunction {
+    const Function *F;
+    void *Code;
+    size_t Size;
+  };
+  std::vector<LoadedFunction> LoadedFunctions;
+
+  /// collectLoadedFunctions - Record the address and size of every function
+  /// defined by the object in Buffer, now that Dyld has placed it.
+  void collectLoadedFunctions();
+
 public:
   ~MCJIT();
 
@@ -57,6 +71,11 @@ public:
   virtual GenericValue runFunction(Function *F,
                                    const std::vector<GenericValue> &ArgValues);
 
+  /// RegisterJITEventListener - The whole module is compiled up front and
+  /// nothing is emitted later, so the listener is told about every loaded
+  /// function right away and need not be remembered.
+  virtual void RegisterJITEventListener(JITEventListener *L);
+
   /// getPointerToNamedFunction - This method returns the address of the
   /// specified function by using the dlsym function call.  As such it is only
   /// useful for resolving library symbols, not code generated symbols.
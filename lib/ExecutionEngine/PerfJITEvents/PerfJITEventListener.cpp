@@ -0,0 +1,320 @@
+//===-- PerfJITEventListener.cpp - Tell Linux perf about JITted code ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that makes JITted functions
+// visible to the Linux perf tool.  Every emitted function is appended to the
+// /tmp/perf-<pid>.map symbol file that "perf report" consults for anonymous
+// executable memory.  Optionally the listener also writes a jitdump file,
+// which carries a copy of the code bytes and the line table of each function,
+// so that "perf inject --jit" can build a symbolized, annotatable image.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Config/config.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+
+#define DEBUG_TYPE "perf-jit-event-listener"
+#include "llvm/Function.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/DebugInfo.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "EventListenerCommon.h"
+
+#if LLVM_ON_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::jitprofiling;
+
+#if LLVM_ON_UNIX
+
+namespace {
+
+// The jitdump format is described in jitdump-specification.txt in the perf
+// documentation of the Linux kernel tree.  Fields are in host byte order.
+enum {
+  JitDumpMagic = 0x4A695444, // "JiTD"
+  JitDumpVersion = 1,
+  JitDumpHeaderSize = 40,
+  JitDumpRecordHeaderSize = 16
+};
+
+enum JitDumpRecordType {
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3
+};
+
+static uint32_t getHostELFMachine() {
+#if defined(__x86_64__)
+  return ELF::EM_X86_64;
+#elif defined(__i386__)
+  return ELF::EM_386;
+#elif defined(__arm__)
+  return ELF::EM_ARM;
+#elif defined(__powerpc64__)
+  return ELF::EM_PPC64;
+#elif defined(__powerpc__)
+  return ELF::EM_PPC;
+#elif defined(__mips__)
+  return ELF::EM_MIPS;
+#else
+  return ELF::EM_NONE;
+#endif
+}
+
+/// getTimestamp - perf correlates jitdump records with its samples by
+/// timestamp, which must come from the clock perf itself uses ("perf record
+/// -k mono").
+static uint64_t getTimestamp() {
+#ifdef __linux__
+  struct timespec TS;
+  if (clock_gettime(CLOCK_MONOTONIC, &TS) == 0)
+    return uint64_t(TS.tv_sec) * 1000000000ULL + TS.tv_nsec;
+#endif
+  sys::TimeValue Now = sys::TimeValue::now();
+  return uint64_t(Now.seconds()) * 1000000000ULL + Now.nanoseconds();
+}
+
+static uint32_t getThreadId() {
+#if defined(__linux__) && defined(SYS_gettid)
+  return ::syscall(SYS_gettid);
+#else
+  return ::getpid();
+#endif
+}
+
+/// LineEntry - One row of a JIT_CODE_DEBUG_INFO record.
+struct LineEntry {
+  uint64_t Address;
+  unsigned Line;
+  std::string File;
+};
+
+class PerfJITEventListener : public JITEventListener {
+  /// Lock - Serializes writes to the output files; the same listener may be
+  /// registered with several execution engines.
+  sys::Mutex Lock;
+
+  OwningPtr<raw_fd_ostream> MapFile;
+  OwningPtr<raw_fd_ostream> DumpFile;
+
+  /// Marker - The executable mapping of the jitdump file.  perf only picks
+  /// up jitdump files whose mmap it has recorded.
+  void *Marker;
+  size_t MarkerSize;
+
+  uint32_t Pid;
+  uint64_t CodeIndex;
+
+  void openMapFile(const std::string &Path);
+  void openDumpFile(const std::string &Path);
+
+  template<typename T>
+  void writeField(T Value) {
+    DumpFile->write(reinterpret_cast<const char*>(&Value), sizeof(Value));
+  }
+  void writeRecordHeader(JitDumpRecordType Type, uint32_t TotalSize) {
+    writeField<uint32_t>(Type);
+    writeField<uint32_t>(TotalSize);
+    writeField<uint64_t>(getTimestamp());
+  }
+
+  void writeDebugInfo(const Function &F, void *FnStart,
+                      const EmittedFunctionDetails &Details);
+  void writeCodeLoad(const Function &F, void *FnStart, size_t FnSize);
+
+public:
+  PerfJITEventListener(const std::string &MapPath,
+                       const std::string &DumpPath);
+  ~PerfJITEventListener();
+
+  virtual void NotifyFunctionEmitted(const Function &F,
+                                     void *FnStart, size_t FnSize,
+                                     const EmittedFunctionDetails &Details);
+};
+
+PerfJITEventListener::PerfJITEventListener(const std::string &MapPath,
+                                           const std::string &DumpPath)
+  : Marker(0), MarkerSize(0), Pid(::getpid()), CodeIndex(0) {
+  if (!MapPath.empty())
+    openMapFile(MapPath);
+  if (!DumpPath.empty())
+    openDumpFile(DumpPath);
+}
+
+PerfJITEventListener::~PerfJITEventListener() {
+  if (DumpFile) {
+    writeRecordHeader(JIT_CODE_CLOSE, JitDumpRecordHeaderSize);
+    DumpFile->flush();
+  }
+  if (Marker)
+    ::munmap(Marker, MarkerSize);
+}
+
+void PerfJITEventListener::openMapFile(const std::string &Path) {
+  std::string ErrorInfo;
+  MapFile.reset(new raw_fd_ostream(Path.c_str(), ErrorInfo,
+                                   raw_fd_ostream::F_Append));
+  if (!ErrorInfo.empty()) {
+    DEBUG(dbgs() << "Failed to open perf map file " << Path << ": "
+                 << ErrorInfo << "\n");
+    MapFile.reset();
+  }
+}
+
+void PerfJITEventListener::openDumpFile(const std::string &Path) {
+  int FD = ::open(Path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (FD < 0) {
+    DEBUG(dbgs() << "Failed to open jitdump file " << Path << ": "
+                 << sys::StrError() << "\n");
+    return;
+  }
+
+  MarkerSize = sys::Process::GetPageSize();
+  Marker = ::mmap(0, MarkerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, FD, 0);
+  if (Marker == MAP_FAILED) {
+    DEBUG(dbgs() << "Failed to map jitdump file " << Path << ": "
+                 << sys::StrError() << "\n");
+    Marker = 0;
+  }
+
+  DumpFile.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+  writeField<uint32_t>(JitDumpMagic);
+  writeField<uint32_t>(JitDumpVersion);
+  writeField<uint32_t>(JitDumpHeaderSize);
+  writeField<uint32_t>(getHostELFMachine());
+  writeField<uint32_t>(0); // pad1
+  writeField<uint32_t>(Pid);
+  writeField<uint64_t>(getTimestamp());
+  writeField<uint64_t>(0); // flags
+  DumpFile->flush();
+}
+
+void PerfJITEventListener::writeDebugInfo(
+    const Function &F, void *FnStart, const EmittedFunctionDetails &Details) {
+  FilenameCache Filenames;
+  std::vector<LineEntry> Lines;
+  Lines.reserve(Details.LineStarts.size());
+  uint32_t Size = JitDumpRecordHeaderSize + 16;
+  for (std::vector<EmittedFunctionDetails::LineStart>::const_iterator
+         I = Details.LineStarts.begin(), E = Details.LineStarts.end();
+       I != E; ++I) {
+    if (I->Loc.isUnknown())
+      continue;
+    LineEntry Entry;
+    Entry.Address = I->Address;
+    Entry.Line = I->Loc.getLine();
+    Entry.File = Filenames.getFullPath(I->Loc.getScope(F.getContext()));
+    Size += 16 + Entry.File.size() + 1;
+    Lines.push_back(Entry);
+  }
+  if (Lines.empty())
+    return;
+
+  writeRecordHeader(JIT_CODE_DEBUG_INFO, Size);
+  writeField<uint64_t>(reinterpret_cast<uintptr_t>(FnStart));
+  writeField<uint64_t>(Lines.size());
+  for (unsigned i = 0, e = Lines.size(); i != e; ++i) {
+    writeField<uint64_t>(Lines[i].Address);
+    writeField<int32_t>(Lines[i].Line);
+    writeField<int32_t>(0); // discriminator
+    DumpFile->write(Lines[i].File.c_str(), Lines[i].File.size() + 1);
+  }
+}
+
+void PerfJITEventListener::writeCodeLoad(const Function &F, void *FnStart,
+                                         size_t FnSize) {
+  StringRef Name = F.getName();
+  uint64_t Addr = reinterpret_cast<uintptr_t>(FnStart);
+
+  writeRecordHeader(JIT_CODE_LOAD,
+                    JitDumpRecordHeaderSize + 40 + Name.size() + 1 + FnSize);
+  writeField<uint32_t>(Pid);
+  writeField<uint32_t>(getThreadId());
+  writeField<uint64_t>(Addr); // vma
+  writeField<uint64_t>(Addr); // code_addr
+  writeField<uint64_t>(FnSize);
+  writeField<uint64_t>(CodeIndex++);
+  DumpFile->write(Name.data(), Name.size());
+  DumpFile->write('\0');
+  DumpFile->write(static_cast<const char*>(FnStart), FnSize);
+}
+
+// Appends the just-emitted function to the perf map and the jitdump file.
+// Both files are flushed after every function: perf reads them after the
+// process is gone, and JITted programs frequently leave through exit().
+void PerfJITEventListener::NotifyFunctionEmitted(
+    const Function &F, void *FnStart, size_t FnSize,
+    const EmittedFunctionDetails &Details) {
+  assert(F.hasName() && FnStart != 0 && "Bad symbol to add");
+  MutexGuard Locked(Lock);
+
+  if (MapFile) {
+    MapFile->write_hex(reinterpret_cast<uintptr_t>(FnStart)) << ' ';
+    MapFile->write_hex(FnSize) << ' ' << F.getName() << '\n';
+    MapFile->flush();
+  }
+
+  if (DumpFile) {
+    // perf expects the line table to precede the code it describes.
+    writeDebugInfo(F, FnStart, Details);
+    writeCodeLoad(F, FnStart, FnSize);
+    DumpFile->flush();
+  }
+}
+
+}  // anonymous namespace.
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener(
+                                      bool EmitJITDump) {
+  std::string Pid = utostr(::getpid());
+  return new PerfJITEventListener("/tmp/perf-" + Pid + ".map",
+                                  EmitJITDump ? "jit-" + Pid + ".dump" : "");
+}
+
+// for testing
+JITEventListener *JITEventListener::createPerfJITEventListener(
+                                      StringRef MapPath, StringRef DumpPath) {
+  return new PerfJITEventListener(MapPath.str(), DumpPath.str());
+}
+
+} // namespace llvm
+
+#else // !LLVM_ON_UNIX
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener(bool) {
+  return 0;
+}
+
+JITEventListener *JITEventListener::createPerfJITEventListener(StringRef,
+                                                               StringRef) {
+  return 0;
+}
+} // namespace llvm
+
+#endif // LLVM_ON_UNIX
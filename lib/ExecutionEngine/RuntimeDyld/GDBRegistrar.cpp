@@ -13,6 +13,13 @@
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/TimeValue.h"
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace llvm;
 
@@ -43,8 +50,9 @@ extern "C" {
 
   // We put information about the JITed function in this global, which the
   // debugger reads.  Make sure to specify the version statically, because the
-  // debugger checks the version before we can set it during runtime.
-  static struct jit_descriptor __jit_debug_descriptor = { 1, 0, 0, 0 };
+  // debugger checks the version before we can set it during runtime.  It is
+  // not static so that the unit tests can look at what the debugger sees.
+  struct jit_descriptor __jit_debug_descriptor = { 1, 0, 0, 0 };
 
   // Debuggers puts a breakpoint in this function.
   LLVM_ATTRIBUTE_NOINLINE void __jit_debug_register_code() { }
@@ -53,7 +61,8 @@ extern "C" {
 
 namespace {
 
-// Buffer for an in-memory object file in executable memory
+// Buffer for an in-memory object file in executable memory.  The entry is
+// null while the object is queued and the debugger has not been told yet.
 typedef llvm::DenseMap< const char*,
                         std::pair<std::size_t, jit_code_entry*> >
   RegisteredObjectBufferMap;
@@ -62,14 +71,41 @@ typedef llvm::DenseMap< const char*,
 /// singleton toolbox. Handles thread-safe registration and deregistration of
 /// object files that are in executable memory managed by the client of this
 /// class.
+///
+/// Telling the debugger about an object is deferred until a debugger is seen
+/// attached to the process or publishing is explicitly requested.  Until then
+/// objects are only queued, without a jit_code_entry, and are later published
+/// as one batch.  The process is checked for a debugger when the registrar is
+/// created, and again on any registration at least ProbeIntervalMS after the
+/// previous check.  A debugger that attaches between registrations sees the
+/// queued objects at the first registration that checks again.  Clients that
+/// need the debugger to see their objects at a particular point call
+/// publishObjects(), which RuntimeDyld::registerObjectsWithDebugger exposes.
 class GDBJITRegistrar : public JITRegistrar {
   /// A map of in-memory object files that have been registered with the
   /// JIT interface.
   RegisteredObjectBufferMap ObjectBufferMap;
 
+  /// Objects that have not been handed to the debugger yet, in registration
+  /// order.  Objects deregistered in the meantime are skipped when the queue
+  /// is flushed or compacted.
+  std::vector<const char*> PendingObjects;
+
+  /// Whether new entries are handed to the debugger right away.
+  bool Publishing;
+
+  /// When the process was last checked for a debugger.
+  sys::TimeValue LastProbe;
+
+  /// The minimum time between two checks for a debugger.  Each check reads
+  /// /proc, which is too slow to do for every object.
+  static const unsigned ProbeIntervalMS = 100;
+
 public:
   /// Instantiates the JIT service.
-  GDBJITRegistrar() : ObjectBufferMap() {}
+  GDBJITRegistrar()
+    : ObjectBufferMap(), Publishing(isDebuggerAttached()),
+      LastProbe(sys::TimeValue::now()) {}
 
   /// Unregisters each object that was previously registered and releases all
   /// internal resources.
@@ -85,20 +121,40 @@ public:
   /// Returns true if @p Object was found in ObjectBufferMap.
   bool deregisterObject(const MemoryBuffer &Object);
 
+  /// Hands all queued objects to the debugger, and every later object as
+  /// soon as it is registered.
+  void publishObjects();
+
 private:
   /// Deregister the debug info for the given object file from the debugger
   /// and delete any temporary copies.  This private method does not remove
   /// the function from Map so that it can be called while iterating over Map.
   void deregisterObjectInternal(RegisteredObjectBufferMap::iterator I);
+
+  /// Hand the queued objects to the debugger.  The caller holds
+  /// JITDebugLock.
+  void flushPendingObjects();
+
+  /// Returns true if @p Buffer is registered but not yet known to the
+  /// debugger.
+  bool isPending(const char *Buffer) const {
+    RegisteredObjectBufferMap::const_iterator I = ObjectBufferMap.find(Buffer);
+    return I != ObjectBufferMap.end() && I->second.second == NULL;
+  }
+
+  /// Returns true if the process is known to be traced by a debugger.  Hosts
+  /// where this cannot be determined cheaply always report true, which keeps
+  /// registration eager there.
+  static bool isDebuggerAttached();
 };
 
 /// Lock used to serialize all jit registration events, since they
 /// modify global variables.
 llvm::sys::Mutex JITDebugLock;
 
-/// Acquire the lock and do the registration.
+/// Link the entry into the debugger's list and notify the debugger.  The
+/// caller holds JITDebugLock.
 void NotifyDebugger(jit_code_entry* JITCodeEntry) {
-  llvm::MutexGuard locked(JITDebugLock);
   __jit_debug_descriptor.action_flag = JIT_REGISTER_FN;
 
   // Insert this entry at the head of the list.
@@ -113,7 +169,31 @@ void NotifyDebugger(jit_code_entry* JITCodeEntry) {
   __jit_debug_register_code();
 }
 
+bool GDBJITRegistrar::isDebuggerAttached() {
+#ifdef __linux__
+  // A non-zero TracerPid in /proc/self/status means that a debugger (or some
+  // other ptrace user) is attached.
+  int FD = ::open("/proc/self/status", O_RDONLY);
+  if (FD < 0)
+    return true;
+  char Status[4096];
+  ssize_t Size = ::read(FD, Status, sizeof(Status) - 1);
+  ::close(FD);
+  if (Size <= 0)
+    return true;
+  StringRef Contents(Status, Size);
+  size_t Pos = Contents.find("TracerPid:");
+  if (Pos == StringRef::npos)
+    return true;
+  StringRef Pid = Contents.substr(Pos + 10).ltrim(" \t");
+  return !Pid.startswith("0");
+#else
+  return true;
+#endif
+}
+
 GDBJITRegistrar::~GDBJITRegistrar() {
+  llvm::MutexGuard locked(JITDebugLock);
   // Free all registered object files.
  for (RegisteredObjectBufferMap::iterator I = ObjectBufferMap.begin(), E = ObjectBufferMap.end();
        I != E; ++I) {
@@ -122,6 +202,7 @@ GDBJITRegistrar::~GDBJITRegistrar() {
     deregisterObjectInternal(I);
   }
   ObjectBufferMap.clear();
+  PendingObjects.clear();
 }
 
 void GDBJITRegistrar::registerObject(const MemoryBuffer &Object) {
@@ -130,25 +211,76 @@ void GDBJITRegistrar::registerObject(const MemoryBuffer &Object) {
   size_t      Size = Object.getBufferSize();
 
   assert(Buffer && "Attempt to register a null object with a debugger.");
+  llvm::MutexGuard locked(JITDebugLock);
   assert(ObjectBufferMap.find(Buffer) == ObjectBufferMap.end() &&
          "Second attempt to perform debug registration.");
-  jit_code_entry* JITCodeEntry = new jit_code_entry();
 
-  if (JITCodeEntry == 0) {
-    llvm::report_fatal_error(
-      "Allocation failed when registering a JIT entry!\n");
+  ObjectBufferMap[Buffer] = std::make_pair(Size, (jit_code_entry*)NULL);
+  PendingObjects.push_back(Buffer);
+
+  // Look for a debugger that attached since the last check, at most once per
+  // ProbeIntervalMS so that probing stays cheap for huge numbers of objects.
+  unsigned NumPending = PendingObjects.size();
+  if (!Publishing) {
+    sys::TimeValue Now = sys::TimeValue::now();
+    if ((Now - LastProbe).msec() >= ProbeIntervalMS) {
+      LastProbe = Now;
+      Publishing = isDebuggerAttached();
+    }
+  }
+  if (Publishing) {
+    flushPendingObjects();
+    return;
+  }
+
+  // Drop deregistered objects once they make up most of the queue.
+  if (NumPending > 64 && NumPending > 2 * ObjectBufferMap.size()) {
+    std::vector<const char*> Live;
+    Live.reserve(ObjectBufferMap.size());
+    for (unsigned i = 0; i != NumPending; ++i)
+      if (isPending(PendingObjects[i]))
+        Live.push_back(PendingObjects[i]);
+    PendingObjects.swap(Live);
   }
-  else {
-    JITCodeEntry->symfile_addr = Buffer;
-    JITCodeEntry->symfile_size = Size;
+}
 
-    ObjectBufferMap[Buffer] = std::make_pair(Size, JITCodeEntry);
+void GDBJITRegistrar::publishObjects() {
+  llvm::MutexGuard locked(JITDebugLock);
+  Publishing = true;
+  flushPendingObjects();
+}
+
+void GDBJITRegistrar::flushPendingObjects() {
+  // The debugger only looks at relevant_entry when it stops in
+  // __jit_debug_register_code, so each object still needs its own
+  // notification; the batch merely shares one critical section.
+  for (unsigned i = 0, e = PendingObjects.size(); i != e; ++i) {
+    RegisteredObjectBufferMap::iterator I =
+      ObjectBufferMap.find(PendingObjects[i]);
+    // Skip objects deregistered while queued, and buffers that were queued
+    // twice because they were reused for a new object.
+    if (I == ObjectBufferMap.end() || I->second.second != NULL)
+      continue;
+
+    jit_code_entry* JITCodeEntry = new jit_code_entry();
+    if (JITCodeEntry == 0) {
+      llvm::report_fatal_error(
+        "Allocation failed when registering a JIT entry!\n");
+    }
+
+    // The entry refers to the loaded object in place; the debugger reads the
+    // object straight out of the client's buffer.
+    JITCodeEntry->symfile_addr = I->first;
+    JITCodeEntry->symfile_size = I->second.first;
+    I->second.second = JITCodeEntry;
     NotifyDebugger(JITCodeEntry);
   }
+  PendingObjects.clear();
 }
 
 bool GDBJITRegistrar::deregisterObject(const MemoryBuffer& Object) {
   const char *Buffer = Object.getBufferStart();
+  llvm::MutexGuard locked(JITDebugLock);
   RegisteredObjectBufferMap::iterator I = ObjectBufferMap.find(Buffer);
 
   if (I != ObjectBufferMap.end()) {
@@ -164,9 +296,13 @@ void GDBJITRegistrar::deregisterObjectInternal(
 
   jit_code_entry*& JITCodeEntry = I->second.second;
 
-  // Acquire the lock and do the unregistration.
+  // An object the debugger never saw only has to leave the map; the queue
+  // skips it from then on.
+  if (JITCodeEntry == NULL)
+    return;
+
+  // Do the unregistration; the caller holds the lock.
   {
-    llvm::MutexGuard locked(JITDebugLock);
     __jit_debug_descriptor.action_flag = JIT_UNREGISTER_FN;
 
     // Remove the jit_code_entry from the linked list.
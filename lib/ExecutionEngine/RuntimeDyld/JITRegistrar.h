@@ -34,6 +34,11 @@ public:
   /// Returns true if @p Object was previously registered.
   virtual bool deregisterObject(const MemoryBuffer &Object) = 0;
 
+  /// Hands every registered object to the debugger, including objects whose
+  /// registration was deferred because no debugger was attached, and stops
+  /// deferring further registrations.
+  virtual void publishObjects() = 0;
+
   /// Returns a reference to a GDB JIT registrar singleton
   static JITRegistrar& getGDBRegistrar();
 };
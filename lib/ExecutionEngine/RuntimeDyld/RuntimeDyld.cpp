@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "dyld"
+#include "JITRegistrar.h"
 #include "RuntimeDyldImpl.h"
 #include "RuntimeDyldELF.h"
 #include "RuntimeDyldMachO.h"
@@ -480,4 +481,8 @@ StringRef RuntimeDyld::getErrorString() {
   return Dyld->getErrorString();
 }
 
+void RuntimeDyld::registerObjectsWithDebugger() {
+  JITRegistrar::getGDBRegistrar().publishObjects();
+}
+
 } // end namespace llvm
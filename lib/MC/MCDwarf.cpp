@@ -16,6 +16,7 @@
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/MCExpr.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -25,8 +26,14 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Config/config.h"
+#include <climits>
 using namespace llvm;
 
+static cl::opt<bool>
+ReduceCFI("reduce-cfi", cl::Hidden, cl::init(false),
+          cl::desc("Drop call frame instructions that do not change the "
+                   "frame description, and shorten DW_CFA_def_cfa"));
+
 // Given a special op, return the address skip amount (in units of
 // DWARF2_LINE_MIN_INSN_LENGTH.
 #define SPECIAL_ADDR(op) (((op) - DWARF2_LINE_OPCODE_BASE)/DWARF2_LINE_RANGE)
@@ -837,16 +844,52 @@ static const MachineLocation TranslateMachineLocation(
 }
 
 namespace {
-  class FrameEmitterImpl {
+  /// CFIState - The rules set up by the call frame instructions emitted so
+  /// far for the current CIE or FDE.
+  struct CFIState {
+    /// OtherRule - The rule of a register that is not saved at an offset from
+    /// the CFA.
+    static const int OtherRule = INT_MIN;
+
+    unsigned CFAReg;
     int CFAOffset;
+
+    /// RegRules - The offset from the CFA at which each register is saved,
+    /// or OtherRule.  Registers not in the map have their initial rule.
+    DenseMap<unsigned, int> RegRules;
+
+    /// Known - False once an instruction whose effect is not tracked, such
+    /// as an escape, has been emitted.
+    bool Known;
+
+    CFIState() : CFAReg(~0U), CFAOffset(0), Known(true) {}
+
+    bool isCFAKnown() const { return Known && CFAReg != ~0U; }
+
+    int getRule(unsigned Reg) const {
+      DenseMap<unsigned, int>::const_iterator I = RegRules.find(Reg);
+      return I == RegRules.end() ? OtherRule : I->second;
+    }
+  };
+
+  class FrameEmitterImpl {
     int CIENum;
     bool UsingCFI;
     bool IsEH;
     const MCSymbol *SectionStart;
+
+    /// State - The rules in effect at the current point of the CIE or FDE
+    /// being emitted.  InitialState is the state at the end of the CIE, which
+    /// every FDE starts from, and SavedStates is the stack of states pushed
+    /// by DW_CFA_remember_state.
+    CFIState State;
+    CFIState InitialState;
+    SmallVector<CFIState, 4> SavedStates;
+
+    bool isRedundant(const MCCFIInstruction &Instr) const;
   public:
     FrameEmitterImpl(bool usingCFI, bool isEH)
-      : CFAOffset(0), CIENum(0), UsingCFI(usingCFI), IsEH(isEH),
-        SectionStart(0) {}
+      : CIENum(0), UsingCFI(usingCFI), IsEH(isEH), SectionStart(0) {}
 
     void setSectionStart(const MCSymbol *Label) { SectionStart = Label; }
 
@@ -933,7 +976,25 @@ void FrameEmitterImpl::EmitCFIInstruction(MCStreamer &Streamer,
 
     // If advancing cfa.
     if (Dst.isReg() && Dst.getReg() == MachineLocation::VirtualFP) {
-      if (Src.getReg() == MachineLocation::VirtualFP) {
+      int NewOffset = IsRelative ? State.CFAOffset + Src.getOffset() :
+                                   -Src.getOffset();
+
+      // A DW_CFA_def_cfa that only changes one of the register and the offset
+      // is emitted as the shorter instruction that changes just that one.
+      bool Shorten = ReduceCFI && State.isCFAKnown();
+      if (Shorten && Src.getReg() != MachineLocation::VirtualFP &&
+          Src.getReg() != State.CFAReg && NewOffset == State.CFAOffset) {
+        if (VerboseAsm) Streamer.AddComment("DW_CFA_def_cfa_register");
+        Streamer.EmitIntValue(dwarf::DW_CFA_def_cfa_register, 1);
+        if (VerboseAsm) Streamer.AddComment(Twine("Reg ") +
+                                            Twine(Src.getReg()));
+        Streamer.EmitULEB128IntValue(Src.getReg());
+        State.CFAReg = Src.getReg();
+        return;
+      }
+
+      if (Src.getReg() == MachineLocation::VirtualFP ||
+          (Shorten && Src.getReg() == State.CFAReg)) {
         if (VerboseAsm) Streamer.AddComment("DW_CFA_def_cfa_offset");
         Streamer.EmitIntValue(dwarf::DW_CFA_def_cfa_offset, 1);
       } else {
@@ -942,15 +1003,13 @@ void FrameEmitterImpl::EmitCFIInstruction(MCStreamer &Streamer,
         if (VerboseAsm) Streamer.AddComment(Twine("Reg ") +
                                             Twine(Src.getReg()));
         Streamer.EmitULEB128IntValue(Src.getReg());
+        State.CFAReg = Src.getReg();
       }
 
-      if (IsRelative)
-        CFAOffset += Src.getOffset();
-      else
-        CFAOffset = -Src.getOffset();
+      State.CFAOffset = NewOffset;
 
-      if (VerboseAsm) Streamer.AddComment(Twine("Offset " + Twine(CFAOffset)));
-      Streamer.EmitULEB128IntValue(CFAOffset);
+      if (VerboseAsm) Streamer.AddComment(Twine("Offset " + Twine(NewOffset)));
+      Streamer.EmitULEB128IntValue(NewOffset);
       return;
     }
 
@@ -960,13 +1019,15 @@ void FrameEmitterImpl::EmitCFIInstruction(MCStreamer &Streamer,
       Streamer.EmitIntValue(dwarf::DW_CFA_def_cfa_register, 1);
       if (VerboseAsm) Streamer.AddComment(Twine("Reg ") + Twine(Dst.getReg()));
       Streamer.EmitULEB128IntValue(Dst.getReg());
+      State.CFAReg = Dst.getReg();
       return;
     }
 
     unsigned Reg = Src.getReg();
     int Offset = Dst.getOffset();
     if (IsRelative)
-      Offset -= CFAOffset;
+      Offset -= State.CFAOffset;
+    State.RegRules[Reg] = Offset;
     Offset = Offset / dataAlignmentFactor;
 
     if (Offset < 0) {
@@ -995,10 +1056,17 @@ void FrameEmitterImpl::EmitCFIInstruction(MCStreamer &Streamer,
   case MCCFIInstruction::RememberState:
     if (VerboseAsm) Streamer.AddComment("DW_CFA_remember_state");
     Streamer.EmitIntValue(dwarf::DW_CFA_remember_state, 1);
+    SavedStates.push_back(State);
     return;
   case MCCFIInstruction::RestoreState:
     if (VerboseAsm) Streamer.AddComment("DW_CFA_restore_state");
     Streamer.EmitIntValue(dwarf::DW_CFA_restore_state, 1);
+    if (SavedStates.empty()) {
+      State.Known = false;
+    } else {
+      State = SavedStates.back();
+      SavedStates.pop_back();
+    }
     return;
   case MCCFIInstruction::SameValue: {
     unsigned Reg = Instr.getDestination().getReg();
@@ -1006,6 +1074,7 @@ void FrameEmitterImpl::EmitCFIInstruction(MCStreamer &Streamer,
     Streamer.EmitIntValue(dwarf::DW_CFA_same_value, 1);
     if (VerboseAsm) Streamer.AddComment(Twine("Reg ") + Twine(Reg));
     Streamer.EmitULEB128IntValue(Reg);
+    State.RegRules[Reg] = CFIState::OtherRule;
     return;
   }
   case MCCFIInstruction::Restore: {
@@ -1015,16 +1084,61 @@ void FrameEmitterImpl::EmitCFIInstruction(MCStreamer &Streamer,
       Streamer.AddComment(Twine("Reg ") + Twine(Reg));
     }
     Streamer.EmitIntValue(dwarf::DW_CFA_restore | Reg, 1);
+    if (InitialState.RegRules.count(Reg))
+      State.RegRules[Reg] = InitialState.getRule(Reg);
+    else
+      State.RegRules.erase(Reg);
     return;
   }
   case MCCFIInstruction::Escape:
     if (VerboseAsm) Streamer.AddComment("Escape bytes");
     Streamer.EmitBytes(Instr.getValues(), 0);
+    State.Known = false;
     return;
   }
   llvm_unreachable("Unhandled case in switch");
 }
 
+/// isRedundant - Return true if Instr would not change the rules set up by
+/// the instructions emitted so far.
+bool FrameEmitterImpl::isRedundant(const MCCFIInstruction &Instr) const {
+  if (!ReduceCFI || !State.Known)
+    return false;
+
+  switch (Instr.getOperation()) {
+  case MCCFIInstruction::Move:
+  case MCCFIInstruction::RelMove: {
+    const MachineLocation &Dst = Instr.getDestination();
+    const MachineLocation &Src = Instr.getSource();
+    const bool IsRelative = Instr.getOperation() == MCCFIInstruction::RelMove;
+
+    if (Dst.isReg() && Dst.getReg() == MachineLocation::VirtualFP) {
+      int NewOffset = IsRelative ? State.CFAOffset + Src.getOffset() :
+                                   -Src.getOffset();
+      return State.isCFAKnown() && NewOffset == State.CFAOffset &&
+             (Src.getReg() == MachineLocation::VirtualFP ||
+              Src.getReg() == State.CFAReg);
+    }
+
+    if (Src.isReg() && Src.getReg() == MachineLocation::VirtualFP)
+      return State.isCFAKnown() && Dst.getReg() == State.CFAReg;
+
+    int Offset = Dst.getOffset();
+    if (IsRelative)
+      Offset -= State.CFAOffset;
+    int Rule = State.getRule(Src.getReg());
+    return Rule != CFIState::OtherRule && Rule == Offset;
+  }
+  case MCCFIInstruction::Restore: {
+    unsigned Reg = Instr.getDestination().getReg();
+    return State.getRule(Reg) == InitialState.getRule(Reg) &&
+           State.RegRules.count(Reg) == InitialState.RegRules.count(Reg);
+  }
+  default:
+    return false;
+  }
+}
+
 /// EmitFrameMoves - Emit frame instructions to describe the layout of the
 /// frame.
 void FrameEmitterImpl::EmitCFIInstructions(MCStreamer &streamer,
@@ -1036,6 +1150,9 @@ void FrameEmitterImpl::EmitCFIInstructions(MCStreamer &streamer,
     // Throw out move if the label is invalid.
     if (Label && !Label->isDefined()) continue; // Not emitted, in dead code.
 
+    // Throw out instructions that would leave the rules as they are.
+    if (isRedundant(Instr)) continue;
+
     // Advance row if new location.
     if (BaseLabel && Label) {
       MCSymbol *ThisSym = Label;
@@ -1245,7 +1362,10 @@ const MCSymbol &FrameEmitterImpl::EmitCIE(MCStreamer &streamer,
     Instructions.push_back(Inst);
   }
 
+  State = CFIState();
+  SavedStates.clear();
   EmitCFIInstructions(streamer, Instructions, NULL);
+  InitialState = State;
 
   // Padding
   streamer.EmitValueToAlignment(IsEH
@@ -1325,7 +1445,8 @@ MCSymbol *FrameEmitterImpl::EmitFDE(MCStreamer &streamer,
   }
 
   // Call Frame Instructions
-
+  State = InitialState;
+  SavedStates.clear();
   EmitCFIInstructions(streamer, frame.Instructions, frame.Begin);
 
   // Padding
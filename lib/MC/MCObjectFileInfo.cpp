@@ -151,6 +151,11 @@ void MCObjectFileInfo::InitMachOMCObjectFileInfo(Triple T) {
                            MCSectionMachO::S_ATTR_DEBUG,
                            SectionKind::getReadOnly());
 
+  // Statepoint stack maps.
+  StackMapSection =
+    Ctx->getMachOSection("__LLVM_STACKMAPS", "__llvm_stackmaps", 0,
+                         SectionKind::getMetadata());
+
   // Debug Information.
   DwarfAccelNamesSection =
     Ctx->getMachOSection("__DWARF", "__apple_names",
@@ -360,6 +365,13 @@ void MCObjectFileInfo::InitELFMCObjectFileInfo(Triple T) {
                        ELF::SHF_ALLOC,
                        SectionKind::getReadOnly());
 
+  // Statepoint stack maps.  These are read by the program's collector, so
+  // unlike the debug sections they are allocated.
+  StackMapSection =
+    Ctx->getELFSection(".llvm_stackmaps", ELF::SHT_PROGBITS,
+                       ELF::SHF_ALLOC,
+                       SectionKind::getMetadata());
+
   // Debug Info Sections.
   DwarfAbbrevSection =
     Ctx->getELFSection(".debug_abbrev", ELF::SHT_PROGBITS, 0,
@@ -542,6 +554,7 @@ void MCObjectFileInfo::InitMCObjectFileInfo(StringRef TT, Reloc::Model relocm,
 
   EHFrameSection = 0;             // Created on demand.
   CompactUnwindSection = 0;       // Used only by selected targets.
+  StackMapSection = 0;            // Used only by selected targets.
   DwarfAccelNamesSection = 0;     // Used only by selected targets.
   DwarfAccelObjCSection = 0;      // Used only by selected targets.
   DwarfAccelNamespaceSection = 0; // Used only by selected targets.
@@ -20,12 +20,25 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include <limits.h>
+#include <cfloat>
+#include <cmath>
 #include <cstring>
+#include <limits>
 
 using namespace llvm;
 
 #define convolve(lhs, rhs) ((lhs) * 4 + (rhs))
 
+/* Host float and double arithmetic can stand in for IEEEsingle and
+   IEEEdouble arithmetic only if intermediate results are not kept in
+   a wider format (x87) and the compiler preserves IEEE semantics.  */
+#if defined(__FLT_EVAL_METHOD__) && __FLT_EVAL_METHOD__ == 0 && \
+    !defined(__FAST_MATH__)
+#define APFLOAT_HOST_ARITHMETIC 1
+#else
+#define APFLOAT_HOST_ARITHMETIC 0
+#endif
+
 /* Assumed in hexadecimal significand parsing, and conversion to
    hexadecimal strings.  */
 #define COMPILE_TIME_ASSERT(cond) extern int CTAssert[(cond) ? 1 : -1]
@@ -1552,6 +1565,150 @@ APFloat::copySign(const APFloat &rhs)
   sign = rhs.sign;
 }
 
+/* Returns the number of bits in the odd part of the significand of a
+   normal double, i.e. the significand with trailing zeroes removed.  */
+static unsigned int
+oddSignificandBits(double d)
+{
+  uint64_t significand = (DoubleToBits(d) & 0xfffffffffffffULL) |
+                         0x10000000000000ULL;
+
+  return 53 - CountTrailingZeros_64(significand);
+}
+
+/* If THIS and RHS are normal IEEEsingle or IEEEdouble numbers and the
+   result of OP ('+', '-', '*' or '/') can be computed with host
+   arithmetic, computes it into THIS, stores the status in FS and
+   returns true.  Only round-to-nearest-even is handled, since that is
+   the host's rounding mode, and only results that are normal and
+   finite, so that underflow and overflow are left to the general
+   code.  Returns false without touching THIS otherwise.  */
+bool
+APFloat::hostArithmetic(const APFloat &rhs, roundingMode rounding_mode,
+                        char op, opStatus &fs)
+{
+  double lhsValue, rhsValue, result;
+  bool exact;
+
+  if (!APFLOAT_HOST_ARITHMETIC || rounding_mode != rmNearestTiesToEven ||
+      semantics != rhs.semantics || !getHostValue(lhsValue) ||
+      !rhs.getHostValue(rhsValue))
+    return false;
+
+  if (op == '-') {
+    rhsValue = -rhsValue;
+    op = '+';
+  }
+
+  if (semantics == &IEEEsingle) {
+    /* Operands are exactly representable as doubles, and double has
+       more than 2 * 24 + 2 bits of precision, so rounding first to
+       double and then to float gives the correctly rounded result.  */
+    double wide;
+    float narrow;
+
+    if (op == '+') {
+      wide = lhsValue + rhsValue;
+      /* Knuth's TwoSum: err is the exact rounding error of wide.  */
+      double b = wide - lhsValue;
+      double err = (lhsValue - (wide - b)) + (rhsValue - b);
+      narrow = (float) wide;
+      exact = err == 0 && narrow == wide;
+    } else if (op == '*') {
+      /* A 24x24 bit product is exact in double.  */
+      wide = lhsValue * rhsValue;
+      narrow = (float) wide;
+      exact = narrow == wide;
+    } else {
+      wide = lhsValue / rhsValue;
+      narrow = (float) wide;
+      /* The product of two floats is exact in double.  */
+      exact = (double) narrow * rhsValue == lhsValue;
+    }
+
+    if (!(std::fabs(narrow) >= FLT_MIN && std::fabs(narrow) <= FLT_MAX))
+      return false;
+    result = narrow;
+  } else {
+    if (op == '+') {
+      result = lhsValue + rhsValue;
+      double b = result - lhsValue;
+      double err = (lhsValue - (result - b)) + (rhsValue - b);
+      exact = err == 0;
+    } else if (op == '*') {
+      /* Without a fused multiply-add there is no cheap way to get the
+         rounding error of a product, so only handle products of
+         significands that fit in 53 bits.  These are common in
+         constant folding (powers of two, small integers).  */
+      if (oddSignificandBits(lhsValue) + oddSignificandBits(rhsValue) > 53)
+        return false;
+      result = lhsValue * rhsValue;
+      exact = true;
+    } else {
+      return false;
+    }
+
+    if (!(std::fabs(result) >= DBL_MIN && std::fabs(result) <= DBL_MAX))
+      return false;
+  }
+
+  setHostValue(result);
+  fs = exact ? opOK : opInexact;
+  return true;
+}
+
+/* Stores the value of a normal (not denormal) IEEEsingle or IEEEdouble
+   number in D and returns true; returns false for anything else.  */
+bool
+APFloat::getHostValue(double &d) const
+{
+  if (category != fcNormal || !std::numeric_limits<double>::is_iec559)
+    return false;
+
+  uint64_t significand = *significandParts();
+
+  if (semantics == &IEEEdouble) {
+    if (!(significand & 0x10000000000000ULL))
+      return false;
+    d = BitsToDouble(((uint64_t)(sign & 1) << 63) |
+                     ((uint64_t)(exponent + 1023) << 52) |
+                     (significand & 0xfffffffffffffULL));
+    return true;
+  }
+
+  if (semantics == &IEEEsingle) {
+    if (!(significand & 0x800000))
+      return false;
+    d = BitsToFloat(((uint32_t)(sign & 1) << 31) |
+                    ((uint32_t)(exponent + 127) << 23) |
+                    ((uint32_t)significand & 0x7fffff));
+    return true;
+  }
+
+  return false;
+}
+
+/* Sets THIS, which has IEEEsingle or IEEEdouble semantics, to D.  D
+   must be normal and exactly representable in those semantics.  */
+void
+APFloat::setHostValue(double d)
+{
+  category = fcNormal;
+
+  if (semantics == &IEEEdouble) {
+    uint64_t i = DoubleToBits(d);
+    sign = static_cast<unsigned int>(i >> 63);
+    exponent = ((i >> 52) & 0x7ff) - 1023;
+    *significandParts() = (i & 0xfffffffffffffULL) | 0x10000000000000ULL;
+  } else {
+    assert(semantics == &IEEEsingle);
+    uint32_t i = FloatToBits((float) d);
+    sign = i >> 31;
+    exponent = ((i >> 23) & 0xff) - 127;
+    *significandParts() = (i & 0x7fffff) | 0x800000;
+  }
+}
+
 /* Normalized addition or subtraction.  */
 APFloat::opStatus
 APFloat::addOrSubtract(const APFloat &rhs, roundingMode rounding_mode,
@@ -1561,6 +1718,9 @@ APFloat::addOrSubtract(const APFloat &rhs, roundingMode rounding_mode,
 
   assertArithmeticOK(*semantics);
 
+  if (hostArithmetic(rhs, rounding_mode, subtract ? '-' : '+', fs))
+    return fs;
+
   fs = addOrSubtractSpecials(rhs, subtract);
 
   /* This return code means it was not a simple case.  */
@@ -1606,6 +1766,10 @@ APFloat::multiply(const APFloat &rhs, roundingMode rounding_mode)
   opStatus fs;
 
   assertArithmeticOK(*semantics);
+
+  if (hostArithmetic(rhs, rounding_mode, '*', fs))
+    return fs;
+
   sign ^= rhs.sign;
   fs = multiplySpecials(rhs);
 
@@ -1626,6 +1790,10 @@ APFloat::divide(const APFloat &rhs, roundingMode rounding_mode)
   opStatus fs;
 
   assertArithmeticOK(*semantics);
+
+  if (hostArithmetic(rhs, rounding_mode, '/', fs))
+    return fs;
+
   sign ^= rhs.sign;
   fs = divideSpecials(rhs);
 
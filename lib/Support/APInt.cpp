@@ -512,11 +512,7 @@ bool APInt::EqualSlowCase(uint64_t Val) const {
     return false;
 }
 
-bool APInt::ult(const APInt& RHS) const {
-  assert(BitWidth == RHS.BitWidth && "Bit widths must be same for comparison");
-  if (isSingleWord())
-    return VAL < RHS.VAL;
-
+bool APInt::ultSlowCase(const APInt& RHS) const {
   // Get active bit length of both operands
   unsigned n1 = getActiveBits();
   unsigned n2 = RHS.getActiveBits();
@@ -544,14 +540,7 @@ bool APInt::ult(const APInt& RHS) const {
   return false;
 }
 
-bool APInt::slt(const APInt& RHS) const {
-  assert(BitWidth == RHS.BitWidth && "Bit widths must be same for comparison");
-  if (isSingleWord()) {
-    int64_t lhsSext = (int64_t(VAL) << (64-BitWidth)) >> (64-BitWidth);
-    int64_t rhsSext = (int64_t(RHS.VAL) << (64-BitWidth)) >> (64-BitWidth);
-    return lhsSext < rhsSext;
-  }
-
+bool APInt::sltSlowCase(const APInt& RHS) const {
   APInt lhs(*this);
   APInt rhs(RHS);
   bool lhsNeg = isNegative();
@@ -733,9 +722,7 @@ unsigned APInt::countLeadingOnes() const {
   return Count;
 }
 
-unsigned APInt::countTrailingZeros() const {
-  if (isSingleWord())
-    return std::min(unsigned(CountTrailingZeros_64(VAL)), BitWidth);
+unsigned APInt::countTrailingZerosSlowCase() const {
   unsigned Count = 0;
   unsigned i = 0;
   for (; i < getNumWords() && pVal[i] == 0; ++i)
@@ -916,13 +903,7 @@ double APInt::roundToDouble(bool isSigned) const {
 }
 
 // Truncate to new width.
-APInt APInt::trunc(unsigned width) const {
-  assert(width < BitWidth && "Invalid APInt Truncate request");
-  assert(width && "Can't truncate to 0 bits");
-
-  if (width <= APINT_BITS_PER_WORD)
-    return APInt(width, getRawData()[0]);
-
+APInt APInt::truncSlowCase(unsigned width) const {
   APInt Result(getMemory(getNumWords(width)), width);
 
   // Copy full words.
@@ -939,15 +920,7 @@ APInt APInt::trunc(unsigned width) const {
 }
 
 // Sign extend to a new width.
-APInt APInt::sext(unsigned width) const {
-  assert(width > BitWidth && "Invalid APInt SignExtend request");
-
-  if (width <= APINT_BITS_PER_WORD) {
-    uint64_t val = VAL << (APINT_BITS_PER_WORD - BitWidth);
-    val = (int64_t)val >> (width - BitWidth);
-    return APInt(width, val >> (APINT_BITS_PER_WORD - width));
-  }
-
+APInt APInt::sextSlowCase(unsigned width) const {
   APInt Result(getMemory(getNumWords(width)), width);
 
   // Copy full words.
@@ -980,12 +953,7 @@ APInt APInt::sext(unsigned width) const {
 }
 
 //  Zero extend to a new width.
-APInt APInt::zext(unsigned width) const {
-  assert(width > BitWidth && "Invalid APInt ZeroExtend request");
-
-  if (width <= APINT_BITS_PER_WORD)
-    return APInt(width, VAL);
-
+APInt APInt::zextSlowCase(unsigned width) const {
   APInt Result(getMemory(getNumWords(width)), width);
 
   // Copy words.
@@ -1839,15 +1807,7 @@ void APInt::divide(const APInt LHS, unsigned lhsWords,
   }
 }
 
-APInt APInt::udiv(const APInt& RHS) const {
-  assert(BitWidth == RHS.BitWidth && "Bit widths must be the same");
-
-  // First, deal with the easy case
-  if (isSingleWord()) {
-    assert(RHS.VAL != 0 && "Divide by zero?");
-    return APInt(BitWidth, VAL / RHS.VAL);
-  }
-
+APInt APInt::udivSlowCase(const APInt& RHS) const {
   // Get some facts about the LHS and RHS number of bits and words
   unsigned rhsBits = RHS.getActiveBits();
   unsigned rhsWords = !rhsBits ? 0 : (APInt::whichWord(rhsBits - 1) + 1);
@@ -1876,13 +1836,7 @@ APInt APInt::udiv(const APInt& RHS) const {
   return Quotient;
 }
 
-APInt APInt::urem(const APInt& RHS) const {
-  assert(BitWidth == RHS.BitWidth && "Bit widths must be the same");
-  if (isSingleWord()) {
-    assert(RHS.VAL != 0 && "Remainder by zero?");
-    return APInt(BitWidth, VAL % RHS.VAL);
-  }
-
+APInt APInt::uremSlowCase(const APInt& RHS) const {
   // Get some facts about the LHS
   unsigned lhsBits = getActiveBits();
   unsigned lhsWords = !lhsBits ? 0 : (whichWord(lhsBits - 1) + 1);
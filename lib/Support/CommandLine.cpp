@@ -17,10 +17,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Support/Host.h"
@@ -89,18 +91,119 @@ extrahelp::extrahelp(const char *Help)
 
 static bool OptionListChanged = false;
 
+/// ExtraOptionNamesChanged - Set when the value names of enum options without
+/// an ArgStr may have changed, so that OptionTable has to collect them again.
+static bool ExtraOptionNamesChanged = true;
+
 // MarkOptionsChanged - Internal helper function.
 void cl::MarkOptionsChanged() {
   OptionListChanged = true;
+  ExtraOptionNamesChanged = true;
 }
 
 /// RegisteredOptionList - This is the list of the command line options that
 /// have statically constructed themselves.
 static Option *RegisteredOptionList = 0;
 
+namespace {
+/// OptionTable - Maps every name of every registered option to the option,
+/// and is the table that ParseCommandLineOptions looks names up in.  Each
+/// option adds its ArgStr as it is registered, so a name defined twice is
+/// reported right away.  Enum options without an ArgStr, like the pass list of
+/// opt, are named by their values; those names are only collected the first
+/// time a lookup misses, so a command line that only uses ordinary options
+/// never asks an enum option for its values.
+class OptionTable {
+public:
+  typedef StringMap<Option*, BumpPtrAllocator&> MapTy;
+
+private:
+  /// Entries are taken from a bump allocator rather than making a heap
+  /// allocation per registered option.  The table is created during static
+  /// initialization, which may run before that of
+  /// BumpPtrAllocator::DefaultSlabAllocator, so it brings its own.
+  MallocSlabAllocator SlabAllocator;
+  BumpPtrAllocator Allocator;
+  MapTy Map;
+  /// ExtraEntries - The entries added for the value names of options without
+  /// an ArgStr, which are dropped whenever those names are collected again.
+  std::vector<MapTy::MapEntryTy*> ExtraEntries;
+
+  bool add(StringRef Name, Option *O, MapTy::MapEntryTy *&Entry) {
+    Entry = &Map.GetOrCreateValue(Name, O);
+    if (Entry->getValue() == O)
+      return false;
+    errs() << ProgramName << ": CommandLine Error: Argument '"
+           << Name << "' defined more than once!\n";
+    return true;
+  }
+
+  /// addExtraNames - Collect the value names of the enum options that have no
+  /// ArgStr, if they may have changed since they were last collected.
+  void addExtraNames() {
+    if (!ExtraOptionNamesChanged)
+      return;
+    ExtraOptionNamesChanged = false;
+
+    for (unsigned i = 0, e = ExtraEntries.size(); i != e; ++i) {
+      Map.remove(ExtraEntries[i]);
+      ExtraEntries[i]->Destroy(Allocator);
+    }
+    ExtraEntries.clear();
+
+    SmallVector<const char*, 16> Names;
+    for (Option *O = RegisteredOptionList; O;
+         O = O->getNextRegisteredOption()) {
+      if (O->ArgStr[0])
+        continue;
+      O->getExtraOptionNames(Names);
+      for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+        if (Map.count(Names[i])) {
+          MapTy::MapEntryTy *Entry;
+          add(Names[i], O, Entry);
+          continue;
+        }
+        ExtraEntries.push_back(&Map.GetOrCreateValue(Names[i], O));
+      }
+      Names.clear();
+    }
+  }
+
+public:
+  OptionTable() : Allocator(4096, 4096, SlabAllocator), Map(Allocator) {}
+
+  /// addArgStr - Add the ArgStr of a newly registered option.
+  void addArgStr(Option *O) {
+    MapTy::MapEntryTy *Entry;
+    add(O->ArgStr, O, Entry);
+  }
+
+  /// lookup - Return the option named Name, or null.
+  Option *lookup(StringRef Name) {
+    MapTy::const_iterator I = Map.find(Name);
+    if (I == Map.end() && ExtraOptionNamesChanged) {
+      addExtraNames();
+      I = Map.find(Name);
+    }
+    return I != Map.end() ? I->second : 0;
+  }
+
+  /// getMap - Return the map of all option names, for listing them.
+  const MapTy &getMap() {
+    addExtraNames();
+    return Map;
+  }
+};
+} // end anonymous namespace
+
+static ManagedStatic<OptionTable> Options;
+
 void Option::addArgument() {
   assert(NextRegistered == 0 && "argument multiply registered!");
 
+  if (ArgStr[0])
+    Options->addArgStr(this);
+
   NextRegistered = RegisteredOptionList;
   RegisteredOptionList = this;
   MarkOptionsChanged();
@@ -111,31 +214,13 @@ void Option::addArgument() {
 // Basic, shared command line option processing machinery.
 //
 
-/// GetOptionInfo - Scan the list of registered options, turning them into data
-/// structures that are easier to handle.
-static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
-                          SmallVectorImpl<Option*> &SinkOpts,
-                          StringMap<Option*> &OptionsMap) {
-  SmallVector<const char*, 16> OptionNames;
+/// GetPositionalAndSinkOptions - Scan the list of registered options for
+/// positional and sink options.
+static void
+GetPositionalAndSinkOptions(SmallVectorImpl<Option*> &PositionalOpts,
+                            SmallVectorImpl<Option*> &SinkOpts) {
   Option *CAOpt = 0;  // The ConsumeAfter option if it exists.
   for (Option *O = RegisteredOptionList; O; O = O->getNextRegisteredOption()) {
-    // If this option wants to handle multiple option names, get the full set.
-    // This handles enum options like "-O1 -O2" etc.
-    O->getExtraOptionNames(OptionNames);
-    if (O->ArgStr[0])
-      OptionNames.push_back(O->ArgStr);
-
-    // Handle named options.
-    for (size_t i = 0, e = OptionNames.size(); i != e; ++i) {
-      // Add argument to the argument map!
-      if (OptionsMap.GetOrCreateValue(OptionNames[i], O).second != O) {
-        errs() << ProgramName << ": CommandLine Error: Argument '"
-             << OptionNames[i] << "' defined more than once!\n";
-      }
-    }
-
-    OptionNames.clear();
-
     // Remember information about positional options.
     if (O->getFormattingFlag() == cl::Positional)
       PositionalOpts.push_back(O);
@@ -155,12 +240,10 @@ static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
   std::reverse(PositionalOpts.begin(), PositionalOpts.end());
 }
 
-
 /// LookupOption - Lookup the option specified by the specified option on the
 /// command line.  If there is a value specified (after an equal sign) return
 /// that as well.  This assumes that leading dashes have already been stripped.
-static Option *LookupOption(StringRef &Arg, StringRef &Value,
-                            const StringMap<Option*> &OptionsMap) {
+static Option *LookupOption(StringRef &Arg, StringRef &Value) {
   // Reject all dashes.
   if (Arg.empty()) return 0;
 
@@ -169,19 +252,17 @@ static Option *LookupOption(StringRef &Arg, StringRef &Value,
   // If we have an equals sign, remember the value.
   if (EqualPos == StringRef::npos) {
     // Look up the option.
-    StringMap<Option*>::const_iterator I = OptionsMap.find(Arg);
-    return I != OptionsMap.end() ? I->second : 0;
+    return Options->lookup(Arg);
   }
 
   // If the argument before the = is a valid option name, we match.  If not,
   // return Arg unmolested.
-  StringMap<Option*>::const_iterator I =
-    OptionsMap.find(Arg.substr(0, EqualPos));
-  if (I == OptionsMap.end()) return 0;
+  Option *O = Options->lookup(Arg.substr(0, EqualPos));
+  if (!O) return 0;
 
   Value = Arg.substr(EqualPos+1);
   Arg = Arg.substr(0, EqualPos);
-  return I->second;
+  return O;
 }
 
 /// LookupNearestOption - Lookup the closest match to the option specified by
@@ -189,7 +270,6 @@ static Option *LookupOption(StringRef &Arg, StringRef &Value,
 /// (after an equal sign) return that as well.  This assumes that leading dashes
 /// have already been stripped.
 static Option *LookupNearestOption(StringRef Arg,
-                                   const StringMap<Option*> &OptionsMap,
                                    std::string &NearestString) {
   // Reject all dashes.
   if (Arg.empty()) return 0;
@@ -202,7 +282,8 @@ static Option *LookupNearestOption(StringRef Arg,
   // Find the closest match.
   Option *Best = 0;
   unsigned BestDistance = 0;
-  for (StringMap<Option*>::const_iterator it = OptionsMap.begin(),
+  const OptionTable::MapTy &OptionsMap = Options->getMap();
+  for (OptionTable::MapTy::const_iterator it = OptionsMap.begin(),
          ie = OptionsMap.end(); it != ie; ++it) {
     Option *O = it->second;
     SmallVector<const char*, 16> OptionNames;
@@ -342,22 +423,21 @@ static inline bool isPrefixedOrGrouping(const Option *O) {
 // otherwise return null.
 //
 static Option *getOptionPred(StringRef Name, size_t &Length,
-                             bool (*Pred)(const Option*),
-                             const StringMap<Option*> &OptionsMap) {
+                             bool (*Pred)(const Option*)) {
 
-  StringMap<Option*>::const_iterator OMI = OptionsMap.find(Name);
+  Option *O = Options->lookup(Name);
 
   // Loop while we haven't found an option and Name still has at least two
   // characters in it (so that the next iteration will not be the empty
   // string.
-  while (OMI == OptionsMap.end() && Name.size() > 1) {
+  while (!O && Name.size() > 1) {
     Name = Name.substr(0, Name.size()-1);   // Chop off the last character.
-    OMI = OptionsMap.find(Name);
+    O = Options->lookup(Name);
   }
 
-  if (OMI != OptionsMap.end() && Pred(OMI->second)) {
+  if (O && Pred(O)) {
     Length = Name.size();
-    return OMI->second;    // Found one!
+    return O;    // Found one!
   }
   return 0;                // No option found!
 }
@@ -367,13 +447,12 @@ static Option *getOptionPred(StringRef Name, size_t &Length,
 /// see if this is a prefix or grouped option.  If so, split arg into output an
 /// Arg/Value pair and return the Option to parse it with.
 static Option *HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
-                                             bool &ErrorParsing,
-                                         const StringMap<Option*> &OptionsMap) {
+                                             bool &ErrorParsing) {
   if (Arg.size() == 1) return 0;
 
   // Do the lookup!
   size_t Length = 0;
-  Option *PGOpt = getOptionPred(Arg, Length, isPrefixedOrGrouping, OptionsMap);
+  Option *PGOpt = getOptionPred(Arg, Length, isPrefixedOrGrouping);
   if (PGOpt == 0) return 0;
 
   // If the option is a prefixed option, then the value is simply the
@@ -382,7 +461,7 @@ static Option *HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
   if (PGOpt->getFormattingFlag() == cl::Prefix) {
     Value = Arg.substr(Length);
     Arg = Arg.substr(0, Length);
-    assert(OptionsMap.count(Arg) && OptionsMap.find(Arg)->second == PGOpt);
+    assert(Options->lookup(Arg) == PGOpt);
     return PGOpt;
   }
 
@@ -404,7 +483,7 @@ static Option *HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
                                   StringRef(), 0, 0, Dummy);
 
     // Get the next grouping option.
-    PGOpt = getOptionPred(Arg, Length, isGrouping, OptionsMap);
+    PGOpt = getOptionPred(Arg, Length, isGrouping);
   } while (PGOpt && Length != Arg.size());
 
   // Return the last option with Arg cut down to just the last one.
@@ -530,14 +609,14 @@ static void ExpandResponseFiles(unsigned argc, const char*const* argv,
 
 void cl::ParseCommandLineOptions(int argc, const char * const *argv,
                                  const char *Overview, bool ReadResponseFiles) {
-  // Process all registered options.
+  // Process all registered options.  Named options are looked up in the
+  // table that they registered themselves in.
   SmallVector<Option*, 4> PositionalOpts;
   SmallVector<Option*, 4> SinkOpts;
-  StringMap<Option*> Opts;
-  GetOptionInfo(PositionalOpts, SinkOpts, Opts);
+  GetPositionalAndSinkOptions(PositionalOpts, SinkOpts);
+  OptionListChanged = false;
 
-  assert((!Opts.empty() || !PositionalOpts.empty()) &&
-         "No options specified!");
+  assert(RegisteredOptionList && "No options specified!");
 
   // Expand response files.
   std::vector<char*> newArgv;
@@ -626,8 +705,7 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
     if (OptionListChanged) {
       PositionalOpts.clear();
       SinkOpts.clear();
-      Opts.clear();
-      GetOptionInfo(PositionalOpts, SinkOpts, Opts);
+      GetPositionalAndSinkOptions(PositionalOpts, SinkOpts);
       OptionListChanged = false;
     }
 
@@ -672,7 +750,7 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
       while (!ArgName.empty() && ArgName[0] == '-')
         ArgName = ArgName.substr(1);
 
-      Handler = LookupOption(ArgName, Value, Opts);
+      Handler = LookupOption(ArgName, Value);
       if (!Handler || Handler->getFormattingFlag() != cl::Positional) {
         ProvidePositionalOption(ActivePositionalArg, argv[i], i);
         continue;  // We are done!
@@ -684,18 +762,16 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
       while (!ArgName.empty() && ArgName[0] == '-')
         ArgName = ArgName.substr(1);
 
-      Handler = LookupOption(ArgName, Value, Opts);
+      Handler = LookupOption(ArgName, Value);
 
       // Check to see if this "option" is really a prefixed or grouped argument.
       if (Handler == 0)
-        Handler = HandlePrefixedOrGroupedOption(ArgName, Value,
-                                                ErrorParsing, Opts);
+        Handler = HandlePrefixedOrGroupedOption(ArgName, Value, ErrorParsing);
 
       // Otherwise, look for the closest available option to report to the user
       // in the upcoming error.
       if (Handler == 0 && SinkOpts.empty())
-        NearestHandler = LookupNearestOption(ArgName, Opts,
-                                             NearestHandlerString);
+        NearestHandler = LookupNearestOption(ArgName, NearestHandlerString);
     }
 
     if (Handler == 0) {
@@ -807,15 +883,20 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
                                               PositionalVals[ValNo].second);
   }
 
-  // Loop over args and make sure all required args are specified!
-  for (StringMap<Option*>::iterator I = Opts.begin(),
-         E = Opts.end(); I != E; ++I) {
-    switch (I->second->getNumOccurrencesFlag()) {
+  // Loop over args and make sure all required named args are specified!
+  // Unnamed positional arguments were checked above.
+  SmallVector<const char*, 16> OptionNames;
+  for (Option *O = RegisteredOptionList; O; O = O->getNextRegisteredOption()) {
+    switch (O->getNumOccurrencesFlag()) {
     case Required:
     case OneOrMore:
-      if (I->second->getNumOccurrences() == 0) {
-        I->second->error("must be specified at least once!");
-        ErrorParsing = true;
+      if (O->getNumOccurrences() == 0) {
+        O->getExtraOptionNames(OptionNames);
+        if (O->ArgStr[0] || !OptionNames.empty()) {
+          O->error("must be specified at least once!");
+          ErrorParsing = true;
+        }
+        OptionNames.clear();
       }
       // Fall through
     default:
@@ -832,9 +913,7 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
         dbgs() << '\n';
        );
 
-  // Free all of the memory allocated to the map.  Command line options may only
-  // be processed once!
-  Opts.clear();
+  // Command line options may only be processed once!
   PositionalOpts.clear();
   MoreHelp->clear();
 
@@ -1196,13 +1275,13 @@ static int OptNameCompare(const void *LHS, const void *RHS) {
 
 // Copy Options into a vector so we can sort them as we like.
 static void
-sortOpts(StringMap<Option*> &OptMap,
+sortOpts(const OptionTable::MapTy &OptMap,
          SmallVectorImpl< std::pair<const char *, Option*> > &Opts,
          bool ShowHidden) {
   SmallPtrSet<Option*, 128> OptionSet;  // Duplicate option detection.
 
-  for (StringMap<Option*>::iterator I = OptMap.begin(), E = OptMap.end();
-       I != E; ++I) {
+  for (OptionTable::MapTy::const_iterator I = OptMap.begin(),
+         E = OptMap.end(); I != E; ++I) {
     // Ignore really-hidden options.
     if (I->second->getOptionHiddenFlag() == ReallyHidden)
       continue;
@@ -1241,11 +1320,10 @@ public:
     // Get all the options.
     SmallVector<Option*, 4> PositionalOpts;
     SmallVector<Option*, 4> SinkOpts;
-    StringMap<Option*> OptMap;
-    GetOptionInfo(PositionalOpts, SinkOpts, OptMap);
+    GetPositionalAndSinkOptions(PositionalOpts, SinkOpts);
 
     SmallVector<std::pair<const char *, Option*>, 128> Opts;
-    sortOpts(OptMap, Opts, ShowHidden);
+    sortOpts(Options->getMap(), Opts, ShowHidden);
 
     if (ProgramOverview)
       outs() << "OVERVIEW: " << ProgramOverview << "\n";
@@ -1319,13 +1397,8 @@ void cl::PrintOptionValues() {
   if (!PrintOptions && !PrintAllOptions) return;
 
   // Get all the options.
-  SmallVector<Option*, 4> PositionalOpts;
-  SmallVector<Option*, 4> SinkOpts;
-  StringMap<Option*> OptMap;
-  GetOptionInfo(PositionalOpts, SinkOpts, OptMap);
-
   SmallVector<std::pair<const char *, Option*>, 128> Opts;
-  sortOpts(OptMap, Opts, /*ShowHidden*/true);
+  sortOpts(Options->getMap(), Opts, /*ShowHidden*/true);
 
   // Compute the maximum argument length...
   size_t MaxArgLen = 0;
@@ -0,0 +1,254 @@
+//===-- Compression.cpp - Fast byte compression ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a byte-oriented LZ77 code in the style of LZ4.  The
+// compressed data is a sequence of
+//
+//   token       - high nibble: literal count, low nibble: match length - 4.
+//                 A nibble of 15 is continued by bytes that are added to it,
+//                 up to and including the first byte that is not 255.
+//   literals
+//   offset      - 16-bit little-endian distance back to the match.
+//
+// The final sequence consists of a token and literals only.  Matches are
+// found through hash chains with one step of lazy evaluation.  A dictionary
+// is handled as if it had been decompressed just before the input.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using namespace llvm;
+
+namespace {
+
+enum {
+  MinMatch = 4,
+  MaxOffset = 0xFFFF,
+  WindowSize = 0x10000,
+  MaxHashBits = 15,
+  MaxChainLength = 32
+};
+
+class LZCompressor {
+  /// Data - The dictionary followed by the input.
+  std::vector<unsigned char> Data;
+  /// Start - The offset of the input in Data.
+  size_t Start;
+  size_t Size;
+  SmallVectorImpl<char> &Out;
+
+  /// Head - The most recent position with a given hash, or -1.  Small inputs
+  /// use smaller tables, so that compressing many small chunks stays cheap.
+  std::vector<int32_t> Head;
+  unsigned HashBits;
+  /// Prev - For each position in the window, the previous position with the
+  /// same hash.
+  std::vector<int32_t> Prev;
+  size_t PrevMask;
+  /// NextInsert - The first position that is not in the hash chains yet.
+  size_t NextInsert;
+
+  unsigned hash(size_t Pos) const {
+    uint32_t V = Data[Pos] | (Data[Pos+1] << 8) | (Data[Pos+2] << 16) |
+                 (uint32_t(Data[Pos+3]) << 24);
+    return (V * 2654435761U) >> (32 - HashBits);
+  }
+
+  void insertUpTo(size_t End) {
+    for (; NextInsert < End; ++NextInsert) {
+      unsigned H = hash(NextInsert);
+      Prev[NextInsert & PrevMask] = Head[H];
+      Head[H] = NextInsert;
+    }
+  }
+
+  size_t findMatch(size_t Pos, unsigned &Offset) const;
+  void emitLength(size_t Len);
+  void emitSequence(size_t Anchor, size_t LitLen, size_t MatchLen,
+                    unsigned Offset);
+
+public:
+  LZCompressor(StringRef Input, StringRef Dictionary,
+               SmallVectorImpl<char> &Output)
+    : Out(Output), NextInsert(0) {
+    if (Dictionary.size() > WindowSize)
+      Dictionary = Dictionary.substr(Dictionary.size() - WindowSize);
+    Data.reserve(Dictionary.size() + Input.size());
+    Data.insert(Data.end(), Dictionary.begin(), Dictionary.end());
+    Data.insert(Data.end(), Input.begin(), Input.end());
+    Start = Dictionary.size();
+    Size = Data.size();
+
+    uint64_t TableSize = NextPowerOf2(Size);
+    HashBits = std::min(unsigned(MaxHashBits),
+                        std::max(8U, Log2_64(TableSize)));
+    Head.assign(1 << HashBits, -1);
+    Prev.resize(std::min(uint64_t(WindowSize), TableSize));
+    PrevMask = Prev.size() - 1;
+  }
+
+  void run();
+};
+
+} // end anonymous namespace
+
+/// findMatch - Return the length of the longest earlier occurrence of the
+/// bytes at Pos within the window, and set Offset to its distance.
+size_t LZCompressor::findMatch(size_t Pos, unsigned &Offset) const {
+  size_t Best = 0;
+  size_t Max = Size - Pos;
+  int32_t Cand = Head[hash(Pos)];
+  for (unsigned Chain = MaxChainLength;
+       Chain && Cand >= 0 && Pos - Cand <= MaxOffset;
+       --Chain, Cand = Prev[Cand & PrevMask]) {
+    // Cheap rejection: a longer match has to agree at the current best end.
+    if (Data[Cand + Best] != Data[Pos + Best])
+      continue;
+    size_t Len = 0;
+    while (Len < Max && Data[Cand + Len] == Data[Pos + Len])
+      ++Len;
+    if (Len > Best) {
+      Best = Len;
+      Offset = Pos - Cand;
+      if (Len == Max)
+        break;
+    }
+  }
+  return Best;
+}
+
+void LZCompressor::emitLength(size_t Len) {
+  Len -= 15;
+  for (; Len >= 255; Len -= 255)
+    Out.push_back(char(255));
+  Out.push_back(char(Len));
+}
+
+void LZCompressor::emitSequence(size_t Anchor, size_t LitLen,
+                                size_t MatchLen, unsigned Offset) {
+  unsigned Token = (LitLen < 15 ? LitLen : 15) << 4;
+  if (MatchLen)
+    Token |= MatchLen - MinMatch < 15 ? MatchLen - MinMatch : 15;
+  Out.push_back(char(Token));
+  if (LitLen >= 15)
+    emitLength(LitLen);
+  Out.append(Data.begin() + Anchor, Data.begin() + Anchor + LitLen);
+  if (!MatchLen)
+    return;
+  Out.push_back(char(Offset & 0xFF));
+  Out.push_back(char(Offset >> 8));
+  if (MatchLen - MinMatch >= 15)
+    emitLength(MatchLen - MinMatch);
+}
+
+void LZCompressor::run() {
+  size_t Pos = Start, Anchor = Start;
+  while (Pos + MinMatch <= Size) {
+    insertUpTo(Pos);
+    unsigned Offset;
+    size_t Len = findMatch(Pos, Offset);
+    if (Len < MinMatch) {
+      ++Pos;
+      continue;
+    }
+
+    // Prefer a longer match starting at the next byte.
+    if (Pos + 1 + MinMatch <= Size) {
+      insertUpTo(Pos + 1);
+      unsigned NextOffset;
+      size_t NextLen = findMatch(Pos + 1, NextOffset);
+      if (NextLen > Len) {
+        ++Pos;
+        Len = NextLen;
+        Offset = NextOffset;
+      }
+    }
+
+    emitSequence(Anchor, Pos - Anchor, Len, Offset);
+    Pos += Len;
+    Anchor = Pos;
+  }
+
+  if (Anchor < Size)
+    emitSequence(Anchor, Size - Anchor, 0, 0);
+}
+
+void lz77::compress(StringRef Input, SmallVectorImpl<char> &Output,
+                    StringRef Dictionary) {
+  if (Input.empty())
+    return;
+  LZCompressor(Input, Dictionary, Output).run();
+}
+
+/// readLength - Add the continuation bytes of a length nibble to Len.
+static bool readLength(const unsigned char *&In, const unsigned char *End,
+                       size_t &Len) {
+  unsigned char Byte;
+  do {
+    if (In == End)
+      return true;
+    Byte = *In++;
+    Len += Byte;
+  } while (Byte == 255);
+  return false;
+}
+
+bool lz77::decompress(StringRef Input, char *Output, size_t OutputSize,
+                      StringRef Dictionary) {
+  const unsigned char *In =
+    reinterpret_cast<const unsigned char*>(Input.data());
+  const unsigned char *End = In + Input.size();
+  size_t Pos = 0;
+  while (In != End) {
+    unsigned Token = *In++;
+
+    size_t LitLen = Token >> 4;
+    if (LitLen == 15 && readLength(In, End, LitLen))
+      return true;
+    if (size_t(End - In) < LitLen || OutputSize - Pos < LitLen)
+      return true;
+    memcpy(Output + Pos, In, LitLen);
+    In += LitLen;
+    Pos += LitLen;
+    if (In == End)
+      break;
+
+    if (End - In < 2)
+      return true;
+    size_t Offset = In[0] | (In[1] << 8);
+    In += 2;
+    size_t MatchLen = Token & 15;
+    if (MatchLen == 15 && readLength(In, End, MatchLen))
+      return true;
+    MatchLen += MinMatch;
+    if (Offset == 0 || Offset > Pos + Dictionary.size() ||
+        OutputSize - Pos < MatchLen)
+      return true;
+
+    size_t i = 0;
+    // The start of the match may lie in the dictionary.
+    for (; i != MatchLen && Pos + i < Offset; ++i)
+      Output[Pos + i] = Dictionary[Dictionary.size() - (Offset - Pos - i)];
+    // The rest may overlap the bytes it produces.
+    if (Offset >= MatchLen) {
+      if (i != MatchLen)
+        memcpy(Output + Pos + i, Output + Pos + i - Offset, MatchLen - i);
+    } else {
+      for (; i != MatchLen; ++i)
+        Output[Pos + i] = Output[Pos + i - Offset];
+    }
+    Pos += MatchLen;
+  }
+  return Pos != OutputSize;
+}
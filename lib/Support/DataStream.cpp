@@ -60,7 +60,12 @@ public:
   }
   virtual size_t GetBytes(unsigned char *buf, size_t len) {
     NumStreamFetches++;
-    return read(Fd, buf, len);
+    int Read;
+    do
+      Read = read(Fd, buf, len);
+    while (Read < 0 && errno == EINTR);
+    // Treat a read error like the end of the stream.
+    return Read < 0 ? 0 : Read;
   }
 
   error_code OpenFile(const std::string &Filename) {
@@ -9,7 +9,8 @@
 //
 //  This header file implements the operating system DynamicLibrary concept.
 //
-// FIXME: This file leaks ExplicitSymbols and OpenedHandles!
+// FIXME: This file leaks ExplicitSymbols, OpenedHandles and
+// LibrarySymbolCache!
 //
 //===----------------------------------------------------------------------===//
 
@@ -50,6 +51,13 @@ void llvm::sys::DynamicLibrary::AddSymbol(StringRef symbolName,
   (*ExplicitSymbols)[symbolName] = symbolValue;
 }
 
+void llvm::sys::DynamicLibrary::SearchForAddressOfSymbols(
+    ArrayRef<const char *> symbolNames, void **addresses) {
+  SmartScopedLock<true> lock(getMutex());
+  for (unsigned i = 0, e = symbolNames.size(); i != e; ++i)
+    addresses[i] = SearchForAddressOfSymbol(symbolNames[i]);
+}
+
 char llvm::sys::DynamicLibrary::Invalid = 0;
 
 #ifdef LLVM_ON_WIN32
@@ -70,6 +78,12 @@ using namespace llvm::sys;
 
 static DenseSet<void *> *OpenedHandles = 0;
 
+// Addresses that SearchForAddressOfSymbol() found in OpenedHandles.  Searching
+// every handle with dlsym is slow and the JIT asks again for each module that
+// references the symbol.  A newly opened library may change the result, so
+// the cache is flushed whenever one is added.
+static StringMap<void *> *LibrarySymbolCache = 0;
+
 DynamicLibrary DynamicLibrary::getPermanentLibrary(const char *filename,
                                                    std::string *errMsg) {
   SmartScopedLock<true> lock(getMutex());
@@ -94,6 +108,8 @@ DynamicLibrary DynamicLibrary::getPermanentLibrary(const char *filename,
   // keep the internal refcount at +1.
   if (!OpenedHandles->insert(handle).second)
     dlclose(handle);
+  else if (LibrarySymbolCache)
+    LibrarySymbolCache->clear();
 
   return DynamicLibrary(handle);
 }
@@ -139,11 +155,20 @@ void* DynamicLibrary::SearchForAddressOfSymbol(const char *symbolName) {
 #if HAVE_DLFCN_H
   // Now search the libraries.
   if (OpenedHandles) {
+    if (LibrarySymbolCache) {
+      StringMap<void *>::iterator i = LibrarySymbolCache->find(symbolName);
+      if (i != LibrarySymbolCache->end())
+        return i->second;
+    }
+
     for (DenseSet<void *>::iterator I = OpenedHandles->begin(),
          E = OpenedHandles->end(); I != E; ++I) {
       //lt_ptr ptr = lt_dlsym(*I, symbolName);
       void *ptr = dlsym(*I, symbolName);
       if (ptr) {
+        if (LibrarySymbolCache == 0)
+          LibrarySymbolCache = new StringMap<void *>();
+        (*LibrarySymbolCache)[symbolName] = ptr;
         return ptr;
       }
     }
@@ -51,6 +51,9 @@ sys::IdentifyFileType(const char *magic, unsigned length) {
     case 'B':
       if (magic[1] == 'C' && magic[2] == (char)0xC0 && magic[3] == (char)0xDE)
         return Bitcode_FileType;
+      // Compressed bitcode container.
+      if (magic[1] == 'C' && magic[2] == 'Z' && magic[3] == 0x01)
+        return Bitcode_FileType;
       break;
     case '!':
       if (length >= 8)
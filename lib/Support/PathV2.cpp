@@ -755,6 +755,9 @@ file_magic identify_magic(StringRef magic) {
     case 'B':
       if (magic[1] == 'C' && magic[2] == (char)0xC0 && magic[3] == (char)0xDE)
         return file_magic::bitcode;
+      // Compressed bitcode container.
+      if (magic[1] == 'C' && magic[2] == 'Z' && magic[3] == 0x01)
+        return file_magic::bitcode;
       break;
     case '!':
       if (magic.size() >= 8)
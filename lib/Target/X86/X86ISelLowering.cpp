@@ -1250,6 +1250,10 @@ X86TargetLowering::X86TargetLowering(X86TargetMachine &TM)
   // Predictable cmov don't hurt on atom because it's in-order.
   predictableSelectIsExpensive = !Subtarget->isAtom();
 
+  // Adds with an immediate that doesn't fit in 32 bits need a movabsq, so
+  // keep the large offsets that CodeGenPrepare shares between addresses.
+  setSharedAddReassocIsExpensive();
+
   setPrefFunctionAlignment(4); // 2^4 bytes.
 }
 
@@ -11260,6 +11264,11 @@ bool X86TargetLowering::isLegalAddressingMode(const AddrMode &AM,
 }
 
 
+bool X86TargetLowering::isLegalAddImmediate(int64_t Imm) const {
+  // The immediate of an add is a sign-extended 32-bit value.
+  return isInt<32>(Imm);
+}
+
 bool X86TargetLowering::isTruncateFree(Type *Ty1, Type *Ty2) const {
   if (!Ty1->isIntegerTy() || !Ty2->isIntegerTy())
     return false;
@@ -14,6 +14,10 @@
 // to the function does not create any copies of the pointer value that
 // outlive the call.  This more or less means that the pointer is only
 // dereferenced, and not returned from the function or stored in a global.
+// Non-captured arguments that are never written through are further marked
+// readonly or readnone, functions that only return fresh allocations are
+// marked noalias, and pointers that can never be null (returned values, and
+// arguments the function dereferences on entry) are marked nonnull.
 // This pass is implemented as a bottom-up traversal of the call-graph.
 //
 //===----------------------------------------------------------------------===//
@@ -37,7 +41,11 @@ using namespace llvm;
 STATISTIC(NumReadNone, "Number of functions marked readnone");
 STATISTIC(NumReadOnly, "Number of functions marked readonly");
 STATISTIC(NumNoCapture, "Number of arguments marked nocapture");
+STATISTIC(NumReadNoneArg, "Number of arguments marked readnone");
+STATISTIC(NumReadOnlyArg, "Number of arguments marked readonly");
 STATISTIC(NumNoAlias, "Number of function returns marked noalias");
+STATISTIC(NumNonNullArg, "Number of arguments marked nonnull");
+STATISTIC(NumNonNullReturn, "Number of function returns marked nonnull");
 
 namespace {
   struct FunctionAttrs : public CallGraphSCCPass {
@@ -55,6 +63,10 @@ namespace {
     // AddNoCaptureAttrs - Deduce nocapture attributes for the SCC.
     bool AddNoCaptureAttrs(const CallGraphSCC &SCC);
 
+    // AddArgumentReadAttrs - Deduce readonly/readnone attributes for the
+    // nocapture arguments of the SCC.
+    bool AddArgumentReadAttrs(const CallGraphSCC &SCC);
+
     // IsFunctionMallocLike - Does this function allocate new memory?
     bool IsFunctionMallocLike(Function *F,
                               SmallPtrSet<Function*, 8> &) const;
@@ -62,6 +74,13 @@ namespace {
     // AddNoAliasAttrs - Deduce noalias attributes for the SCC.
     bool AddNoAliasAttrs(const CallGraphSCC &SCC);
 
+    // IsReturnNonNull - Does this function never return null?
+    bool IsReturnNonNull(Function *F,
+                         SmallPtrSet<Function*, 8> &) const;
+
+    // AddNonNullAttrs - Deduce nonnull attributes for the SCC.
+    bool AddNonNullAttrs(const CallGraphSCC &SCC);
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesCFG();
       AU.addRequired<AliasAnalysis>();
@@ -472,6 +491,132 @@ bool FunctionAttrs::AddNoCaptureAttrs(const CallGraphSCC &SCC) {
   return Changed;
 }
 
+/// DeterminePointerReadAttrs - Work out how the function containing A uses
+/// the memory A points to.  Returns ReadNone if it is never accessed, ReadOnly
+/// if it is only read and None if it may be written or the uses could not all
+/// be followed.  A must not be captured.
+static Attributes DeterminePointerReadAttrs(Argument *A) {
+  // Give up on arguments with a huge number of (transitive) uses; the
+  // attribute is unlikely to pay for the scan.
+  const unsigned MaxUsesToExplore = 32;
+
+  Function *F = A->getParent();
+  SmallVector<Use*, 16> Worklist;
+  SmallPtrSet<Value*, 16> Visited;
+  bool IsRead = false;
+
+  Visited.insert(A);
+  for (Value::use_iterator UI = A->use_begin(), UE = A->use_end();
+       UI != UE; ++UI)
+    Worklist.push_back(&UI.getUse());
+
+  unsigned Count = 0;
+  while (!Worklist.empty()) {
+    if (++Count > MaxUsesToExplore)
+      return Attribute::None;
+
+    Use *U = Worklist.pop_back_val();
+    Instruction *I = cast<Instruction>(U->getUser());
+
+    switch (I->getOpcode()) {
+    case Instruction::BitCast:
+    case Instruction::GetElementPtr:
+    case Instruction::PHI:
+    case Instruction::Select:
+      // These only compute new pointers from A; follow what uses them.
+      if (Visited.insert(I))
+        for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+             UI != UE; ++UI)
+          Worklist.push_back(&UI.getUse());
+      break;
+
+    case Instruction::Load:
+      if (cast<LoadInst>(I)->isVolatile())
+        return Attribute::None;
+      IsRead = true;
+      break;
+
+    case Instruction::ICmp:
+      break;
+
+    case Instruction::Call:
+    case Instruction::Invoke: {
+      CallSite CS(I);
+      // Calling through the pointer is not something we try to model.
+      if (U < CS.arg_begin() || U >= CS.arg_end())
+        return Attribute::None;
+      unsigned ArgNo = U - CS.arg_begin();
+
+      // A self-recursive call passing the pointer in the same position does
+      // not change the answer.
+      if (CS.getCalledFunction() == F && ArgNo == A->getArgNo())
+        break;
+
+      // memcpy and memmove only read their source operand.
+      if (isa<MemTransferInst>(I) && ArgNo == 1) {
+        IsRead = true;
+        break;
+      }
+
+      if (CS.doesNotAccessMemory() || CS.doesNotAccessMemory(ArgNo))
+        break;
+      if (CS.onlyReadsMemory() || CS.onlyReadsMemory(ArgNo)) {
+        IsRead = true;
+        break;
+      }
+      return Attribute::None;
+    }
+
+    default:
+      // Stores, returns and anything else we do not understand.
+      return Attribute::None;
+    }
+  }
+
+  return IsRead ? Attribute::ReadOnly : Attribute::ReadNone;
+}
+
+/// AddArgumentReadAttrs - Deduce readonly/readnone attributes for the
+/// nocapture pointer arguments of the SCC.
+bool FunctionAttrs::AddArgumentReadAttrs(const CallGraphSCC &SCC) {
+  bool Changed = false;
+
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    // Definitions with weak linkage may be overridden at linktime with
+    // something that writes through its arguments.
+    if (F == 0 || F->isDeclaration() || F->mayBeOverridden())
+      continue;
+
+    // The function-level attribute already covers every argument.
+    if (F->onlyReadsMemory())
+      continue;
+
+    for (Function::arg_iterator A = F->arg_begin(), E = F->arg_end();
+         A != E; ++A) {
+      // Only a pointer that does not escape can be tracked to all of its
+      // accesses.
+      if (!A->getType()->isPointerTy() || !A->hasNoCaptureAttr() ||
+          A->hasByValAttr() || A->onlyReadsMemory())
+        continue;
+
+      Attributes Attr = DeterminePointerReadAttrs(A);
+      if (Attr == Attribute::None)
+        continue;
+
+      A->addAttr(Attr);
+      if (Attr == Attribute::ReadNone)
+        ++NumReadNoneArg;
+      else
+        ++NumReadOnlyArg;
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
 /// IsFunctionMallocLike - A function is malloc-like if it returns either null
 /// or a pointer that doesn't alias any other pointer visible to the caller.
 bool FunctionAttrs::IsFunctionMallocLike(Function *F,
@@ -587,11 +732,160 @@ bool FunctionAttrs::AddNoAliasAttrs(const CallGraphSCC &SCC) {
   return MadeChange;
 }
 
+/// IsReturnNonNull - Return true if every value F returns is a pointer that
+/// is known to be non-null, assuming the other functions in the SCC never
+/// return null either.
+bool FunctionAttrs::IsReturnNonNull(Function *F,
+                                    SmallPtrSet<Function*, 8> &SCCNodes) const {
+  UniqueVector<Value *> FlowsToReturn;
+  for (Function::iterator I = F->begin(), E = F->end(); I != E; ++I)
+    if (ReturnInst *Ret = dyn_cast<ReturnInst>(I->getTerminator()))
+      FlowsToReturn.insert(Ret->getReturnValue());
+
+  for (unsigned i = 0; i != FlowsToReturn.size(); ++i) {
+    Value *RetVal = FlowsToReturn[i+1];   // UniqueVector[0] is reserved.
+
+    // Allocas, non-weak globals and nonnull arguments and calls.
+    if (isKnownNonNull(RetVal->stripPointerCasts()))
+      continue;
+
+    Instruction *RVI = dyn_cast<Instruction>(RetVal);
+    if (!RVI)
+      return false;
+
+    switch (RVI->getOpcode()) {
+      // Extend the analysis by looking upwards.
+      case Instruction::BitCast:
+        FlowsToReturn.insert(RVI->getOperand(0));
+        continue;
+      case Instruction::GetElementPtr:
+        // An inbounds GEP stays within the object it started from, so it
+        // can only produce null from null.
+        if (!cast<GetElementPtrInst>(RVI)->isInBounds())
+          return false;
+        FlowsToReturn.insert(RVI->getOperand(0));
+        continue;
+      case Instruction::Select: {
+        SelectInst *SI = cast<SelectInst>(RVI);
+        FlowsToReturn.insert(SI->getTrueValue());
+        FlowsToReturn.insert(SI->getFalseValue());
+        continue;
+      }
+      case Instruction::PHI: {
+        PHINode *PN = cast<PHINode>(RVI);
+        for (int i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+          FlowsToReturn.insert(PN->getIncomingValue(i));
+        continue;
+      }
+      case Instruction::Call:
+      case Instruction::Invoke: {
+        CallSite CS(RVI);
+        if (CS.getCalledFunction() &&
+            SCCNodes.count(CS.getCalledFunction()))
+          continue;
+      } // fall-through
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/// AddNonNullAttrs - Deduce nonnull attributes for the SCC.
+bool FunctionAttrs::AddNonNullAttrs(const CallGraphSCC &SCC) {
+  SmallPtrSet<Function*, 8> SCCNodes;
+  bool MadeChange = false;
+
+  // Fill SCCNodes with the elements of the SCC.  Used for quickly
+  // looking up whether a given CallGraphNode is in this SCC.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    SCCNodes.insert((*I)->getFunction());
+
+  // An argument that is dereferenced before the entry block can stop or
+  // leave the function cannot be null in any well-defined execution.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+    if (F == 0 || F->isDeclaration() || F->mayBeOverridden())
+      continue;
+
+    BasicBlock &Entry = F->getEntryBlock();
+    for (BasicBlock::iterator BI = Entry.begin(), BE = Entry.end();
+         BI != BE; ++BI) {
+      Value *Ptr = 0;
+      if (LoadInst *LI = dyn_cast<LoadInst>(BI)) {
+        if (!LI->isVolatile())
+          Ptr = LI->getPointerOperand();
+      } else if (StoreInst *SI = dyn_cast<StoreInst>(BI)) {
+        if (!SI->isVolatile())
+          Ptr = SI->getPointerOperand();
+      } else if (isa<CallInst>(BI) || isa<InvokeInst>(BI)) {
+        // The callee may not return.
+        if (!isa<DbgInfoIntrinsic>(BI))
+          break;
+      }
+      if (!Ptr || cast<PointerType>(Ptr->getType())->getAddressSpace() != 0)
+        continue;
+
+      Argument *A = dyn_cast<Argument>(Ptr->stripPointerCasts());
+      if (!A || A->hasNonNullAttr())
+        continue;
+
+      A->addAttr(Attribute::NonNull);
+      ++NumNonNullArg;
+      MadeChange = true;
+    }
+  }
+
+  // Returned pointers.  As for noalias, functions in the SCC are assumed to
+  // return nonnull pointers while the SCC is checked, so either all of them
+  // get the attribute or none do.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    if (F == 0)
+      // External node - skip it;
+      return MadeChange;
+
+    // Already nonnull.
+    if (F->isNonNull(0))
+      continue;
+
+    // Definitions with weak linkage may be overridden at linktime, so
+    // treat them like declarations.
+    if (F->isDeclaration() || F->mayBeOverridden())
+      return MadeChange;
+
+    // Null is only special in the default address space.
+    PointerType *RetTy = dyn_cast<PointerType>(F->getReturnType());
+    if (!RetTy || RetTy->getAddressSpace() != 0)
+      continue;
+
+    if (!IsReturnNonNull(F, SCCNodes))
+      return MadeChange;
+  }
+
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+    PointerType *RetTy = dyn_cast<PointerType>(F->getReturnType());
+    if (F->isNonNull(0) || !RetTy || RetTy->getAddressSpace() != 0)
+      continue;
+
+    F->addAttribute(0, Attribute::NonNull);
+    ++NumNonNullReturn;
+    MadeChange = true;
+  }
+
+  return MadeChange;
+}
+
 bool FunctionAttrs::runOnSCC(CallGraphSCC &SCC) {
   AA = &getAnalysis<AliasAnalysis>();
 
   bool Changed = AddReadAttrs(SCC);
   Changed |= AddNoCaptureAttrs(SCC);
+  Changed |= AddArgumentReadAttrs(SCC);
   Changed |= AddNoAliasAttrs(SCC);
+  Changed |= AddNonNullAttrs(SCC);
   return Changed;
 }
@@ -28,6 +28,7 @@
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
@@ -58,6 +59,11 @@ STATISTIC(NumAliasesResolved, "Number of global aliases resolved");
 STATISTIC(NumAliasesRemoved, "Number of global aliases eliminated");
 STATISTIC(NumCXXDtorsRemoved, "Number of global C++ destructors removed");
 
+static cl::opt<unsigned>
+CtorEvalStepLimit("globalopt-ctor-eval-limit", cl::init(500000), cl::Hidden,
+  cl::desc("The maximum number of instructions to execute while evaluating "
+           "a static constructor"));
+
 namespace {
   struct GlobalStatus;
   struct GlobalOpt : public ModulePass {
@@ -2155,11 +2161,11 @@ isSimpleEnoughValueToCommit(Constant *C,
 /// enough for us to understand.  In particular, if it is a cast to anything
 /// other than from one pointer type to another pointer type, we punt.
 /// We basically just support direct accesses to globals and GEP's of
-/// globals.  This should be kept up to date with CommitValueTo.
+/// globals.  This should be kept up to date with DecomposePointer.
 static bool isSimpleEnoughPointerToCommit(Constant *C) {
-  // Conservatively, avoid aggregate types. This is because we don't
-  // want to worry about them partially overlapping other stores.
-  if (!cast<PointerType>(C->getType())->getElementType()->isSingleValueType())
+  // Stores of whole aggregates are fine: the evaluator keeps the contents of
+  // each global broken up by element, so they cannot partially overlap.
+  if (!cast<PointerType>(C->getType())->getElementType()->isFirstClassType())
     return false;
 
   if (GlobalVariable *GV = dyn_cast<GlobalVariable>(C))
@@ -2203,70 +2209,134 @@ static bool isSimpleEnoughPointerToCommit(Constant *C) {
   return false;
 }
 
-/// EvaluateStoreInto - Evaluate a piece of a constantexpr store into a global
-/// initializer.  This returns 'Init' modified to reflect 'Val' stored into it.
-/// At this point, the GEP operands of Addr [0, OpNo) have been stepped into.
-static Constant *EvaluateStoreInto(Constant *Init, Constant *Val,
-                                   ConstantExpr *Addr, unsigned OpNo) {
-  // Base case of the recursion.
-  if (OpNo == Addr->getNumOperands()) {
-    assert(Val->getType() == Init->getType() && "Type mismatch!");
-    return Val;
-  }
-
-  SmallVector<Constant*, 32> Elts;
-  if (StructType *STy = dyn_cast<StructType>(Init->getType())) {
-    // Break up the constant into its elements.
-    for (unsigned i = 0, e = STy->getNumElements(); i != e; ++i)
-      Elts.push_back(Init->getAggregateElement(i));
-
-    // Replace the element that we are supposed to.
-    ConstantInt *CU = cast<ConstantInt>(Addr->getOperand(OpNo));
-    unsigned Idx = CU->getZExtValue();
-    assert(Idx < STy->getNumElements() && "Struct index out of range!");
-    Elts[Idx] = EvaluateStoreInto(Elts[Idx], Val, Addr, OpNo+1);
+/// DecomposePointer - Split a pointer that is a global or a getelementptr of a
+/// global with a leading zero index and constant integer indices into the
+/// global and the remaining indices.  Return null for any other pointer.
+static GlobalVariable *DecomposePointer(Constant *P,
+                                        SmallVectorImpl<uint64_t> &Idxs) {
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(P))
+    return GV;
 
-    // Return the modified struct.
-    return ConstantStruct::get(STy, Elts);
+  ConstantExpr *CE = dyn_cast<ConstantExpr>(P);
+  if (!CE || CE->getOpcode() != Instruction::GetElementPtr)
+    return 0;
+  GlobalVariable *GV = dyn_cast<GlobalVariable>(CE->getOperand(0));
+  ConstantInt *First = dyn_cast<ConstantInt>(CE->getOperand(1));
+  if (!GV || !First || !First->isZero())
+    return 0;
+  for (unsigned i = 2, e = CE->getNumOperands(); i != e; ++i) {
+    ConstantInt *CI = dyn_cast<ConstantInt>(CE->getOperand(i));
+    if (!CI || CI->getValue().getActiveBits() > 32)
+      return 0;
+    Idxs.push_back(CI->getZExtValue());
   }
-  
-  ConstantInt *CI = cast<ConstantInt>(Addr->getOperand(OpNo));
-  SequentialType *InitTy = cast<SequentialType>(Init->getType());
-
-  uint64_t NumElts;
-  if (ArrayType *ATy = dyn_cast<ArrayType>(InitTy))
-    NumElts = ATy->getNumElements();
-  else
-    NumElts = InitTy->getVectorNumElements();
+  return GV;
+}
 
-  // Break up the array into elements.
-  for (uint64_t i = 0, e = NumElts; i != e; ++i)
-    Elts.push_back(Init->getAggregateElement(i));
+/// GetNumAggregateElements - Return the number of elements of an array,
+/// vector or struct type, and zero for any other type.
+static uint64_t GetNumAggregateElements(Type *Ty) {
+  if (StructType *STy = dyn_cast<StructType>(Ty))
+    return STy->getNumElements();
+  if (ArrayType *ATy = dyn_cast<ArrayType>(Ty))
+    return ATy->getNumElements();
+  if (VectorType *VTy = dyn_cast<VectorType>(Ty))
+    return VTy->getNumElements();
+  return 0;
+}
 
-  assert(CI->getZExtValue() < NumElts);
-  Elts[CI->getZExtValue()] =
-    EvaluateStoreInto(Elts[CI->getZExtValue()], Val, Addr, OpNo+1);
+namespace {
 
-  if (Init->getType()->isArrayTy())
-    return ConstantArray::get(cast<ArrayType>(InitTy), Elts);
-  return ConstantVector::get(Elts);
-}
+/// MutableValue - The contents of a global variable while a static
+/// constructor is being evaluated.  It starts out as the initializer, and
+/// aggregates are broken up into their elements, one level at a time, only
+/// where a store reaches into them.  This makes a store cost time in the depth
+/// of the type rather than in the size of the initializer, and the new
+/// initializer is built once, when the results are committed.
+class MutableValue {
+  /// Val - The value, unless it has been broken up into Elts.
+  Constant *Val;
+  Type *Ty;
+  std::vector<MutableValue> Elts;
+
+  /// expand - Break up Val into its elements.
+  bool expand() {
+    uint64_t NumElts = GetNumAggregateElements(Ty);
+    if (NumElts == 0)
+      return false;
+    Elts.reserve(NumElts);
+    for (uint64_t i = 0; i != NumElts; ++i) {
+      Constant *Elt = Val->getAggregateElement(i);
+      if (!Elt) {
+        Elts.clear();
+        return false;
+      }
+      Elts.push_back(MutableValue(Elt));
+    }
+    Val = 0;
+    return true;
+  }
 
-/// CommitValueTo - We have decided that Addr (which satisfies the predicate
-/// isSimpleEnoughPointerToCommit) should get Val as its value.  Make it happen.
-static void CommitValueTo(Constant *Val, Constant *Addr) {
-  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Addr)) {
-    assert(GV->hasInitializer());
-    GV->setInitializer(Val);
-    return;
+public:
+  explicit MutableValue(Constant *C) : Val(C), Ty(C->getType()) {}
+
+  /// load - Return the value of the element reached through Idxs, or null if
+  /// the indices are out of range.
+  Constant *load(ArrayRef<uint64_t> Idxs) const {
+    const MutableValue *MV = this;
+    for (unsigned i = 0, e = Idxs.size(); i != e; ++i) {
+      if (MV->Val) {
+        // The rest of the path is inside an unmodified constant.
+        Constant *C = MV->Val;
+        for (; i != e; ++i) {
+          if (Idxs[i] >= GetNumAggregateElements(C->getType()))
+            return 0;
+          C = C->getAggregateElement(Idxs[i]);
+          if (!C)
+            return 0;
+        }
+        return C;
+      }
+      if (Idxs[i] >= MV->Elts.size())
+        return 0;
+      MV = &MV->Elts[Idxs[i]];
+    }
+    return MV->materialize();
   }
 
-  ConstantExpr *CE = cast<ConstantExpr>(Addr);
-  GlobalVariable *GV = cast<GlobalVariable>(CE->getOperand(0));
-  GV->setInitializer(EvaluateStoreInto(GV->getInitializer(), Val, CE, 2));
-}
+  /// store - Replace the element reached through Idxs with V.  Return false
+  /// if the indices or the type of V do not fit.
+  bool store(ArrayRef<uint64_t> Idxs, Constant *V) {
+    MutableValue *MV = this;
+    for (unsigned i = 0, e = Idxs.size(); i != e; ++i) {
+      if (MV->Val && !MV->expand())
+        return false;
+      if (Idxs[i] >= MV->Elts.size())
+        return false;
+      MV = &MV->Elts[Idxs[i]];
+    }
+    if (V->getType() != MV->Ty)
+      return false;
+    MV->Val = V;
+    std::vector<MutableValue>().swap(MV->Elts);
+    return true;
+  }
 
-namespace {
+  /// materialize - Build the Constant for the current value.
+  Constant *materialize() const {
+    if (Val)
+      return Val;
+    SmallVector<Constant*, 32> Cs;
+    Cs.reserve(Elts.size());
+    for (unsigned i = 0, e = Elts.size(); i != e; ++i)
+      Cs.push_back(Elts[i].materialize());
+    if (StructType *STy = dyn_cast<StructType>(Ty))
+      return ConstantStruct::get(STy, Cs);
+    if (ArrayType *ATy = dyn_cast<ArrayType>(Ty))
+      return ConstantArray::get(ATy, Cs);
+    return ConstantVector::get(Cs);
+  }
+};
 
 /// Evaluator - This class evaluates LLVM IR, producing the Constant
 /// representing each SSA instruction.  Changes to global variables are stored
@@ -2274,13 +2344,16 @@ namespace {
 /// Once an evaluation call fails, the evaluation object should not be reused.
 class Evaluator {
 public:
+  typedef DenseMap<GlobalVariable*, MutableValue*> MemoryMap;
+
   Evaluator(const TargetData *TD, const TargetLibraryInfo *TLI)
-    : TD(TD), TLI(TLI) {
+    : StepsLeft(CtorEvalStepLimit), TD(TD), TLI(TLI) {
     ValueStack.push_back(new DenseMap<Value*, Constant*>);
   }
 
   ~Evaluator() {
     DeleteContainerPointers(ValueStack);
+    DeleteContainerSeconds(MutatedMemory);
     while (!AllocaTmps.empty()) {
       GlobalVariable *Tmp = AllocaTmps.back();
       AllocaTmps.pop_back();
@@ -2316,7 +2389,7 @@ public:
     ValueStack.back()->operator[](V) = C;
   }
 
-  const DenseMap<Constant*, Constant*> &getMutatedMemory() const {
+  const MemoryMap &getMutatedMemory() const {
     return MutatedMemory;
   }
 
@@ -2326,6 +2399,7 @@ public:
 
 private:
   Constant *ComputeLoadResult(Constant *P);
+  bool StoreToMemory(Constant *P, Constant *Val);
 
   /// ValueStack - As we compute SSA register values, we store their contents
   /// here. The back of the vector contains the current function and the stack
@@ -2337,10 +2411,14 @@ private:
   /// unbounded.
   SmallVector<Function*, 4> CallStack;
 
-  /// MutatedMemory - For each store we execute, we update this map.  Loads
-  /// check this to get the most up-to-date value.  If evaluation is successful,
-  /// this state is committed to the process.
-  DenseMap<Constant*, Constant*> MutatedMemory;
+  /// MutatedMemory - The contents of each global variable that we have
+  /// stored to.  Loads check this to get the most up-to-date value.  If
+  /// evaluation is successful, this state is committed to the process.
+  MemoryMap MutatedMemory;
+
+  /// StepsLeft - The number of instructions we may still execute before
+  /// giving up, which bounds the time spent on loops.
+  unsigned StepsLeft;
 
   /// AllocaTmps - To 'execute' an alloca, we create a temporary global variable
   /// to represent its body.  This vector is needed so we can delete the
@@ -2365,10 +2443,14 @@ private:
 /// P after the stores reflected by 'memory' have been performed.  If we can't
 /// decide, return null.
 Constant *Evaluator::ComputeLoadResult(Constant *P) {
-  // If this memory location has been recently stored, use the stored value: it
-  // is the most up-to-date.
-  DenseMap<Constant*, Constant*>::const_iterator I = MutatedMemory.find(P);
-  if (I != MutatedMemory.end()) return I->second;
+  // If this memory location has been stored to, use the stored value: it is
+  // the most up-to-date.
+  SmallVector<uint64_t, 8> Idxs;
+  if (GlobalVariable *GV = DecomposePointer(P, Idxs)) {
+    MemoryMap::const_iterator I = MutatedMemory.find(GV);
+    if (I != MutatedMemory.end())
+      return I->second->load(Idxs);
+  }
 
   // Access it.
   if (GlobalVariable *GV = dyn_cast<GlobalVariable>(P)) {
@@ -2382,13 +2464,27 @@ Constant *Evaluator::ComputeLoadResult(Constant *P) {
     if (CE->getOpcode() == Instruction::GetElementPtr &&
         isa<GlobalVariable>(CE->getOperand(0))) {
       GlobalVariable *GV = cast<GlobalVariable>(CE->getOperand(0));
-      if (GV->hasDefinitiveInitializer())
+      // The initializer is stale if the global has been stored to.
+      if (GV->hasDefinitiveInitializer() && !MutatedMemory.count(GV))
         return ConstantFoldLoadThroughGEPConstantExpr(GV->getInitializer(), CE);
     }
 
   return 0;  // don't know how to evaluate.
 }
 
+/// StoreToMemory - Record a store of Val to P, which satisfies
+/// isSimpleEnoughPointerToCommit.  Return false if we cannot represent it.
+bool Evaluator::StoreToMemory(Constant *P, Constant *Val) {
+  SmallVector<uint64_t, 8> Idxs;
+  GlobalVariable *GV = DecomposePointer(P, Idxs);
+  if (!GV)
+    return false;
+  MutableValue *&MV = MutatedMemory[GV];
+  if (!MV)
+    MV = new MutableValue(GV->getInitializer());
+  return MV->store(Idxs, Val);
+}
+
 /// EvaluateBlock - Evaluate all instructions in block BB, returning true if
 /// successful, false if we can't evaluate it.  NewBB returns the next BB that
 /// control flows into, or null upon return.
@@ -2398,6 +2494,12 @@ bool Evaluator::EvaluateBlock(BasicBlock::iterator CurInst,
   while (1) {
     Constant *InstResult = 0;
 
+    if (StepsLeft == 0) {
+      DEBUG(dbgs() << "Too many instructions executed in static ctor.\n");
+      return false;
+    }
+    --StepsLeft;
+
     if (StoreInst *SI = dyn_cast<StoreInst>(CurInst)) {
       if (!SI->isSimple()) return false;  // no volatile/atomic accesses.
       Constant *Ptr = getVal(SI->getOperand(1));
@@ -2453,7 +2555,8 @@ bool Evaluator::EvaluateBlock(BasicBlock::iterator CurInst,
           Val = ConstantExpr::getBitCast(Val, NewTy);
         }
           
-      MutatedMemory[Ptr] = Val;
+      if (!StoreToMemory(Ptr, Val))
+        return false;
     } else if (BinaryOperator *BO = dyn_cast<BinaryOperator>(CurInst)) {
       InstResult = ConstantExpr::get(BO->getOpcode(),
                                      getVal(BO->getOperand(0)),
@@ -2647,16 +2750,12 @@ bool Evaluator::EvaluateFunction(Function *F, Constant *&RetVal,
        ++AI, ++ArgNo)
     setVal(AI, ActualArgs[ArgNo]);
 
-  // ExecutedBlocks - We only handle non-looping, non-recursive code.  As such,
-  // we can only evaluate any one basic block at most once.  This set keeps
-  // track of what we have executed so we can detect recursive cases etc.
-  SmallPtrSet<BasicBlock*, 32> ExecutedBlocks;
-
   // CurBB - The current basic block we're evaluating.
   BasicBlock *CurBB = F->begin();
 
   BasicBlock::iterator CurInst = CurBB->begin();
 
+  SmallVector<std::pair<PHINode*, Constant*>, 8> PHIValues;
   while (1) {
     BasicBlock *NextBB = 0; // Initialized to avoid compiler warnings.
     if (!EvaluateBlock(CurInst, NextBB))
@@ -2672,19 +2771,19 @@ bool Evaluator::EvaluateFunction(Function *F, Constant *&RetVal,
       return true;
     }
 
-    // Okay, we succeeded in evaluating this control flow.  See if we have
-    // executed the new block before.  If so, we have a looping function,
-    // which we cannot evaluate in reasonable time.
-    if (!ExecutedBlocks.insert(NextBB))
-      return false;  // looped!
-
-    // Okay, we have never been in this block before.  Check to see if there
-    // are any PHI nodes.  If so, evaluate them with information about where
-    // we came from.
+    // Okay, we succeeded in evaluating this control flow.  Loops are executed
+    // like any other code: the limit on the number of instructions executed
+    // keeps us from spinning forever.  Evaluate the PHI nodes of the new block
+    // with information about where we came from.  They are read before any of
+    // them is updated, as on a back edge they can refer to each other.
     PHINode *PN = 0;
+    PHIValues.clear();
     for (CurInst = NextBB->begin();
          (PN = dyn_cast<PHINode>(CurInst)); ++CurInst)
-      setVal(PN, getVal(PN->getIncomingValueForBlock(CurBB)));
+      PHIValues.push_back(std::make_pair(PN,
+                            getVal(PN->getIncomingValueForBlock(CurBB))));
+    for (unsigned i = 0, e = PHIValues.size(); i != e; ++i)
+      setVal(PHIValues[i].first, PHIValues[i].second);
 
     // Advance to the next block.
     CurBB = NextBB;
@@ -2705,11 +2804,11 @@ static bool EvaluateStaticConstructor(Function *F, const TargetData *TD,
     // We succeeded at evaluation: commit the result.
     DEBUG(dbgs() << "FULLY EVALUATED GLOBAL CTOR FUNCTION '"
           << F->getName() << "' to " << Eval.getMutatedMemory().size()
-          << " stores.\n");
-    for (DenseMap<Constant*, Constant*>::const_iterator I =
+          << " mutated globals.\n");
+    for (Evaluator::MemoryMap::const_iterator I =
            Eval.getMutatedMemory().begin(), E = Eval.getMutatedMemory().end();
-	 I != E; ++I)
-      CommitValueTo(I->second, I->first);
+         I != E; ++I)
+      I->first->setInitializer(I->second->materialize());
     for (SmallPtrSet<GlobalVariable*, 8>::const_iterator I =
            Eval.getInvariants().begin(), E = Eval.getInvariants().end();
          I != E; ++I)
@@ -56,6 +56,9 @@ STATISTIC(NumCastUses, "Number of uses of Cast expressions replaced with uses "
                        "of sunken Casts");
 STATISTIC(NumMemoryInsts, "Number of memory instructions whose address "
                           "computations were sunk");
+STATISTIC(NumAddrModesReused, "Number of addressing mode matches reused");
+STATISTIC(NumGEPsRebased, "Number of GEPs rebased onto a GEP with a nearby "
+                          "offset");
 STATISTIC(NumExtsMoved,  "Number of [s|z]ext instructions combined with loads");
 STATISTIC(NumExtUses,    "Number of uses of [s|z]ext instructions optimized");
 STATISTIC(NumRetsDup,    "Number of return instructions duplicated");
@@ -75,7 +78,17 @@ static cl::opt<bool> DisableSelectToBranch(
   "disable-cgp-select2branch", cl::Hidden, cl::init(false),
   cl::desc("Disable select to branch conversion."));
 
+static cl::opt<bool> DisableGEPRebase(
+  "disable-cgp-gep-rebase", cl::Hidden, cl::init(false),
+  cl::desc("Disable rebasing GEPs with large offsets onto each other"));
+
 namespace {
+  /// MatchedAddrMode - The result of AddressingModeMatcher::Match.
+  struct MatchedAddrMode {
+    ExtAddrMode AddrMode;
+    SmallVector<Instruction*, 4> AddrModeInsts;
+  };
+
   class CodeGenPrepare : public FunctionPass {
     /// TLI - Keep a pointer of a TargetLowering to consult for determining
     /// transformation profitability.
@@ -94,6 +107,13 @@ namespace {
     /// multiple load/stores of the same address.
     DenseMap<Value*, Value*> SunkAddrs;
 
+    /// AddrModes - The addressing modes matched in the current block, by
+    /// address and access type.  The matcher only looks at the block of the
+    /// memory instruction, so memory instructions of a block that share an
+    /// address reuse the first match.  The table is cleared whenever
+    /// instructions it may refer to are deleted or moved.
+    DenseMap<std::pair<Value*, Type*>, MatchedAddrMode> AddrModes;
+
     /// ModifiedDT - If CFG is modified in anyway, dominator tree may need to
     /// be updated.
     bool ModifiedDT;
@@ -121,6 +141,9 @@ namespace {
     void EliminateMostlyEmptyBlock(BasicBlock *BB);
     bool OptimizeBlock(BasicBlock &BB);
     bool OptimizeInst(Instruction *I);
+    bool SplitLargeGEPOffsets(Function &F);
+    const MatchedAddrMode &MatchAddrMode(Value *V, Type *AccessTy,
+                                         Instruction *MemoryInst);
     bool OptimizeMemoryInst(Instruction *I, Value *Addr, Type *AccessTy);
     bool OptimizeInlineAsmInst(CallInst *CS);
     bool OptimizeCallInst(CallInst *CI);
@@ -161,6 +184,11 @@ bool CodeGenPrepare::runOnFunction(Function &F) {
   // find a node corresponding to the value.
   EverMadeChange |= PlaceDbgValues(F);
 
+  // Give GEPs with unfoldable offsets a shared base before their addressing
+  // modes are sunk into the blocks of their uses.
+  if (TLI && !DisableGEPRebase)
+    EverMadeChange |= SplitLargeGEPOffsets(F);
+
   bool MadeChange = true;
   while (MadeChange) {
     MadeChange = false;
@@ -172,6 +200,7 @@ bool CodeGenPrepare::runOnFunction(Function &F) {
   }
 
   SunkAddrs.clear();
+  AddrModes.clear();
 
   if (!DisableBranchOpts) {
     MadeChange = false;
@@ -748,6 +777,125 @@ static bool IsNonLocalValue(Value *V, BasicBlock *BB) {
   return false;
 }
 
+/// CollectAccessTypes - Add the types accessed by the loads and stores that
+/// use Ptr as their address, directly or through bitcasts, to Tys.
+static void CollectAccessTypes(Value *Ptr, SmallVectorImpl<Type*> &Tys) {
+  for (Value::use_iterator UI = Ptr->use_begin(), E = Ptr->use_end();
+       UI != E; ++UI) {
+    if (LoadInst *LI = dyn_cast<LoadInst>(*UI))
+      Tys.push_back(LI->getType());
+    else if (StoreInst *SI = dyn_cast<StoreInst>(*UI)) {
+      if (SI->getPointerOperand() == Ptr)
+        Tys.push_back(SI->getValueOperand()->getType());
+    } else if (BitCastInst *BCI = dyn_cast<BitCastInst>(*UI))
+      CollectAccessTypes(BCI, Tys);
+  }
+}
+
+/// IsFoldableOffset - Return true if accesses of all of the types in Tys can
+/// fold the offset Offs from a base register into their addressing mode.
+static bool IsFoldableOffset(ArrayRef<Type*> Tys, int64_t Offs,
+                             const TargetLowering &TLI) {
+  TargetLowering::AddrMode AM;
+  AM.HasBaseReg = true;
+  AM.BaseOffs = Offs;
+  for (unsigned i = 0, e = Tys.size(); i != e; ++i)
+    if (!TLI.isLegalAddressingMode(AM, Tys[i]))
+      return false;
+  return true;
+}
+
+/// SplitLargeGEPOffsets - Memory operations often address a region through
+/// several GEPs off the same base, at constant offsets that are too large for
+/// the target to fold (fields at the end of a large struct, or elements far
+/// into an array).  Each of those GEPs is then computed on its own, with its
+/// large offset materialized every time, and keeps a register of its own live
+/// if it is used in a loop.  Rebase the later GEPs of a block onto the first
+/// one with the same base, so that only one large offset is computed and the
+/// remaining differences fold into the addressing modes of the loads and
+/// stores.
+bool CodeGenPrepare::SplitLargeGEPOffsets(Function &F) {
+  const TargetData *TD = TLI->getTargetData();
+  if (!TD)
+    return false;
+
+  bool MadeChange = false;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    // The first GEP with an unfoldable offset from each base, and its offset.
+    DenseMap<Value*, std::pair<GetElementPtrInst*, int64_t> > Bases;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ) {
+      GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I++);
+      if (!GEP || !GEP->getType()->isPointerTy() ||
+          !GEP->hasAllConstantIndices())
+        continue;
+
+      SmallVector<Type*, 4> AccessTys;
+      CollectAccessTypes(GEP, AccessTys);
+      if (AccessTys.empty())
+        continue;
+
+      SmallVector<Value*, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+      int64_t Offs = TD->getIndexedOffset(GEP->getPointerOperandType(),
+                                          Indices);
+      if (IsFoldableOffset(AccessTys, Offs, *TLI))
+        continue;
+
+      std::pair<GetElementPtrInst*, int64_t> &Base =
+        Bases[GEP->getPointerOperand()->stripPointerCasts()];
+      if (!Base.first ||
+          Base.first->getPointerAddressSpace() !=
+            GEP->getPointerAddressSpace()) {
+        Base = std::make_pair(GEP, Offs);
+        continue;
+      }
+      int64_t Delta = Offs - Base.second;
+      if (!IsFoldableOffset(AccessTys, Delta, *TLI))
+        continue;
+
+      DEBUG(dbgs() << "CGP: Rebasing " << *GEP << "\n    onto "
+                   << *Base.first << "\n");
+      IRBuilder<> Builder(GEP);
+      Value *V = Builder.CreateBitCast(
+        Base.first, Builder.getInt8PtrTy(GEP->getPointerAddressSpace()));
+      if (Delta) {
+        Value *Idx = ConstantInt::get(TD->getIntPtrType(F.getContext()),
+                                      Delta);
+        if (GEP->isInBounds() && Base.first->isInBounds())
+          V = Builder.CreateInBoundsGEP(V, Idx);
+        else
+          V = Builder.CreateGEP(V, Idx);
+      }
+      V = Builder.CreateBitCast(V, GEP->getType());
+      if (V != Base.first)
+        V->takeName(GEP);
+      GEP->replaceAllUsesWith(V);
+      GEP->eraseFromParent();
+      ++NumGEPsRebased;
+      MadeChange = true;
+    }
+  }
+  return MadeChange;
+}
+
+/// MatchAddrMode - Return the addressing mode that a memory instruction of
+/// AccessTy in the block of MemoryInst can use for the address V, together
+/// with the instructions it covers.  The reference is valid until the next
+/// call.
+const MatchedAddrMode &
+CodeGenPrepare::MatchAddrMode(Value *V, Type *AccessTy,
+                              Instruction *MemoryInst) {
+  std::pair<DenseMap<std::pair<Value*, Type*>, MatchedAddrMode>::iterator,
+            bool> Ins = AddrModes.insert(std::make_pair(
+                          std::make_pair(V, AccessTy), MatchedAddrMode()));
+  MatchedAddrMode &Match = Ins.first->second;
+  if (Ins.second)
+    Match.AddrMode = AddressingModeMatcher::Match(V, AccessTy, MemoryInst,
+                                                  Match.AddrModeInsts, *TLI);
+  else
+    ++NumAddrModesReused;
+  return Match;
+}
+
 /// OptimizeMemoryInst - Load and Store Instructions often have
 /// addressing modes that can do significant amounts of computation.  As such,
 /// instruction selection will try to get the load or store to do as much
@@ -793,10 +941,8 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
     }
     
     // For non-PHIs, determine the addressing mode being computed.
-    SmallVector<Instruction*, 16> NewAddrModeInsts;
-    ExtAddrMode NewAddrMode =
-      AddressingModeMatcher::Match(V, AccessTy, MemoryInst,
-                                   NewAddrModeInsts, *TLI);
+    const MatchedAddrMode &Match = MatchAddrMode(V, AccessTy, MemoryInst);
+    const ExtAddrMode &NewAddrMode = Match.AddrMode;
 
     // This check is broken into two cases with very similar code to avoid using
     // getNumUses() as much as possible. Some values have a lot of uses, so
@@ -805,7 +951,9 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
     if (!Consensus) {
       Consensus = V;
       AddrMode = NewAddrMode;
-      AddrModeInsts = NewAddrModeInsts;
+      AddrModeInsts.clear();
+      AddrModeInsts.append(Match.AddrModeInsts.begin(),
+                           Match.AddrModeInsts.end());
       continue;
     } else if (NewAddrMode == AddrMode) {
       if (!IsNumUsesConsensusValid) {
@@ -822,7 +970,9 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
       if (NumUses > NumUsesConsensus) {
         Consensus = V;
         NumUsesConsensus = NumUses;
-        AddrModeInsts = NewAddrModeInsts;
+        AddrModeInsts.clear();
+        AddrModeInsts.append(Match.AddrModeInsts.begin(),
+                             Match.AddrModeInsts.end());
       }
       continue;
     }
@@ -945,6 +1095,7 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
     BasicBlock *BB = CurInstIterator->getParent();
     
     RecursivelyDeleteTriviallyDeadInstructions(Repl);
+    AddrModes.clear();
 
     if (IterHandle != CurInstIterator) {
       // If the iterator instruction was recursively deleted, start over at the
@@ -1254,11 +1405,21 @@ bool CodeGenPrepare::OptimizeInst(Instruction *I) {
 // selection.
 bool CodeGenPrepare::OptimizeBlock(BasicBlock &BB) {
   SunkAddrs.clear();
+  AddrModes.clear();
   bool MadeChange = false;
 
   CurInstIterator = BB.begin();
-  for (BasicBlock::iterator E = BB.end(); CurInstIterator != E; )
-    MadeChange |= OptimizeInst(CurInstIterator++);
+  for (BasicBlock::iterator E = BB.end(); CurInstIterator != E; ) {
+    Instruction *I = CurInstIterator++;
+    // Sinking the address of a load or store only adds instructions, unless
+    // it deletes the old address, which clears the table itself.
+    bool IsLoadOrStore = isa<LoadInst>(I) || isa<StoreInst>(I);
+    if (OptimizeInst(I)) {
+      MadeChange = true;
+      if (!IsLoadOrStore)
+        AddrModes.clear();
+    }
+  }
 
   return MadeChange;
 }
@@ -7,11 +7,9 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements a trivial dead store elimination that only considers
-// basic-block local redundant stores.
-//
-// FIXME: This should eventually be extended to be a post-dominator tree
-// traversal.  Doing so would be pretty trivial.
+// This file implements a trivial dead store elimination that mostly considers
+// basic-block local redundant stores.  Stores that are overwritten on every
+// path through later blocks are found with a bounded forward scan.
 //
 //===----------------------------------------------------------------------===//
 
@@ -31,14 +29,24 @@
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Target/TargetData.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/STLExtras.h"
 using namespace llvm;
 
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
+STATISTIC(NumNonLocalStores, "Number of stores deleted across blocks");
+STATISTIC(NumShortened, "Number of memory intrinsics shortened");
+
+static cl::opt<unsigned>
+NonLocalScanLimit("dse-nonlocal-scan-limit", cl::init(250), cl::Hidden,
+  cl::desc("Maximum number of instructions DSE scans to prove that a store "
+           "is overwritten in later blocks"));
 
 namespace {
   struct DSE : public FunctionPass {
@@ -63,6 +71,12 @@ namespace {
         if (DT->isReachableFromEntry(I))
           Changed |= runOnBasicBlock(*I);
 
+      // Now look for stores that are only overwritten in later blocks.
+      if (AA->getTargetData())
+        for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
+          if (DT->isReachableFromEntry(I))
+            Changed |= handleNonLocalStores(*I);
+
       AA = 0; MD = 0; DT = 0;
       return Changed;
     }
@@ -70,6 +84,9 @@ namespace {
     bool runOnBasicBlock(BasicBlock &BB);
     bool HandleFree(CallInst *F);
     bool handleEndBlock(BasicBlock &BB);
+    bool handleNonLocalStores(BasicBlock &BB);
+    bool isOverwrittenOnAllPaths(Instruction *Inst,
+                                 const AliasAnalysis::Location &Loc);
     void RemoveAccessedObjects(const AliasAnalysis::Location &LoadedLoc,
                                SmallSetVector<Value*, 16> &DeadStackObjects);
 
@@ -315,6 +332,7 @@ namespace {
   enum OverwriteResult
   {
     OverwriteComplete,
+    OverwriteBegin,
     OverwriteEnd,
     OverwriteUnknown
   };
@@ -323,7 +341,8 @@ namespace {
 /// isOverwrite - Return 'OverwriteComplete' if a store to the 'Later' location
 /// completely overwrites a store to the 'Earlier' location.
 /// 'OverwriteEnd' if the end of the 'Earlier' location is completely 
-/// overwritten by 'Later', or 'OverwriteUnknown' if nothing can be determined
+/// overwritten by 'Later', 'OverwriteBegin' if its beginning is, or
+/// 'OverwriteUnknown' if nothing can be determined
 static OverwriteResult isOverwrite(const AliasAnalysis::Location &Later,
                                    const AliasAnalysis::Location &Earlier,
                                    AliasAnalysis &AA,
@@ -425,6 +444,17 @@ static OverwriteResult isOverwrite(const AliasAnalysis::Location &Later,
       int64_t(LaterOff + Later.Size) >= int64_t(EarlierOff + Earlier.Size))
     return OverwriteEnd;
 
+  // Finally, the later store may overwrite the beginning of the earlier store
+  //
+  //          |--earlier--|
+  //      |--   later  --|
+  //
+  // in which case the earlier store may be shortened from the front.
+  if (EarlierOff >= LaterOff &&
+      EarlierOff < int64_t(LaterOff + Later.Size) &&
+      int64_t(LaterOff + Later.Size) < int64_t(EarlierOff + Earlier.Size))
+    return OverwriteBegin;
+
   // Otherwise, they don't completely overlap.
   return OverwriteUnknown;
 }
@@ -593,6 +623,31 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
                                                     InstWriteOffset - 
                                                     DepWriteOffset);
             DepIntrinsic->setLength(TrimmedLength);
+            ++NumShortened;
+            MadeChange = true;
+          }
+        } else if (OR == OverwriteBegin && isa<MemSetInst>(DepWrite)) {
+          // Advance the start of a memset past the bytes written later.  Only
+          // do this if it keeps the memset's alignment, for the same reason
+          // as above.  A memcpy would need its source adjusted as well.
+          MemSetInst *DepMemSet = cast<MemSetInst>(DepWrite);
+          unsigned DepWriteAlign = DepMemSet->getAlignment();
+          uint64_t Shift = InstWriteOffset + Loc.Size - DepWriteOffset;
+          if (DepWriteAlign != 0 && Shift % DepWriteAlign == 0) {
+            DEBUG(dbgs() << "DSE: Remove Dead Store:\n  OW BEGIN: "
+                  << *DepWrite << "\n  KILLER (offset "
+                  << InstWriteOffset << ", " << Loc.Size << ")"
+                  << *Inst << '\n');
+
+            Value *DepWriteLength = DepMemSet->getLength();
+            Value *Offset = ConstantInt::get(DepWriteLength->getType(), Shift);
+            Value *NewDest =
+              GetElementPtrInst::CreateInBounds(DepMemSet->getRawDest(),
+                                                Offset, "", DepMemSet);
+            DepMemSet->setDest(NewDest);
+            DepMemSet->setLength(ConstantInt::get(DepWriteLength->getType(),
+                                                  DepLoc.Size - Shift));
+            ++NumShortened;
             MadeChange = true;
           }
         }
@@ -624,6 +679,119 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
   return MadeChange;
 }
 
+/// isOverwritingWrite - Return true if Inst writes all of Loc, the location
+/// written by Earlier, without reading it.
+static bool isOverwritingWrite(Instruction *Inst,
+                               const AliasAnalysis::Location &Loc,
+                               Instruction *Earlier, AliasAnalysis &AA) {
+  if (!hasMemoryWrite(Inst))
+    return false;
+  AliasAnalysis::Location InstLoc = getLocForWrite(Inst, AA);
+  if (InstLoc.Ptr == 0)
+    return false;
+  int64_t InstOffset, EarlierOffset;
+  if (isOverwrite(InstLoc, Loc, AA, EarlierOffset, InstOffset) !=
+      OverwriteComplete)
+    return false;
+  return !isPossibleSelfRead(Inst, InstLoc, Earlier, AA);
+}
+
+/// isOverwrittenOnAllPaths - Return true if Loc, which Inst writes, is
+/// overwritten on every path from Inst before anything can read it.  Paths
+/// that leave the function are fine only if Loc is in an alloca of this
+/// function that does not escape.  Give up after looking at
+/// NonLocalScanLimit instructions, or if a path loops back into a block that
+/// dominates Inst.
+bool DSE::isOverwrittenOnAllPaths(Instruction *Inst,
+                                  const AliasAnalysis::Location &Loc) {
+  const Value *Object = GetUnderlyingObject(Loc.Ptr, AA->getTargetData());
+  bool IsLocal = isa<AllocaInst>(Object) &&
+                 !PointerMayBeCaptured(Object, true, true);
+
+  unsigned Budget = NonLocalScanLimit;
+  SmallVector<BasicBlock*, 16> Worklist;
+  SmallPtrSet<BasicBlock*, 16> Visited;
+
+  BasicBlock *InstBB = Inst->getParent();
+  BasicBlock *BB = InstBB;
+  BasicBlock::iterator BBI = Inst;
+  ++BBI;
+  while (true) {
+    bool Overwritten = false;
+    for (BasicBlock::iterator BBE = BB->end(); BBI != BBE; ++BBI) {
+      if (Budget-- == 0)
+        return false;
+
+      if (isOverwritingWrite(BBI, Loc, Inst, *AA)) {
+        Overwritten = true;
+        break;
+      }
+
+      if (AA->getModRefInfo(BBI, Loc) & AliasAnalysis::Ref)
+        return false;
+
+      // If we unwind out of the function, the caller may read non-local
+      // memory.
+      if (!IsLocal && BBI->mayThrow())
+        return false;
+    }
+
+    if (!Overwritten) {
+      TerminatorInst *TI = BB->getTerminator();
+      if (TI->getNumSuccessors() == 0 && !IsLocal && !isa<UnreachableInst>(TI))
+        return false;
+      for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+        BasicBlock *Succ = TI->getSuccessor(i);
+        // Re-entering a block that dominates Inst, Inst's own block included,
+        // starts another iteration of a loop around Inst.  The values Loc is
+        // computed from may change there, e.g. a store to A[i] followed by a
+        // load of A[i-1] in the next iteration, so alias queries against Loc
+        // no longer describe the memory Inst wrote.
+        if (DT->dominates(Succ, InstBB))
+          return false;
+        if (Visited.insert(Succ))
+          Worklist.push_back(Succ);
+      }
+    }
+
+    if (Worklist.empty())
+      return true;
+    BB = Worklist.pop_back_val();
+    BBI = BB->begin();
+  }
+}
+
+/// handleNonLocalStores - Remove stores in BB that are overwritten in later
+/// blocks on every path before being read, e.g. a field initialized before a
+/// branch and then assigned on both sides of it.
+bool DSE::handleNonLocalStores(BasicBlock &BB) {
+  bool MadeChange = false;
+
+  for (BasicBlock::iterator BBI = BB.begin(), BBE = BB.end(); BBI != BBE; ) {
+    Instruction *Inst = BBI++;
+    if (!hasMemoryWrite(Inst) || !isRemovable(Inst))
+      continue;
+
+    AliasAnalysis::Location Loc = getLocForWrite(Inst, *AA);
+    if (Loc.Ptr == 0 || Loc.Size == AliasAnalysis::UnknownSize)
+      continue;
+
+    if (!isOverwrittenOnAllPaths(Inst, Loc))
+      continue;
+
+    DEBUG(dbgs() << "DSE: Remove Store Overwritten In Later Blocks:\n  DEAD: "
+                 << *Inst << '\n');
+
+    // This can also delete instructions computing the stored value and the
+    // address, but those all come before Inst.
+    DeleteDeadInstruction(Inst, *MD);
+    ++NumNonLocalStores;
+    MadeChange = true;
+  }
+
+  return MadeChange;
+}
+
 /// Find all blocks that will unconditionally lead to the block BB and append
 /// them to F.
 static void FindUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
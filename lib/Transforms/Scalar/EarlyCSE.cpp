@@ -16,11 +16,13 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Instructions.h"
 #include "llvm/Pass.h"
+#include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/RecyclingAllocator.h"
 #include "llvm/ADT/ScopedHashTable.h"
@@ -31,9 +33,18 @@ using namespace llvm;
 STATISTIC(NumSimplify, "Number of instructions simplified or DCE'd");
 STATISTIC(NumCSE,      "Number of instructions CSE'd");
 STATISTIC(NumCSELoad,  "Number of load instructions CSE'd");
+STATISTIC(NumCSELoadAA, "Number of loads CSE'd across non-aliasing writes");
 STATISTIC(NumCSECall,  "Number of call instructions CSE'd");
 STATISTIC(NumDSE,      "Number of trivial dead stores removed");
 
+// The number of memory writes a load may look back across when asking alias
+// analysis whether an older available value is still valid.  This keeps the
+// pass linear in the size of the function.
+static cl::opt<unsigned>
+ClobberLookback("early-cse-clobber-lookback", cl::init(8), cl::Hidden,
+  cl::desc("Max number of writes to check with alias analysis when reusing "
+           "an available load in EarlyCSE"));
+
 static unsigned getHash(const void *V) {
   return DenseMapInfo<const void*>::getHashValue(V);
 }
@@ -219,6 +230,7 @@ public:
   const TargetData *TD;
   const TargetLibraryInfo *TLI;
   DominatorTree *DT;
+  AliasAnalysis *AA;
   typedef RecyclingAllocator<BumpPtrAllocator,
                       ScopedHashTableVal<SimpleValue, Value*> > AllocatorTy;
   typedef ScopedHashTable<SimpleValue, Value*, DenseMapInfo<SimpleValue>,
@@ -251,6 +263,13 @@ public:
   
   /// CurrentGeneration - This is the current generation of the memory value.
   unsigned CurrentGeneration;
+
+  /// GenerationClobbers - For the dominator tree path being processed, entry
+  /// G is the instruction that moved the generation from G to G+1, or null if
+  /// the generation changed because of a control flow merge.  Generations are
+  /// only unique along one path, so the entries past CurrentGeneration are
+  /// overwritten when the walk moves to a sibling subtree.
+  std::vector<Instruction*> GenerationClobbers;
   
   static char ID;
   explicit EarlyCSE() : FunctionPass(ID) {
@@ -326,11 +345,24 @@ private:
   };
 
   bool processNode(DomTreeNode *Node);
+
+  /// bumpGeneration - Start a new memory generation because of Clobber, or
+  /// because of an unknown write if Clobber is null.
+  void bumpGeneration(Instruction *Clobber) {
+    GenerationClobbers.resize(CurrentGeneration);
+    GenerationClobbers.push_back(Clobber);
+    ++CurrentGeneration;
+  }
+
+  /// isLoadAvailable - Return true if the memory loaded by LI still holds the
+  /// value made available in generation Gen.
+  bool isLoadAvailable(LoadInst *LI, unsigned Gen);
   
   // This transformation requires dominator postdominator info
   virtual void getAnalysisUsage(AnalysisUsage &AU) const {
     AU.addRequired<DominatorTree>();
     AU.addRequired<TargetLibraryInfo>();
+    AU.addRequired<AliasAnalysis>();
     AU.setPreservesCFG();
   }
 };
@@ -346,8 +378,25 @@ FunctionPass *llvm::createEarlyCSEPass() {
 INITIALIZE_PASS_BEGIN(EarlyCSE, "early-cse", "Early CSE", false, false)
 INITIALIZE_PASS_DEPENDENCY(DominatorTree)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfo)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(EarlyCSE, "early-cse", "Early CSE", false, false)
 
+bool EarlyCSE::isLoadAvailable(LoadInst *LI, unsigned Gen) {
+  if (Gen == CurrentGeneration)
+    return true;
+  assert(Gen < CurrentGeneration && "Available load from a later generation?");
+  if (CurrentGeneration - Gen > ClobberLookback)
+    return false;
+
+  AliasAnalysis::Location Loc = AA->getLocation(LI);
+  for (unsigned G = Gen; G != CurrentGeneration; ++G) {
+    Instruction *Clobber = GenerationClobbers[G];
+    if (Clobber == 0 || (AA->getModRefInfo(Clobber, Loc) & AliasAnalysis::Mod))
+      return false;
+  }
+  return true;
+}
+
 bool EarlyCSE::processNode(DomTreeNode *Node) {
   BasicBlock *BB = Node->getBlock();
   
@@ -358,13 +407,14 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
   // just be conservative and invalidate memory if this block has multiple
   // predecessors.
   if (BB->getSinglePredecessor() == 0)
-    ++CurrentGeneration;
+    bumpGeneration(0);
   
   /// LastStore - Keep track of the last non-volatile store that we saw... for
   /// as long as there in no instruction that reads memory.  If we see a store
   /// to the same location, we delete the dead store.  This zaps trivial dead
   /// stores which can occur in bitfield code among other things.
   StoreInst *LastStore = 0;
+  unsigned LastStoreGeneration = 0;
   
   bool Changed = false;
 
@@ -419,16 +469,19 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
       }
       
       // If we have an available version of this load, and if it is the right
-      // generation, replace this instruction.
+      // generation, or nothing written since then may alias it, replace this
+      // instruction.
       std::pair<Value*, unsigned> InVal =
         AvailableLoads->lookup(Inst->getOperand(0));
-      if (InVal.first != 0 && InVal.second == CurrentGeneration) {
+      if (InVal.first != 0 && isLoadAvailable(LI, InVal.second)) {
         DEBUG(dbgs() << "EarlyCSE CSE LOAD: " << *Inst << "  to: "
               << *InVal.first << '\n');
         if (!Inst->use_empty()) Inst->replaceAllUsesWith(InVal.first);
         Inst->eraseFromParent();
         Changed = true;
         ++NumCSELoad;
+        if (InVal.second != CurrentGeneration)
+          ++NumCSELoadAA;
         continue;
       }
       
@@ -468,7 +521,7 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
     // something that could modify memory.  If so, our available memory values
     // cannot be used so bump the generation count.
     if (Inst->mayWriteToMemory()) {
-      ++CurrentGeneration;
+      bumpGeneration(Inst);
      
       if (StoreInst *SI = dyn_cast<StoreInst>(Inst)) {
         // We do a trivial form of DSE if there are two stores to the same
@@ -477,6 +530,9 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
             LastStore->getPointerOperand() == SI->getPointerOperand()) {
           DEBUG(dbgs() << "EarlyCSE DEAD STORE: " << *LastStore << "  due to: "
                        << *Inst << '\n');
+          // SI writes everything LastStore wrote, so it can stand in for it
+          // as the clobber of its generation.
+          GenerationClobbers[LastStoreGeneration] = SI;
           LastStore->eraseFromParent();
           Changed = true;
           ++NumDSE;
@@ -493,8 +549,10 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
          std::pair<Value*, unsigned>(SI->getValueOperand(), CurrentGeneration));
         
         // Remember that this was the last store we saw for DSE.
-        if (SI->isSimple())
+        if (SI->isSimple()) {
           LastStore = SI;
+          LastStoreGeneration = CurrentGeneration - 1;
+        }
       }
     }
   }
@@ -509,6 +567,7 @@ bool EarlyCSE::runOnFunction(Function &F) {
   TD = getAnalysisIfAvailable<TargetData>();
   TLI = &getAnalysis<TargetLibraryInfo>();
   DT = &getAnalysis<DominatorTree>();
+  AA = &getAnalysis<AliasAnalysis>();
   
   // Tables that the pass uses when walking the domtree.
   ScopedHTType AVTable;
@@ -519,6 +578,7 @@ bool EarlyCSE::runOnFunction(Function &F) {
   AvailableCalls = &CallTable;
   
   CurrentGeneration = 0;
+  GenerationClobbers.clear();
   bool Changed = false;
 
   // Process the root node.
@@ -39,6 +39,7 @@
 #include "llvm/LLVMContext.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AliasSetTracker.h"
+#include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -61,6 +62,8 @@ STATISTIC(NumHoisted   , "Number of instructions hoisted out of loop");
 STATISTIC(NumMovedLoads, "Number of load insts hoisted or sunk");
 STATISTIC(NumMovedCalls, "Number of call insts hoisted or sunk");
 STATISTIC(NumPromoted  , "Number of memory locations promoted to registers");
+STATISTIC(NumPromotedLocal, "Number of conditionally stored, non-escaping "
+                            "allocas promoted to registers");
 
 static cl::opt<bool>
 DisablePromotion("disable-licm-promotion", cl::Hidden,
@@ -626,6 +629,27 @@ bool LICM::isGuaranteedToExecute(Instruction &Inst) {
   return true;
 }
 
+/// isThreadLocalPromotable - Return true if Ptr points into a non-escaping
+/// alloca, and the access through Ptr stays within the alloca.  Such a
+/// location can always be loaded from, and no other thread can observe a
+/// store to it, so it may be promoted even if the stores to it in the loop are
+/// conditional.
+static bool isThreadLocalPromotable(Value *Ptr, const TargetData *TD) {
+  AllocaInst *AI = dyn_cast<AllocaInst>(Ptr->stripPointerCasts());
+  if (AI == 0 || AI->isArrayAllocation())
+    return false;
+
+  Type *AccessTy = cast<PointerType>(Ptr->getType())->getElementType();
+  Type *AllocTy = AI->getAllocatedType();
+  if (AccessTy != AllocTy &&
+      (TD == 0 || !AccessTy->isSized() ||
+       TD->getTypeStoreSize(AccessTy) > TD->getTypeAllocSize(AllocTy)))
+    return false;
+
+  return !PointerMayBeCaptured(AI, /*ReturnCaptures=*/true,
+                               /*StoreCaptures=*/true);
+}
+
 namespace {
   class LoopPromoter : public LoadAndStorePromoter {
     Value *SomePtr;  // Designated pointer to store to.
@@ -708,7 +732,10 @@ void LICM::PromoteAliasSet(AliasSet &AS) {
   // is not safe, because *P may only be valid to access if 'c' is true.
   //
   // It is safe to promote P if all uses are direct load/stores and if at
-  // least one is guaranteed to be executed.
+  // least one is guaranteed to be executed.  If P is a non-escaping alloca,
+  // the promotion is safe anyway: the load cannot trap, and the store
+  // inserted on paths that did not store writes back the value that was
+  // already there, which no other thread can see.
   bool GuaranteedToExecute = false;
 
   SmallVector<Instruction*, 64> LoopUses;
@@ -779,9 +806,16 @@ void LICM::PromoteAliasSet(AliasSet &AS) {
     }
   }
 
-  // If there isn't a guaranteed-to-execute instruction, we can't promote.
-  if (!GuaranteedToExecute)
-    return;
+  // If there isn't a guaranteed-to-execute instruction, we can only promote
+  // a thread-local location.  Use the alignment of the alloca, since no store
+  // told us better.
+  if (!GuaranteedToExecute) {
+    if (!isThreadLocalPromotable(SomePtr, TD))
+      return;
+    if (SomePtr == SomePtr->stripPointerCasts())
+      Alignment = cast<AllocaInst>(SomePtr)->getAlignment();
+    ++NumPromotedLocal;
+  }
 
   // Otherwise, this is safe to promote, lets do it!
   DEBUG(dbgs() << "LICM: Promoting value stored to in loop: " <<*SomePtr<<'\n');
@@ -19,7 +19,10 @@
 //
 // This can increase the size of the code exponentially (doubling it every time
 // a loop is unswitched) so we only unswitch if the resultant code will be
-// smaller than a threshold.
+// smaller than a threshold.  The cloned loop only gets the blocks that are
+// still reachable once the condition is known, the growth of each function is
+// limited by a budget proportional to its size, and conditions that are rarely
+// executed within the loop are left alone.
 //
 // This pass expects LICM to be run before it to hoist invariant conditions out
 // of the loop, to make the unswitching opportunity obvious.
@@ -32,9 +35,12 @@
 #include "llvm/DerivedTypes.h"
 #include "llvm/Function.h"
 #include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
 #include "llvm/Analysis/CodeMetrics.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/ScalarEvolution.h"
@@ -44,6 +50,8 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/BlockFrequency.h"
+#include "llvm/Support/BranchProbability.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
@@ -58,6 +66,10 @@ STATISTIC(NumSelects , "Number of selects unswitched");
 STATISTIC(NumTrivial , "Number of unswitches that are trivial");
 STATISTIC(NumSimplify, "Number of simplifications of unswitched code");
 STATISTIC(TotalInsts,  "Total number of instructions analyzed");
+STATISTIC(NumPartial , "Number of unswitches that cloned part of the loop");
+STATISTIC(NumCold    , "Number of conditions too rarely executed to unswitch");
+STATISTIC(NumBudget  , "Number of unswitches rejected by the growth budget");
+STATISTIC(TotalGrowth, "Number of instructions added by unswitching");
 
 // The specific value of 100 here was chosen based only on intuition and a
 // few specific examples.
@@ -65,6 +77,29 @@ static cl::opt<unsigned>
 Threshold("loop-unswitch-threshold", cl::desc("Max loop size to unswitch"),
           cl::init(100), cl::Hidden);
 
+static cl::opt<unsigned>
+FunctionGrowth("loop-unswitch-function-growth",
+               cl::desc("Max growth of a function through unswitching, as a "
+                        "percentage of its size"),
+               cl::init(100), cl::Hidden);
+
+static cl::opt<unsigned>
+ColdRatio("loop-unswitch-cold-ratio",
+          cl::desc("Don't unswitch conditions that are executed less than "
+                   "once every N loop iterations (0 = no limit)"),
+          cl::init(100), cl::Hidden);
+
+static cl::opt<bool>
+TrivialOnly("loop-unswitch-trivial-only",
+            cl::desc("Only unswitch conditions that don't duplicate code"),
+            cl::init(false), cl::Hidden);
+
+static cl::opt<bool>
+PartialUnswitch("loop-unswitch-partial",
+                cl::desc("Only clone the blocks of the loop that are "
+                         "reachable in the unswitched version"),
+                cl::init(true), cl::Hidden);
+
 namespace {
 
   class LUAnalysisCache {
@@ -134,6 +169,11 @@ namespace {
     bool OptimizeForSize;
     bool redoLoop;
 
+    // GrowthBudget - The number of instructions that unswitching may still add
+    // to BudgetFn.
+    Function *BudgetFn;
+    unsigned GrowthBudget;
+
     Loop *currentLoop;
     DominatorTree *DT;
     BasicBlock *loopHeader;
@@ -150,6 +190,7 @@ namespace {
     static char ID; // Pass ID, replacement for typeid
     explicit LoopUnswitch(bool Os = false) :
       LoopPass(ID), OptimizeForSize(Os), redoLoop(false),
+      BudgetFn(NULL), GrowthBudget(0),
       currentLoop(NULL), DT(NULL), loopHeader(NULL),
       loopPreheader(NULL) {
         initializeLoopUnswitchPass(*PassRegistry::getPassRegistry());
@@ -158,6 +199,11 @@ namespace {
     bool runOnLoop(Loop *L, LPPassManager &LPM);
     bool processCurrentLoop();
 
+    virtual bool doFinalization() {
+      BudgetFn = NULL;
+      return false;
+    }
+
     /// This transformation requires natural loop information & requires that
     /// loop preheaders be inserted into the CFG.
     ///
@@ -196,10 +242,13 @@ namespace {
     /// Update the appropriate Phi nodes as we do so.
     void SplitExitEdges(Loop *L, const SmallVector<BasicBlock *, 8> &ExitBlocks);
 
-    bool UnswitchIfProfitable(Value *LoopCond, Constant *Val);
+    bool UnswitchIfProfitable(Value *LoopCond, Constant *Val,
+                              Instruction *TI);
     void UnswitchTrivialCondition(Loop *L, Value *Cond, Constant *Val,
                                   BasicBlock *ExitBlock);
-    void UnswitchNontrivialCondition(Value *LIC, Constant *OnVal, Loop *L);
+    void UnswitchNontrivialCondition(Value *LIC, Constant *OnVal, Loop *L,
+                                 const SmallPtrSet<BasicBlock*, 16> &Cloned);
+    bool isColdInLoop(BasicBlock *BB);
 
     void RewriteLoopBodyWithConditionConstant(Loop *L, Value *LIC,
                                               Constant *Val, bool isEqual);
@@ -318,7 +367,10 @@ void LUAnalysisCache::cloneData(const Loop* NewLoop, const Loop* OldLoop,
     const SwitchInst* OldInst = I->first;
     Value* NewI = VMap.lookup(OldInst);
     const SwitchInst* NewInst = cast_or_null<SwitchInst>(NewI);
-    assert(NewInst && "All instructions that are in SrcBB must be in VMap.");
+    // Switches that were not cloned, or that were folded away in the clone,
+    // have no counterpart.
+    if (!NewInst)
+      continue;
 
     NewLoopProps.UnswitchedVals[NewInst] = OldLoopProps.UnswitchedVals[OldInst];
   }
@@ -380,6 +432,16 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
   currentLoop = L;
   Function *F = currentLoop->getHeader()->getParent();
   bool Changed = false;
+
+  // Unswitching may grow each function by a fixed fraction of its size, but
+  // small functions always get at least the per-loop threshold.
+  if (F != BudgetFn) {
+    CodeMetrics Metrics;
+    Metrics.analyzeFunction(F);
+    BudgetFn = F;
+    GrowthBudget = std::max<uint64_t>(Threshold, (uint64_t)Metrics.NumInsts *
+                                                 FunctionGrowth / 100);
+  }
   do {
     assert(currentLoop->isLCSSAForm(*DT));
     redoLoop = false;
@@ -435,7 +497,8 @@ bool LoopUnswitch::processCurrentLoop() {
         Value *LoopCond = FindLIVLoopCondition(BI->getCondition(),
                                                currentLoop, Changed);
         if (LoopCond && UnswitchIfProfitable(LoopCond,
-                                             ConstantInt::getTrue(Context))) {
+                                             ConstantInt::getTrue(Context),
+                                             BI)) {
           ++NumBranches;
           return true;
         }
@@ -465,7 +528,7 @@ bool LoopUnswitch::processCurrentLoop() {
         if (!UnswitchVal)
           continue;
 
-        if (UnswitchIfProfitable(LoopCond, UnswitchVal)) {
+        if (UnswitchIfProfitable(LoopCond, UnswitchVal, SI)) {
           ++NumSwitches;
           return true;
         }
@@ -479,7 +542,8 @@ bool LoopUnswitch::processCurrentLoop() {
         Value *LoopCond = FindLIVLoopCondition(SI->getCondition(),
                                                currentLoop, Changed);
         if (LoopCond && UnswitchIfProfitable(LoopCond,
-                                             ConstantInt::getTrue(Context))) {
+                                             ConstantInt::getTrue(Context),
+                                             SI)) {
           ++NumSelects;
           return true;
         }
@@ -620,10 +684,189 @@ bool LoopUnswitch::IsTrivialUnswitchCondition(Value *Cond, Constant **Val,
   return true;
 }
 
+/// getBranchWeights - Fill in the relative weights of the successors of TI
+/// from its branch weight metadata.  Without metadata, edges that leave L are
+/// predicted not taken, using the same weights as BranchProbabilityInfo's
+/// loop branch heuristic, so that loop guards and early exits don't make the
+/// rest of the body look cold.
+static void getBranchWeights(TerminatorInst *TI, const Loop *L,
+                             SmallVectorImpl<uint32_t> &Weights) {
+  // Loop branch heuristic weights from BranchProbabilityInfo.
+  const uint32_t LBH_TAKEN_WEIGHT = 124;
+  const uint32_t LBH_NONTAKEN_WEIGHT = 4;
+
+  unsigned NumSuccs = TI->getNumSuccessors();
+  Weights.resize(NumSuccs);
+
+  MDNode *WeightsNode = TI->getMetadata(LLVMContext::MD_prof);
+  MDString *Name = 0;
+  if (WeightsNode && WeightsNode->getNumOperands() == NumSuccs + 1)
+    Name = dyn_cast<MDString>(WeightsNode->getOperand(0));
+  if (Name && Name->getString() == "branch_weights") {
+    // Clamp the weights so that their sum fits in 32 bits.
+    uint32_t Limit = ~0U / NumSuccs;
+    unsigned i = 0;
+    for (; i != NumSuccs; ++i) {
+      ConstantInt *Weight =
+        dyn_cast<ConstantInt>(WeightsNode->getOperand(i+1));
+      if (!Weight)
+        break;
+      Weights[i] = std::max<uint32_t>(1, Weight->getLimitedValue(Limit));
+    }
+    if (i == NumSuccs)
+      return;
+  }
+
+  for (unsigned i = 0; i != NumSuccs; ++i)
+    Weights[i] = L->contains(TI->getSuccessor(i)) ? LBH_TAKEN_WEIGHT
+                                                  : LBH_NONTAKEN_WEIGHT;
+}
+
+/// isColdInLoop - Return true if BB is estimated to execute less than once
+/// every ColdRatio iterations of the current loop.  Frequencies are propagated
+/// from the header along the forward edges of the loop body, so a block in a
+/// subloop counts once per entry into that subloop.
+bool LoopUnswitch::isColdInLoop(BasicBlock *BB) {
+  if (!ColdRatio || BB == loopHeader)
+    return false;
+
+  LoopBlocksDFS DFS(currentLoop);
+  DFS.perform(LI);
+
+  const uint64_t HeaderFreq = 1 << 20;
+  DenseMap<BasicBlock*, BlockFrequency> Freq;
+  Freq[loopHeader] = HeaderFreq;
+  SmallVector<uint32_t, 4> Weights;
+  for (LoopBlocksDFS::RPOIterator I = DFS.beginRPO(), E = DFS.endRPO();
+       I != E && *I != BB; ++I) {
+    BasicBlock *Block = *I;
+    BlockFrequency BlockFreq = Freq.lookup(Block);
+    if (!BlockFreq.getFrequency())
+      continue;
+
+    TerminatorInst *TI = Block->getTerminator();
+    getBranchWeights(TI, currentLoop, Weights);
+    uint32_t Total = 0;
+    for (unsigned i = 0, e = Weights.size(); i != e; ++i)
+      Total += Weights[i];
+
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+      // Exits and back edges end the iteration.
+      BasicBlock *Succ = TI->getSuccessor(i);
+      if (!currentLoop->contains(Succ) ||
+          DFS.getPostorder(Succ) >= DFS.getPostorder(Block))
+        continue;
+      Freq[Succ] += BlockFreq * BranchProbability(Weights[i], Total);
+    }
+  }
+
+  return Freq.lookup(BB).getFrequency() * ColdRatio < HeaderFreq;
+}
+
+/// getLiveSuccessor - If TI branches on LIC, return the successor that it
+/// takes when LIC == Val, otherwise return null.
+static BasicBlock *getLiveSuccessor(TerminatorInst *TI, Value *LIC,
+                                    Constant *Val) {
+  ConstantInt *CI = dyn_cast<ConstantInt>(Val);
+  if (!CI)
+    return 0;
+  if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+    if (BI->isConditional() && BI->getCondition() == LIC)
+      return BI->getSuccessor(CI->isZero());
+  } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+    if (SI->getCondition() == LIC)
+      return SI->findCaseValue(CI).getCaseSuccessor();
+  }
+  return 0;
+}
+
+/// isLiveEdge - Return true if the edge from BB to Succ can still be taken
+/// when LIC == Val.
+static bool isLiveEdge(BasicBlock *BB, BasicBlock *Succ, Value *LIC,
+                       Constant *Val) {
+  BasicBlock *LiveSucc = getLiveSuccessor(BB->getTerminator(), LIC, Val);
+  return !LiveSucc || LiveSucc == Succ;
+}
+
+/// KeepsLoopForm - Return true if the blocks of L that are in Cloned still
+/// form a loop with the same header and latch once LIC == Val: every one of
+/// them has to reach the back edge, and each subloop has to either keep its
+/// own form or be dropped entirely.
+static bool KeepsLoopForm(Loop *L, const SmallPtrSet<BasicBlock*, 16> &Cloned,
+                          Value *LIC, Constant *Val) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch || !Cloned.count(Latch) ||
+      !isLiveEdge(Latch, L->getHeader(), LIC, Val))
+    return false;
+
+  SmallPtrSet<BasicBlock*, 16> ReachesLatch;
+  SmallVector<BasicBlock*, 16> Worklist;
+  ReachesLatch.insert(Latch);
+  Worklist.push_back(Latch);
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE; ++PI)
+      if (L->contains(*PI) && Cloned.count(*PI) &&
+          isLiveEdge(*PI, BB, LIC, Val) && ReachesLatch.insert(*PI))
+        Worklist.push_back(*PI);
+  }
+
+  unsigned NumCloned = 0;
+  for (Loop::block_iterator I = L->block_begin(), E = L->block_end();
+       I != E; ++I)
+    NumCloned += Cloned.count(*I);
+  if (NumCloned != ReachesLatch.size())
+    return false;
+
+  for (Loop::iterator I = L->begin(), E = L->end(); I != E; ++I) {
+    Loop *SubLoop = *I;
+    if (!Cloned.count(SubLoop->getHeader())) {
+      for (Loop::block_iterator BI = SubLoop->block_begin(),
+             BE = SubLoop->block_end(); BI != BE; ++BI)
+        if (Cloned.count(*BI))
+          return false;
+      continue;
+    }
+    if (!KeepsLoopForm(SubLoop, Cloned, LIC, Val))
+      return false;
+  }
+  return true;
+}
+
+/// ComputeClonedBlocks - Collect the blocks of L that are still reachable
+/// from its header when LIC == Val.  These are all that the version of the
+/// loop for LIC == Val needs.  Cloned is left empty if this is the whole loop,
+/// or if the remaining blocks would not form a loop of their own.
+static void ComputeClonedBlocks(Loop *L, Value *LIC, Constant *Val,
+                                SmallPtrSet<BasicBlock*, 16> &Cloned) {
+  SmallVector<BasicBlock*, 16> Worklist;
+  Cloned.insert(L->getHeader());
+  Worklist.push_back(L->getHeader());
+  while (!Worklist.empty()) {
+    TerminatorInst *TI = Worklist.pop_back_val()->getTerminator();
+    if (BasicBlock *Succ = getLiveSuccessor(TI, LIC, Val)) {
+      if (L->contains(Succ) && Cloned.insert(Succ))
+        Worklist.push_back(Succ);
+      continue;
+    }
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+      BasicBlock *Succ = TI->getSuccessor(i);
+      if (L->contains(Succ) && Cloned.insert(Succ))
+        Worklist.push_back(Succ);
+    }
+  }
+
+  if (Cloned.size() == L->getNumBlocks() ||
+      !KeepsLoopForm(L, Cloned, LIC, Val))
+    Cloned.clear();
+}
+
 /// UnswitchIfProfitable - We have found that we can unswitch currentLoop when
 /// LoopCond == Val to simplify the loop.  If we decide that this is profitable,
-/// unswitch the loop, reprocess the pieces, then return true.
-bool LoopUnswitch::UnswitchIfProfitable(Value *LoopCond, Constant *Val) {
+/// unswitch the loop, reprocess the pieces, then return true.  TI is the
+/// instruction that uses the condition.
+bool LoopUnswitch::UnswitchIfProfitable(Value *LoopCond, Constant *Val,
+                                        Instruction *TI) {
   Function *F = loopHeader->getParent();
   Constant *CondVal = 0;
   BasicBlock *ExitBlock = 0;
@@ -638,15 +881,48 @@ bool LoopUnswitch::UnswitchIfProfitable(Value *LoopCond, Constant *Val) {
   // Check to see if it would be profitable to unswitch current loop.
 
   // Do not do non-trivial unswitch while optimizing for size.
-  if (OptimizeForSize || F->hasFnAttr(Attribute::OptimizeForSize))
+  if (OptimizeForSize || TrivialOnly ||
+      F->hasFnAttr(Attribute::OptimizeForSize))
+    return false;
+
+  // Removing a branch that is rarely executed does not pay for the copy.
+  if (isColdInLoop(TI->getParent())) {
+    DEBUG(dbgs() << "NOT unswitching loop %" << loopHeader->getName()
+          << ", condition in %" << TI->getParent()->getName()
+          << " is rarely executed\n");
+    ++NumCold;
+    return false;
+  }
+
+  SmallPtrSet<BasicBlock*, 16> Cloned;
+  if (PartialUnswitch)
+    ComputeClonedBlocks(currentLoop, LoopCond, Val, Cloned);
+
+  CodeMetrics Metrics;
+  for (Loop::block_iterator I = currentLoop->block_begin(),
+         E = currentLoop->block_end(); I != E; ++I)
+    if (Cloned.empty() || Cloned.count(*I))
+      Metrics.analyzeBasicBlock(*I);
+
+  if (Metrics.NumInsts > GrowthBudget) {
+    DEBUG(dbgs() << "NOT unswitching loop %" << loopHeader->getName()
+          << ", growth of " << Metrics.NumInsts << " exceeds the budget of "
+          << GrowthBudget << " left in function " << F->getName() << "\n");
+    ++NumBudget;
     return false;
+  }
+  GrowthBudget -= Metrics.NumInsts;
+  TotalGrowth += Metrics.NumInsts;
+  if (!Cloned.empty())
+    ++NumPartial;
 
-  UnswitchNontrivialCondition(LoopCond, Val, currentLoop);
+  UnswitchNontrivialCondition(LoopCond, Val, currentLoop, Cloned);
   return true;
 }
 
 /// CloneLoop - Recursively clone the specified loop and all of its children,
-/// mapping the blocks with the specified map.
+/// mapping the blocks with the specified map.  Blocks and subloops that have
+/// not been cloned are left out.
 static Loop *CloneLoop(Loop *L, Loop *PL, ValueToValueMapTy &VM,
                        LoopInfo *LI, LPPassManager *LPM) {
   Loop *New = new Loop();
@@ -656,11 +932,13 @@ static Loop *CloneLoop(Loop *L, Loop *PL, ValueToValueMapTy &VM,
   for (Loop::block_iterator I = L->block_begin(), E = L->block_end();
        I != E; ++I)
     if (LI->getLoopFor(*I) == L)
-      New->addBasicBlockToLoop(cast<BasicBlock>(VM[*I]), LI->getBase());
+      if (Value *NewBB = VM.lookup(*I))
+        New->addBasicBlockToLoop(cast<BasicBlock>(NewBB), LI->getBase());
 
   // Add all of the subloops to the new loop.
   for (Loop::iterator I = L->begin(), E = L->end(); I != E; ++I)
-    CloneLoop(*I, New, VM, LI, LPM);
+    if (VM.lookup((*I)->getHeader()))
+      CloneLoop(*I, New, VM, LI, LPM);
 
   return New;
 }
@@ -759,11 +1037,36 @@ void LoopUnswitch::SplitExitEdges(Loop *L,
   }
 }
 
+/// RemoveStalePHIEntries - Drop the incoming values of the PHI nodes in BB
+/// that belong to edges which do not exist (anymore).
+static void RemoveStalePHIEntries(BasicBlock *BB) {
+  if (!isa<PHINode>(BB->begin()))
+    return;
+
+  SmallVector<BasicBlock*, 8> Preds(pred_begin(BB), pred_end(BB));
+  for (BasicBlock::iterator I = BB->begin(); PHINode *PN = dyn_cast<PHINode>(I);
+       ++I) {
+    // A block that branches to BB along several edges has an entry for each.
+    SmallVector<BasicBlock*, 8> Edges(Preds);
+    for (unsigned i = PN->getNumIncomingValues(); i-- != 0; ) {
+      SmallVector<BasicBlock*, 8>::iterator Edge =
+        std::find(Edges.begin(), Edges.end(), PN->getIncomingBlock(i));
+      if (Edge != Edges.end())
+        Edges.erase(Edge);
+      else
+        PN->removeIncomingValue(i, /*DeletePHIIfEmpty=*/false);
+    }
+  }
+}
+
 /// UnswitchNontrivialCondition - We determined that the loop is profitable
 /// to unswitch when LIC equal Val.  Split it into loop versions and test the
 /// condition outside of either loop.  Return the loops created as Out1/Out2.
+/// If Cloned is not empty, the version for LIC == Val only gets those blocks
+/// of the loop, and the exit blocks that they still branch to.
 void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
-                                               Loop *L) {
+                                               Loop *L,
+                               const SmallPtrSet<BasicBlock*, 16> &Cloned) {
   Function *F = loopHeader->getParent();
   DEBUG(dbgs() << "loop-unswitch: Unswitching loop %"
         << loopHeader->getName() << " [" << L->getBlocks().size()
@@ -804,6 +1107,19 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
   NewBlocks.reserve(LoopBlocks.size());
   ValueToValueMapTy VMap;
   for (unsigned i = 0, e = LoopBlocks.size(); i != e; ++i) {
+    // Leave out the blocks that cannot execute when LIC == Val.
+    if (!Cloned.empty() && i != 0 && !Cloned.count(LoopBlocks[i])) {
+      if (L->contains(LoopBlocks[i]))
+        continue;
+      bool IsReached = false;
+      for (pred_iterator PI = pred_begin(LoopBlocks[i]),
+             PE = pred_end(LoopBlocks[i]); PI != PE && !IsReached; ++PI)
+        IsReached = Cloned.count(*PI) &&
+                    isLiveEdge(*PI, LoopBlocks[i], LIC, Val);
+      if (!IsReached)
+        continue;
+    }
+
     BasicBlock *NewBB = CloneBasicBlock(LoopBlocks[i], VMap, ".us", F);
 
     NewBlocks.push_back(NewBB);
@@ -811,6 +1127,24 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
     LPM->cloneBasicBlockSimpleAnalysis(LoopBlocks[i], NewBB, L);
   }
 
+  // The branches on LIC in a partial clone can only go one way.  Fold them
+  // before cloning the loop info, so that the unswitched switches are not
+  // recorded for the clone.
+  if (!Cloned.empty())
+    for (unsigned i = 0, e = LoopBlocks.size(); i != e; ++i) {
+      if (!Cloned.count(LoopBlocks[i]))
+        continue;
+      BasicBlock *Succ = getLiveSuccessor(LoopBlocks[i]->getTerminator(),
+                                          LIC, Val);
+      if (!Succ)
+        continue;
+      TerminatorInst *NewTI =
+        cast<BasicBlock>(VMap[LoopBlocks[i]])->getTerminator();
+      BranchInst::Create(cast<BasicBlock>(VMap[Succ]), NewTI);
+      LPM->deleteSimpleAnalysisValue(NewTI, L);
+      NewTI->eraseFromParent();
+    }
+
   // Splice the newly inserted blocks into the function right before the
   // original preheader.
   F->getBasicBlockList().splice(NewPreheader, F->getBasicBlockList(),
@@ -831,7 +1165,10 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
   }
 
   for (unsigned i = 0, e = ExitBlocks.size(); i != e; ++i) {
-    BasicBlock *NewExit = cast<BasicBlock>(VMap[ExitBlocks[i]]);
+    Value *NewExitVal = VMap.lookup(ExitBlocks[i]);
+    if (!NewExitVal)
+      continue;
+    BasicBlock *NewExit = cast<BasicBlock>(NewExitVal);
     // The new exit block should be in the same loop as the old one.
     if (Loop *ExitBBLoop = LI->getLoopFor(ExitBlocks[i]))
       ExitBBLoop->addBasicBlockToLoop(NewExit, LI->getBase());
@@ -871,6 +1208,11 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
            E = NewBlocks[i]->end(); I != E; ++I)
       RemapInstruction(I, VMap,RF_NoModuleLevelChanges|RF_IgnoreMissingEntries);
 
+  // PHI nodes still have entries for the edges that were not cloned.
+  if (!Cloned.empty())
+    for (unsigned i = 0, e = NewBlocks.size(); i != e; ++i)
+      RemoveStalePHIEntries(NewBlocks[i]);
+
   // Rewrite the original preheader to select between versions of the loop.
   BranchInst *OldBR = cast<BranchInst>(loopPreheader->getTerminator());
   assert(OldBR->isUnconditional() && OldBR->getSuccessor(0) == LoopBlocks[0] &&
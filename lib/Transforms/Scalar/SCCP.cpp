@@ -15,6 +15,11 @@
 //   * Proves values to be constant, and replaces them with constants
 //   * Proves conditional branches to be unconditional
 //
+// Given a code growth budget (-ipsccp-specialize-budget, off by default), the
+// interprocedural variant also clones functions that are called with the same
+// constant arguments from several call sites, so that those constants can be
+// propagated into the specialized copy.
+//
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "sccp"
@@ -25,10 +30,12 @@
 #include "llvm/Instructions.h"
 #include "llvm/Pass.h"
 #include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/InstVisitor.h"
@@ -48,6 +55,20 @@ STATISTIC(NumDeadBlocks , "Number of basic blocks unreachable");
 STATISTIC(IPNumInstRemoved, "Number of instructions removed by IPSCCP");
 STATISTIC(IPNumArgsElimed ,"Number of arguments constant propagated by IPSCCP");
 STATISTIC(IPNumGlobalConst, "Number of globals found to be constant by IPSCCP");
+STATISTIC(IPNumSpecialized, "Number of functions specialized by IPSCCP");
+
+// Specialization is off by default.  The budget is per module, so it can
+// double the size of a small one, and there is no runtime data yet showing
+// that the clones pay for that.
+static cl::opt<unsigned>
+SpecializeBudget("ipsccp-specialize-budget", cl::init(0), cl::Hidden,
+  cl::desc("Maximum number of instructions IPSCCP may add to a module by "
+           "cloning functions for constant arguments (0 = disable)"));
+
+static cl::opt<unsigned>
+SpecializeMinCallSites("ipsccp-specialize-min-calls", cl::init(2), cl::Hidden,
+  cl::desc("Minimum number of call sites that must share a constant argument "
+           "pattern for IPSCCP to specialize a function for it"));
 
 namespace {
 /// LatticeVal class - This class represents the different lattice values that
@@ -1692,9 +1713,10 @@ static bool AddressIsTaken(const GlobalValue *GV) {
   return false;
 }
 
-bool IPSCCP::runOnModule(Module &M) {
-  const TargetData *TD = getAnalysisIfAvailable<TargetData>();
-  const TargetLibraryInfo *TLI = &getAnalysis<TargetLibraryInfo>();
+/// RunIPSCCP - Solve the whole module and rewrite everything that was found
+/// to be constant.
+static bool RunIPSCCP(Module &M, const TargetData *TD,
+                      const TargetLibraryInfo *TLI) {
   SCCPSolver Solver(TD, TLI);
 
   // AddressTakenFunctions - This set keeps track of the address-taken functions
@@ -1944,3 +1966,210 @@ bool IPSCCP::runOnModule(Module &M) {
 
   return MadeChanges;
 }
+
+namespace {
+  /// ConstantArgs - The constant arguments a call site passes to a function,
+  /// as (argument number, constant) pairs in argument order.
+  typedef SmallVector<std::pair<unsigned, Constant*>, 4> ConstantArgs;
+
+  /// SpecializationCandidate - A set of call sites to a function that pass it
+  /// the same constant arguments.
+  struct SpecializationCandidate {
+    ConstantArgs Args;
+    SmallVector<CallSite, 4> Calls;
+  };
+}
+
+/// getFunctionSize - Return the number of instructions in F, the unit the
+/// specialization budget is measured in.
+static unsigned getFunctionSize(const Function &F) {
+  unsigned Size = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Size += BB->size();
+  return Size;
+}
+
+/// isSpecializable - Return true if F may be cloned for a set of its call
+/// sites.
+static bool isSpecializable(const Function &F) {
+  if (F.isDeclaration() || F.mayBeOverridden() || F.isVarArg())
+    return false;
+  if (F.hasFnAttr(Attribute::Naked) || F.hasFnAttr(Attribute::ReturnsTwice))
+    return false;
+  // Copies grow the code, which optsize functions ask us not to do, and act
+  // like a partial inlining of F's constants, which noinline forbids.
+  if (F.hasFnAttr(Attribute::NoInline) ||
+      F.hasFnAttr(Attribute::OptimizeForSize))
+    return false;
+  // Cloning would leave blockaddress constants pointing into the original.
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    if (BB->hasAddressTaken())
+      return false;
+  return true;
+}
+
+/// isFoldableUse - Return true if knowing that A is a constant lets U fold
+/// away: U branches on A, or all of U's other operands are constants.
+static bool isFoldableUse(const Argument *A, const User *U) {
+  if (const BranchInst *BI = dyn_cast<BranchInst>(U))
+    return BI->isConditional() && BI->getCondition() == A;
+  if (const SwitchInst *SI = dyn_cast<SwitchInst>(U))
+    return SI->getCondition() == A;
+  if (const SelectInst *SI = dyn_cast<SelectInst>(U))
+    return SI->getCondition() == A;
+  if (!isa<BinaryOperator>(U) && !isa<CmpInst>(U) && !isa<CastInst>(U))
+    return false;
+  for (User::const_op_iterator OI = U->op_begin(), OE = U->op_end();
+       OI != OE; ++OI)
+    if (*OI != A && !isa<Constant>(*OI))
+      return false;
+  return true;
+}
+
+/// isProfitableArg - Return true if specializing F for a constant value of A
+/// folds some of its code, rather than just copying F.
+static bool isProfitableArg(const Argument *A) {
+  if (A->hasByValAttr())
+    return false;
+  for (Value::const_use_iterator UI = A->use_begin(), UE = A->use_end();
+       UI != UE; ++UI)
+    if (isFoldableUse(A, *UI))
+      return true;
+  return false;
+}
+
+/// getConstantArgs - Collect the arguments that CS passes to F as constants
+/// and that fold some of F's code when known, as given by Profitable.
+static void getConstantArgs(CallSite CS,
+                            const SmallVectorImpl<bool> &Profitable,
+                            ConstantArgs &Args) {
+  for (unsigned i = 0, e = CS.arg_size(); i != e; ++i) {
+    Constant *C = dyn_cast<Constant>(CS.getArgument(i));
+    if (!C || !Profitable[i])
+      continue;
+    // Only constants that enable folding; undef and constant expressions
+    // are left to the normal lattice.
+    if (!isa<ConstantInt>(C) && !isa<ConstantFP>(C) &&
+        !isa<ConstantPointerNull>(C) && !isa<GlobalValue>(C))
+      continue;
+    Args.push_back(std::make_pair(i, C));
+  }
+}
+
+/// SpecializeFunctions - Clone functions for the constant argument patterns
+/// that are shared by the most call sites, within the code growth budget.
+/// The call sites are redirected to the clones, whose arguments are replaced
+/// by the constants; a following IPSCCP run propagates them.
+static bool SpecializeFunctions(Module &M) {
+  unsigned Budget = SpecializeBudget;
+  if (Budget == 0)
+    return false;
+
+  // Clones are added to the module as we go; only look at the functions that
+  // were there to begin with.
+  SmallVector<Function*, 32> Worklist;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (isSpecializable(*F))
+      Worklist.push_back(F);
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Worklist.size(); i != e && Budget; ++i) {
+    Function *F = Worklist[i];
+    unsigned Size = getFunctionSize(*F);
+    if (Size > Budget)
+      continue;
+
+    SmallVector<bool, 8> Profitable;
+    bool AnyProfitable = false;
+    for (Function::arg_iterator AI = F->arg_begin(), AE = F->arg_end();
+         AI != AE; ++AI) {
+      Profitable.push_back(isProfitableArg(AI));
+      AnyProfitable |= Profitable.back();
+    }
+    if (!AnyProfitable)
+      continue;
+
+    // Group the direct call sites by the constants they pass.  The number of
+    // distinct patterns is small in practice, so a linear search keeps the
+    // order, and thus the output, deterministic.
+    SmallVector<SpecializationCandidate, 4> Candidates;
+    for (Value::use_iterator UI = F->use_begin(), UE = F->use_end();
+         UI != UE; ++UI) {
+      CallSite CS(*UI);
+      if (!CS || !CS.isCallee(UI))
+        continue;
+      ConstantArgs Args;
+      getConstantArgs(CS, Profitable, Args);
+      if (Args.empty())
+        continue;
+
+      unsigned j = 0, je = Candidates.size();
+      while (j != je && Candidates[j].Args != Args)
+        ++j;
+      if (j == je) {
+        Candidates.push_back(SpecializationCandidate());
+        Candidates.back().Args = Args;
+      }
+      Candidates[j].Calls.push_back(CS);
+    }
+
+    // An internal function whose call sites all agree already had the
+    // constants propagated into it.
+    if (Candidates.size() == 1 && F->hasLocalLinkage() &&
+        Candidates[0].Calls.size() == F->getNumUses())
+      continue;
+
+    // Specialize for the most common patterns first.
+    while (!Candidates.empty() && Size <= Budget) {
+      unsigned Best = 0;
+      for (unsigned j = 1, je = Candidates.size(); j != je; ++j)
+        if (Candidates[j].Calls.size() > Candidates[Best].Calls.size())
+          Best = j;
+      if (Candidates[Best].Calls.size() < SpecializeMinCallSites)
+        break;
+
+      SpecializationCandidate &C = Candidates[Best];
+      ValueToValueMapTy VMap;
+      Function *Clone = CloneFunction(F, VMap, /*ModuleLevelChanges=*/false);
+      Clone->setLinkage(GlobalValue::InternalLinkage);
+      Clone->setVisibility(GlobalValue::DefaultVisibility);
+      Clone->setName(F->getName() + ".spec");
+      M.getFunctionList().push_back(Clone);
+
+      DEBUG(dbgs() << "IPSCCP: specializing '" << F->getName() << "' for "
+                   << C.Calls.size() << " call sites\n");
+
+      Function::arg_iterator AI = Clone->arg_begin();
+      unsigned ArgNo = 0;
+      for (unsigned k = 0, ke = C.Args.size(); k != ke; ++k) {
+        for (; ArgNo != C.Args[k].first; ++ArgNo)
+          ++AI;
+        AI->replaceAllUsesWith(C.Args[k].second);
+      }
+      for (unsigned k = 0, ke = C.Calls.size(); k != ke; ++k)
+        C.Calls[k].setCalledFunction(Clone);
+
+      Budget -= Size;
+      ++IPNumSpecialized;
+      Changed = true;
+      Candidates.erase(Candidates.begin() + Best);
+    }
+  }
+
+  return Changed;
+}
+
+bool IPSCCP::runOnModule(Module &M) {
+  const TargetData *TD = getAnalysisIfAvailable<TargetData>();
+  const TargetLibraryInfo *TLI = &getAnalysis<TargetLibraryInfo>();
+
+  // The first run turns the arguments of call sites that are constant into
+  // literal constants, which is what specialization keys on.  If any
+  // function was cloned, solve again to propagate into the clones.
+  bool MadeChanges = RunIPSCCP(M, TD, TLI);
+  if (SpecializeFunctions(M)) {
+    RunIPSCCP(M, TD, TLI);
+    MadeChanges = true;
+  }
+  return MadeChanges;
+}
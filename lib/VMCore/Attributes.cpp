@@ -46,6 +46,8 @@ std::string Attribute::getAsString(Attributes Attrs) {
     Result += "noalias ";
   if (Attrs & Attribute::NoCapture)
     Result += "nocapture ";
+  if (Attrs & Attribute::NonNull)
+    Result += "nonnull ";
   if (Attrs & Attribute::StructRet)
     Result += "sret ";
   if (Attrs & Attribute::ByVal)
@@ -103,7 +105,8 @@ Attributes Attribute::typeIncompatible(Type *Ty) {
   
   if (!Ty->isPointerTy())
     // Attributes that only apply to pointers.
-    Incompatible |= ByVal | Nest | NoAlias | StructRet | NoCapture;
+    Incompatible |= ByVal | Nest | NoAlias | StructRet | NoCapture | NonNull |
+      ReadNone | ReadOnly;
   
   return Incompatible;
 }
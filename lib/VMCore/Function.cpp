@@ -117,6 +117,20 @@ bool Argument::hasStructRetAttr() const {
   return getParent()->paramHasAttr(1, Attribute::StructRet);
 }
 
+/// hasNonNullAttr - Return true if this argument has the nonnull attribute on
+/// it in its containing function.
+bool Argument::hasNonNullAttr() const {
+  if (!getType()->isPointerTy()) return false;
+  return getParent()->paramHasAttr(getArgNo()+1, Attribute::NonNull);
+}
+
+/// onlyReadsMemory - Return true if this argument has the readonly or readnone
+/// attribute on it in its containing function.
+bool Argument::onlyReadsMemory() const {
+  if (!getType()->isPointerTy()) return false;
+  return getParent()->onlyReadsMemory(getArgNo()+1);
+}
+
 /// addAttr - Add a Attribute to an argument
 void Argument::addAttr(Attributes attr) {
   getParent()->addAttribute(getArgNo() + 1, attr);
@@ -390,7 +404,8 @@ enum IIT_Info {
   IIT_STRUCT5 = 21,
   IIT_EXTEND_VEC_ARG = 22,
   IIT_TRUNC_VEC_ARG = 23,
-  IIT_ANYPTR = 24
+  IIT_ANYPTR = 24,
+  IIT_VARARG = 25
 };
 
 
@@ -404,6 +419,9 @@ static void DecodeIITType(unsigned &NextElt, ArrayRef<unsigned char> Infos,
   case IIT_Done:
     OutputTable.push_back(IITDescriptor::get(IITDescriptor::Void, 0));
     return;
+  case IIT_VARARG:
+    OutputTable.push_back(IITDescriptor::get(IITDescriptor::VarArg, 0));
+    return;
   case IIT_MMX:
     OutputTable.push_back(IITDescriptor::get(IITDescriptor::MMX, 0));
     return;
@@ -541,7 +559,8 @@ static Type *DecodeFixedType(ArrayRef<Intrinsic::IITDescriptor> &Infos,
   Infos = Infos.slice(1);
   
   switch (D.Kind) {
-  case IITDescriptor::Void: return Type::getVoidTy(Context);
+  case IITDescriptor::Void:
+  case IITDescriptor::VarArg: return Type::getVoidTy(Context);
   case IITDescriptor::MMX: return Type::getX86_MMXTy(Context);
   case IITDescriptor::Metadata: return Type::getMetadataTy(Context);
   case IITDescriptor::Float: return Type::getFloatTy(Context);
@@ -586,10 +605,16 @@ FunctionType *Intrinsic::getType(LLVMContext &Context,
   Type *ResultTy = DecodeFixedType(TableRef, Tys, Context);
     
   SmallVector<Type*, 8> ArgTys;
-  while (!TableRef.empty())
+  bool IsVarArg = false;
+  while (!TableRef.empty()) {
+    if (TableRef.front().Kind == IITDescriptor::VarArg) {
+      IsVarArg = true;
+      break;
+    }
     ArgTys.push_back(DecodeFixedType(TableRef, Tys, Context));
+  }
 
-  return FunctionType::get(ResultTy, ArgTys, false); 
+  return FunctionType::get(ResultTy, ArgTys, IsVarArg);
 }
 
 bool Intrinsic::isOverloaded(ID id) {
@@ -534,7 +534,8 @@ void Verifier::VerifyParameterAttrs(Attributes Attrs, Type *Ty,
           " only applies to the function!", V);
 
   if (isReturnValue) {
-    Attributes RetI = Attrs & Attribute::ParameterOnly;
+    Attributes RetI = Attrs & (Attribute::ParameterOnly |
+                               Attribute::FunctionOrParameter);
     Assert1(!RetI, "Attribute " + Attribute::getAsString(RetI) +
             " does not apply to return values!", V);
   }
@@ -595,7 +596,8 @@ void Verifier::VerifyFunctionAttrs(FunctionType *FT,
   }
 
   Attributes FAttrs = Attrs.getFnAttributes();
-  Attributes NotFn = FAttrs & (~Attribute::FunctionOnly);
+  Attributes NotFn = FAttrs & ~(Attribute::FunctionOnly |
+                                Attribute::FunctionOrParameter);
   Assert1(!NotFn, "Attribute " + Attribute::getAsString(NotFn) +
           " does not apply to the function!", V);
 
@@ -1695,6 +1697,7 @@ bool Verifier::VerifyIntrinsicType(Type *Ty,
   
   switch (D.Kind) {
   case IITDescriptor::Void: return !Ty->isVoidTy();
+  case IITDescriptor::VarArg: return true;
   case IITDescriptor::MMX:  return !Ty->isX86_MMXTy();
   case IITDescriptor::Metadata: return !Ty->isMetadataTy();
   case IITDescriptor::Float: return !Ty->isFloatTy();
@@ -1768,7 +1771,6 @@ void Verifier::visitIntrinsicFunctionCall(Intrinsic::ID ID, CallInst &CI) {
   // Verify that the intrinsic prototype lines up with what the .td files
   // describe.
   FunctionType *IFTy = IF->getFunctionType();
-  Assert1(!IFTy->isVarArg(), "Intrinsic prototypes are not varargs", IF);
   
   SmallVector<Intrinsic::IITDescriptor, 8> Table;
   getIntrinsicInfoTableEntries(ID, Table);
@@ -1780,6 +1782,15 @@ void Verifier::visitIntrinsicFunctionCall(Intrinsic::ID ID, CallInst &CI) {
   for (unsigned i = 0, e = IFTy->getNumParams(); i != e; ++i)
     Assert1(!VerifyIntrinsicType(IFTy->getParamType(i), TableRef, ArgTys),
             "Intrinsic has incorrect argument type!", IF);
+
+  // Only intrinsics whose table ends in VarArg may have varargs prototypes.
+  bool IsVarArg = !TableRef.empty() &&
+    TableRef.front().Kind == Intrinsic::IITDescriptor::VarArg;
+  if (IsVarArg)
+    TableRef = TableRef.slice(1);
+  Assert1(IsVarArg == IFTy->isVarArg(),
+          IsVarArg ? "Intrinsic prototype must be varargs" :
+                     "Intrinsic prototypes are not varargs", IF);
   Assert1(TableRef.empty(), "Intrinsic has too few arguments!", IF);
 
   // Now that we have the intrinsic ID and the actual argument types (and we
@@ -1840,6 +1851,58 @@ void Verifier::visitIntrinsicFunctionCall(Intrinsic::ID ID, CallInst &CI) {
     Assert1(CI.getParent()->getParent()->hasGC(),
             "Enclosing function does not use GC.", &CI);
     break;
+  case Intrinsic::gc_statepoint: {
+    Assert1(CI.getParent()->getParent()->hasGC(),
+            "Enclosing function does not use GC.", &CI);
+    Assert1(isa<ConstantInt>(CI.getArgOperand(0)),
+            "llvm.gc.statepoint parameter #1 must be a constant.", &CI);
+    const ConstantInt *NumCallArgs = dyn_cast<ConstantInt>(CI.getArgOperand(2));
+    Assert1(NumCallArgs, "llvm.gc.statepoint parameter #3 must be a constant.",
+            &CI);
+    Assert1(NumCallArgs->getZExtValue() <= CI.getNumArgOperands() - 3,
+            "llvm.gc.statepoint has too few call arguments.", &CI);
+    for (unsigned i = 3 + NumCallArgs->getZExtValue(),
+           e = CI.getNumArgOperands(); i != e; ++i)
+      Assert1(CI.getArgOperand(i)->getType()->isPointerTy(),
+              "llvm.gc.statepoint gc pointers must have pointer type.", &CI);
+    for (Value::use_iterator UI = CI.use_begin(), UE = CI.use_end();
+         UI != UE; ++UI) {
+      const IntrinsicInst *User = dyn_cast<IntrinsicInst>(*UI);
+      Assert2(User && (User->getIntrinsicID() == Intrinsic::gc_relocate ||
+                       User->getIntrinsicID() == Intrinsic::gc_result_int ||
+                       User->getIntrinsicID() == Intrinsic::gc_result_float ||
+                       User->getIntrinsicID() == Intrinsic::gc_result_ptr),
+              "llvm.gc.statepoint may only be used by llvm.gc.relocate and "
+              "llvm.gc.result.", &CI, *UI);
+    }
+    break;
+  }
+  case Intrinsic::gc_result_int:
+  case Intrinsic::gc_result_float:
+  case Intrinsic::gc_result_ptr:
+  case Intrinsic::gc_relocate: {
+    const IntrinsicInst *Statepoint =
+      dyn_cast<IntrinsicInst>(CI.getArgOperand(0));
+    Assert1(Statepoint &&
+            Statepoint->getIntrinsicID() == Intrinsic::gc_statepoint,
+            "gc parameter #1 must be an llvm.gc.statepoint.", &CI);
+    if (ID != Intrinsic::gc_relocate)
+      break;
+
+    const ConstantInt *Index = dyn_cast<ConstantInt>(CI.getArgOperand(1));
+    Assert1(Index, "llvm.gc.relocate parameter #2 must be a constant.", &CI);
+    const ConstantInt *NumCallArgs =
+      dyn_cast<ConstantInt>(Statepoint->getArgOperand(2));
+    Assert1(NumCallArgs, "llvm.gc.statepoint parameter #3 must be a constant.",
+            Statepoint);
+    uint64_t GCArg = 3 + NumCallArgs->getZExtValue() + Index->getZExtValue();
+    Assert1(GCArg < Statepoint->getNumArgOperands(),
+            "llvm.gc.relocate index is out of range.", &CI);
+    Assert1(Statepoint->getArgOperand(GCArg)->getType() == CI.getType(),
+            "llvm.gc.relocate must have the type of the relocated pointer.",
+            &CI);
+    break;
+  }
   case Intrinsic::init_trampoline:
     Assert1(isa<Function>(CI.getArgOperand(1)->stripPointerCasts()),
             "llvm.init_trampoline parameter #2 must resolve to a function.",
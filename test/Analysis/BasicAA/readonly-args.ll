@@ -0,0 +1,41 @@
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+
+declare void @reader(i32* nocapture readonly)
+declare void @ignorer(i32* nocapture readnone)
+declare void @writer(i32* nocapture)
+
+; A call can not modify a local through a readonly argument.
+; CHECK: @test_readonly
+; CHECK: call void @reader
+; CHECK-NOT: load
+; CHECK: ret i32 1
+define i32 @test_readonly() {
+  %a = alloca i32
+  store i32 1, i32* %a
+  call void @reader(i32* %a)
+  %v = load i32* %a
+  ret i32 %v
+}
+
+; CHECK: @test_readnone
+; CHECK: call void @ignorer
+; CHECK-NOT: load
+; CHECK: ret i32 1
+define i32 @test_readnone() {
+  %a = alloca i32
+  store i32 1, i32* %a
+  call void @ignorer(i32* %a)
+  %v = load i32* %a
+  ret i32 %v
+}
+
+; CHECK: @test_writer
+; CHECK: call void @writer
+; CHECK: load i32* %a
+define i32 @test_writer() {
+  %a = alloca i32
+  store i32 1, i32* %a
+  call void @writer(i32* %a)
+  %v = load i32* %a
+  ret i32 %v
+}
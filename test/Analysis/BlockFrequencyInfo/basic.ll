@@ -7,7 +7,7 @@ entry:
   br label %body
 
 ; Loop backedges are weighted and thus their bodies have a greater frequency.
-; CHECK: body = 31744
+; CHECK: body = 32768
 body:
   %iv = phi i32 [ 0, %entry ], [ %next, %body ]
   %base = phi i32 [ 0, %entry ], [ %sum, %body ]
@@ -31,7 +31,7 @@ entry:
   br i1 %cond, label %then, label %else, !prof !0
 
 ; The 'then' branch is predicted more likely via branch weight metadata.
-; CHECK: then = 963
+; CHECK: then = 964
 then:
   br label %exit
 
@@ -39,8 +39,7 @@ then:
 else:
   br label %exit
 
-; FIXME: It may be a bug that we don't sum back to 1024.
-; CHECK: exit = 1023
+; CHECK: exit = 1024
 exit:
   %result = phi i32 [ %a, %then ], [ %b, %else ]
   ret i32 %result
@@ -78,8 +77,7 @@ case_d:
 case_e:
   br label %exit
 
-; FIXME: It may be a bug that we don't sum back to 1024.
-; CHECK: exit = 1023
+; CHECK: exit = 1024
 exit:
   %result = phi i32 [ %a, %case_a ],
                     [ %b, %case_b ],
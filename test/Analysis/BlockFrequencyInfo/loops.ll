@@ -0,0 +1,164 @@
+; RUN: opt < %s -analyze -block-freq | FileCheck %s
+
+define void @nested() {
+; CHECK: Printing analysis {{.*}} for function 'nested'
+; CHECK: {{^}} entry = 1024
+entry:
+  br label %outer
+
+; CHECK: {{^}} outer = 2048
+outer:
+  br label %inner
+
+; CHECK: {{^}} inner = 8192
+inner:
+  %c1 = call i1 @cond()
+  br i1 %c1, label %inner, label %latch, !prof !0
+
+; CHECK: {{^}} latch = 2048
+latch:
+  %c2 = call i1 @cond()
+  br i1 %c2, label %outer, label %exit, !prof !1
+
+; CHECK: {{^}} exit = 1024
+exit:
+  ret void
+}
+
+; Both exits of the loop together are taken once per entry.
+define void @multiexit() {
+; CHECK: Printing analysis {{.*}} for function 'multiexit'
+; CHECK: {{^}} entry = 1024
+entry:
+  br label %header
+
+; CHECK: {{^}} header = 2048
+header:
+  %c1 = call i1 @cond()
+  br i1 %c1, label %exit1, label %body, !prof !2
+
+; CHECK: {{^}} body = 1536
+body:
+  %c2 = call i1 @cond()
+  br i1 %c2, label %exit2, label %header, !prof !3
+
+; CHECK: {{^}} exit1 = 512
+exit1:
+  br label %join
+
+; CHECK: {{^}} exit2 = 512
+exit2:
+  br label %join
+
+; CHECK: {{^}} join = 1024
+join:
+  ret void
+}
+
+; The inner loop exits both to the outer latch and out of the outer loop.
+define void @deepexit() {
+; CHECK: Printing analysis {{.*}} for function 'deepexit'
+; CHECK: {{^}} entry = 1024
+entry:
+  br label %outer
+
+; CHECK: {{^}} outer = 2560
+outer:
+  br label %inner
+
+; CHECK: {{^}} inner = 4096
+inner:
+  %c1 = call i1 @cond()
+  br i1 %c1, label %inner.body, label %latch, !prof !1
+
+; CHECK: {{^}} inner.body = 2048
+inner.body:
+  %c2 = call i1 @cond()
+  br i1 %c2, label %inner, label %exit, !prof !0
+
+; CHECK: {{^}} latch = 2048
+latch:
+  %c3 = call i1 @cond()
+  br i1 %c3, label %outer, label %exit, !prof !0
+
+; CHECK: {{^}} exit = 1024
+exit:
+  ret void
+}
+
+; A loop without exits is assumed to run 4096 times.
+define void @infinite() {
+; CHECK: Printing analysis {{.*}} for function 'infinite'
+; CHECK: {{^}} entry = 1024
+entry:
+  br label %loop
+
+; CHECK: {{^}} loop = 4194304
+loop:
+  call i1 @cond()
+  br label %loop
+}
+
+; The hottest block of a deep nest of hot loops would not fit 64 bits, so all
+; frequencies are scaled down together.
+define void @deep() {
+; CHECK: Printing analysis {{.*}} for function 'deep'
+; CHECK: {{^}} entry = 4
+entry:
+  br label %l1
+
+; CHECK: {{^}} l1 = 4194304
+l1:
+  br label %l2
+
+; CHECK: {{^}} l2 = 4398046511104
+l2:
+  br label %l3
+
+; CHECK: {{^}} l3 = 4611686018427387904
+l3:
+  %c3 = call i1 @cond()
+  br i1 %c3, label %l3, label %l2.latch, !prof !4
+
+; CHECK: {{^}} l2.latch = 4398046511104
+l2.latch:
+  %c2 = call i1 @cond()
+  br i1 %c2, label %l2, label %l1.latch, !prof !4
+
+; CHECK: {{^}} l1.latch = 4194304
+l1.latch:
+  %c1 = call i1 @cond()
+  br i1 %c1, label %l1, label %exit, !prof !4
+
+; CHECK: {{^}} exit = 4
+exit:
+  ret void
+}
+
+; Irreducible control flow does not break the analysis.
+define void @irreducible() {
+; CHECK: Printing analysis {{.*}} for function 'irreducible'
+; CHECK: {{^}} entry = 1024
+entry:
+  %c0 = call i1 @cond()
+  br i1 %c0, label %a, label %b
+
+a:
+  %c1 = call i1 @cond()
+  br i1 %c1, label %b, label %exit
+
+b:
+  %c2 = call i1 @cond()
+  br i1 %c2, label %a, label %exit
+
+exit:
+  ret void
+}
+
+declare i1 @cond()
+
+!0 = metadata !{metadata !"branch_weights", i32 3, i32 1}
+!1 = metadata !{metadata !"branch_weights", i32 1, i32 1}
+!2 = metadata !{metadata !"branch_weights", i32 1, i32 3}
+!3 = metadata !{metadata !"branch_weights", i32 1, i32 2}
+!4 = metadata !{metadata !"branch_weights", i32 1048575, i32 1}
@@ -0,0 +1,174 @@
+; RUN: opt < %s -analyze -basicaa -lda | FileCheck %s
+
+@A = common global [32 x [32 x i32]] zeroinitializer, align 4
+@x = common global [256 x i32] zeroinitializer, align 4
+
+;; for (i = 0; i < 10; i++)
+;;   for (j = 0; j < 10; j++)
+;;     A[i+1][j] = A[i][j+1]
+
+define void @f1(...) nounwind {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %i.next = add i64 %i, 1
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add i64 %j, 1
+  %ld.addr = getelementptr [32 x [32 x i32]]* @A, i64 0, i64 %i, i64 %j.next
+  %st.addr = getelementptr [32 x [32 x i32]]* @A, i64 0, i64 %i.next, i64 %j
+  %v = load i32* %ld.addr     ; 0
+  store i32 %v, i32* %st.addr ; 1
+; CHECK: 0,1: dependent [-1 1]
+  %inner.exit = icmp eq i64 %j.next, 10
+  br i1 %inner.exit, label %outer.latch, label %inner
+
+outer.latch:
+  %outer.exit = icmp eq i64 %i.next, 10
+  br i1 %outer.exit, label %end, label %outer
+
+end:
+  ret void
+}
+
+;; for (i = 0; i < 10; i++)
+;;   for (j = 0; j < 10; j++)
+;;     x[10*i+j] = x[10*i+j+100]
+
+define void @f2(...) nounwind {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %i.next = add i64 %i, 1
+  %i.10 = mul i64 %i, 10
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add i64 %j, 1
+  %st.idx = add i64 %i.10, %j
+  %ld.idx = add i64 %st.idx, 100
+  %ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %ld.idx
+  %st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %st.idx
+  %v = load i32* %ld.addr     ; 0
+  store i32 %v, i32* %st.addr ; 1
+; CHECK: 0,1: independent
+  %inner.exit = icmp eq i64 %j.next, 10
+  br i1 %inner.exit, label %outer.latch, label %inner
+
+outer.latch:
+  %outer.exit = icmp eq i64 %i.next, 10
+  br i1 %outer.exit, label %end, label %outer
+
+end:
+  ret void
+}
+
+;; for (i = 0; i < 10; i++)
+;;   for (j = 0; j < 10; j++)
+;;     x[10*i+j] = x[10*i+j+10]
+
+define void @f3(...) nounwind {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %i.next = add i64 %i, 1
+  %i.10 = mul i64 %i, 10
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add i64 %j, 1
+  %st.idx = add i64 %i.10, %j
+  %ld.idx = add i64 %st.idx, 10
+  %ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %ld.idx
+  %st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %st.idx
+  %v = load i32* %ld.addr     ; 0
+  store i32 %v, i32* %st.addr ; 1
+; CHECK: 0,1: dependent [< >=]
+  %inner.exit = icmp eq i64 %j.next, 10
+  br i1 %inner.exit, label %outer.latch, label %inner
+
+outer.latch:
+  %outer.exit = icmp eq i64 %i.next, 10
+  br i1 %outer.exit, label %end, label %outer
+
+end:
+  ret void
+}
+
+;; for (i = 0; i < 10; i++)
+;;   for (j = 0; j < 10; j++)
+;;     x[2*i+4*j] = x[2*i+4*j+1]
+
+define void @f4(...) nounwind {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %i.next = add i64 %i, 1
+  %i.2 = mul i64 %i, 2
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add i64 %j, 1
+  %j.4 = mul i64 %j, 4
+  %st.idx = add i64 %i.2, %j.4
+  %ld.idx = add i64 %st.idx, 1
+  %ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %ld.idx
+  %st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %st.idx
+  %v = load i32* %ld.addr     ; 0
+  store i32 %v, i32* %st.addr ; 1
+; CHECK: 0,1: independent
+  %inner.exit = icmp eq i64 %j.next, 10
+  br i1 %inner.exit, label %outer.latch, label %inner
+
+outer.latch:
+  %outer.exit = icmp eq i64 %i.next, 10
+  br i1 %outer.exit, label %end, label %outer
+
+end:
+  ret void
+}
+
+;; for (i = 0; i < 10; i++)
+;;   for (j = 0; j < 10; j++)
+;;     A[i][j] = A[i][5]
+
+define void @f5(...) nounwind {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %i.next = add i64 %i, 1
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add i64 %j, 1
+  %ld.addr = getelementptr [32 x [32 x i32]]* @A, i64 0, i64 %i, i64 5
+  %st.addr = getelementptr [32 x [32 x i32]]* @A, i64 0, i64 %i, i64 %j
+  %v = load i32* %ld.addr     ; 0
+  store i32 %v, i32* %st.addr ; 1
+; CHECK: 0,1: dependent [0 *]
+  %inner.exit = icmp eq i64 %j.next, 10
+  br i1 %inner.exit, label %outer.latch, label %inner
+
+outer.latch:
+  %outer.exit = icmp eq i64 %i.next, 10
+  br i1 %outer.exit, label %end, label %outer
+
+end:
+  ret void
+}
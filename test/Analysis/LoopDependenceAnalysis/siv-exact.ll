@@ -0,0 +1,159 @@
+; RUN: opt < %s -analyze -basicaa -lda | FileCheck %s
+
+@x = common global [256 x i32] zeroinitializer, align 4
+@y = common global [256 x i32] zeroinitializer, align 4
+
+;; for (i = 0; i < 10; i++)
+;;   x[2*i] = x[3*i+1] + y[i]
+
+define void @f1(...) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %i.2 = mul i64 %i, 2
+  %i.3 = mul i64 %i, 3
+  %i.3.1 = add i64 %i.3, 1
+  %y.ld.addr = getelementptr [256 x i32]* @y, i64 0, i64 %i
+  %x.ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.3.1
+  %x.st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.2
+  %x = load i32* %x.ld.addr     ; 0
+  %y = load i32* %y.ld.addr     ; 1
+  %r = add i32 %y, %x
+  store i32 %r, i32* %x.st.addr ; 2
+; CHECK: 0,2: dependent [<]
+; CHECK: 1,2: independent
+  %i.next = add i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 10
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;; for (i = 0; i < 10; i++)
+;;   x[2*i] = x[4*i+1] + y[i]
+
+define void @f2(...) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %i.2 = mul i64 %i, 2
+  %i.4 = mul i64 %i, 4
+  %i.4.1 = add i64 %i.4, 1
+  %y.ld.addr = getelementptr [256 x i32]* @y, i64 0, i64 %i
+  %x.ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.4.1
+  %x.st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.2
+  %x = load i32* %x.ld.addr     ; 0
+  %y = load i32* %y.ld.addr     ; 1
+  %r = add i32 %y, %x
+  store i32 %r, i32* %x.st.addr ; 2
+; CHECK: 0,2: independent
+; CHECK: 1,2: independent
+  %i.next = add i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 10
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;; for (i = 0; i < 4; i++)
+;;   x[2*i] = x[3*i+10] + y[i]
+
+define void @f3(...) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %i.2 = mul i64 %i, 2
+  %i.3 = mul i64 %i, 3
+  %i.3.10 = add i64 %i.3, 10
+  %y.ld.addr = getelementptr [256 x i32]* @y, i64 0, i64 %i
+  %x.ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.3.10
+  %x.st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.2
+  %x = load i32* %x.ld.addr     ; 0
+  %y = load i32* %y.ld.addr     ; 1
+  %r = add i32 %y, %x
+  store i32 %r, i32* %x.st.addr ; 2
+; CHECK: 0,2: independent
+; CHECK: 1,2: independent
+  %i.next = add i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 4
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;; // only i = 2 touches an element written by the loop
+;; for (i = 0; i < 3; i++)
+;;   x[2*i+2] = x[3*i] + y[i]
+
+define void @f4(...) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %i.2 = mul i64 %i, 2
+  %i.2.2 = add i64 %i.2, 2
+  %i.3 = mul i64 %i, 3
+  %y.ld.addr = getelementptr [256 x i32]* @y, i64 0, i64 %i
+  %x.ld.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.3
+  %x.st.addr = getelementptr [256 x i32]* @x, i64 0, i64 %i.2.2
+  %x = load i32* %x.ld.addr     ; 0
+  %y = load i32* %y.ld.addr     ; 1
+  %r = add i32 %y, %x
+  store i32 %r, i32* %x.st.addr ; 2
+; CHECK: 0,2: dependent [0]
+; CHECK: 1,2: independent
+  %i.next = add i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 3
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+;; // strong SIV with a symbolic distance
+;; for (i = 0; i < 256; i++)
+;;   x[i+n] = x[i] + y[i]   // n > 0
+;;   x[i+n+256] = 0
+
+define void @f5(i32 %m) nounwind {
+entry:
+  %m.ext = zext i32 %m to i64
+  %n = add i64 %m.ext, 1
+  %n.256 = add i64 %n, 256
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %i.n = add i64 %i, %n
+  %i.n.256 = add i64 %i, %n.256
+  %y.ld.addr = getelementptr i32* getelementptr ([256 x i32]* @y, i64 0, i64 0), i64 %i
+  %x.ld.addr = getelementptr i32* getelementptr ([256 x i32]* @x, i64 0, i64 0), i64 %i
+  %x.st.addr = getelementptr i32* getelementptr ([256 x i32]* @x, i64 0, i64 0), i64 %i.n
+  %x.st2.addr = getelementptr i32* getelementptr ([256 x i32]* @x, i64 0, i64 0), i64 %i.n.256
+  %x = load i32* %x.ld.addr      ; 0
+  %y = load i32* %y.ld.addr      ; 1
+  %r = add i32 %y, %x
+  store i32 %r, i32* %x.st.addr  ; 2
+  store i32 0, i32* %x.st2.addr  ; 3
+; CHECK: 0,2: dependent [>]
+; CHECK: 0,3: independent
+; CHECK: 1,2: independent
+; CHECK: 1,3: independent
+; CHECK: 2,3: independent
+  %i.next = add i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 256
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -18,8 +18,8 @@ for.body:
   %y = load i32* %y.addr      ; 1
   %r = add i32 %y, %x
   store i32 %r, i32* %x.addr  ; 2
-; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 0,2: dependent [0]
+; CHECK: 1,2: independent
   %i.next = add i64 %i, 1
   %exitcond = icmp eq i64 %i.next, 256
   br i1 %exitcond, label %for.end, label %for.body
@@ -45,8 +45,8 @@ for.body:
   %y = load i32* %y.ld.addr     ; 1
   %r = add i32 %y, %x
   store i32 %r, i32* %x.st.addr ; 2
-; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 0,2: dependent [-1]
+; CHECK: 1,2: independent
   %exitcond = icmp eq i64 %i.next, 256
   br i1 %exitcond, label %for.end, label %for.body
 
@@ -71,8 +71,8 @@ for.body:
   %y = load i32* %y.ld.addr     ; 1
   %r = add i32 %y, %x
   store i32 %r, i32* %x.st.addr ; 2
-; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 0,2: independent
+; CHECK: 1,2: independent
   %i.next = add i64 %i, 1
   %exitcond = icmp eq i64 %i.next, 10
   br i1 %exitcond, label %for.end, label %for.body
@@ -99,8 +99,8 @@ for.body:
   %y = load i32* %y.ld.addr     ; 1
   %r = add i32 %y, %x
   store i32 %r, i32* %x.st.addr ; 2
-; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 0,2: independent
+; CHECK: 1,2: independent
   %i.next = add i64 %i, 1
   %exitcond = icmp eq i64 %i.next, 10
   br i1 %exitcond, label %for.end, label %for.body
@@ -108,3 +108,29 @@ for.body:
 for.end:
   ret void
 }
+
+@z = common global [256 x [256 x i32]] zeroinitializer, align 4
+
+;; for (i = 0; i < 256; i++)
+;;   z[i][(int)i] = z[i][(int)i] + 1
+;; The two subscripts give the same distance in different types.
+
+define void @f5(...) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %j = trunc i64 %i to i32
+  %z.addr = getelementptr [256 x [256 x i32]]* @z, i64 0, i64 %i, i32 %j
+  %z = load i32* %z.addr      ; 0
+  %r = add i32 %z, 1
+  store i32 %r, i32* %z.addr  ; 1
+; CHECK: 0,1: dependent [0]
+  %i.next = add i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 256
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -20,8 +20,8 @@ for.body:
   %y = load i32* %y.ld.addr     ; 1
   %r = add i32 %y, %x
   store i32 %r, i32* %x.st.addr ; 2
-; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 0,2: dependent [<>]
+; CHECK: 1,2: independent
   %i.next = add i64 %i, 1
   %exitcond = icmp eq i64 %i.next, 256
   br i1 %exitcond, label %for.end, label %for.body
@@ -47,8 +47,8 @@ for.body:
   %y = load i32* %y.ld.addr     ; 1
   %r = add i32 %y, %x
   store i32 %r, i32* %x.st.addr ; 2
-; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 0,2: independent
+; CHECK: 1,2: independent
   %i.next = add i64 %i, 1
   %exitcond = icmp eq i64 %i.next, 100
   br i1 %exitcond, label %for.end, label %for.body
@@ -108,7 +108,7 @@ for.body:
   %r = add i32 %y, %x
   store i32 %r, i32* %x.st.addr ; 2
 ; CHECK: 0,2: dep
-; CHECK: 1,2: ind
+; CHECK: 1,2: independent
   %i.next = add i64 %i, 1
   %exitcond = icmp eq i64 %i.next, 256
   br i1 %exitcond, label %for.end, label %for.body
@@ -0,0 +1,11 @@
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+
+; Parameter readonly/readnone and nonnull survive a trip through bitcode.
+
+; CHECK: declare nonnull i8* @f(i8* nocapture readonly, i32* readnone, i8* nonnull)
+declare nonnull i8* @f(i8* nocapture readonly, i32* readnone, i8* nonnull)
+
+; CHECK: define void @g(i8* nonnull %p) readonly {
+define void @g(i8* nonnull %p) readonly {
+  ret void
+}
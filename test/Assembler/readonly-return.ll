@@ -0,0 +1,4 @@
+; RUN: not llvm-as < %s > /dev/null |& grep {invalid use of attribute on a return value}
+; readonly and readnone may be placed on parameters, but not on return values.
+
+declare readonly i8* @f(i8*)
@@ -0,0 +1,37 @@
+; RUN: llvm-as -compress < %s > %t.bc
+; RUN: llvm-dis < %t.bc | FileCheck %s
+; RUN: opt -S %t.bc | FileCheck %s
+; RUN: llvm-extract -func=second -S %t.bc -o - | FileCheck -check-prefix=EXTRACT %s
+
+; A compressed bitcode container reads back the same whether it is streamed,
+; read as a whole, or read lazily.
+
+@g = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+; CHECK: define i32 @first(i32 %x)
+; EXTRACT: declare i32 @first(i32)
+define i32 @first(i32 %x) {
+entry:
+  %p = getelementptr [4 x i32]* @g, i32 0, i32 %x
+  %v = load i32* %p
+  ret i32 %v
+}
+
+; CHECK: define i32 @second(i32 %x)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %y = call i32 @first(i32 %x)
+; EXTRACT: define i32 @second(i32 %x)
+; EXTRACT-NEXT: entry:
+; EXTRACT-NEXT: %y = call i32 @first(i32 %x)
+define i32 @second(i32 %x) {
+entry:
+  %y = call i32 @first(i32 %x)
+  %z = mul i32 %y, %y
+  ret i32 %z
+}
+
+; CHECK: define void @empty()
+define void @empty() {
+entry:
+  ret void
+}
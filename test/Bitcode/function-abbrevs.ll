@@ -0,0 +1,76 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump 2>/dev/null | FileCheck %s
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s --check-prefix=ROUNDTRIP
+
+; Stores, branches, compares and C calls are written with the function block
+; abbreviations, unless the pointer of a store or the lhs of a compare is a
+; forward reference.
+
+declare void @g(i32)
+
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <INST_STORE abbrevid={{[0-9]+}}
+; CHECK-NEXT: <INST_CMP2 abbrevid={{[0-9]+}}
+; CHECK-NEXT: <INST_BR abbrevid={{[0-9]+}} op0=1 op1=2
+; CHECK-NEXT: <INST_CALL abbrevid={{[0-9]+}}
+; CHECK-NEXT: <INST_BR abbrevid={{[0-9]+}} op0=2/>
+; CHECK-NEXT: <INST_RET
+
+; ROUNDTRIP: define i32 @f(i32* %p, i32 %x) {
+; ROUNDTRIP-NEXT: entry:
+; ROUNDTRIP-NEXT: store i32 %x, i32* %p
+; ROUNDTRIP-NEXT: %c = icmp eq i32 %x, 0
+; ROUNDTRIP-NEXT: br i1 %c, label %a, label %b
+; ROUNDTRIP: a:
+; ROUNDTRIP-NEXT: call void @g(i32 %x)
+; ROUNDTRIP-NEXT: br label %b
+; ROUNDTRIP: b:
+; ROUNDTRIP-NEXT: ret i32 %x
+define i32 @f(i32* %p, i32 %x) {
+entry:
+  store i32 %x, i32* %p
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %a, label %b
+
+a:
+  call void @g(i32 %x)
+  br label %b
+
+b:
+  ret i32 %x
+}
+
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <INST_BR abbrevid={{[0-9]+}} op0=2/>
+; CHECK-NEXT: <INST_STORE op0=
+; CHECK-NEXT: <INST_CMP2 op0=
+; CHECK-NEXT: <INST_BR abbrevid={{[0-9]+}}
+; CHECK-NEXT: <INST_LOAD abbrevid={{[0-9]+}}
+
+; ROUNDTRIP: define void @forward(i32* %p) {
+; ROUNDTRIP-NEXT: entry:
+; ROUNDTRIP-NEXT: br label %def
+; ROUNDTRIP: use:
+; ROUNDTRIP-NEXT: store i32 %v, i32* %q
+; ROUNDTRIP-NEXT: %c = icmp eq i32 %v, 0
+; ROUNDTRIP-NEXT: br i1 %c, label %exit, label %exit
+; ROUNDTRIP: def:
+; ROUNDTRIP-NEXT: %v = load i32* %p
+; ROUNDTRIP-NEXT: %q = getelementptr i32* %p, i32 1
+; ROUNDTRIP-NEXT: br label %use
+define void @forward(i32* %p) {
+entry:
+  br label %def
+
+use:
+  store i32 %v, i32* %q
+  %c = icmp eq i32 %v, 0
+  br i1 %c, label %exit, label %exit
+
+def:
+  %v = load i32* %p
+  %q = getelementptr i32* %p, i32 1
+  br label %use
+
+exit:
+  ret void
+}
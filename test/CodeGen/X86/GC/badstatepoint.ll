@@ -0,0 +1,49 @@
+; RUN: not llvm-as < %s -o /dev/null |& FileCheck %s
+
+declare i32 @llvm.gc.statepoint(i32, i8*, i32, ...)
+declare i32 @llvm.gc.result.int.i32(i32)
+declare i8* @llvm.gc.relocate.p0i8(i32, i32)
+declare void @collect()
+
+define void @nogc(i8* %obj) {
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 0, i8* bitcast (void ()* @collect to i8*), i32 0, i8* %obj)
+  ret void
+}
+; CHECK: Enclosing function does not use GC.
+
+define void @badid(i32 %id) gc "statepoint" {
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 %id, i8* bitcast (void ()* @collect to i8*), i32 0)
+  ret void
+}
+; CHECK: llvm.gc.statepoint parameter #1 must be a constant.
+
+define void @toofew() gc "statepoint" {
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 0, i8* bitcast (void ()* @collect to i8*), i32 2, i32 1)
+  ret void
+}
+; CHECK: llvm.gc.statepoint has too few call arguments.
+
+define void @notptr() gc "statepoint" {
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 0, i8* bitcast (void ()* @collect to i8*), i32 0, i64 1)
+  ret void
+}
+; CHECK: llvm.gc.statepoint gc pointers must have pointer type.
+
+define i32 @baduse() gc "statepoint" {
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 0, i8* bitcast (void ()* @collect to i8*), i32 0)
+  ret i32 %tok
+}
+; CHECK: llvm.gc.statepoint may only be used by llvm.gc.relocate and llvm.gc.result.
+
+define i32 @notoken(i32 %x) gc "statepoint" {
+  %r = call i32 @llvm.gc.result.int.i32(i32 %x)
+  ret i32 %r
+}
+; CHECK: gc parameter #1 must be an llvm.gc.statepoint.
+
+define i8* @outofrange(i8* %obj) gc "statepoint" {
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 0, i8* bitcast (void ()* @collect to i8*), i32 0, i8* %obj)
+  %moved = call i8* @llvm.gc.relocate.p0i8(i32 %tok, i32 1)
+  ret i8* %moved
+}
+; CHECK: llvm.gc.relocate index is out of range.
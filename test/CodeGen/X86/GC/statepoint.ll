@@ -0,0 +1,91 @@
+; RUN: llc < %s -mtriple=x86_64-linux -disable-fp-elim | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-linux -disable-fp-elim -O0 | FileCheck %s
+
+; GC pointers are spilled to a stack slot immediately before the statepoint's
+; call, read back from it immediately after, and the slot is described by an
+; [%rbp + offset] location in the stack map record for the return address.
+
+declare i32 @llvm.gc.statepoint(i32, i8*, i32, ...)
+declare i32 @llvm.gc.result.int.i32(i32)
+declare i8* @llvm.gc.relocate.p0i8(i32, i32)
+declare i64* @llvm.gc.relocate.p0i64(i32, i32)
+declare i32 @allocate(i32)
+declare void @collect()
+
+define i8* @one(i8* %obj) gc "statepoint" {
+entry:
+; CHECK: one:
+; CHECK: movq %rdi, [[ONE:-[0-9]+]](%rbp)
+; CHECK: callq allocate
+; CHECK-NEXT: [[ONERET:.Ltmp[0-9]+]]:
+; CHECK: [[ONE]](%rbp)
+; CHECK: ret
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 7, i8* bitcast (i32 (i32)* @allocate to i8*), i32 1, i32 16, i8* %obj)
+  %ret = call i32 @llvm.gc.result.int.i32(i32 %tok)
+  %moved = call i8* @llvm.gc.relocate.p0i8(i32 %tok, i32 0)
+  %p = getelementptr i8* %moved, i32 %ret
+  ret i8* %p
+}
+
+define i64 @two(i8* %a, i64* %b, i1 %c) gc "statepoint" {
+entry:
+; CHECK: two:
+; CHECK: movq %rsi, [[TWOB:-[0-9]+]](%rbp)
+; CHECK: movq %rdi, [[TWOA:-[0-9]+]](%rbp)
+; CHECK: callq collect
+; CHECK-NEXT: [[TWORET:.Ltmp[0-9]+]]:
+; CHECK: movq [[TWOB]](%rbp), %r
+; CHECK: ret
+  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 8, i8* bitcast (void ()* @collect to i8*), i32 0, i8* %a, i64* %b)
+  br i1 %c, label %t, label %f
+
+t:
+  %b.moved = call i64* @llvm.gc.relocate.p0i64(i32 %tok, i32 1)
+  %v = load i64* %b.moved
+  ret i64 %v
+
+f:
+  ret i64 0
+}
+
+; CHECK: .section .llvm_stackmaps,"a",@progbits
+; CHECK-NEXT: .align 8
+; CHECK-NEXT: .type __LLVM_StackMaps,@object
+; CHECK-NEXT: __LLVM_StackMaps:
+; CHECK-NEXT: .byte 1
+; CHECK-NEXT: .byte 0
+; CHECK-NEXT: .short 0
+; CHECK-NEXT: .long 2
+; CHECK-NEXT: .align 8
+
+; CHECK-NEXT: .quad one
+; CHECK-NEXT: .long {{[0-9]+}}
+; CHECK-NEXT: .long 1
+; CHECK-NEXT: .long 7
+; CHECK-NEXT: [[ONESET:.Lset[0-9]+]] = [[ONERET]]-one
+; CHECK-NEXT: .long [[ONESET]]
+; CHECK-NEXT: .short 0
+; CHECK-NEXT: .short 1
+; CHECK-NEXT: .byte 2
+; CHECK-NEXT: .byte 0
+; CHECK-NEXT: .short 6
+; CHECK-NEXT: .long [[ONE]]
+; CHECK-NEXT: .align 8
+
+; CHECK-NEXT: .quad two
+; CHECK-NEXT: .long {{[0-9]+}}
+; CHECK-NEXT: .long 1
+; CHECK-NEXT: .long 8
+; CHECK-NEXT: [[TWOSET:.Lset[0-9]+]] = [[TWORET]]-two
+; CHECK-NEXT: .long [[TWOSET]]
+; CHECK-NEXT: .short 0
+; CHECK-NEXT: .short 2
+; CHECK-NEXT: .byte 2
+; CHECK-NEXT: .byte 0
+; CHECK-NEXT: .short 6
+; CHECK-NEXT: .long [[TWOA]]
+; CHECK-NEXT: .byte 2
+; CHECK-NEXT: .byte 0
+; CHECK-NEXT: .short 6
+; CHECK-NEXT: .long [[TWOB]]
+; CHECK-NEXT: .align 8
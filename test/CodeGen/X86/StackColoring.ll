@@ -0,0 +1,192 @@
+; RUN: llc < %s -mcpu=corei7 -mtriple=x86_64-apple-macosx10.8.0 | FileCheck %s -check-prefix=YESCOLOR
+; RUN: llc < %s -mcpu=corei7 -mtriple=x86_64-apple-macosx10.8.0 -no-stack-coloring | FileCheck %s -check-prefix=NOCOLOR
+
+; Two disjoint 4k buffers share a single slot.
+;YESCOLOR: myCall_w2:
+;YESCOLOR: subq  $4104, %rsp
+;NOCOLOR: myCall_w2:
+;NOCOLOR: subq  $8200, %rsp
+define i32 @myCall_w2(i32 %in) {
+entry:
+  %a = alloca [4096 x i8], align 16
+  %b = alloca [4096 x i8], align 16
+  %a8 = getelementptr [4096 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [4096 x i8]* %b, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  %t1 = call i32 @foo(i32 %in, i8* %a8)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  %t2 = call i32 @foo(i32 %in, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  %t3 = add i32 %t1, %t2
+  ret i32 %t3
+}
+
+; Two pairs of disjoint buffers collapse into two slots.
+;YESCOLOR: myCall2_pairs:
+;YESCOLOR: subq  $6144, %rsp
+;NOCOLOR: myCall2_pairs:
+;NOCOLOR: subq  $10240, %rsp
+define i32 @myCall2_pairs(i32 %in, i1 %d) {
+entry:
+  %a = alloca [4096 x i8], align 16
+  %b = alloca [2048 x i8], align 16
+  %c = alloca [2048 x i8], align 16
+  %d2 = alloca [2048 x i8], align 16
+  %a8 = getelementptr [4096 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [2048 x i8]* %b, i64 0, i64 0
+  %c8 = getelementptr [2048 x i8]* %c, i64 0, i64 0
+  %d8 = getelementptr [2048 x i8]* %d2, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  %t1 = call i32 @foo(i32 %in, i8* %a8)
+  %t2 = call i32 @foo(i32 %in, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  call void @llvm.lifetime.start(i64 -1, i8* %c8)
+  call void @llvm.lifetime.start(i64 -1, i8* %d8)
+  %t3 = call i32 @foo(i32 %in, i8* %c8)
+  %t4 = call i32 @foo(i32 %in, i8* %d8)
+  call void @llvm.lifetime.end(i64 -1, i8* %c8)
+  call void @llvm.lifetime.end(i64 -1, i8* %d8)
+  %t5 = add i32 %t1, %t2
+  %t6 = add i32 %t3, %t4
+  %t7 = add i32 %t5, %t6
+  ret i32 %t7
+}
+
+; Lifetimes that cross basic blocks: %a is live on both sides of the
+; branch, %b only in the join block after %a ended.
+;YESCOLOR: myCall_cfg:
+;YESCOLOR: subq  $4096, %rsp
+;NOCOLOR: myCall_cfg:
+;NOCOLOR: subq  $8192, %rsp
+define i32 @myCall_cfg(i32 %in, i1 %d) {
+entry:
+  %a = alloca [4096 x i8], align 16
+  %b = alloca [4096 x i8], align 16
+  %a8 = getelementptr [4096 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [4096 x i8]* %b, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  br i1 %d, label %bb1, label %bb2
+
+bb1:
+  %t1 = call i32 @foo(i32 %in, i8* %a8)
+  br label %bb3
+
+bb2:
+  %t2 = call i32 @foo(i32 %in, i8* %a8)
+  br label %bb3
+
+bb3:
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  %t3 = call i32 @foo(i32 %in, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  ret i32 %t3
+}
+
+; Overlapping lifetimes must not be merged.
+;YESCOLOR: myCall_overlap:
+;YESCOLOR: subq  $8200, %rsp
+;NOCOLOR: myCall_overlap:
+;NOCOLOR: subq  $8200, %rsp
+define i32 @myCall_overlap(i32 %in) {
+entry:
+  %a = alloca [4096 x i8], align 16
+  %b = alloca [4096 x i8], align 16
+  %a8 = getelementptr [4096 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [4096 x i8]* %b, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  %t1 = call i32 @foo(i32 %in, i8* %a8)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  %t2 = call i32 @foo(i32 %in, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  %t3 = add i32 %t1, %t2
+  ret i32 %t3
+}
+
+; The store to %a happens after its lifetime ended. The slot is not merged,
+; even though the markers alone would allow it.
+;YESCOLOR: myCall_escaped:
+;YESCOLOR: subq  $8200, %rsp
+;NOCOLOR: myCall_escaped:
+;NOCOLOR: subq  $8200, %rsp
+define i32 @myCall_escaped(i32 %in) {
+entry:
+  %a = alloca [4096 x i8], align 16
+  %b = alloca [4096 x i8], align 16
+  %a8 = getelementptr [4096 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [4096 x i8]* %b, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  %t1 = call i32 @foo(i32 %in, i8* %a8)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  %t2 = call i32 @foo(i32 %in, i8* %b8)
+  store i8 0, i8* %a8
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  %t3 = add i32 %t1, %t2
+  ret i32 %t3
+}
+
+; Disjoint buffers in a function with a stack protector are still merged; the
+; guard slot itself is left alone.
+;YESCOLOR: myCall_ssp:
+;YESCOLOR: subq  $4112, %rsp
+;NOCOLOR: myCall_ssp:
+;NOCOLOR: subq  $8208, %rsp
+define i32 @myCall_ssp(i32 %in) ssp {
+entry:
+  %a = alloca [4096 x i8], align 16
+  %b = alloca [4096 x i8], align 16
+  %a8 = getelementptr [4096 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [4096 x i8]* %b, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  %t1 = call i32 @foo(i32 %in, i8* %a8)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  %t2 = call i32 @foo(i32 %in, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  %t3 = add i32 %t1, %t2
+  ret i32 %t3
+}
+
+; %a is live around the loop and restarted inside it after %b ends, so the
+; loop block ends %a before it starts it again.  %a is still live from the
+; top of the block up to its end marker, which overlaps %b.
+;YESCOLOR: loop_restart:
+;YESCOLOR: subq  $128, %rsp
+;NOCOLOR: loop_restart:
+;NOCOLOR: subq  $128, %rsp
+define void @loop_restart(i32 %n) {
+entry:
+  %a = alloca [64 x i8], align 16
+  %b = alloca [64 x i8], align 16
+  %a8 = getelementptr [64 x i8]* %a, i64 0, i64 0
+  %b8 = getelementptr [64 x i8]* %b, i64 0, i64 0
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  call void @llvm.lifetime.start(i64 -1, i8* %b8)
+  call void @bar(i8* %a8, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %b8)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  call void @llvm.lifetime.start(i64 -1, i8* %a8)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  call void @bar(i8* %a8, i8* null)
+  call void @llvm.lifetime.end(i64 -1, i8* %a8)
+  ret void
+}
+
+declare i32 @foo(i32, i8*)
+declare void @bar(i8*, i8*)
+
+declare void @llvm.lifetime.start(i64, i8* nocapture) nounwind
+declare void @llvm.lifetime.end(i64, i8* nocapture) nounwind
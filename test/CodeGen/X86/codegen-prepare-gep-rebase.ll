@@ -0,0 +1,60 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -disable-cgp-gep-rebase \
+; RUN:   | FileCheck %s -check-prefix=NOREBASE
+
+; CodeGenPrepare rebases GEPs whose offsets are too large for an addressing
+; mode onto the first GEP of the same base, so that the large offset is only
+; materialized once and the rest folds into the loads and stores.
+
+%node = type { %node*, [1073741824 x i64], i32, i32, i32 }
+
+; CHECK: walk:
+; CHECK: movabsq $8589934600, [[OFF:%r[a-z0-9]+]]
+; CHECK-NOT: movabsq
+; CHECK: %loop
+; CHECK: movl (%rdi,[[OFF]]),
+; CHECK: addl 4(%rdi,[[OFF]]),
+; CHECK: movl {{%e[a-z0-9]+}}, 8(%rdi,[[OFF]])
+
+; NOREBASE: walk:
+; NOREBASE: movabsq $8589934600
+; NOREBASE: movabsq $8589934604
+; NOREBASE: movabsq $8589934608
+define i32 @walk(%node* %n) {
+entry:
+  br label %loop
+
+loop:
+  %cur = phi %node* [ %n, %entry ], [ %next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %a = getelementptr inbounds %node* %cur, i64 0, i32 2
+  %b = getelementptr inbounds %node* %cur, i64 0, i32 3
+  %c = getelementptr inbounds %node* %cur, i64 0, i32 4
+  %va = load i32* %a
+  %vb = load i32* %b
+  %s = add i32 %va, %vb
+  store i32 %s, i32* %c
+  %acc.next = add i32 %acc, %s
+  %link = getelementptr inbounds %node* %cur, i64 0, i32 0
+  %next = load %node** %link
+  %done = icmp eq %node* %next, null
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %acc.next
+}
+
+; Offsets that fold on their own are left alone.
+; CHECK: small:
+; CHECK-NOT: movabsq
+; CHECK: movl 8(%rdi), %eax
+; CHECK: addl 12(%rdi), %eax
+; CHECK: ret
+define i32 @small(i32* %p) {
+  %a = getelementptr inbounds i32* %p, i64 2
+  %b = getelementptr inbounds i32* %p, i64 3
+  %va = load i32* %a
+  %vb = load i32* %b
+  %s = add i32 %va, %vb
+  ret i32 %s
+}
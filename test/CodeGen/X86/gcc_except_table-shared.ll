@@ -0,0 +1,79 @@
+; RUN: llc -mtriple x86_64-linux < %s | FileCheck %s
+
+; The LSDAs use a uleb128 call-site table and share a single set of action
+; records and type infos, emitted after the last of them.
+
+@_ZTIi = external constant i8*
+@_ZTIc = external constant i8*
+
+declare void @g()
+declare i32 @__gxx_personality_v0(...)
+
+define i32 @f1() {
+entry:
+  invoke void @g() to label %cont unwind label %lpad
+cont:
+  ret i32 0
+lpad:
+  %lp = landingpad { i8*, i32 } personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*)
+          catch i8* bitcast (i8** @_ZTIi to i8*)
+  ret i32 1
+}
+
+define i32 @f2() {
+entry:
+  invoke void @g() to label %cont unwind label %lpad
+cont:
+  ret i32 0
+lpad:
+  %lp = landingpad { i8*, i32 } personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*)
+          catch i8* bitcast (i8** @_ZTIc to i8*)
+          catch i8* bitcast (i8** @_ZTIi to i8*)
+  ret i32 1
+}
+
+define void @f3() {
+entry:
+  invoke void @g() to label %cont unwind label %lpad
+cont:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 } personality i8* bitcast (i32 (...)* @__gxx_personality_v0 to i8*)
+          filter [1 x i8*] [i8* bitcast (i8** @_ZTIi to i8*)]
+  ret void
+}
+
+; CHECK: GCC_except_table0:
+; CHECK: .uleb128 [[TTBASE:.Ltmp[0-9]+]]-.Lttbase_ref0 # @TType base offset
+; CHECK: .byte 1 # Call site Encoding = uleb128
+; CHECK: .uleb128 .Lcst_end0-.Lcst_begin0
+; CHECK: .uleb128 ([[ACTIONS:.Ltmp[0-9]+]]-.Lcst_end0)+1 # On action at offset 0
+; CHECK: .Lcst_end0:
+; CHECK-NOT: Action Record
+
+; CHECK: GCC_except_table1:
+; CHECK: .uleb128 [[TTBASE]]-.Lttbase_ref1
+; CHECK: .uleb128 ([[ACTIONS]]-.Lcst_end1)+3 # On action at offset 2
+; CHECK-NOT: Action Record
+
+; CHECK: GCC_except_table2:
+; CHECK: .uleb128 [[TTBASE]]-.Lttbase_ref2
+; CHECK: .uleb128 ([[ACTIONS]]-.Lcst_end2)+5 # On action at offset 4
+
+; CHECK: [[ACTIONS]]:
+; CHECK-NEXT: .byte 1 # >> Action Record 1 at offset 0 <<
+; CHECK-NEXT: # Catch TypeInfo 1
+; CHECK-NEXT: .byte 0 # No further actions
+; CHECK-NEXT: .byte 2 # >> Action Record 2 at offset 2 <<
+; CHECK-NEXT: # Catch TypeInfo 2
+; CHECK-NEXT: .byte 125 # Continue to action 1
+; CHECK-NEXT: .byte 127 # >> Action Record 3 at offset 4 <<
+; CHECK-NEXT: # Filter TypeInfo -1
+; CHECK-NEXT: .byte 0 # No further actions
+; CHECK-NEXT: .align 4
+; CHECK: .long _ZTIc # TypeInfo 2
+; CHECK-NEXT: .long _ZTIi # TypeInfo 1
+; CHECK-NEXT: [[TTBASE]]:
+; CHECK: .byte 1 # FilterInfo 1
+; CHECK-NEXT: .byte 0
+; CHECK-NOT: Action Record
@@ -0,0 +1,52 @@
+; RUN: llc < %s -mtriple=x86_64-linux | FileCheck %s
+
+; An add immediate must fit in a sign-extended 32 bits on x86-64, so LSR
+; folds these offsets into the start values of its induction variables
+; instead of adding them to a shared register on every iteration.
+
+; CHECK: f:
+; CHECK: movabsq $4294967296
+; CHECK: movabsq $8589934592
+; CHECK: %loop
+; CHECK-NEXT: Inner Loop Header
+; CHECK-NEXT: movq %r{{.*}}, (%rdi)
+; CHECK-NEXT: movq %r{{.*}}, (%rdi)
+define void @f(i64* %p, i64 %n) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %a = add i64 %i, 4294967296
+  %b = add i64 %i, 8589934592
+  store volatile i64 %a, i64* %p
+  store volatile i64 %b, i64* %p
+  %i.next = add i64 %i, 1
+  %c = icmp eq i64 %i.next, %n
+  br i1 %c, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; CHECK: h:
+; CHECK: movabsq $12884901888
+; CHECK: %loop
+; CHECK-NEXT: Inner Loop Header
+; CHECK-NEXT: xorq %r{{.*}}, %rax
+define i64 @h(i64 %n) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i64 [ 0, %entry ], [ %s.next, %loop ]
+  %x = add i64 %i, 12884901888
+  %s.next = xor i64 %s, %x
+  %i.next = add i64 %i, 1
+  %c = icmp eq i64 %i.next, %n
+  br i1 %c, label %exit, label %loop
+
+exit:
+  ret i64 %s.next
+}
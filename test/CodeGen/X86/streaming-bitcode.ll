@@ -0,0 +1,56 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: llc < %t.bc > %t.whole.s
+; RUN: cat %t.bc | llc -streaming-bitcode > %t.streamed.s
+; RUN: diff %t.whole.s %t.streamed.s
+; RUN: cat %t.bc | llc -streaming-bitcode | FileCheck %s
+
+; Functions of a streamed module are compiled as their bodies are read.
+; A blockaddress of a function further down the stream must still refer to
+; the real block, not to the reader's placeholder for it.
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@table = constant [2 x i8*] [i8* blockaddress(@dispatch, %one),
+                             i8* blockaddress(@dispatch, %two)]
+@counter = internal global i32 0
+
+; CHECK: first:
+; CHECK: movl $[[ONE:.Ltmp[0-9]+]], %eax
+define i8* @first() nounwind {
+entry:
+  ret i8* blockaddress(@dispatch, %one)
+}
+
+; CHECK: caller:
+; CHECK: callq later
+define i32 @caller(i32 %x) nounwind {
+entry:
+  %r = call i32 @later(i32 %x)
+  %c = load i32* @counter
+  %s = add i32 %r, %c
+  ret i32 %s
+}
+
+; CHECK: dispatch:
+; CHECK: [[ONE]]:
+; CHECK-NEXT: %one
+define i32 @dispatch(i8* %p) nounwind {
+entry:
+  indirectbr i8* %p, [label %one, label %two]
+one:
+  ret i32 1
+two:
+  ret i32 2
+}
+
+; CHECK: later:
+define internal i32 @later(i32 %x) nounwind noinline {
+entry:
+  store i32 %x, i32* @counter
+  %y = mul i32 %x, 3
+  ret i32 %y
+}
+
+; CHECK: table:
+; CHECK-NEXT: .quad [[ONE]]
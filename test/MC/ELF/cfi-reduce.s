@@ -0,0 +1,44 @@
+// RUN: llvm-mc -reduce-cfi -filetype=obj -triple x86_64-pc-linux-gnu %s -o - | elf-dump  --dump-section-data | FileCheck %s
+
+// Instructions that do not change the rules are dropped, and DW_CFA_def_cfa
+// is shortened when it changes only the register or only the offset.  Each
+// FDE starts from the CIE's rules, whatever the previous FDE ended with.
+
+f:
+	.cfi_startproc
+	.cfi_def_cfa_offset 8
+	pushq	%rbp
+	.cfi_def_cfa_offset 16
+	.cfi_offset %rbp, -16
+	nop
+	.cfi_offset %rbp, -16
+	.cfi_restore %rbx
+	movq	%rsp, %rbp
+	.cfi_def_cfa %rbp, 16
+	.cfi_def_cfa_register %rbp
+	pushq	%rax
+	.cfi_def_cfa %rbp, 24
+	ret
+	.cfi_endproc
+
+g:
+	.cfi_startproc
+	pushq	%rax
+	.cfi_adjust_cfa_offset 8
+	.cfi_adjust_cfa_offset 0
+	ret
+	.cfi_endproc
+
+// CHECK:       # Section 4
+// CHECK-NEXT:  (('sh_name', 0x00000011) # '.eh_frame'
+// CHECK-NEXT:   ('sh_type', 0x00000001)
+// CHECK-NEXT:   ('sh_flags', 0x0000000000000002)
+// CHECK-NEXT:   ('sh_addr', 0x0000000000000000)
+// CHECK-NEXT:   ('sh_offset', 0x0000000000000050)
+// CHECK-NEXT:   ('sh_size', 0x0000000000000048)
+// CHECK-NEXT:   ('sh_link', 0x00000000)
+// CHECK-NEXT:   ('sh_info', 0x00000000)
+// CHECK-NEXT:   ('sh_addralign', 0x0000000000000008)
+// CHECK-NEXT:   ('sh_entsize', 0x0000000000000000)
+// CHECK-NEXT:   ('_section_data', '14000000 00000000 017a5200 01781001 1b0c0708 90010000 18000000 1c000000 00000000 07000000 00410e10 8602440d 06410e18 10000000 38000000 00000000 02000000 00410e10')
+// CHECK-NEXT:  ),
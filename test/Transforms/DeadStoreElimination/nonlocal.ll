@@ -0,0 +1,172 @@
+; RUN: opt < %s -basicaa -dse -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+declare void @use(i32*)
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1) nounwind
+
+; The store in the entry block is overwritten on both sides of the branch.
+define void @diamond(i32* noalias %p, i1 %c) nounwind {
+; CHECK: @diamond
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br i1 %c
+entry:
+  store i32 0, i32* %p
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %p
+  br label %exit
+
+else:
+  store i32 2, i32* %p
+  br label %exit
+
+exit:
+  ret void
+}
+
+; One path reads the stored value, so the store stays.
+define i32 @diamond_read(i32* noalias %p, i1 %c) nounwind {
+; CHECK: @diamond_read
+; CHECK: store i32 0, i32* %p
+entry:
+  store i32 0, i32* %p
+  br i1 %c, label %then, label %else
+
+then:
+  %v = load i32* %p
+  store i32 1, i32* %p
+  br label %exit
+
+else:
+  store i32 2, i32* %p
+  br label %exit
+
+exit:
+  %r = phi i32 [ %v, %then ], [ 0, %else ]
+  ret i32 %r
+}
+
+; One path returns without overwriting a non-local location.
+define void @diamond_escape(i32* noalias %p, i1 %c) nounwind {
+; CHECK: @diamond_escape
+; CHECK: store i32 0, i32* %p
+entry:
+  store i32 0, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 1, i32* %p
+  br label %exit
+
+exit:
+  ret void
+}
+
+; Stores to an alloca are dead on paths that return.  The load in the loop
+; only reads the value stored inside the loop.
+define void @alloca_loop(i32 %n) nounwind {
+; CHECK: @alloca_loop
+; CHECK-NOT: store i32 0
+; CHECK: ret void
+entry:
+  %a = alloca i32
+  call void @use(i32* %a)
+  store i32 0, i32* %a
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store i32 %i, i32* %a
+  %v = load i32* %a
+  %i.next = add i32 %v, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; A call that may read the location keeps the store alive.
+define void @call_reads(i1 %c) nounwind {
+; CHECK: @call_reads
+; CHECK: store i32 0, i32* %a
+entry:
+  %a = alloca i32
+  store i32 0, i32* %a
+  br i1 %c, label %then, label %exit
+
+then:
+  call void @use(i32* %a)
+  br label %exit
+
+exit:
+  store i32 1, i32* %a
+  call void @use(i32* %a)
+  ret void
+}
+
+; The start of the memset is overwritten, so it is shortened from the front.
+define void @memset_begin(i32* nocapture %p) nounwind {
+; CHECK: @memset_begin
+; CHECK: [[GEP:%[0-9a-z.]+]] = getelementptr inbounds i8* %p3, i64 4
+; CHECK: call void @llvm.memset.p0i8.i64(i8* [[GEP]], i8 0, i64 28, i32 4, i1 false)
+entry:
+  %p3 = bitcast i32* %p to i8*
+  call void @llvm.memset.p0i8.i64(i8* %p3, i8 0, i64 32, i32 4, i1 false)
+  store i32 1, i32* %p, align 4
+  ret void
+}
+
+; Shortening would break the alignment of the memset.
+define void @memset_begin_misaligned(i32* nocapture %p) nounwind {
+; CHECK: @memset_begin_misaligned
+; CHECK: call void @llvm.memset.p0i8.i64(i8* %p3, i8 0, i64 32, i32 16, i1 false)
+entry:
+  %p3 = bitcast i32* %p to i8*
+  call void @llvm.memset.p0i8.i64(i8* %p3, i8 0, i64 32, i32 16, i1 false)
+  store i32 1, i32* %p, align 4
+  ret void
+}
+
+; The next iteration reads the element this one stored, so the store stays
+; even though the loop body stores to %A[i] again before reaching an exit.
+define void @loop_carried(i32* noalias %A, i32 %n) nounwind {
+; CHECK: @loop_carried
+; CHECK: store i32 %i, i32* %p
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 1, %entry ], [ %i.next, %loop ]
+  %p = getelementptr inbounds i32* %A, i32 %i
+  store i32 %i, i32* %p
+  %i.prev = add i32 %i, -1
+  %q = getelementptr inbounds i32* %A, i32 %i.prev
+  %v = load i32* %q
+  %i.next = add i32 %v, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; The alloca escapes to @use, which may keep it around, so the return path
+; does not make the store dead.
+define void @escaped_alloca(i1 %c) nounwind {
+; CHECK: @escaped_alloca
+; CHECK: store i32 0, i32* %a
+entry:
+  %a = alloca i32
+  call void @use(i32* %a)
+  store i32 0, i32* %a
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 1, i32* %a
+  br label %exit
+
+exit:
+  ret void
+}
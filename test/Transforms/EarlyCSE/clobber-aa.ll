@@ -0,0 +1,84 @@
+; RUN: opt < %s -S -basicaa -early-cse | FileCheck %s
+; RUN: opt < %s -S -tbaa -basicaa -early-cse | FileCheck %s -check-prefix=TBAA
+; RUN: opt < %s -S -basicaa -early-cse -early-cse-clobber-lookback=1 | FileCheck %s -check-prefix=LOOKBACK
+
+target datalayout = "e-p:64:64:64-i32:32:32-i64:64:64"
+
+; Stores to distinct allocas and fields do not kill the available load.
+; CHECK: @test1
+; CHECK: %V1 = load i32* %P
+; CHECK-NOT: load
+; CHECK: ret i32 0
+; LOOKBACK: @test1
+; LOOKBACK: load i32* %P
+; LOOKBACK: load i32* %P
+define i32 @test1(i32* %P, i32 %x) {
+  %A = alloca i32
+  %B = alloca [2 x i32]
+  %V1 = load i32* %P
+  store i32 %x, i32* %A
+  %B1 = getelementptr [2 x i32]* %B, i32 0, i32 1
+  store i32 %x, i32* %B1
+  %V2 = load i32* %P
+  %R = sub i32 %V1, %V2
+  ret i32 %R
+}
+
+; A store that may alias still invalidates the load.
+; CHECK: @test2
+; CHECK: %V1 = load i32* %P
+; CHECK: store i32 %x, i32* %Q
+; CHECK: %V2 = load i32* %P
+define i32 @test2(i32* %P, i32* %Q, i32 %x) {
+  %V1 = load i32* %P
+  store i32 %x, i32* %Q
+  %V2 = load i32* %P
+  %R = sub i32 %V1, %V2
+  ret i32 %R
+}
+
+; Store-to-load forwarding across a store to a different field.
+; CHECK: @test3
+; CHECK-NOT: load
+; CHECK: ret i32 %x
+%pair = type { i32, i32 }
+define i32 @test3(%pair* %S, i32 %x, i32 %y) {
+  %F0 = getelementptr %pair* %S, i32 0, i32 0
+  %F1 = getelementptr %pair* %S, i32 0, i32 1
+  store i32 %x, i32* %F0
+  store i32 %y, i32* %F1
+  %V = load i32* %F0
+  ret i32 %V
+}
+
+; Type-based alias analysis separates an int load from a float store.
+; TBAA: @test4
+; TBAA: %V1 = load i32* %P, !tbaa
+; TBAA-NOT: load
+; TBAA: ret i32 0
+define i32 @test4(i32* %P, float* %Q) {
+  %V1 = load i32* %P, !tbaa !1
+  store float 1.0, float* %Q, !tbaa !2
+  %V2 = load i32* %P, !tbaa !1
+  %R = sub i32 %V1, %V2
+  ret i32 %R
+}
+
+; A call cannot modify a local that has not escaped.
+; CHECK: @test5
+; CHECK: call void @unknown()
+; CHECK-NOT: load
+; CHECK: ret i32 %x
+define i32 @test5(i32 %x) {
+  %A = alloca i32
+  store i32 %x, i32* %A
+  call void @unknown()
+  %V = load i32* %A
+  ret i32 %V
+}
+
+declare void @unknown()
+
+!0 = metadata !{metadata !"root"}
+!1 = metadata !{metadata !"int", metadata !0}
+!2 = metadata !{metadata !"float", metadata !0}
@@ -0,0 +1,108 @@
+; RUN: opt < %s -basicaa -functionattrs -S | FileCheck %s
+
+@g = global i32 0
+@h = global i32 0
+
+; The argument is only read, but the function writes other memory.
+; CHECK: define void @copy_to_global(i32* nocapture nonnull readonly %p)
+define void @copy_to_global(i32* %p) {
+entry:
+  %v = load i32* %p
+  store i32 %v, i32* @g
+  ret void
+}
+
+; Passing the pointer where it is not dereferenced does not access memory
+; through it.
+declare void @ignore(i32* nocapture readnone)
+
+; CHECK: define void @passes_along(i32* nocapture readnone %p)
+define void @passes_along(i32* %p) {
+entry:
+  call void @ignore(i32* %p)
+  store i32 1, i32* @g
+  ret void
+}
+
+; CHECK: define void @store_through(i32* nocapture nonnull %p)
+define void @store_through(i32* %p) {
+entry:
+  store i32 0, i32* %p
+  ret void
+}
+
+; The callee's readonly argument is picked up bottom-up.  The call might not
+; return, so %p is not known to be nonnull.
+; CHECK: define void @calls_reader(i32* nocapture readonly %p)
+define void @calls_reader(i32* %p) {
+entry:
+  call void @copy_to_global(i32* %p)
+  store i32 1, i32* @h
+  ret void
+}
+
+; Self recursion through the same argument keeps it readonly.
+; CHECK: define void @recurse(i32* nocapture readonly %p, i32 %n)
+define void @recurse(i32* %p, i32 %n) {
+entry:
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %done, label %more
+
+more:
+  %v = load i32* %p
+  store i32 %v, i32* @g
+  %m = sub i32 %n, 1
+  call void @recurse(i32* %p, i32 %m)
+  br label %done
+
+done:
+  ret void
+}
+
+; A load that only happens on some paths says nothing about null.
+; CHECK: define void @cond_load(i32* nocapture readonly %p, i1 %c)
+define void @cond_load(i32* %p, i1 %c) {
+entry:
+  br i1 %c, label %load, label %done
+
+load:
+  %v = load i32* %p
+  store i32 %v, i32* @g
+  br label %done
+
+done:
+  ret void
+}
+
+; CHECK: define nonnull i8* @pick_global(i1 %c)
+define i8* @pick_global(i1 %c) {
+entry:
+  %r = select i1 %c, i8* bitcast (i32* @g to i8*), i8* bitcast (i32* @h to i8*)
+  ret i8* %r
+}
+
+; CHECK: define nonnull i32* @gep_of_nonnull(i32* nonnull %p)
+define i32* @gep_of_nonnull(i32* nonnull %p) {
+entry:
+  %q = getelementptr inbounds i32* %p, i32 1
+  ret i32* %q
+}
+
+; CHECK: define i32* @maybe_null(i1 %c)
+define i32* @maybe_null(i1 %c) {
+entry:
+  %r = select i1 %c, i32* @g, i32* null
+  ret i32* %r
+}
+
+; CHECK: define nonnull i32* @returns_nonnull_call()
+define i32* @returns_nonnull_call() {
+entry:
+  %r = call i32* @pick_global_i32()
+  ret i32* %r
+}
+
+define i32* @pick_global_i32() {
+entry:
+  ret i32* @h
+}
@@ -0,0 +1,48 @@
+; RUN: opt < %s -globalopt -S | FileCheck %s
+; RUN: opt < %s -globalopt -globalopt-ctor-eval-limit=20 -S | FileCheck %s -check-prefix=LIMIT
+
+; Static constructors that fill tables in a loop are evaluated, and stores
+; into parts of an aggregate are visible to later loads of the whole.
+
+@llvm.global_ctors = appending global [2 x { i32, void ()* }] [{ i32, void ()* } { i32 65535, void ()* @fill }, { i32, void ()* } { i32 65535, void ()* @copy }]
+
+; CHECK: @T = global [4 x { i32, i32 }] [{ i32, i32 } { i32 0, i32 3 }, { i32, i32 } { i32 1, i32 4 }, { i32, i32 } { i32 2, i32 5 }, { i32, i32 } { i32 3, i32 6 }]
+@T = global [4 x { i32, i32 }] zeroinitializer
+; CHECK: @Copy = global { i32, i32 } { i32 2, i32 5 }
+@Copy = global { i32, i32 } zeroinitializer
+; CHECK: @Fib = global [2 x i32] [i32 2, i32 3]
+@Fib = global [2 x i32] zeroinitializer
+
+; CHECK-NOT: @fill
+; CHECK-NOT: @copy
+; LIMIT: define internal void @fill()
+define internal void @fill() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  ; Swapping PHIs read their values from the previous iteration.
+  %a = phi i32 [ 0, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 1, %entry ], [ %ab, %loop ]
+  %ab = add i32 %a, %b
+  %first = getelementptr inbounds [4 x { i32, i32 }]* @T, i32 0, i32 %i, i32 0
+  store i32 %i, i32* %first
+  %second = getelementptr inbounds [4 x { i32, i32 }]* @T, i32 0, i32 %i, i32 1
+  %i.3 = add i32 %i, 3
+  store i32 %i.3, i32* %second
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 4
+  br i1 %done, label %exit, label %loop
+
+exit:
+  store i32 %a, i32* getelementptr inbounds ([2 x i32]* @Fib, i32 0, i32 0)
+  store i32 %b, i32* getelementptr inbounds ([2 x i32]* @Fib, i32 0, i32 1)
+  ret void
+}
+
+define internal void @copy() {
+  %elt = load { i32, i32 }* getelementptr inbounds ([4 x { i32, i32 }]* @T, i32 0, i32 2)
+  store { i32, i32 } %elt, { i32, i32 }* @Copy
+  ret void
+}
@@ -598,3 +598,20 @@ unreachableblock:
   %Y = icmp eq i32* %X, null
   ret i1 %Y
 }
+
+define i1 @nonnull_arg(i32* nonnull %p) {
+  %c = icmp eq i32* %p, null
+  ret i1 %c
+; CHECK: @nonnull_arg
+; CHECK: ret i1 false
+}
+
+declare nonnull i32* @returns_nonnull()
+
+define i1 @nonnull_call() {
+  %p = call i32* @returns_nonnull()
+  %c = icmp ne i32* %p, null
+  ret i1 %c
+; CHECK: @nonnull_call
+; CHECK: ret i1 true
+}
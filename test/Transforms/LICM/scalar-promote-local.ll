@@ -0,0 +1,84 @@
+; RUN: opt < %s -basicaa -licm -S | FileCheck %s
+
+; A conditionally stored accumulator in a non-escaping alloca is promoted:
+; no other thread can see the store that is added on the exit path.
+
+declare void @use(i32*)
+
+define i32 @cond_accumulate(i32 %n, i32* %p) nounwind {
+; CHECK: @cond_accumulate
+; CHECK: entry:
+; CHECK: %acc.promoted = load i32* %acc, align 4
+; CHECK: for.body:
+; CHECK-NOT: load i32* %acc
+; CHECK-NOT: store i32 {{.*}}, i32* %acc
+; CHECK: for.end:
+; CHECK-NEXT: store i32 %new2, i32* %acc, align 4
+entry:
+  %acc = alloca i32, align 4
+  store i32 0, i32* %acc, align 4
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr i32* %p, i32 %i
+  %x = load i32* %idx, align 4
+  %pos = icmp sgt i32 %x, 0
+  br i1 %pos, label %if.then, label %for.inc
+
+if.then:
+  %old = load i32* %acc, align 4
+  %new = add nsw i32 %old, %x
+  store i32 %new, i32* %acc, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  %r = load i32* %acc, align 4
+  ret i32 %r
+}
+
+; The same loop with an escaping alloca must keep the conditional store.
+define i32 @cond_accumulate_escape(i32 %n, i32* %p) nounwind {
+; CHECK: @cond_accumulate_escape
+; CHECK: if.then:
+; CHECK-NEXT: load i32* %acc
+; CHECK-NEXT: add
+; CHECK-NEXT: store i32 %new, i32* %acc
+entry:
+  %acc = alloca i32, align 4
+  call void @use(i32* %acc)
+  br label %for.cond
+
+for.cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.inc ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %idx = getelementptr i32* %p, i32 %i
+  %x = load i32* %idx, align 4
+  %pos = icmp sgt i32 %x, 0
+  br i1 %pos, label %if.then, label %for.inc
+
+if.then:
+  %old = load i32* %acc, align 4
+  %new = add nsw i32 %old, %x
+  store i32 %new, i32* %acc, align 4
+  br label %for.inc
+
+for.inc:
+  %i.next = add nsw i32 %i, 1
+  br label %for.cond
+
+for.end:
+  %r = load i32* %acc, align 4
+  ret i32 %r
+}
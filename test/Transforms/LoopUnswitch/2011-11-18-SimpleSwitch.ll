@@ -15,8 +15,7 @@
 
 ; CHECK:      loop_begin.us:                                    ; preds = %loop_begin.backedge.us, %.split.us
 ; CHECK-NEXT:   %var_val.us = load i32* %var
-; CHECK-NEXT:   switch i32 1, label %default.us-lcssa.us [
-; CHECK-NEXT:     i32 1, label %inc.us
+; CHECK-NEXT:   br label %inc.us
 
 ; CHECK:      inc.us:                                           ; preds = %loop_begin.us
 ; CHECK-NEXT:   call void @incf() noreturn nounwind
@@ -32,16 +31,13 @@
 ; CHECK:      .split.split.us:                                  ; preds = %.split
 ; CHECK-NEXT:   br label %loop_begin.us1
 
-; CHECK:      loop_begin.us1:                                   ; preds = %loop_begin.backedge.us5, %.split.split.us
+; CHECK:      loop_begin.us1:                                   ; preds = %loop_begin.backedge.us3, %.split.split.us
 ; CHECK-NEXT:   %var_val.us2 = load i32* %var
-; CHECK-NEXT:   switch i32 2, label %default.us-lcssa.us-lcssa.us [
-; CHECK-NEXT:     i32 1, label %inc.us3
-; CHECK-NEXT:     i32 2, label %dec.us4
-; CHECK-NEXT:   ]
+; CHECK-NEXT:   br label %dec.us
 
-; CHECK:      dec.us4:                                          ; preds = %loop_begin.us1
+; CHECK:      dec.us:                                           ; preds = %loop_begin.us1
 ; CHECK-NEXT:   call void @decf() noreturn nounwind
-; CHECK-NEXT:   br label %loop_begin.backedge.us5
+; CHECK-NEXT:   br label %loop_begin.backedge.us3
 
 ; CHECK:      .split.split:                                     ; preds = %.split..split.split_crit_edge
 ; CHECK-NEXT:   br label %loop_begin
@@ -57,7 +53,7 @@
 ; CHECK-NEXT:   br i1 true, label %us-unreachable.us-lcssa, label %inc.split
 
 ; CHECK:      dec:                                              ; preds = %loop_begin
-; CHECK-NEXT:   br i1 true, label %us-unreachable6, label %dec.split
+; CHECK-NEXT:   br i1 true, label %us-unreachable4, label %dec.split
 
 define i32 @test(i32* %var) {
   %mem = alloca i32
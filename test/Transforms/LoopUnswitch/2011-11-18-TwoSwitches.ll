@@ -1,8 +1,16 @@
 ; RUN: opt -loop-unswitch -loop-unswitch-threshold 1000 -disable-output -stats -info-output-file - < %s | FileCheck --check-prefix=STATS %s
-; RUN: opt -S -loop-unswitch -loop-unswitch-threshold 1000 -verify-loop-info -verify-dom-info %s | FileCheck %s
+; RUN: opt -loop-unswitch -loop-unswitch-partial=false -loop-unswitch-threshold 1000 -disable-output -stats -info-output-file - < %s | FileCheck --check-prefix=FULL %s
+; RUN: opt -S -loop-unswitch -loop-unswitch-partial=false -loop-unswitch-threshold 1000 -verify-loop-info -verify-dom-info %s | FileCheck %s
 
+; By default the copy for %c == 1, which never reaches the second switch,
+; leaves that switch out and is not unswitched on %d again.
 ; STATS: 1 loop-simplify - Number of pre-header or exit blocks inserted
-; STATS: 3 loop-unswitch - Number of switches unswitched
+; STATS: 2 loop-unswitch - Number of switches unswitched
+; STATS: 2 loop-unswitch - Number of unswitches that cloned part of the loop
+
+; Cloning the whole loop unswitches that copy on %d as well.
+; FULL: 1 loop-simplify - Number of pre-header or exit blocks inserted
+; FULL: 3 loop-unswitch - Number of switches unswitched
 
 ; CHECK:        %1 = icmp eq i32 %c, 1
 ; CHECK-NEXT:   br i1 %1, label %.split.us, label %..split_crit_edge
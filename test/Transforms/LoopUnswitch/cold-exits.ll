@@ -0,0 +1,71 @@
+; RUN: opt < %s -S -loop-unswitch | FileCheck %s
+
+; Without profile data the early exits are predicted not taken, so the
+; invariant branch after them is not treated as cold and gets unswitched.
+
+; CHECK: define void @early_exits
+; CHECK: loop.us:
+define void @early_exits(i32* %p, i32 %n, i1 %c) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %x0 = load volatile i32* %p
+  %e0 = icmp eq i32 %x0, 0
+  br i1 %e0, label %exit, label %b1
+
+b1:
+  %x1 = load volatile i32* %p
+  %e1 = icmp eq i32 %x1, 1
+  br i1 %e1, label %exit, label %b2
+
+b2:
+  %x2 = load volatile i32* %p
+  %e2 = icmp eq i32 %x2, 2
+  br i1 %e2, label %exit, label %b3
+
+b3:
+  %x3 = load volatile i32* %p
+  %e3 = icmp eq i32 %x3, 3
+  br i1 %e3, label %exit, label %b4
+
+b4:
+  %x4 = load volatile i32* %p
+  %e4 = icmp eq i32 %x4, 4
+  br i1 %e4, label %exit, label %b5
+
+b5:
+  %x5 = load volatile i32* %p
+  %e5 = icmp eq i32 %x5, 5
+  br i1 %e5, label %exit, label %b6
+
+b6:
+  %x6 = load volatile i32* %p
+  %e6 = icmp eq i32 %x6, 6
+  br i1 %e6, label %exit, label %b7
+
+b7:
+  %x7 = load volatile i32* %p
+  %e7 = icmp eq i32 %x7, 7
+  br i1 %e7, label %exit, label %inv
+
+inv:
+  br i1 %c, label %a, label %b
+
+a:
+  store volatile i32 1, i32* %p
+  br label %latch
+
+b:
+  store volatile i32 2, i32* %p
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,123 @@
+; RUN: opt < %s -loop-unswitch -disable-output -stats -info-output-file - | FileCheck %s --check-prefix=STATS
+; RUN: opt < %s -loop-unswitch -loop-unswitch-cold-ratio=0 -disable-output -stats -info-output-file - | FileCheck %s --check-prefix=NOCOLD
+; RUN: opt < %s -loop-unswitch -loop-unswitch-function-growth=1000 -disable-output -stats -info-output-file - | FileCheck %s --check-prefix=GROWTH
+; RUN: opt < %s -S -loop-unswitch -loop-unswitch-trivial-only | FileCheck %s --check-prefix=TRIVIAL
+
+; STATS: 1 loop-unswitch - Number of branches unswitched
+; STATS: 1 loop-unswitch - Number of conditions too rarely executed to unswitch
+; STATS: 3 loop-unswitch - Number of selects unswitched
+; STATS: 3 loop-unswitch - Number of unswitches rejected by the growth budget
+; STATS: 1 loop-unswitch - Number of unswitches that are trivial
+
+; NOCOLD: 2 loop-unswitch - Number of branches unswitched
+; NOCOLD: 1 loop-unswitch - Number of unswitches that cloned part of the loop
+
+; GROWTH: 7 loop-unswitch - Number of selects unswitched
+; GROWTH-NOT: growth budget
+
+; TRIVIAL-NOT: .us:
+; TRIVIAL: define void @trivial
+; TRIVIAL: br i1 %c, label %entry.exit.split_crit_edge, label %entry.entry.split_crit_edge
+
+; The invariant branch is only reached on one iteration in a thousand.
+define void @cold(i32* %p, i32 %n, i1 %c, i1 %rare) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %x = load volatile i32* %p
+  %rare.cmp = icmp eq i32 %x, 0
+  br i1 %rare.cmp, label %rare.bb, label %latch, !prof !0
+
+rare.bb:
+  br i1 %c, label %a, label %b
+
+a:
+  store volatile i32 1, i32* %p
+  br label %latch
+
+b:
+  store volatile i32 2, i32* %p
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; Every copy of this loop is 40 instructions, so the budget is used up before
+; all eight versions for %c1, %c2 and %c3 have been created.
+define void @heavy(i32* %p, i32 %n, i1 %c1, i1 %c2, i1 %c3) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %x0 = select i1 %c1, i32 %i, i32 1
+  %x1 = select i1 %c2, i32 %i, i32 2
+  %x2 = select i1 %c3, i32 %i, i32 3
+  %x3 = add i32 %x0, 1
+  %x4 = add i32 %x1, 1
+  %x5 = add i32 %x2, 1
+  %x6 = add i32 %x3, 1
+  %x7 = add i32 %x4, 1
+  %x8 = add i32 %x5, 1
+  %x9 = add i32 %x6, 1
+  %x10 = add i32 %x7, 1
+  %x11 = add i32 %x8, 1
+  %v0 = add i32 %x0, 0
+  store volatile i32 %v0, i32* %p
+  %v1 = add i32 %x1, 1
+  store volatile i32 %v1, i32* %p
+  %v2 = add i32 %x2, 2
+  store volatile i32 %v2, i32* %p
+  %v3 = add i32 %x3, 3
+  store volatile i32 %v3, i32* %p
+  %v4 = add i32 %x4, 4
+  store volatile i32 %v4, i32* %p
+  %v5 = add i32 %x5, 5
+  store volatile i32 %v5, i32* %p
+  %v6 = add i32 %x6, 6
+  store volatile i32 %v6, i32* %p
+  %v7 = add i32 %x7, 7
+  store volatile i32 %v7, i32* %p
+  %v8 = add i32 %x8, 8
+  store volatile i32 %v8, i32* %p
+  %v9 = add i32 %x9, 9
+  store volatile i32 %v9, i32* %p
+  %v10 = add i32 %x10, 10
+  store volatile i32 %v10, i32* %p
+  %v11 = add i32 %x11, 11
+  store volatile i32 %v11, i32* %p
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+define void @trivial(i32* %p, i32 %n, i1 %c) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  br i1 %c, label %exit, label %body
+
+body:
+  store volatile i32 %i, i32* %p
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1000}
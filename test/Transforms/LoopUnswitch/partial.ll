@@ -0,0 +1,69 @@
+; RUN: opt < %s -S -loop-unswitch -verify-loop-info -verify-dom-info | FileCheck %s
+; RUN: opt < %s -S -loop-unswitch -loop-unswitch-partial=false | FileCheck %s --check-prefix=FULL
+
+; The version of the loop for %c == true only needs the 'then' region,
+; including its inner loop, and the other version only the 'else' block.
+
+; CHECK: define void @partial
+; CHECK: entry:
+; CHECK-NEXT: br i1 %c, label %entry.split.us, label %entry.entry.split_crit_edge
+
+; CHECK: loop.us:
+; CHECK-NEXT: %i.us = phi i32 [ 0, %entry.split.us ], [ %i.next.us, %latch.us ]
+; CHECK-NEXT: br label %then.us
+
+; CHECK: latch.us:
+; CHECK-NEXT: %v.us = phi i32 [ 1, %then.end.us ]
+
+; CHECK: inner.us:
+; CHECK: br i1 %inner.cmp.us, label %inner.us, label %then.end.us
+
+; CHECK: exit.us-lcssa.us:
+; CHECK-NEXT: %r.ph.us = phi i32 [ %i.next.us, %latch.us ]
+; CHECK-NEXT: br label %exit
+
+; CHECK-NOT: else.us
+
+; CHECK: loop:
+; CHECK: br i1 false, label %then, label %else
+
+; FULL: else.us:
+
+define void @partial(i32* %p, i32 %n, i1 %c) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %then, label %else
+
+then:
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %then ], [ %j.next, %inner ]
+  store volatile i32 %j, i32* %p
+  %j.next = add i32 %j, 1
+  %inner.cmp = icmp slt i32 %j.next, %n
+  br i1 %inner.cmp, label %inner, label %then.end
+
+then.end:
+  br label %latch
+
+else:
+  store volatile i32 %i, i32* %p
+  %else.cmp = icmp eq i32 %i, 42
+  br i1 %else.cmp, label %exit, label %latch
+
+latch:
+  %v = phi i32 [ 1, %then.end ], [ 2, %else ]
+  store volatile i32 %v, i32* %p
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ %i, %else ], [ %i.next, %latch ]
+  store volatile i32 %r, i32* %p
+  ret void
+}
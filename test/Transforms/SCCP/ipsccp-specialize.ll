@@ -0,0 +1,159 @@
+; RUN: opt < %s -ipsccp -ipsccp-specialize-budget=1000 -S | FileCheck %s
+; RUN: opt < %s -ipsccp -S | FileCheck %s -check-prefix=NOSPEC
+
+; An external function called with the same constant from two call sites
+; gets a specialized internal copy.  The call with a variable mode keeps
+; calling the original.
+
+define i32 @kernel(i32 %mode, i32 %x) {
+entry:
+  %c = icmp eq i32 %mode, 0
+  br i1 %c, label %add, label %mul
+
+add:
+  %a = add i32 %x, 1
+  ret i32 %a
+
+mul:
+  %m = mul i32 %x, 3
+  ret i32 %m
+}
+
+define i32 @caller(i32 %x, i32 %y) {
+  %r1 = call i32 @kernel(i32 0, i32 %x)
+  %r2 = call i32 @kernel(i32 0, i32 %y)
+  %r3 = call i32 @kernel(i32 %x, i32 %y)
+  %s1 = add i32 %r1, %r2
+  %s2 = add i32 %s1, %r3
+  ret i32 %s2
+}
+
+; CHECK: define i32 @caller
+; CHECK: call i32 @kernel.spec(i32 0, i32 %x)
+; CHECK: call i32 @kernel.spec(i32 0, i32 %y)
+; CHECK: call i32 @kernel(i32 %x, i32 %y)
+
+; NOSPEC: define i32 @caller
+; NOSPEC: call i32 @kernel(i32 0, i32 %x)
+; NOSPEC: call i32 @kernel(i32 0, i32 %y)
+
+; An internal function called with two different constants merges them to
+; overdefined; each pattern gets its own copy.
+
+define internal i32 @step(i32 %k, i32 %x) {
+entry:
+  switch i32 %k, label %other [ i32 1, label %one
+                                i32 2, label %two ]
+one:
+  %a = shl i32 %x, 1
+  ret i32 %a
+two:
+  %b = lshr i32 %x, 1
+  ret i32 %b
+other:
+  ret i32 0
+}
+
+define i32 @steps(i32 %x) {
+  %a = call i32 @step(i32 1, i32 %x)
+  %b = call i32 @step(i32 2, i32 %a)
+  %c = call i32 @step(i32 1, i32 %b)
+  %d = call i32 @step(i32 2, i32 %c)
+  ret i32 %d
+}
+
+; CHECK: define i32 @steps
+; CHECK: call i32 @[[ONE:step.spec[0-9]*]](i32 1, i32 %x)
+; CHECK: call i32 @[[TWO:step.spec[0-9]*]](i32 2,
+; CHECK: call i32 @[[ONE]](i32 1,
+; CHECK: call i32 @[[TWO]](i32 2,
+
+; A pattern used by only one call site is not worth a copy.
+
+define i32 @lonely(i32 %k) {
+  %c = icmp sgt i32 %k, 10
+  %r = select i1 %c, i32 %k, i32 10
+  ret i32 %r
+}
+
+define i32 @calls_lonely() {
+  %r = call i32 @lonely(i32 20)
+  ret i32 %r
+}
+
+; CHECK: define i32 @calls_lonely
+; CHECK: call i32 @lonely(i32 20)
+
+; A constant that is only stored folds nothing, so it is not worth a copy.
+
+define void @big(i32* %p, i32 %k) {
+  store i32 %k, i32* %p
+  %q = getelementptr i32* %p, i32 1
+  store i32 %k, i32* %q
+  ret void
+}
+
+define void @calls_big(i32* %p) {
+  call void @big(i32* %p, i32 1)
+  call void @big(i32* %p, i32 1)
+  call void @big(i32* %p, i32 2)
+  call void @big(i32* %p, i32 2)
+  ret void
+}
+
+; CHECK: define void @calls_big
+; CHECK: call void @big(i32* %p, i32 1)
+; CHECK: call void @big(i32* %p, i32 2)
+
+; Functions marked noinline or optsize are not copied.
+
+define i32 @noinline_kernel(i32 %mode, i32 %x) noinline {
+  %c = icmp eq i32 %mode, 0
+  %r = select i1 %c, i32 %x, i32 0
+  ret i32 %r
+}
+
+define i32 @optsize_kernel(i32 %mode, i32 %x) optsize {
+  %c = icmp eq i32 %mode, 0
+  %r = select i1 %c, i32 %x, i32 0
+  ret i32 %r
+}
+
+define i32 @calls_attributed(i32 %x) {
+  %a = call i32 @noinline_kernel(i32 0, i32 %x)
+  %b = call i32 @noinline_kernel(i32 0, i32 %a)
+  %c = call i32 @optsize_kernel(i32 0, i32 %b)
+  %d = call i32 @optsize_kernel(i32 0, i32 %c)
+  ret i32 %d
+}
+
+; CHECK: define i32 @calls_attributed
+; CHECK: call i32 @noinline_kernel(i32 0,
+; CHECK: call i32 @noinline_kernel(i32 0,
+; CHECK: call i32 @optsize_kernel(i32 0,
+; CHECK: call i32 @optsize_kernel(i32 0,
+
+; CHECK-NOT: define internal void @big.spec
+; CHECK-NOT: define internal i32 @noinline_kernel.spec
+; CHECK-NOT: define internal i32 @optsize_kernel.spec
+
+; The specialized copies have their constant folded in.
+
+; CHECK: define internal i32 @kernel.spec(i32 %mode, i32 %x)
+; CHECK-NOT: icmp
+; CHECK-NOT: mul
+; CHECK: add i32 %x, 1
+; CHECK-NOT: mul
+; CHECK: }
+
+; CHECK: define internal i32 @step.spec
+; CHECK-NOT: switch
+; CHECK: {{shl|lshr}} i32 %x, 1
+; CHECK: }
+
+; CHECK: define internal i32 @step.spec
+; CHECK-NOT: switch
+; CHECK: {{shl|lshr}} i32 %x, 1
+; CHECK: }
+
+; NOSPEC-NOT: .spec
@@ -18,11 +18,13 @@
 #include "llvm/PassManager.h"
 #include "llvm/Pass.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DataStream.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -249,6 +251,12 @@ UseInitArray("use-init-array",
   cl::desc("Use .init_array instead of .ctors."),
   cl::init(false));
 
+static cl::opt<bool>
+StreamingBitcode("streaming-bitcode",
+  cl::desc("Read bitcode as a stream and compile each function as soon as "
+           "its body has arrived"),
+  cl::init(false));
+
 // GetFileNameRoot - Helper function to get the basename of a filename.
 static inline std::string
 GetFileNameRoot(const std::string &InputFilename) {
@@ -327,6 +335,33 @@ static tool_output_file *GetOutputStream(const char *TargetName,
   return FDOut;
 }
 
+/// CompileStreamedModule - Materialize the functions of a streamed module in
+/// the order their bodies appear in the stream, and run the code generator on
+/// each one as soon as it has been read.  Reading the rest of the input thus
+/// overlaps with compiling what has already arrived.
+static bool CompileStreamedModule(Module &M, FunctionPassManager &FPM,
+                                  const char *ProgName) {
+  std::string ErrorMessage;
+  FPM.doInitialization();
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->Materialize(&ErrorMessage)) {
+      errs() << ProgName << ": " << ErrorMessage << "\n";
+      return true;
+    }
+    if (!I->isDeclaration())
+      FPM.run(*I);
+  }
+
+  // Pick up anything that follows the function bodies before the module-level
+  // parts of the output are written.
+  if (M.MaterializeAll(&ErrorMessage)) {
+    errs() << ProgName << ": " << ErrorMessage << "\n";
+    return true;
+  }
+  FPM.doFinalization();
+  return false;
+}
+
 // main - Entry point for the llc compiler.
 //
 int main(int argc, char **argv) {
@@ -354,10 +389,26 @@ int main(int argc, char **argv) {
   SMDiagnostic Err;
   std::auto_ptr<Module> M;
 
-  M.reset(ParseIRFile(InputFilename, Err, Context));
-  if (M.get() == 0) {
-    Err.print(argv[0], errs());
-    return 1;
+  if (StreamingBitcode) {
+    std::string ErrorMessage;
+    DataStreamer *Streamer = getDataFileStreamer(InputFilename, &ErrorMessage);
+    if (Streamer) {
+      std::string DisplayFilename = InputFilename;
+      if (InputFilename == "-")
+        DisplayFilename = "<stdin>";
+      M.reset(getStreamedBitcodeModule(DisplayFilename, Streamer, Context,
+                                       &ErrorMessage));
+    }
+    if (M.get() == 0) {
+      errs() << argv[0] << ": " << ErrorMessage << "\n";
+      return 1;
+    }
+  } else {
+    M.reset(ParseIRFile(InputFilename, Err, Context));
+    if (M.get() == 0) {
+      Err.print(argv[0], errs());
+      return 1;
+    }
   }
   Module &mod = *M.get();
 
@@ -453,8 +504,12 @@ int main(int argc, char **argv) {
     (GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]));
   if (!Out) return 1;
 
-  // Build up all of the passes that we want to do to the module.
-  PassManager PM;
+  // Build up all of the passes that we want to do to the module.  A streamed
+  // module is compiled a function at a time, as its bodies arrive.
+  PassManager MPM;
+  FunctionPassManager FPM(&mod);
+  PassManagerBase &PM = StreamingBitcode ? static_cast<PassManagerBase&>(FPM)
+                                         : MPM;
 
   // Add the target data from the target machine, if it exists, or the module.
   if (const TargetData *TD = Target.getTargetData())
@@ -486,7 +541,12 @@ int main(int argc, char **argv) {
     // Before executing passes, print the final values of the LLVM options.
     cl::PrintOptionValues();
 
-    PM.run(mod);
+    if (StreamingBitcode) {
+      if (CompileStreamedModule(mod, FPM, argv[0]))
+        return 1;
+    } else {
+      MPM.run(mod);
+    }
   }
 
   // Declare success.
@@ -175,6 +175,17 @@ namespace {
     cl::Hidden,
     cl::desc("Emit debug info objfiles to disk"),
     cl::init(false));
+
+  cl::opt<bool>
+  EmitPerfMap("jit-perf-map",
+    cl::desc("Describe JITted functions in /tmp/perf-<pid>.map for perf"),
+    cl::init(false));
+
+  cl::opt<bool>
+  EmitPerfJITDump("jit-perf-dump",
+    cl::desc("Also write code and line tables to jit-<pid>.dump for "
+             "'perf inject --jit'"),
+    cl::init(false));
 }
 
 static ExecutionEngine *EE = 0;
@@ -476,6 +487,9 @@ int main(int argc, char **argv, char * const *envp) {
                 JITEventListener::createOProfileJITEventListener());
   EE->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
+  if (EmitPerfMap || EmitPerfJITDump)
+    EE->RegisterJITEventListener(
+                JITEventListener::createPerfJITEventListener(EmitPerfJITDump));
 
   EE->DisableLazyCompilation(NoLazyCompilation);
 
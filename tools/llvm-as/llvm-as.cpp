@@ -46,6 +46,9 @@ DisableOutput("disable-output", cl::desc("Disable output"), cl::init(false));
 static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as parsed"), cl::Hidden);
 
+static cl::opt<bool>
+Compress("compress", cl::desc("Write a compressed bitcode container"));
+
 static cl::opt<bool>
 DisableVerify("disable-verify", cl::Hidden,
               cl::desc("Do not run verifier on input LLVM (dangerous!)"));
@@ -77,8 +80,12 @@ static void WriteOutputFile(const Module *M) {
     exit(1);
   }
 
-  if (Force || !CheckBitcodeOutputToConsole(Out->os(), true))
-    WriteBitcodeToFile(M, Out->os());
+  if (Force || !CheckBitcodeOutputToConsole(Out->os(), true)) {
+    if (Compress)
+      WriteCompressedBitcodeToFile(M, Out->os());
+    else
+      WriteBitcodeToFile(M, Out->os());
+  }
 
   // Declare success.
   Out->keep();
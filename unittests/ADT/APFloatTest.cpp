@@ -677,4 +677,68 @@ TEST(APFloatTest, convert) {
   EXPECT_EQ(4294967295.0, test.convertToDouble());
   EXPECT_FALSE(losesInfo);
 }
+
+// Evaluate Op on L and R in Sem, and compare the result and status against
+// the same operation done in IEEEquad and rounded back to Sem.  Quad has more
+// than twice the precision of double plus two bits, so the double rounding
+// gives the correctly rounded result.
+static void checkAgainstQuad(const fltSemantics &Sem, const char *L,
+                             const char *R, char Op) {
+  APFloat::roundingMode RM = APFloat::rmNearestTiesToEven;
+  APFloat Test(Sem, L), RHS(Sem, R);
+  APFloat Ref(Test), RefRHS(RHS);
+  bool LosesInfo;
+  Ref.convert(APFloat::IEEEquad, RM, &LosesInfo);
+  RefRHS.convert(APFloat::IEEEquad, RM, &LosesInfo);
+  APFloat::opStatus TestStatus, RefStatus;
+  switch (Op) {
+  case '+':
+    TestStatus = Test.add(RHS, RM);
+    RefStatus = Ref.add(RefRHS, RM);
+    break;
+  case '-':
+    TestStatus = Test.subtract(RHS, RM);
+    RefStatus = Ref.subtract(RefRHS, RM);
+    break;
+  case '*':
+    TestStatus = Test.multiply(RHS, RM);
+    RefStatus = Ref.multiply(RefRHS, RM);
+    break;
+  default:
+    TestStatus = Test.divide(RHS, RM);
+    RefStatus = Ref.divide(RefRHS, RM);
+    break;
+  }
+  RefStatus = APFloat::opStatus(RefStatus | Ref.convert(Sem, RM, &LosesInfo));
+  EXPECT_TRUE(Test.bitwiseIsEqual(Ref)) << L << ' ' << Op << ' ' << R;
+  EXPECT_EQ(RefStatus, TestStatus) << L << ' ' << Op << ' ' << R;
+}
+
+TEST(APFloatTest, basicArithmetic) {
+  static const char *const Values[] = {
+    "1.0", "-3.0", "0.1", "0.2", "1e30", "-1e-30", "0x1p-1000", "0x1p+1000",
+    "0x1.fffffep+127", "0x1p-126", "0x1p-149", "1.5", "7.0", "-0.0", "0.0"
+  };
+  static const char Ops[] = { '+', '-', '*', '/' };
+  const unsigned NumValues = sizeof(Values) / sizeof(Values[0]);
+  for (unsigned I = 0; I != NumValues; ++I)
+    for (unsigned J = 0; J != NumValues; ++J)
+      for (unsigned K = 0; K != 4; ++K) {
+        checkAgainstQuad(APFloat::IEEEsingle, Values[I], Values[J], Ops[K]);
+        checkAgainstQuad(APFloat::IEEEdouble, Values[I], Values[J], Ops[K]);
+      }
+
+  APFloat F(0.1f);
+  EXPECT_EQ(APFloat::opInexact, F.add(APFloat(0.2f),
+                                      APFloat::rmNearestTiesToEven));
+  EXPECT_EQ(0.1f + 0.2f, F.convertToFloat());
+
+  APFloat D(3.0);
+  EXPECT_EQ(APFloat::opOK, D.multiply(APFloat(5.0),
+                                      APFloat::rmNearestTiesToEven));
+  EXPECT_EQ(15.0, D.convertToDouble());
+  EXPECT_EQ(APFloat::opInexact, D.divide(APFloat(7.0),
+                                         APFloat::rmNearestTiesToEven));
+  EXPECT_EQ(15.0 / 7.0, D.convertToDouble());
+}
 }
@@ -514,4 +514,34 @@ TEST(APIntTest, Rotate) {
   EXPECT_EQ(Rot, Big.rotr(144));
 }
 
+TEST(APIntTest, CompareWithRawIntegers) {
+  // The immediate is truncated to the bit width, or zero extended.
+  EXPECT_TRUE(APInt(8, 7).ult(264));
+  EXPECT_FALSE(APInt(8, 9).ult(264));
+  EXPECT_TRUE(APInt(8, 255).slt(1));
+  EXPECT_FALSE(APInt(8, 1).slt(255));
+
+  APInt Big(128, 5);
+  EXPECT_TRUE(Big.ult(6));
+  EXPECT_FALSE(Big.ult(5));
+  EXPECT_TRUE(Big.slt(uint64_t(-1)));
+  EXPECT_TRUE((-Big).slt(0));
+  EXPECT_FALSE((-Big).ult(uint64_t(-1)));
+  EXPECT_FALSE(Big.shl(64).ult(uint64_t(-1)));
+  EXPECT_FALSE(Big.shl(64).slt(uint64_t(-1)));
+}
+
+TEST(APIntTest, SingleWordResize) {
+  EXPECT_EQ(APInt(32, 0xfffffff0u), APInt(8, 0xf0).sext(32));
+  EXPECT_EQ(APInt(32, 0x70), APInt(8, 0x70).sext(32));
+  EXPECT_EQ(-1, APInt(1, 1).sext(64).getSExtValue());
+  EXPECT_EQ(APInt(32, 0xf0), APInt(8, 0xf0).zext(32));
+  EXPECT_EQ(APInt(8, 0x34), APInt(32, 0x1234).trunc(8));
+  EXPECT_EQ(APInt(64, 1), (APInt(128, 1).shl(64) + 1).trunc(64));
+  EXPECT_EQ(APInt(8, 0xfe).udiv(APInt(8, 0x10)), APInt(8, 0xf));
+  EXPECT_EQ(APInt(8, 0xfe).urem(APInt(8, 0x10)), APInt(8, 0xe));
+  EXPECT_EQ(8u, APInt(8, 0).countTrailingZeros());
+  EXPECT_EQ(4u, APInt(8, 0x30).countTrailingZeros());
+}
+
 }
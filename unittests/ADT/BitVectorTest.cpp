@@ -281,5 +281,86 @@ TYPED_TEST(BitVectorTest, BinOps) {
   EXPECT_FALSE(A.anyCommon(B));
   EXPECT_FALSE(B.anyCommon(A));
 }
+
+TYPED_TEST(BitVectorTest, LargeBulkOps) {
+  // Large enough that the blocked loops in BitVector are exercised, with a
+  // tail of partial blocks.
+  TypeParam A(1000), B(1000);
+  EXPECT_FALSE(A.anyCommon(B));
+  EXPECT_TRUE(A == B);
+
+  A.set(999);
+  EXPECT_FALSE(A.anyCommon(B));
+  EXPECT_FALSE(A == B);
+  B.set(999);
+  EXPECT_TRUE(A.anyCommon(B));
+  EXPECT_TRUE(A == B);
+
+  B.reset(999);
+  B.set(70);
+  EXPECT_FALSE(A.anyCommon(B));
+  EXPECT_FALSE(A == B);
+
+  A.set();
+  EXPECT_TRUE(A.all());
+  A.reset(500);
+  EXPECT_FALSE(A.all());
+  A.resize(1024, true);
+  A.set(500);
+  EXPECT_TRUE(A.all());
+  EXPECT_TRUE(TypeParam().all());
+}
+
+TYPED_TEST(BitVectorTest, LargeFindAndCount) {
+  // count adds up blocks of words at a time, with a tail of single words.
+  TypeParam A(2000);
+  EXPECT_EQ(-1, A.find_first());
+  EXPECT_EQ(0U, A.count());
+
+  unsigned Set[] = { 1, 63, 64, 300, 301, 1023, 1024, 1999 };
+  unsigned NumSet = sizeof(Set) / sizeof(Set[0]);
+  for (unsigned i = 0; i != NumSet; ++i)
+    A.set(Set[i]);
+  EXPECT_EQ(NumSet, A.count());
+
+  int Idx = A.find_first();
+  for (unsigned i = 0; i != NumSet; ++i) {
+    EXPECT_EQ((int)Set[i], Idx);
+    Idx = A.find_next(Idx);
+  }
+  EXPECT_EQ(-1, Idx);
+  EXPECT_EQ(1999, A.find_next(1025));
+  EXPECT_EQ(-1, A.find_next(1999));
+
+  A.set();
+  EXPECT_EQ(2000U, A.count());
+  for (unsigned i = 0; i != 1990; ++i)
+    A.reset(i);
+  EXPECT_EQ(10U, A.count());
+  EXPECT_EQ(1990, A.find_first());
+}
+
+TYPED_TEST(BitVectorTest, UnionWith) {
+  TypeParam A(10), B(10);
+  EXPECT_FALSE(A.unionWith(B));
+
+  B.set(3);
+  EXPECT_TRUE(A.unionWith(B));
+  EXPECT_TRUE(A.test(3));
+  EXPECT_FALSE(A.unionWith(B));
+
+  // Growing to a larger size only reports a change if new bits get set.
+  TypeParam C(300);
+  EXPECT_FALSE(A.unionWith(C));
+  EXPECT_EQ(300U, A.size());
+  EXPECT_EQ(1U, A.count());
+
+  C.set(299);
+  C.set(3);
+  EXPECT_TRUE(A.unionWith(C));
+  EXPECT_EQ(2U, A.count());
+  EXPECT_TRUE(A == C);
+  EXPECT_FALSE(A.unionWith(A));
+}
 }
 #endif
@@ -0,0 +1,86 @@
+//===- ValueTrackingTest.cpp - ValueTracking unit tests -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/Function.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Support/IRBuilder.h"
+#include "gtest/gtest.h"
+
+namespace llvm {
+namespace {
+
+class ValueTrackingTest : public testing::Test {
+protected:
+  ValueTrackingTest() : M("", Context), Builder(Context) {
+    Type *I8 = Type::getInt8Ty(Context);
+    Type *Params[] = { I8, I8 };
+    FunctionType *FTy =
+      FunctionType::get(Type::getVoidTy(Context), Params, false);
+    F = Function::Create(FTy, GlobalValue::ExternalLinkage, "f", &M);
+    Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", F));
+  }
+
+  /// buildDAG - Build Levels rounds of X' = (X+Y) >>s 1, Y' = (X-Y) >>s 1,
+  /// starting from the sign-extended arguments.  Every value is used twice,
+  /// and both uses are at the same depth from the root.
+  Value *buildDAG(unsigned Levels) {
+    Function::arg_iterator AI = F->arg_begin();
+    Type *I32 = Type::getInt32Ty(Context);
+    Value *X = Builder.CreateSExt(AI++, I32);
+    Value *Y = Builder.CreateSExt(AI, I32);
+    for (unsigned i = 0; i != Levels; ++i) {
+      Value *NewX = Builder.CreateAShr(Builder.CreateAdd(X, Y), 1);
+      Y = Builder.CreateAShr(Builder.CreateSub(X, Y), 1);
+      X = NewX;
+    }
+    return Builder.CreateXor(X, Y);
+  }
+
+  /// cloneTree - Copy the expression rooted at V, duplicating every shared
+  /// instruction, so that no value is reached along more than one path.
+  Value *cloneTree(Value *V) {
+    Instruction *I = dyn_cast<Instruction>(V);
+    if (!I)
+      return V;
+    Instruction *Clone = I->clone();
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+      Clone->setOperand(i, cloneTree(I->getOperand(i)));
+    return Builder.Insert(Clone);
+  }
+
+  LLVMContext Context;
+  Module M;
+  IRBuilder<> Builder;
+  Function *F;
+};
+
+// The per-query caches must give the same answers as walking the equivalent
+// tree, where nothing can be reused.
+TEST_F(ValueTrackingTest, CachedQueriesMatchTree) {
+  for (unsigned Levels = 0; Levels != 4; ++Levels) {
+    Value *DAG = buildDAG(Levels);
+    Value *Tree = cloneTree(DAG);
+
+    unsigned DAGSignBits = ComputeNumSignBits(DAG);
+    EXPECT_EQ(ComputeNumSignBits(Tree), DAGSignBits);
+    EXPECT_LT(1U, DAGSignBits);
+
+    APInt DAGZero(32, 0), DAGOne(32, 0), TreeZero(32, 0), TreeOne(32, 0);
+    ComputeMaskedBits(DAG, DAGZero, DAGOne);
+    ComputeMaskedBits(Tree, TreeZero, TreeOne);
+    EXPECT_EQ(TreeZero, DAGZero);
+    EXPECT_EQ(TreeOne, DAGOne);
+  }
+}
+
+}
+}
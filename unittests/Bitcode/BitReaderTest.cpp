@@ -7,6 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
@@ -16,6 +18,7 @@
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/DataStream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
 
@@ -61,5 +64,74 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+static void appendInt32(std::string &S, uint32_t V) {
+  for (unsigned i = 0; i != 4; ++i)
+    S += char(V >> (i * 8));
+}
+
+static std::string makeCompressedHeader(uint32_t BitcodeSize,
+                                        uint32_t NumChunks,
+                                        uint32_t DictionarySize,
+                                        uint32_t DictionaryStoredSize,
+                                        StringRef ChunkIndex) {
+  std::string S("BCZ\x01", 4);
+  appendInt32(S, BitcodeSize);
+  appendInt32(S, NumChunks);
+  appendInt32(S, DictionarySize);
+  appendInt32(S, DictionaryStoredSize);
+  S += ChunkIndex;
+  S += "BC\xC0\xDE";
+  return S;
+}
+
+/// StringStreamer - Streams the bytes of a string, a few at a time.
+class StringStreamer : public DataStreamer {
+  std::string Data;
+  size_t Pos;
+public:
+  explicit StringStreamer(const std::string &Data) : Data(Data), Pos(0) {}
+  virtual size_t GetBytes(unsigned char *Buf, size_t Len) {
+    size_t N = std::min<size_t>(std::min<size_t>(Len, 3), Data.size() - Pos);
+    memcpy(Buf, Data.data() + Pos, N);
+    Pos += N;
+    return N;
+  }
+};
+
+struct CompressedHeader {
+  uint32_t BitcodeSize, NumChunks, DictionarySize, DictionaryStoredSize;
+  const char *ChunkIndex;
+};
+
+TEST(BitReaderTest, RejectsOversizedCompressedHeader) {
+  const CompressedHeader Headers[] = {
+    // More chunks than the input can hold.
+    { 4, 0xFFFFFFFF, 0, 0, "\x04\x04" },
+    // Dictionary larger than any writer's.
+    { 4, 1, 0xFFFFFFFF, 0, "\x04\x04" },
+    // A chunk of almost 4G in one stored byte.
+    { 0xFFFFFFF0, 1, 0, 0, "\xF0\xFF\xFF\xFF\x0F\x01" },
+    // A chunk stored as is that is larger than the rest of the input.
+    { 0xFFFFFFF0, 1, 0, 0, "\xF0\xFF\xFF\xFF\x0F\xF0\xFF\xFF\xFF\x0F" },
+  };
+  for (unsigned i = 0; i != array_lengthof(Headers); ++i) {
+    std::string Data =
+      makeCompressedHeader(Headers[i].BitcodeSize, Headers[i].NumChunks,
+                           Headers[i].DictionarySize,
+                           Headers[i].DictionaryStoredSize,
+                           Headers[i].ChunkIndex);
+    OwningPtr<MemoryBuffer> Buffer(
+      MemoryBuffer::getMemBuffer(Data, "test", false));
+    std::string ErrMsg;
+    EXPECT_EQ(0, ParseBitcodeFile(Buffer.get(), getGlobalContext(), &ErrMsg));
+    EXPECT_FALSE(ErrMsg.empty());
+
+    ErrMsg.clear();
+    EXPECT_EQ(0, getStreamedBitcodeModule("test", new StringStreamer(Data),
+                                          getGlobalContext(), &ErrMsg));
+    EXPECT_FALSE(ErrMsg.empty());
+  }
+}
+
 }
 }
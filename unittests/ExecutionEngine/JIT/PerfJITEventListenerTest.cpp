@@ -0,0 +1,171 @@
+//===- PerfJITEventListenerTest.cpp - Unit tests for PerfJITEventListener -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "JITEventListenerTestCommon.h"
+
+#include <cstring>
+
+#if LLVM_ON_UNIX
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+#if LLVM_ON_UNIX
+
+namespace {
+
+// The listener talks to files rather than to a profiling library, so there is
+// nothing to mock.
+struct NoWrapper {};
+
+template<typename T>
+T readField(const char *&Ptr) {
+  T Value;
+  memcpy(&Value, Ptr, sizeof(T));
+  Ptr += sizeof(T);
+  return Value;
+}
+
+class PerfJITEventListenerTest : public JITEventListenerTestBase<NoWrapper> {
+protected:
+  SmallString<128> MapPath;
+  SmallString<128> DumpPath;
+
+  void makeTempFile(const char *Model, SmallString<128> &Path) {
+    int FD;
+    ASSERT_FALSE(sys::fs::unique_file(Model, FD, Path));
+    ::close(FD);
+  }
+
+  virtual void SetUp() {
+    makeTempFile("perf-jit-test-%%%%%%.map", MapPath);
+    makeTempFile("perf-jit-test-%%%%%%.dump", DumpPath);
+    Listener.reset(JITEventListener::createPerfJITEventListener(MapPath,
+                                                                DumpPath));
+    ASSERT_TRUE(0 != Listener);
+    EE->RegisterJITEventListener(Listener.get());
+  }
+
+  virtual void TearDown() {
+    bool Existed;
+    sys::fs::remove(MapPath.str(), Existed);
+    sys::fs::remove(DumpPath.str(), Existed);
+  }
+
+  // Unregisters and destroys the listener, so that the jitdump file is
+  // complete, and returns the contents of File.
+  std::string finishAndRead(StringRef File) {
+    EE->UnregisterJITEventListener(Listener.get());
+    Listener.reset();
+    OwningPtr<MemoryBuffer> Buffer;
+    if (MemoryBuffer::getFile(File, Buffer))
+      return "";
+    return Buffer->getBuffer();
+  }
+
+public:
+  PerfJITEventListenerTest()
+  : JITEventListenerTestBase<NoWrapper>(new NoWrapper) {
+  }
+};
+
+TEST_F(PerfJITEventListenerTest, PerfMap) {
+  SourceLocations DebugLocations;
+  Function *F = buildFunction(DebugLocations);
+  void *Code = EE->getPointerToFunction(F);
+  ASSERT_TRUE(0 != Code);
+
+  std::string Map = finishAndRead(MapPath);
+  ASSERT_FALSE(Map.empty());
+
+  // "<start> <size> <name>\n", both numbers in hex without a 0x prefix.
+  std::string Expected;
+  raw_string_ostream OS(Expected);
+  OS.write_hex(reinterpret_cast<uintptr_t>(Code));
+  OS.flush();
+  EXPECT_EQ(Expected + " ", Map.substr(0, Expected.size() + 1));
+  EXPECT_EQ(" id\n", Map.substr(Map.size() - 4));
+}
+
+TEST_F(PerfJITEventListenerTest, JITDump) {
+  SourceLocations DebugLocations;
+  DebugLocations.push_back(std::make_pair(std::string(getFilename()),
+                                          getLine()));
+  DebugLocations.push_back(std::make_pair(std::string(getFilename()),
+                                          getLine() + 1));
+  Function *F = buildFunction(DebugLocations);
+  void *Code = EE->getPointerToFunction(F);
+  ASSERT_TRUE(0 != Code);
+
+  std::string Dump = finishAndRead(DumpPath);
+  ASSERT_LE(40u, Dump.size());
+
+  const char *Ptr = Dump.data();
+  const char *End = Ptr + Dump.size();
+  EXPECT_EQ(0x4A695444u, readField<uint32_t>(Ptr));
+  EXPECT_EQ(1u, readField<uint32_t>(Ptr));
+  EXPECT_EQ(40u, readField<uint32_t>(Ptr));
+  readField<uint32_t>(Ptr); // elf_mach
+  readField<uint32_t>(Ptr); // pad1
+  EXPECT_EQ(uint32_t(::getpid()), readField<uint32_t>(Ptr));
+  Ptr += 16; // timestamp, flags
+
+  // Expect the line table, then the code, then the close record.
+  std::vector<uint32_t> Records;
+  while (Ptr + 16 <= End) {
+    const char *Record = Ptr;
+    uint32_t Id = readField<uint32_t>(Ptr);
+    uint32_t Size = readField<uint32_t>(Ptr);
+    readField<uint64_t>(Ptr); // timestamp
+    ASSERT_LE(16u, Size);
+    ASSERT_TRUE(Record + Size <= End);
+    Records.push_back(Id);
+
+    if (Id == 2) { // JIT_CODE_DEBUG_INFO
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(Code), readField<uint64_t>(Ptr));
+      uint64_t Entries = readField<uint64_t>(Ptr);
+      EXPECT_LE(1u, Entries);
+      readField<uint64_t>(Ptr); // address
+      EXPECT_EQ(int32_t(getLine()), readField<int32_t>(Ptr));
+      readField<int32_t>(Ptr); // discriminator
+      EXPECT_STREQ(getFilename(), Ptr);
+    } else if (Id == 0) { // JIT_CODE_LOAD
+      readField<uint32_t>(Ptr); // pid
+      readField<uint32_t>(Ptr); // tid
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(Code), readField<uint64_t>(Ptr));
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(Code), readField<uint64_t>(Ptr));
+      uint64_t CodeSize = readField<uint64_t>(Ptr);
+      EXPECT_EQ(0u, readField<uint64_t>(Ptr)); // code_index
+      EXPECT_STREQ("id", Ptr);
+      Ptr += 3;
+      ASSERT_EQ(Record + Size, Ptr + CodeSize);
+      EXPECT_EQ(0, memcmp(Ptr, Code, CodeSize));
+    }
+    Ptr = Record + Size;
+  }
+  EXPECT_EQ(End, Ptr);
+
+  ASSERT_EQ(3u, Records.size());
+  EXPECT_EQ(2u, Records[0]);
+  EXPECT_EQ(0u, Records[1]);
+  EXPECT_EQ(3u, Records[2]);
+}
+
+}  // anonymous namespace
+
+testing::Environment* const perf_jit_env =
+  testing::AddGlobalTestEnvironment(new JITEnvironment);
+
+#endif // LLVM_ON_UNIX
@@ -0,0 +1,130 @@
+//===- GDBRegistrarTest.cpp - Unit tests for the GDB JIT interface --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These tests load objects with MCJIT and check what the GDB JIT interface
+// shows a debugger.  No debugger is attached while they run, so registration
+// is deferred until RuntimeDyld::registerObjectsWithDebugger is called.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JITMemoryManager.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+
+using namespace llvm;
+
+// The debugger's view of the registered objects.  This must be kept in sync
+// with gdb/gdb/jit.h and lib/ExecutionEngine/RuntimeDyld/GDBRegistrar.cpp.
+extern "C" {
+  struct jit_code_entry {
+    struct jit_code_entry *next_entry;
+    struct jit_code_entry *prev_entry;
+    const char *symfile_addr;
+    uint64_t symfile_size;
+  };
+
+  struct jit_descriptor {
+    uint32_t version;
+    uint32_t action_flag;
+    struct jit_code_entry *relevant_entry;
+    struct jit_code_entry *first_entry;
+  };
+
+  extern struct jit_descriptor __jit_debug_descriptor;
+}
+
+namespace {
+
+// Only Linux can tell cheaply whether a debugger is attached.  Elsewhere
+// objects are always registered right away.
+#ifdef __linux__
+
+unsigned countEntries() {
+  unsigned N = 0;
+  for (jit_code_entry *E = __jit_debug_descriptor.first_entry; E;
+       E = E->next_entry)
+    ++N;
+  return N;
+}
+
+class GDBRegistrarTest : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+  }
+
+  /// createEngine - Compile a module with a single function with MCJIT, which
+  /// loads it as an object and registers that with the debugger interface.
+  ExecutionEngine *createEngine() {
+    Module *M = new Module("gdb", Context);
+    SMDiagnostic Error;
+    EXPECT_TRUE(ParseAssemblyString("define i32 @f() { ret i32 42 }",
+                                    M, Error, Context) != 0);
+    std::string ErrorStr;
+    ExecutionEngine *EE = EngineBuilder(M)
+                          .setUseMCJIT(true)
+                          .setEngineKind(EngineKind::JIT)
+                          .setJITMemoryManager(
+                             JITMemoryManager::CreateDefaultMemManager())
+                          .setErrorStr(&ErrorStr)
+                          .create();
+    EXPECT_TRUE(EE != 0) << ErrorStr;
+    return EE;
+  }
+
+  LLVMContext Context;
+};
+
+// Publishing can't be undone, so everything that needs registration to be
+// deferred has to happen in this one test.
+TEST_F(GDBRegistrarTest, DefersUntilPublished) {
+  ASSERT_EQ(0U, countEntries());
+
+  // Objects are only queued while no debugger is attached.
+  OwningPtr<ExecutionEngine> Dropped(createEngine());
+  OwningPtr<ExecutionEngine> Kept(createEngine());
+  ASSERT_TRUE(Dropped.get() != 0 && Kept.get() != 0);
+  EXPECT_EQ(0U, countEntries());
+
+  // Deregistering a queued object leaves no entry, now or when the queue is
+  // published.
+  Dropped.reset();
+  EXPECT_EQ(0U, countEntries());
+
+  // Publishing hands over the queued object that is still loaded.
+  RuntimeDyld::registerObjectsWithDebugger();
+  ASSERT_EQ(1U, countEntries());
+  jit_code_entry *Entry = __jit_debug_descriptor.first_entry;
+  EXPECT_EQ(Entry, __jit_debug_descriptor.relevant_entry);
+  EXPECT_TRUE(Entry->symfile_addr != 0);
+  EXPECT_LT(0U, Entry->symfile_size);
+
+  // From now on objects are registered as they are loaded.
+  OwningPtr<ExecutionEngine> Later(createEngine());
+  ASSERT_TRUE(Later.get() != 0);
+  EXPECT_EQ(2U, countEntries());
+
+  Kept.reset();
+  Later.reset();
+  EXPECT_EQ(0U, countEntries());
+}
+
+#endif
+
+}
@@ -0,0 +1,289 @@
+//===- StatepointTest.cpp - Unit tests for statepoint stack maps ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// These tests run code compiled with the "statepoint" GC and act as its
+// collector: they find the caller's stack map record through the return
+// address, move the objects it lists, and check that the caller picks up the
+// new addresses.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/CodeGen/GCs.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JITMemoryManager.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetOptions.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace llvm;
+
+namespace {
+
+// The collector below reads the caller's frame through the frame pointer
+// chain, which needs a GCC-compatible compiler and the x86-64 frame layout.
+#if defined(__x86_64__) && defined(__GNUC__)
+
+bool LoadAssemblyInto(Module *M, const char *assembly) {
+  SMDiagnostic Error;
+  bool success =
+    NULL != ParseAssemblyString(assembly, M, Error, M->getContext());
+  std::string errMsg;
+  raw_string_ostream os(errMsg);
+  Error.print("", os);
+  EXPECT_TRUE(success) << os.str();
+  return success;
+}
+
+/// TestMemoryManager - Gives every section MCJIT loads its own block of
+/// memory.  MCJIT only allocates sections and looks up symbols through it.
+class TestMemoryManager : public JITMemoryManager {
+  SmallVector<sys::MemoryBlock, 4> CodeMem;
+  SmallVector<void*, 4> DataMem;
+
+public:
+  ~TestMemoryManager() {
+    for (unsigned i = 0, e = CodeMem.size(); i != e; ++i)
+      sys::Memory::ReleaseRWX(CodeMem[i]);
+    for (unsigned i = 0, e = DataMem.size(); i != e; ++i)
+      free(DataMem[i]);
+  }
+
+  virtual uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID) {
+    // RWX allocations are page aligned.
+    sys::MemoryBlock MB = sys::Memory::AllocateRWX(Size, 0, 0);
+    CodeMem.push_back(MB);
+    return (uint8_t*)MB.base();
+  }
+  virtual uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID) {
+    if (!Alignment)
+      Alignment = 16;
+    void *Addr = calloc((Size + Alignment - 1) / Alignment + 1, Alignment);
+    DataMem.push_back(Addr);
+    return (uint8_t*)(((uintptr_t)Addr + Alignment - 1) &
+                      ~(uintptr_t)(Alignment - 1));
+  }
+  virtual void *getPointerToNamedFunction(const std::string &Name,
+                                          bool AbortOnFailure = true) {
+    if (AbortOnFailure)
+      report_fatal_error("Unexpected external function '" + Name + "'");
+    return 0;
+  }
+
+  virtual void setMemoryWritable() { llvm_unreachable("Unexpected call!"); }
+  virtual void setMemoryExecutable() { llvm_unreachable("Unexpected call!"); }
+  virtual void setPoisonMemory(bool) { llvm_unreachable("Unexpected call!"); }
+  virtual void AllocateGOT() { llvm_unreachable("Unexpected call!"); }
+  virtual uint8_t *getGOTBase() const {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual uint8_t *startFunctionBody(const Function *, uintptr_t &) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual uint8_t *allocateStub(const GlobalValue *, unsigned, unsigned) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual void endFunctionBody(const Function *, uint8_t *, uint8_t *) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual uint8_t *allocateSpace(intptr_t, unsigned) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual uint8_t *allocateGlobal(uintptr_t, unsigned) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual void deallocateFunctionBody(void *) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual uint8_t *startExceptionTable(const Function *, uintptr_t &) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual void endExceptionTable(const Function *, uint8_t *, uint8_t *,
+                                 uint8_t *) {
+    llvm_unreachable("Unexpected call!");
+  }
+  virtual void deallocateExceptionTable(void *) {
+    llvm_unreachable("Unexpected call!");
+  }
+};
+
+// The DWARF numbers of the registers a location may be based on.
+const uint16_t DwarfRBP = 6;
+const uint16_t DwarfRSP = 7;
+
+// The state shared between a test and the collector it calls into.
+const uint8_t *StackMaps;
+int64_t FromSpace, ToSpace;
+unsigned NumRecordsFound, NumRelocated;
+
+template<typename T> T read(const uint8_t *&P) {
+  T V;
+  memcpy(&V, P, sizeof(T));
+  P += sizeof(T);
+  return V;
+}
+
+void alignTo(const uint8_t *&P, uintptr_t Align) {
+  P = (const uint8_t *)(((uintptr_t)P + Align - 1) & ~(Align - 1));
+}
+
+/// relocateFrame - Find the stack map record for the call that returns to
+/// RetAddr, and move every object it lists from FromSpace to ToSpace.
+/// CallerFP and CallerSP are the caller's %rbp and %rsp during the call.
+void relocateFrame(uintptr_t RetAddr, uint8_t *CallerFP, uint8_t *CallerSP) {
+  const uint8_t *P = StackMaps;
+  ASSERT_EQ(1, read<uint8_t>(P));
+  read<uint8_t>(P);
+  read<uint16_t>(P);
+  uint32_t NumFunctions = read<uint32_t>(P);
+  alignTo(P, sizeof(void*));
+
+  for (uint32_t i = 0; i != NumFunctions; ++i) {
+    uintptr_t FnAddr = read<uintptr_t>(P);
+    read<uint32_t>(P);                              // FrameSize
+    uint32_t NumRecords = read<uint32_t>(P);
+    for (uint32_t j = 0; j != NumRecords; ++j) {
+      read<uint32_t>(P);                            // ID
+      uint32_t ReturnOffset = read<uint32_t>(P);
+      read<uint16_t>(P);
+      uint16_t NumLocations = read<uint16_t>(P);
+      bool Match = FnAddr + ReturnOffset == RetAddr;
+      NumRecordsFound += Match;
+      for (uint16_t k = 0; k != NumLocations; ++k) {
+        uint8_t Kind = read<uint8_t>(P);
+        read<uint8_t>(P);
+        uint16_t Reg = read<uint16_t>(P);
+        int32_t Offset = read<int32_t>(P);
+        if (!Match)
+          continue;
+
+        // Only Indirect [Reg + Offset] locations are produced so far.
+        ASSERT_EQ(2, Kind);
+        uint8_t *Base = 0;
+        if (Reg == DwarfRBP)
+          Base = CallerFP;
+        else if (Reg == DwarfRSP)
+          Base = CallerSP;
+        ASSERT_TRUE(Base != 0) << "unexpected base register " << Reg;
+
+        int64_t **Slot = (int64_t **)(Base + Offset);
+        if (*Slot == &FromSpace) {
+          *Slot = &ToSpace;
+          ++NumRelocated;
+        }
+      }
+    }
+    alignTo(P, sizeof(void*));
+  }
+}
+
+/// collect - The target of the statepoint.  The caller's frame pointer was
+/// saved by our prologue, and its stack pointer is just above our return
+/// address.
+LLVM_ATTRIBUTE_NOINLINE void collect() {
+  uint8_t *Frame = (uint8_t *)__builtin_frame_address(0);
+  uint8_t *CallerFP = *(uint8_t **)Frame;
+  uint8_t *CallerSP = Frame + 2 * sizeof(void*);
+  relocateFrame((uintptr_t)__builtin_return_address(0), CallerFP, CallerSP);
+}
+
+class StatepointTest : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    linkStatepointGC();
+    linkStatepointGCPrinter();
+  }
+
+  virtual void SetUp() {
+    M = new Module("statepoint", Context);
+    StackMaps = 0;
+    FromSpace = 1;
+    ToSpace = 2;
+    NumRecordsFound = NumRelocated = 0;
+  }
+
+  /// createEngine - Compile M with MCJIT, so that the statepoint GC's stack
+  /// maps are emitted and loaded along with the code.
+  void createEngine() {
+    TargetOptions Options;
+    Options.NoFramePointerElim = true;
+    std::string Error;
+    EE.reset(EngineBuilder(M)
+             .setUseMCJIT(true)
+             .setEngineKind(EngineKind::JIT)
+             .setJITMemoryManager(new TestMemoryManager())
+             .setTargetOptions(Options)
+             .setErrorStr(&Error)
+             .create());
+    ASSERT_TRUE(EE.get() != 0) << Error;
+  }
+
+  LLVMContext Context;
+  Module *M;  // Owned by EE.
+  OwningPtr<ExecutionEngine> EE;
+};
+
+TEST_F(StatepointTest, RelocatesLiveFrame) {
+  ASSERT_TRUE(LoadAssemblyInto(M,
+    "declare i32 @llvm.gc.statepoint(i32, i8*, i32, ...) "
+    "declare i64* @llvm.gc.relocate.p0i64(i32, i32) "
+    "@__LLVM_StackMaps = external global i8 "
+    " "
+    "define i8* @stackmaps() { "
+    "  ret i8* @__LLVM_StackMaps "
+    "} "
+    " "
+    "define i64 @run(i64* %a, i64* %b, i8* %collect) gc \"statepoint\" { "
+    "  %tok = call i32 (i32, i8*, i32, ...)* @llvm.gc.statepoint(i32 1, "
+    "           i8* %collect, i32 0, i64* %a, i64* %b) "
+    "  %a.moved = call i64* @llvm.gc.relocate.p0i64(i32 %tok, i32 0) "
+    "  %b.moved = call i64* @llvm.gc.relocate.p0i64(i32 %tok, i32 1) "
+    "  %x = load i64* %a.moved "
+    "  %y = load i64* %b.moved "
+    "  %s = mul i64 %x, 10 "
+    "  %r = add i64 %s, %y "
+    "  ret i64 %r "
+    "} "));
+  createEngine();
+
+  typedef uint8_t *(*StackMapsFn)();
+  typedef int64_t (*RunFn)(int64_t *, int64_t *, void (*)());
+  StackMaps = ((StackMapsFn)(intptr_t)
+               EE->getPointerToFunction(M->getFunction("stackmaps")))();
+  RunFn Run = (RunFn)(intptr_t)EE->getPointerToFunction(M->getFunction("run"));
+  ASSERT_TRUE(StackMaps != 0);
+  ASSERT_TRUE(Run != 0);
+
+  // Both pointers start out in from-space; the collector moves them, and the
+  // code after the call reads the objects from to-space.
+  int64_t Result = Run(&FromSpace, &FromSpace, collect);
+  EXPECT_EQ(1U, NumRecordsFound);
+  EXPECT_EQ(2U, NumRelocated);
+  EXPECT_EQ(22, Result);
+}
+
+#endif
+
+}
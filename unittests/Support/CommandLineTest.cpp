@@ -55,6 +55,21 @@ TEST(CommandLineTest, ParseEnvironment) {
   EXPECT_EQ("hello", EnvironmentTestOption);
 }
 
+enum TestEnumKind { EnumA, EnumB };
+cl::opt<TestEnumKind> EnvironmentTestEnum(
+  cl::desc("Enum option named only by its values"), cl::init(EnumA),
+  cl::values(clEnumValN(EnumA, "env-test-enum-a", "A"),
+             clEnumValN(EnumB, "env-test-enum-b", "B"),
+             clEnumValEnd));
+TEST(CommandLineTest, ParseEnvironmentEnum) {
+  // Enum value names are only added to the option map when a named option is
+  // looked up; make sure they are still found.
+  TempEnvVar TEV(test_env_var, "-env-test-enum-b");
+  EXPECT_EQ(EnumA, EnvironmentTestEnum);
+  cl::ParseEnvironmentOptions("CommandLineTest", test_env_var);
+  EXPECT_EQ(EnumB, EnvironmentTestEnum);
+}
+
 #endif  // SKIP_ENVIRONMENT_TESTS
 
 }  // anonymous namespace
@@ -0,0 +1,112 @@
+//===- llvm/unittest/Support/CompressionTest.cpp - LZ77 tests -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/Compression.h"
+#include <string>
+using namespace llvm;
+
+namespace {
+
+std::string roundTrip(StringRef Input, size_t &CompressedSize,
+                      StringRef Dictionary = StringRef()) {
+  SmallVector<char, 256> Compressed;
+  lz77::compress(Input, Compressed, Dictionary);
+  CompressedSize = Compressed.size();
+  std::string Output(Input.size(), '\0');
+  if (lz77::decompress(StringRef(Compressed.data(), Compressed.size()),
+                       &Output[0], Output.size(), Dictionary))
+    return "<error>";
+  return Output;
+}
+
+TEST(CompressionTest, Empty) {
+  size_t Size;
+  SmallVector<char, 4> Compressed;
+  lz77::compress("", Compressed);
+  EXPECT_EQ(0U, Compressed.size());
+  char Out;
+  EXPECT_FALSE(lz77::decompress("", &Out, 0));
+  EXPECT_EQ("", roundTrip("", Size));
+}
+
+TEST(CompressionTest, Short) {
+  size_t Size;
+  EXPECT_EQ("a", roundTrip("a", Size));
+  EXPECT_EQ("abcd", roundTrip("abcd", Size));
+  EXPECT_EQ("abcdabcd", roundTrip("abcdabcd", Size));
+}
+
+TEST(CompressionTest, Repetitive) {
+  std::string Input;
+  for (unsigned i = 0; i != 1000; ++i)
+    Input += "define i32 @f(i32 %x) {";
+  size_t Size;
+  EXPECT_EQ(Input, roundTrip(Input, Size));
+  EXPECT_GT(Input.size() / 20, Size);
+
+  // A run of one byte is encoded as a single overlapping match.
+  std::string Run(100000, 'x');
+  EXPECT_EQ(Run, roundTrip(Run, Size));
+  EXPECT_GT(1000U, Size);
+}
+
+TEST(CompressionTest, Incompressible) {
+  std::string Input;
+  uint32_t State = 1;
+  for (unsigned i = 0; i != 200000; ++i) {
+    State = State * 1103515245 + 12345;
+    Input += char(State >> 24);
+  }
+  size_t Size;
+  EXPECT_EQ(Input, roundTrip(Input, Size));
+  // Long literal runs cost little more than their length.
+  EXPECT_GT(Input.size() + Input.size() / 100, Size);
+}
+
+TEST(CompressionTest, Dictionary) {
+  std::string Dictionary;
+  for (unsigned i = 0; i != 100; ++i)
+    Dictionary += "store i32 %x, i32* %p, align 4\n";
+  StringRef Input = "  store i32 %x, i32* %p, align 4\n  ret void\n";
+
+  size_t Plain, WithDictionary;
+  EXPECT_EQ(Input, roundTrip(Input, Plain));
+  EXPECT_EQ(Input, roundTrip(Input, WithDictionary, Dictionary));
+  EXPECT_GT(Plain, WithDictionary);
+
+  // Matches into the dictionary cannot be resolved without it.
+  SmallVector<char, 64> Compressed;
+  lz77::compress(Input, Compressed, Dictionary);
+  std::string Output(Input.size(), '\0');
+  EXPECT_TRUE(lz77::decompress(StringRef(Compressed.data(), Compressed.size()),
+                               &Output[0], Output.size()));
+
+  // Only the last 64K of a large dictionary are used.
+  std::string Large = Input.str() + std::string(70000, ' ') + Dictionary;
+  EXPECT_EQ(Input, roundTrip(Input, WithDictionary, Large));
+}
+
+TEST(CompressionTest, Malformed) {
+  SmallVector<char, 64> Compressed;
+  lz77::compress("hello hello hello hello", Compressed);
+  StringRef Data(Compressed.data(), Compressed.size());
+  char Out[64];
+  // Wrong output size.
+  EXPECT_TRUE(lz77::decompress(Data, Out, 22));
+  EXPECT_TRUE(lz77::decompress(Data, Out, 24));
+  EXPECT_FALSE(lz77::decompress(Data, Out, 23));
+  // Truncated input.
+  EXPECT_TRUE(lz77::decompress(Data.drop_back(1), Out, 23));
+  // A match that reaches before the start of the output.
+  const char BadOffset[] = { 0x10, 'a', 0x05, 0x00 };
+  EXPECT_TRUE(lz77::decompress(StringRef(BadOffset, 4), Out, 5));
+}
+
+} // end anonymous namespace
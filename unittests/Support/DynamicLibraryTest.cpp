@@ -0,0 +1,93 @@
+//===- llvm/unittest/Support/DynamicLibraryTest.cpp - DynamicLibrary tests ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/DynamicLibrary.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace sys;
+
+// A symbol of the test program itself, so that overriding it can't change
+// what any other lookup in the process finds.
+extern "C" int DynamicLibraryTest_Library;
+int DynamicLibraryTest_Library;
+
+namespace {
+
+int ExplicitA;
+int ExplicitB;
+int Override;
+
+TEST(DynamicLibraryTest, ExplicitSymbols) {
+  DynamicLibrary::AddSymbol("DynamicLibraryTest_A", &ExplicitA);
+  EXPECT_EQ(&ExplicitA,
+            DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_A"));
+  EXPECT_EQ(0,
+            DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_Z"));
+}
+
+TEST(DynamicLibraryTest, BulkSearch) {
+  DynamicLibrary::AddSymbol("DynamicLibraryTest_A", &ExplicitA);
+  DynamicLibrary::AddSymbol("DynamicLibraryTest_B", &ExplicitB);
+
+  const char *Names[] = {
+    "DynamicLibraryTest_B", "DynamicLibraryTest_Z", "DynamicLibraryTest_A"
+  };
+  void *Addresses[3] = { 0, &Override, 0 };
+  DynamicLibrary::SearchForAddressOfSymbols(Names, Addresses);
+  EXPECT_EQ(&ExplicitB, Addresses[0]);
+  EXPECT_EQ(0, Addresses[1]);
+  EXPECT_EQ(&ExplicitA, Addresses[2]);
+}
+
+TEST(DynamicLibraryTest, LibrarySymbolsAreStable) {
+  // Load the program itself and look up a symbol twice; the second lookup
+  // comes from the cache and must agree with the first.
+  std::string Err;
+  ASSERT_TRUE(DynamicLibrary::getPermanentLibrary(0, &Err).isValid()) << Err;
+  void *First =
+    DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_Library");
+  ASSERT_NE((void*)0, First);
+  void *Second =
+    DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_Library");
+  EXPECT_EQ(First, Second);
+
+  // Symbols added explicitly take precedence over cached library symbols.
+  DynamicLibrary::AddSymbol("DynamicLibraryTest_Library", &Override);
+  EXPECT_EQ(&Override,
+      DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_Library"));
+}
+
+#if defined(__linux__) && defined(__GLIBC__)
+TEST(DynamicLibraryTest, NewLibrariesAreSearched) {
+  // Fill the cache from the program itself.
+  std::string Err;
+  ASSERT_TRUE(DynamicLibrary::getPermanentLibrary(0, &Err).isValid()) << Err;
+  void *Cached =
+    DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_Library");
+  ASSERT_NE((void*)0, Cached);
+
+  // ns_initparse is only defined in libresolv, which the test program does
+  // not link against.  Once libresolv is loaded, the lookup must search it
+  // rather than answer from what was cached before.
+  EXPECT_EQ(0, DynamicLibrary::SearchForAddressOfSymbol("ns_initparse"));
+  DynamicLibrary Resolv =
+    DynamicLibrary::getPermanentLibrary("libresolv.so.2", &Err);
+  ASSERT_TRUE(Resolv.isValid()) << Err;
+  void *Found = DynamicLibrary::SearchForAddressOfSymbol("ns_initparse");
+  ASSERT_NE((void*)0, Found);
+  EXPECT_EQ(Resolv.getAddressOfSymbol("ns_initparse"), Found);
+
+  // Symbols found before the library was loaded are found again.
+  EXPECT_EQ(Cached,
+      DynamicLibrary::SearchForAddressOfSymbol("DynamicLibraryTest_Library"));
+}
+#endif
+
+} // end anonymous namespace